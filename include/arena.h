@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Bump allocator for per-command lifetime data.
+ *
+ * Allocations are carved out of large blocks and are never freed
+ * individually: the whole arena is released at once with arena_free().
+ */
+typedef struct arena_block arena_block_t;
+
+typedef struct {
+    arena_block_t *head;
+    size_t block_size;
+} arena_t;
+
+arena_t arena_init(size_t block_size);
+void arena_free(arena_t *arena);
+
+void* arena_alloc(arena_t *arena, size_t size);
+void* arena_calloc(arena_t *arena, size_t count, size_t size);
+void* arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+char* arena_strdup(arena_t *arena, const char *str);
+char* arena_strndup(arena_t *arena, const char *str, size_t len);
+char* arena_sprintf(arena_t *arena, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif // ARENA_H
@@ -0,0 +1,44 @@
+#ifndef BRANCH_SWITCH_H
+#define BRANCH_SWITCH_H
+
+#include <stdbool.h>
+
+#include "merge.h"
+#include "repository.h"
+
+/** How switch and checkout move to another commit. */
+typedef struct {
+    bool force;
+    bool merge;
+    merge_style_t style;
+    bool quiet;
+    bool detach;
+} branch_switch_options_t;
+
+/**
+ * Move the index and worktree from HEAD's tree, or the empty tree while
+ * HEAD is unborn, to that of commit `target`. Returns -1 after printing
+ * an error.
+ */
+int branch_switch_worktree(git_repository_t *repo, int target, const char *label,
+                           const branch_switch_options_t *opts);
+
+/**
+ * Switch to commit `target` and point HEAD at local `branch`, or detach
+ * it there when `branch` is NULL. `name` is what the user asked for.
+ * Returns the exit code.
+ */
+int branch_switch_to(git_repository_t *repo, const char *name, const char *branch, int target,
+                     const branch_switch_options_t *opts);
+
+/**
+ * Create `branch` at `start`, or reset it there when `reset` is set and
+ * it exists, then switch to it. The tree is switched before the ref is
+ * written, so a refused switch leaves no branch behind. With `track`, a
+ * remote-tracking `start` becomes the branch's upstream. Returns the
+ * exit code.
+ */
+int branch_switch_create(git_repository_t *repo, const char *branch, const char *start, bool reset, bool track,
+                         const branch_switch_options_t *opts);
+
+#endif // BRANCH_SWITCH_H
@@ -0,0 +1,12 @@
+#ifndef COMMIT_GRAPH_COMMANDS_H
+#define COMMIT_GRAPH_COMMANDS_H
+
+#include <argus/types.h>
+
+// External option declarations for commit-graph subcommands
+extern argus_option_t commit_graph_write_options[];
+
+// Subcommand handlers
+int commit_graph_write_handler(argus_t *argus, void *data);
+
+#endif // COMMIT_GRAPH_COMMANDS_H
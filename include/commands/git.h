@@ -9,6 +9,9 @@ extern argus_option_t add_options[];
 extern argus_option_t commit_options[];
 extern argus_option_t status_options[];
 extern argus_option_t log_options[];
+extern argus_option_t shortlog_options[];
+extern argus_option_t describe_options[];
+extern argus_option_t merge_base_options[];
 extern argus_option_t branch_options[];
 extern argus_option_t pull_options[];
 extern argus_option_t fetch_options[];
@@ -20,6 +23,8 @@ extern argus_option_t switch_options[];
 extern argus_option_t remote_options[];
 extern argus_option_t config_options[];
 extern argus_option_t stash_options[];
+extern argus_option_t sparse_checkout_options[];
+extern argus_option_t commit_graph_options[];
 
 // Command handlers
 int init_handler(argus_t *argus, void *data);
@@ -27,6 +32,9 @@ int add_handler(argus_t *argus, void *data);
 int commit_handler(argus_t *argus, void *data);
 int status_handler(argus_t *argus, void *data);
 int log_handler(argus_t *argus, void *data);
+int shortlog_handler(argus_t *argus, void *data);
+int describe_handler(argus_t *argus, void *data);
+int merge_base_handler(argus_t *argus, void *data);
 int branch_handler(argus_t *argus, void *data);
 int pull_handler(argus_t *argus, void *data);
 int fetch_handler(argus_t *argus, void *data);
@@ -38,5 +46,7 @@ int switch_handler(argus_t *argus, void *data);
 int remote_handler(argus_t *argus, void *data);
 int config_handler(argus_t *argus, void *data);
 int stash_handler(argus_t *argus, void *data);
+int sparse_checkout_handler(argus_t *argus, void *data);
+int commit_graph_handler(argus_t *argus, void *data);
 
 #endif // GIT_H
\ No newline at end of file
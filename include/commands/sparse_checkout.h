@@ -0,0 +1,21 @@
+#ifndef SPARSE_CHECKOUT_COMMANDS_H
+#define SPARSE_CHECKOUT_COMMANDS_H
+
+#include <argus/types.h>
+
+// External option declarations for sparse-checkout subcommands
+extern argus_option_t sparse_checkout_init_options[];
+extern argus_option_t sparse_checkout_set_options[];
+extern argus_option_t sparse_checkout_add_options[];
+extern argus_option_t sparse_checkout_list_options[];
+
+// Subcommand handlers
+int sparse_checkout_init_handler(argus_t *argus, void *data);
+int sparse_checkout_set_handler(argus_t *argus, void *data);
+int sparse_checkout_add_handler(argus_t *argus, void *data);
+int sparse_checkout_list_handler(argus_t *argus, void *data);
+
+// Shared by set and add
+int sparse_checkout_add_directories(argus_t *argus, void *data);
+
+#endif // SPARSE_CHECKOUT_COMMANDS_H
@@ -0,0 +1,83 @@
+#ifndef COMMIT_GRAPH_H
+#define COMMIT_GRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "repository.h"
+
+#define BLOOM_NUM_HASHES        7
+#define BLOOM_BITS_PER_ENTRY    10
+#define BLOOM_MAX_CHANGED_PATHS 512
+
+typedef struct {
+    uint32_t hashes[BLOOM_NUM_HASHES];
+} bloom_key_t;
+
+/**
+ * Changed-path Bloom filter of one commit, holding every file it changed
+ * against its first parent and every directory above one. A commit that
+ * changed more than BLOOM_MAX_CHANGED_PATHS paths gets a single all-set
+ * byte, which rules nothing out.
+ */
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+} bloom_filter_t;
+
+/**
+ * Walk data computed once for the history and kept with the repository,
+ * indexed like `repo->commits`. A commit's generation is one more than
+ * the highest of its parents', so a commit never reaches one of a higher
+ * generation. `filters` point into the mapped commit-graph file and stay
+ * NULL until changed paths are first asked for, or when the file has none.
+ */
+struct commit_graph {
+    uint32_t *generations;
+    bloom_filter_t *filters;
+    int commit_count;
+    bool changed_paths_read;
+    const unsigned char *map;
+    size_t map_size;
+};
+
+/**
+ * The repository's commit graph, written on first use. NULL when
+ * `core.commitGraph` is off.
+ */
+const commit_graph_t* commit_graph_open(git_repository_t *repo);
+
+/**
+ * The commit graph with the changed-path filters read from
+ * `$GIT_DIR/objects/info/commit-graph`. Nothing is computed here: NULL when
+ * no file holds filters, or `commitGraph.readChangedPaths` is off, and
+ * callers diff trees instead.
+ */
+const commit_graph_t* commit_graph_open_changed_paths(git_repository_t *repo);
+
+/**
+ * Write the history to `$GIT_DIR/objects/info/commit-graph` in git's
+ * format. With `changed_paths` each commit's filter is computed too, by
+ * diffing commits on `commitGraph.workers` threads (0, the default, means
+ * one per core). Returns 0, or -1 with errno set.
+ */
+int commit_graph_write(git_repository_t *repo, bool changed_paths);
+
+/** Unmap the file behind the graph's filters, if one was read. */
+void commit_graph_close(commit_graph_t *graph);
+
+/**
+ * Keys for `path` and each directory above it, all of which a filter
+ * must hold for the commit to have touched the path. Returns the count.
+ */
+size_t bloom_keys_for_path(arena_t *arena, const char *path, bloom_key_t **keys);
+
+/**
+ * Whether the commit at `pos` may have changed the path behind `keys`
+ * against its first parent. False means it certainly did not.
+ */
+bool commit_graph_maybe_changed(const commit_graph_t *graph, int pos, const bloom_key_t *keys, size_t count);
+
+#endif // COMMIT_GRAPH_H
@@ -0,0 +1,63 @@
+#ifndef COMMIT_GREP_H
+#define COMMIT_GREP_H
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+typedef enum {
+    COMMIT_GREP_AUTHOR,
+    COMMIT_GREP_COMMITTER,
+    COMMIT_GREP_MESSAGE,
+} commit_grep_field_t;
+
+/**
+ * A pattern with no regex metacharacters is searched for as a literal,
+ * 16 bytes at a time where SSE2 is there; `literal` is then set, folded
+ * to lower case when matching ignores case. Others are compiled to
+ * `regex`.
+ */
+typedef struct {
+    commit_grep_field_t field;
+    const char *literal;
+    size_t len;
+    regex_t regex;
+} commit_grep_pattern_t;
+
+/**
+ * Filters for `log --grep`, `--author` and `--committer`, run on raw
+ * commit objects. A commit is kept when one of the author patterns
+ * matches its author and one of the committer patterns its committer, and
+ * when one of the message patterns matches its message, or all of them
+ * with `all_match`. `invert` keeps the commits whose message the message
+ * patterns reject instead. `fields` has a bit set for each field that
+ * has patterns.
+ */
+typedef struct {
+    arena_t *arena;
+    commit_grep_pattern_t *patterns;
+    size_t count;
+    size_t alloc;
+    unsigned fields;
+    bool ignore_case;
+    bool all_match;
+    bool invert;
+    const char *error;
+} commit_grep_t;
+
+commit_grep_t commit_grep_init(arena_t *arena, bool ignore_case);
+
+/**
+ * Add a basic regular expression for `field`. Returns -1, with `error`
+ * describing why, if it does not compile.
+ */
+int commit_grep_add(commit_grep_t *grep, commit_grep_field_t field, const char *pattern);
+
+/** Whether the commit object in `buffer` passes every filter. */
+bool commit_grep_match(const commit_grep_t *grep, const char *buffer, size_t size);
+
+void commit_grep_free(commit_grep_t *grep);
+
+#endif // COMMIT_GREP_H
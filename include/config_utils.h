@@ -0,0 +1,13 @@
+#ifndef CONFIG_UTILS_H
+#define CONFIG_UTILS_H
+
+#include <stdbool.h>
+
+#include "git_context.h"
+
+void config_set_override(git_context_t *ctx, const char *key, const char *value);
+const char* config_get(git_context_t *ctx, const char *key, const char *fallback);
+int config_get_int(git_context_t *ctx, const char *key, int fallback);
+bool config_get_bool(git_context_t *ctx, const char *key, bool fallback);
+
+#endif // CONFIG_UTILS_H
@@ -0,0 +1,69 @@
+#ifndef DATE_H
+#define DATE_H
+
+#include <stdbool.h>
+
+#include "strbuf.h"
+
+#define DATE_ZONE_CACHE 64
+
+typedef enum {
+    DATE_NORMAL,
+    DATE_RELATIVE,
+    DATE_ISO,
+    DATE_ISO_STRICT,
+    DATE_RFC,
+    DATE_SHORT,
+    DATE_RAW,
+    DATE_UNIX,
+    DATE_STRFTIME,
+} date_mode_type_t;
+
+/**
+ * How `--date` shows a timestamp. `local` shows it in the local zone
+ * rather than the one it was recorded in; `strftime_format` is the
+ * pattern of DATE_STRFTIME.
+ */
+typedef struct {
+    date_mode_type_t type;
+    const char *strftime_format;
+    bool local;
+} date_mode_t;
+
+/**
+ * Formats timestamps in one mode. Local times need the zone offset in
+ * effect, which only localtime_r() knows; `zone_days` caches it per UTC
+ * day, so a log's worth of dates asks about each day once. A day holding
+ * a zone change caches INT_MIN and asks per timestamp.
+ */
+typedef struct {
+    date_mode_t mode;
+    long long now;
+    long long zone_days[DATE_ZONE_CACHE];
+    int zone_offsets[DATE_ZONE_CACHE];
+} date_formatter_t;
+
+/**
+ * Parse a `--date` mode: default, relative, local, iso (iso8601),
+ * iso-strict (iso8601-strict), rfc (rfc2822), short, raw, unix or
+ * format:<strftime>, any but the last with a "-local" suffix. Returns -1
+ * for anything else.
+ */
+int date_mode_parse(const char *text, date_mode_t *mode);
+
+/**
+ * Parse a date as `--since` and `--until` take it: git's own format,
+ * RFC 2822, ISO 8601 ("2024-01-15", "2024-01-15 10:30[:45]", with a "T"
+ * and a zone optionally), "@<seconds>", "now", "yesterday" or
+ * "<n> <unit>s ago". Dates without a zone are in the local zone, or in
+ * UTC unless `local`. Stores the time and, in minutes east of UTC, the
+ * zone it was given in. Returns -1 if `text` is none of these.
+ */
+int date_parse(const char *text, long long now, bool local, long long *time, int *tz);
+
+date_formatter_t date_formatter_init(date_mode_t mode, long long now);
+
+/** Append `time`, recorded `tz` minutes east of UTC, as the mode shows it. */
+void date_format(date_formatter_t *formatter, long long time, int tz, strbuf_t *out);
+
+#endif // DATE_H
@@ -0,0 +1,67 @@
+#ifndef DECORATE_H
+#define DECORATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "oid.h"
+#include "repository.h"
+#include "strbuf.h"
+
+typedef enum {
+    DECORATION_HEAD,
+    DECORATION_LOCAL,
+    DECORATION_REMOTE,
+    DECORATION_TAG,
+} decoration_type_t;
+
+/** A ref naming a commit, `name` in full; the next names the same one. */
+typedef struct decoration {
+    const char *name;
+    decoration_type_t type;
+    const struct decoration *next;
+} decoration_t;
+
+/** A commit some ref names, with the first of those refs. */
+typedef struct {
+    git_oid_t oid;
+    const decoration_t *first;
+} decoration_entry_t;
+
+/** Entry number `entry`, from 1, and more bits of its name to check first. */
+typedef struct {
+    uint32_t check;
+    uint32_t entry;
+} decoration_slot_t;
+
+/**
+ * The refs of a repository by the commit they name, tags peeled, for
+ * `log --decorate`. `slots` is an open-addressing table over `entries`,
+ * sized for every ref up front so that building it never rehashes. Its
+ * slots are small, and an entry is only read when its check bits agree,
+ * so the many commits that no ref names cost a single probe. `head_ref`
+ * is the full name of the checked-out branch, NULL when HEAD is detached.
+ */
+typedef struct {
+    decoration_slot_t *slots;
+    size_t capacity;
+    decoration_entry_t *entries;
+    size_t entry_count;
+    const char *head_ref;
+} decoration_map_t;
+
+decoration_map_t decoration_map_build(const git_repository_t *repo, arena_t *arena);
+
+/** The refs naming `oid`, HEAD first and the rest in reverse order of name, or NULL. */
+const decoration_t* decoration_lookup(const decoration_map_t *map, const git_oid_t *oid);
+
+/**
+ * Append " (HEAD -> main, tag: v1.0, origin/main)" for the refs naming
+ * `oid`, with `full` names rather than short ones. Appends nothing for a
+ * commit no ref names.
+ */
+void decoration_format(const decoration_map_t *map, const git_oid_t *oid, bool full, strbuf_t *out);
+
+#endif // DECORATE_H
@@ -0,0 +1,79 @@
+#ifndef DESCRIBE_H
+#define DESCRIBE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "oid.h"
+#include "repository.h"
+
+// Each candidate marks the commits it reaches with a bit of its own
+#define DESCRIBE_MAX_CANDIDATES 27
+
+/**
+ * The tag that names `commit`, short name and all. `date` is an annotated
+ * tag's tagger date, which picks the newest of several on one commit; it
+ * is 0 for a lightweight tag.
+ */
+typedef struct {
+    git_oid_t commit;
+    const char *name;
+    long long date;
+    bool annotated;
+} describe_name_t;
+
+/**
+ * The tags of a repository by the commit they name, one each, in an
+ * open-addressing table over `entries`. Where several tags name a
+ * commit, an annotated tag wins over a lightweight one, then the newer
+ * annotated tag, then the first by name, as in Git. `slots` hold entry
+ * numbers, from 1.
+ */
+typedef struct {
+    describe_name_t *entries;
+    size_t count;
+    uint32_t *slots;
+    size_t capacity;
+} describe_names_t;
+
+/**
+ * `tags` lets lightweight tags describe a commit as well. `candidates` is
+ * how many tags the walk collects before it settles on the nearest; 0
+ * accepts only a tag on the commit itself.
+ */
+typedef struct {
+    bool tags;
+    int candidates;
+} describe_options_t;
+
+/**
+ * The tag a commit is described by and how many commits it has that the
+ * tag does not, 0 for the tag's own commit. `unannotated` records that
+ * lightweight tags were passed over on the way.
+ */
+typedef struct {
+    const describe_name_t *name;
+    int depth;
+    bool unannotated;
+} describe_result_t;
+
+describe_names_t describe_names_build(const git_repository_t *repo, arena_t *arena);
+
+/** The tag naming `oid`, or NULL. */
+const describe_name_t* describe_names_lookup(const describe_names_t *names, const git_oid_t *oid);
+
+/**
+ * Find the nearest tag to the commit at `pos`, as `git describe` does:
+ * walk its history by date, counting for each tag met the commits that
+ * do not reach it, and keep the tag with the fewest. The walk stops as
+ * soon as everything left to walk reaches the best tag so far, since no
+ * later tag could come out closer, rather than running to the end of the
+ * history or the candidate limit. Returns -1, with `out->name` NULL, if
+ * no tag describes the commit.
+ */
+int describe_commit(git_repository_t *repo, const describe_names_t *names, int pos, const describe_options_t *opts,
+                    describe_result_t *out);
+
+#endif // DESCRIBE_H
@@ -0,0 +1,72 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "git_context.h"
+#include "line_diff.h"
+#include "object_store.h"
+#include "strbuf.h"
+#include "tree_diff.h"
+
+typedef enum {
+    DIFF_FORMAT_PATCH = 1 << 0,
+    DIFF_FORMAT_STAT = 1 << 1,
+    DIFF_FORMAT_NUMSTAT = 1 << 2,
+    DIFF_FORMAT_SHORTSTAT = 1 << 3,
+    DIFF_FORMAT_NAME_ONLY = 1 << 4,
+    DIFF_FORMAT_NAME_STATUS = 1 << 5,
+} diff_format_t;
+
+typedef enum {
+    DIFF_DETECT_NONE,
+    DIFF_DETECT_RENAMES,
+    DIFF_DETECT_COPIES,
+} diff_detect_t;
+
+typedef struct {
+    diff_algorithm_t algorithm;
+    unsigned int format;
+    int context;
+    int stat_width;
+    diff_detect_t detect;
+    int rename_score;
+    int rename_limit;
+    git_pathspec_t pathspec;
+} diff_options_t;
+
+/**
+ * Line counts of one changed file. Stat formats only need these, so they
+ * never produce patch text. `name` is how they show the file, which is
+ * "dir/{old => new}" for renames and copies.
+ */
+typedef struct {
+    const git_diff_entry_t *entry;
+    const char *name;
+    int added;
+    int deleted;
+    bool binary;
+    size_t old_size;
+    size_t new_size;
+} diff_file_stat_t;
+
+diff_algorithm_t diff_algorithm_from_config(git_context_t *ctx, const char *name);
+
+/**
+ * Options from `diff.algorithm`, `diff.renames` and `diff.renameLimit`,
+ * with three lines of context and a 50% rename similarity threshold.
+ */
+diff_options_t diff_options_init(git_context_t *ctx);
+
+/**
+ * Format a tree diff in every format set in `opts->format`, appending to
+ * `out`. Blobs are only read when a stat or patch format needs them, and
+ * all files share one line-intern table allocated from `arena`. Returns
+ * -1 if a blob is missing.
+ */
+int diff_output(const git_odb_t *odb, arena_t *arena, const git_diff_list_t *diff, const diff_options_t *opts,
+                strbuf_t *out);
+
+#endif // DIFF_H
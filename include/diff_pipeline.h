@@ -0,0 +1,36 @@
+#ifndef DIFF_PIPELINE_H
+#define DIFF_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "diff.h"
+#include "repository.h"
+#include "strbuf.h"
+
+/**
+ * Produces the trees of the i-th diff of a sequence, or returns false
+ * once the sequence is exhausted. A NULL `old_tree` stands for the empty
+ * tree.
+ */
+typedef bool (*diff_pipeline_next_fn)(void *data, size_t i, const git_oid_t **old_tree,
+                                      const git_oid_t **new_tree);
+
+/** Receives the formatted i-th diff, always in sequence order. */
+typedef int (*diff_pipeline_emit_fn)(void *data, size_t i, const strbuf_t *diff);
+
+/**
+ * Diff a sequence of tree pairs on a worker pool. The calling thread
+ * produces pairs and emits results; workers tree-diff and format up to a
+ * window of pairs ahead of the emitter, each into its own arena, so the
+ * output is identical to running the sequence one pair at a time.
+ *
+ * Worker count comes from `log.workers` (0, the default, means one per
+ * core); sequences of diffs that need no blob reads run inline. Stops at
+ * the first emit returning non-zero and returns that value, or -1 if an
+ * object is missing.
+ */
+int diff_pipeline_run(git_repository_t *repo, const diff_options_t *opts, diff_pipeline_next_fn next,
+                      diff_pipeline_emit_fn emit, void *data);
+
+#endif // DIFF_PIPELINE_H
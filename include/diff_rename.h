@@ -0,0 +1,20 @@
+#ifndef DIFF_RENAME_H
+#define DIFF_RENAME_H
+
+#include "diff.h"
+#include "object_store.h"
+#include "tree_diff.h"
+
+/**
+ * Pair added files of `diff` with deleted ones as renames, and with
+ * DIFF_DETECT_COPIES also with modified ones as copies. The paired entry
+ * takes the added file's place and a renamed source is dropped.
+ *
+ * Identical blobs are paired first. Of the rest, files whose basename is
+ * unique on both sides are tried against each other, then every remaining
+ * pair is scored by shared content, unless there are more than
+ * `rename_limit` squared of them. Returns -1 if a blob is missing.
+ */
+int diff_detect_renames(const git_odb_t *odb, git_diff_list_t *diff, const diff_options_t *opts);
+
+#endif // DIFF_RENAME_H
@@ -0,0 +1,23 @@
+#ifndef GIT_CONTEXT_H
+#define GIT_CONTEXT_H
+
+#include "arena.h"
+#include "git_types.h"
+
+/**
+ * Per-invocation state handed to every command handler as the `data`
+ * argument of argus_exec(). It is created after argus_parse() and released
+ * right next to argus_free(), so handlers never free what they allocate
+ * from the arena.
+ */
+typedef struct {
+    arena_t arena;
+    git_config_entry_t *config_overrides;
+    int config_override_count;
+    struct git_repository *repo;
+} git_context_t;
+
+git_context_t git_context_init(void);
+void git_context_free(git_context_t *ctx);
+
+#endif // GIT_CONTEXT_H
@@ -9,6 +9,7 @@ typedef struct {
     const char *author;
     const char *date;
     const char *email;
+    const char *parents[2];
 } git_commit_t;
 
 typedef struct {
@@ -18,6 +19,17 @@ typedef struct {
     const char *type;
 } git_branch_t;
 
+/**
+ * A tag on commit `hash`. An annotated tag has a `message` and a `tagger`,
+ * "Name <email>"; a lightweight one has neither.
+ */
+typedef struct {
+    const char *name;
+    const char *hash;
+    const char *message;
+    const char *tagger;
+} git_tag_t;
+
 typedef struct {
     const char *filename;
     const char *status;
@@ -37,8 +49,32 @@ typedef struct {
     const char *description;
     const char *branch;
     const char *timestamp;
+    const char *base;
 } git_stash_entry_t;
 
+typedef struct {
+    const char *path;
+    const char *content;
+} git_tree_file_t;
+
+typedef struct {
+    long long mtime;
+    long long ctime;
+    unsigned long long size;
+    unsigned long ino;
+} git_stat_data_t;
+
+typedef struct {
+    const char *path;
+    const char *content;
+    git_stat_data_t stat;
+} git_worktree_file_t;
+
+typedef struct {
+    const char *path;
+    git_stat_data_t stat;
+} git_index_stat_t;
+
 typedef struct {
     const char *key;
     const char *value;
@@ -0,0 +1,71 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "git_types.h"
+#include "object_store.h"
+#include "oid.h"
+
+#define GIT_MODE_FILE 0100644
+#define GIT_MODE_DIR  040000
+
+typedef struct {
+    const char *path;
+    git_oid_t oid;
+    unsigned int mode;
+    git_stat_data_t stat;
+    bool skip_worktree;
+} git_index_entry_t;
+
+/**
+ * Cache-tree index extension: one node per directory recording the tree
+ * object name and how many index entries it covers. An entry_count of -1
+ * marks a directory whose tree must be rebuilt.
+ */
+typedef struct cache_tree cache_tree_t;
+
+struct cache_tree {
+    const char *name;
+    size_t name_len;
+    int entry_count;
+    git_oid_t oid;
+    cache_tree_t **subtrees;
+    int subtree_count;
+};
+
+/**
+ * Entries are kept sorted by path, which is also the order in which
+ * their tree objects list them. `timestamp` is when the index was last
+ * written: entries modified at or after it cannot be trusted from their
+ * stat data alone (the racy-git problem). A `sparse` index may hold
+ * directory entries ("dir/", GIT_MODE_DIR) standing for a whole tree
+ * outside the sparse-checkout cone.
+ */
+typedef struct {
+    arena_t *arena;
+    git_index_entry_t *entries;
+    size_t count;
+    size_t alloc;
+    long long timestamp;
+    cache_tree_t *cache_tree;
+    bool sparse;
+} git_index_t;
+
+git_index_t index_init(arena_t *arena);
+git_index_t index_clone(const git_index_t *src);
+long index_find(const git_index_t *index, const char *path);
+git_index_entry_t* index_add(git_index_t *index, const char *path, const git_oid_t *oid, unsigned int mode);
+bool index_remove(git_index_t *index, const char *path);
+bool index_entry_is_sparse_dir(const git_index_entry_t *entry);
+bool index_entry_stat_matches(const git_index_entry_t *entry, const git_stat_data_t *st);
+bool index_entry_is_racy(const git_index_t *index, const git_index_entry_t *entry);
+
+cache_tree_t* cache_tree_new(arena_t *arena, const char *name, size_t name_len);
+cache_tree_t* cache_tree_subtree(const cache_tree_t *tree, const char *name, size_t name_len);
+void cache_tree_invalidate_path(cache_tree_t *tree, const char *path);
+int cache_tree_update(git_index_t *index, git_odb_t *odb);
+
+#endif // INDEX_H
@@ -0,0 +1,75 @@
+#ifndef LINE_DIFF_H
+#define LINE_DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+typedef enum {
+    DIFF_ALGORITHM_MYERS,
+    DIFF_ALGORITHM_PATIENCE,
+    DIFF_ALGORITHM_HISTOGRAM,
+} diff_algorithm_t;
+
+typedef struct {
+    const char *start;
+    size_t len;
+    uint64_t hash;
+    int id;
+} line_intern_slot_t;
+
+/**
+ * Lines are interned into a table shared by every file of one diff, so
+ * the diff algorithms compare integers instead of strings.
+ */
+typedef struct {
+    arena_t *arena;
+    line_intern_slot_t *slots;
+    size_t capacity;
+    size_t count;
+} line_intern_t;
+
+typedef struct {
+    const char *start;
+    size_t len;
+    int id;
+} diff_line_t;
+
+/**
+ * A file split into lines. Each line keeps its newline; only the last
+ * one may lack it.
+ */
+typedef struct {
+    diff_line_t *lines;
+    int count;
+} diff_file_t;
+
+/** A changed region, with 0-based line offsets into both files. */
+typedef struct {
+    int old_start;
+    int old_count;
+    int new_start;
+    int new_count;
+} diff_hunk_t;
+
+typedef struct {
+    arena_t *arena;
+    diff_hunk_t *hunks;
+    size_t count;
+    size_t alloc;
+} diff_hunk_list_t;
+
+void line_intern_init(line_intern_t *intern, arena_t *arena);
+void diff_file_load(diff_file_t *file, line_intern_t *intern, const char *data, size_t size);
+
+diff_hunk_list_t diff_hunk_list_init(arena_t *arena);
+/**
+ * Diff two files loaded into the same intern table, appending the changed
+ * regions to `out` in file order.
+ */
+void diff_lines(arena_t *arena, const diff_file_t *old_file, const diff_file_t *new_file,
+                diff_algorithm_t algorithm, diff_hunk_list_t *out);
+
+#endif // LINE_DIFF_H
@@ -0,0 +1,66 @@
+#ifndef LOG_GRAPH_H
+#define LOG_GRAPH_H
+
+#include "arena.h"
+#include "strbuf.h"
+
+typedef enum {
+    LOG_GRAPH_PADDING,
+    LOG_GRAPH_COMMIT,
+    LOG_GRAPH_POST_MERGE,
+    LOG_GRAPH_COLLAPSING,
+} log_graph_state_t;
+
+/**
+ * Streaming renderer for `log --graph`, drawing what git draws. Each lane
+ * is a column of the drawing that waits for one commit. `lane_of` maps a
+ * commit position to its lane in `next_lanes`, or -1, so placing a commit
+ * and its parents never searches the lanes. Only the open lanes are held,
+ * so rows come out as fast as commits go in.
+ *
+ * `mapping` holds, for each screen column of the row being drawn, the
+ * lane its line is headed for, or -1.
+ */
+typedef struct {
+    arena_t *arena;
+    int *lane_of;
+    int *lanes;
+    int lane_count;
+    int *next_lanes;
+    int next_count;
+    int lane_alloc;
+    int *mapping;
+    int *old_mapping;
+    int mapping_size;
+    int *parents;
+    int parent_count;
+    int commit;
+    int commit_index;
+    int prev_commit_index;
+    int width;
+    int merge_layout;
+    int edges_added;
+    int prev_edges_added;
+    log_graph_state_t state;
+    log_graph_state_t prev_state;
+} log_graph_t;
+
+log_graph_t log_graph_init(arena_t *arena, int commit_count);
+
+/**
+ * Start the commit at `pos`, whose shown parents are the distinct
+ * positions in `parents`, two at most as in this history. Rows the
+ * previous commit had no lines left for are written to `out` first.
+ */
+void log_graph_commit(log_graph_t *graph, int pos, const int *parents, int parent_count, strbuf_t *out);
+
+/**
+ * Append the graph prefix of the next output line: the commit row, then
+ * the rows that lead its lanes to their parents, then plain padding.
+ */
+void log_graph_prefix(log_graph_t *graph, strbuf_t *out);
+
+/** Write the rows still owed by the last commit as lines of their own. */
+void log_graph_flush(log_graph_t *graph, strbuf_t *out);
+
+#endif // LOG_GRAPH_H
@@ -0,0 +1,58 @@
+#ifndef MAILMAP_H
+#define MAILMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "repository.h"
+
+/**
+ * One line of a .mailmap: the identity `old_email`, or only its commits
+ * by `old_name` when that is set, shows as `name` and `email`. Either of
+ * those may be NULL to leave that half alone. `hash` is that of the key,
+ * folded to lower case.
+ */
+typedef struct {
+    const char *name;
+    const char *email;
+    const char *old_name;
+    const char *old_email;
+    uint64_t hash;
+} mailmap_entry_t;
+
+/**
+ * The identities of a .mailmap, in an open-addressing table keyed on the
+ * old email, or on it and the old name. Keys compare regardless of case,
+ * as in Git, and mailmap_map() hashes them as it reads them, so a lookup
+ * allocates nothing. `slots` hold entry numbers, from 1.
+ */
+typedef struct {
+    arena_t *arena;
+    mailmap_entry_t *entries;
+    size_t count;
+    size_t alloc;
+    uint32_t *slots;
+    size_t capacity;
+} mailmap_t;
+
+mailmap_t mailmap_init(arena_t *arena);
+
+/**
+ * Add the lines of a .mailmap file. A later line for the same identity
+ * fills in what it gives over what an earlier one said.
+ */
+void mailmap_add(mailmap_t *map, const char *text, size_t len);
+
+/** Read .mailmap at the top of the worktree and the file `mailmap.file` names. */
+void mailmap_read(mailmap_t *map, git_repository_t *repo);
+
+/**
+ * Replace an identity by the one the map gives it, if any: first by a
+ * line for both its name and its email, then by one for its email alone.
+ * The results point into the map. Returns whether anything changed.
+ */
+bool mailmap_map(const mailmap_t *map, const char **name, size_t *name_len, const char **email, size_t *email_len);
+
+#endif // MAILMAP_H
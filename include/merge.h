@@ -0,0 +1,84 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "git_context.h"
+#include "object_store.h"
+#include "oid.h"
+#include "repository.h"
+#include "strbuf.h"
+
+typedef enum {
+    MERGE_STYLE_MERGE,
+    MERGE_STYLE_DIFF3,
+    MERGE_STYLE_ZDIFF3,
+} merge_style_t;
+
+typedef struct {
+    const char *ancestor_label;
+    const char *ours_label;
+    const char *theirs_label;
+    merge_style_t style;
+} merge_options_t;
+
+typedef struct {
+    const char *data;
+    size_t size;
+} merge_buffer_t;
+
+typedef enum {
+    MERGE_CLEAN,
+    MERGE_CONFLICT_CONTENT,
+    MERGE_CONFLICT_ADD_ADD,
+    MERGE_CONFLICT_MODIFY_DELETE,
+} merge_conflict_t;
+
+/**
+ * Outcome for one path whose merged state differs from ours or which
+ * conflicted. `oid` names the content to leave in the worktree, conflict
+ * markers included.
+ */
+typedef struct {
+    const char *path;
+    git_oid_t oid;
+    unsigned int mode;
+    bool deleted;
+    bool auto_merged;
+    bool deleted_by_ours;
+    merge_conflict_t conflict;
+} merge_entry_t;
+
+typedef struct {
+    arena_t *arena;
+    merge_entry_t *entries;
+    size_t count;
+    size_t alloc;
+    int conflict_count;
+} merge_result_t;
+
+merge_style_t merge_style_from_config(git_context_t *ctx, const char *name);
+merge_result_t merge_result_init(arena_t *arena);
+
+/**
+ * Three-way merge of one file, appended to `out`. Returns the number of
+ * conflicting hunks written with markers.
+ */
+int merge_file(arena_t *arena, const merge_buffer_t *base, const merge_buffer_t *ours,
+               const merge_buffer_t *theirs, const merge_options_t *opts, strbuf_t *out);
+
+/**
+ * Three-way merge of trees, done entirely on objects: merged and
+ * conflicted blobs go to the object database and nothing touches the
+ * index or worktree until merge_result_apply(). A NULL base stands for
+ * the empty tree.
+ */
+int merge_trees(git_odb_t *odb, const git_oid_t *base, const git_oid_t *ours, const git_oid_t *theirs,
+                const merge_options_t *opts, merge_result_t *out);
+void merge_result_print(const merge_result_t *result, const merge_options_t *opts);
+int merge_check_local_changes(const git_repository_t *repo, const merge_result_t *result);
+int merge_result_apply(git_repository_t *repo, const merge_result_t *result);
+
+#endif // MERGE_H
@@ -0,0 +1,71 @@
+#ifndef MERGE_BASE_H
+#define MERGE_BASE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "repository.h"
+
+// Separate queries one paint walk answers together, one bit of paint each
+#define MERGE_BASE_BATCH 64
+
+/** Commit positions, best merge bases newest first unless said otherwise. */
+typedef struct {
+    int *commits;
+    size_t count;
+} merge_base_list_t;
+
+/**
+ * The merge bases of `one` and a merge of all of `twos`: their common
+ * ancestors that no other common ancestor reaches. Paints down from both
+ * sides, by generation when there is a commit graph and by date when not,
+ * and stops once nothing left to walk can be a merge base.
+ */
+merge_base_list_t merge_bases_many(git_repository_t *repo, int one, const int *twos, size_t count, arena_t *arena);
+
+/**
+ * The merge bases of `one` with each of `twos` apart, `out[i]` for
+ * `twos[i]`. Each query paints with a bit of its own and the paint from
+ * `one` is shared, so MERGE_BASE_BATCH queries cost a single walk instead
+ * of one each.
+ */
+void merge_bases_batch(git_repository_t *repo, int one, const int *twos, size_t count, arena_t *arena,
+                       merge_base_list_t *out);
+
+/**
+ * The merge bases of a merge of all of `commits`, as `merge-base
+ * --octopus` finds them: those of the first two, then of each of those
+ * with the third, and so on, with any that others reach left out.
+ */
+merge_base_list_t merge_bases_octopus(git_repository_t *repo, const int *commits, size_t count, arena_t *arena);
+
+/**
+ * `commits` without duplicates and without those that another of them
+ * reaches, in the order given.
+ */
+merge_base_list_t merge_base_independent(git_repository_t *repo, const int *commits, size_t count, arena_t *arena);
+
+/** Whether `ancestor` is reachable from `descendant`, or is it. */
+bool merge_base_is_ancestor(git_repository_t *repo, int ancestor, int descendant);
+
+/** How many commits each side of a pair has that the other does not. */
+typedef struct {
+    int ahead;
+    int behind;
+} ahead_behind_t;
+
+/**
+ * Count, for each pair, the commits `tips[i]` has that `bases[i]` does
+ * not as `out[i].ahead`, and the other way round as `out[i].behind`.
+ * One walk answers every pair: each distinct commit among them paints
+ * its history with a bit of its own. The walk goes by generation, so a
+ * commit's paint is settled before it is counted, and it stops once all
+ * queued commits carry every bit, as those count for no pair. Without a
+ * commit graph the generations of what the pairs reach are worked out
+ * first.
+ */
+void merge_base_ahead_behind(git_repository_t *repo, const int *tips, const int *bases, size_t count,
+                             ahead_behind_t *out);
+
+#endif // MERGE_BASE_H
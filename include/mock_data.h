@@ -8,7 +8,13 @@ const git_stash_entry_t* get_mock_stashes(int *count);
 const git_commit_t* get_mock_commits(int *count);
 const git_branch_t* get_mock_branches(int *count);
 const git_branch_t* get_mock_remote_branches(int *count);
+const git_tag_t* get_mock_tags(int *count);
 const git_file_status_t* get_mock_file_status(int *count);
 const git_config_entry_t* get_mock_config_entries(const char *scope, int *count);
+const git_tree_file_t* get_mock_commit_changes(const char *hash, int *count);
+const git_tree_file_t* get_mock_stash_changes(int index, int *count);
+const git_worktree_file_t* get_mock_worktree_files(int *count);
+const git_index_stat_t* get_mock_index_stats(int *count);
+long long get_mock_index_timestamp(void);
 
 #endif // MOCK_DATA_H
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef OBJECT_STORE_H
+#define OBJECT_STORE_H
+
+#include <stddef.h>
+
+#include "arena.h"
+#include "oid.h"
+
+typedef enum {
+    OBJ_BLOB,
+    OBJ_TREE,
+    OBJ_COMMIT,
+    OBJ_TAG,
+} git_object_type_t;
+
+typedef struct {
+    git_oid_t oid;
+    git_object_type_t type;
+    const char *data;
+    size_t size;
+} git_object_t;
+
+/**
+ * In-memory object database: an open-addressing hash table keyed on the
+ * object name. Object payloads live in the arena the store was created with.
+ */
+typedef struct {
+    arena_t *arena;
+    git_object_t **slots;
+    size_t capacity;
+    size_t count;
+} git_odb_t;
+
+git_odb_t odb_init(arena_t *arena);
+const git_object_t* odb_write(git_odb_t *odb, git_object_type_t type, const void *data, size_t size);
+const git_object_t* odb_read(const git_odb_t *odb, const git_oid_t *oid);
+const char* object_type_name(git_object_type_t type);
+
+#endif // OBJECT_STORE_H
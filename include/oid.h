@@ -0,0 +1,28 @@
+#ifndef OID_H
+#define OID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define GIT_OID_RAWSZ 20
+#define GIT_OID_HEXSZ 40
+
+typedef struct {
+    unsigned char id[GIT_OID_RAWSZ];
+} git_oid_t;
+
+/**
+ * Object names are the SHA-1 of "<type> <size>\0<data>", as in Git.
+ */
+void oid_hash_object(const char *type, const void *data, size_t len, git_oid_t *out);
+
+/** The SHA-1 of `data` alone, as the checksum trailing git's binary files. */
+void oid_hash_buffer(const void *data, size_t len, git_oid_t *out);
+void oid_to_hex(const git_oid_t *oid, char *out);
+
+/** Parse the first GIT_OID_HEXSZ characters of `hex`. Returns -1 if they are not all hex digits. */
+int oid_from_hex(const char *hex, git_oid_t *out);
+int oid_cmp(const git_oid_t *a, const git_oid_t *b);
+bool oid_is_zero(const git_oid_t *oid);
+
+#endif // OID_H
@@ -0,0 +1,60 @@
+#ifndef PARALLEL_CHECKOUT_H
+#define PARALLEL_CHECKOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "git_types.h"
+#include "merge.h"
+#include "oid.h"
+#include "repository.h"
+
+typedef struct {
+    const char *path;
+    git_oid_t oid;
+    unsigned int mode;
+    const git_object_t *blob;
+    char *buffer;
+    git_stat_data_t stat;
+} checkout_item_t;
+
+/**
+ * Checkout of a list of index entries. The main thread queues the entries
+ * and creates their directories, workers inflate and write the files
+ * concurrently, and the index stat data is refreshed in bulk at the end.
+ *
+ * Worker count comes from `checkout.workers` (0 means one per core);
+ * batches smaller than `checkout.thresholdForParallelism` run inline.
+ */
+typedef struct {
+    git_repository_t *repo;
+    checkout_item_t *items;
+    size_t count;
+    size_t alloc;
+} parallel_checkout_t;
+
+parallel_checkout_t parallel_checkout_init(git_repository_t *repo);
+void parallel_checkout_add(parallel_checkout_t *pc, const char *path, const git_oid_t *oid, unsigned int mode);
+int parallel_checkout_run(parallel_checkout_t *pc);
+
+typedef struct {
+    bool force;
+    bool merge;
+    merge_style_t style;
+    const char *old_label;
+    const char *new_label;
+} checkout_switch_options_t;
+
+/**
+ * Move the index and worktree from `old_tree` to `new_tree`, touching only
+ * the paths that differ between them. Unless `force` is set, the switch is
+ * refused when one of those paths carries local changes; with `merge`,
+ * locally modified files are instead merged with the new version, the
+ * result left in the worktree. A NULL `old_tree` stands for the empty
+ * tree, as when HEAD is unborn. Returns the number of paths updated, or -1
+ * after printing an error.
+ */
+int checkout_switch_tree(git_repository_t *repo, const git_oid_t *old_tree, const git_oid_t *new_tree,
+                         const checkout_switch_options_t *opts);
+
+#endif // PARALLEL_CHECKOUT_H
@@ -0,0 +1,140 @@
+#ifndef REFS_H
+#define REFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "oid.h"
+
+/**
+ * A ref, named in full. `oid` is the object it points at: for an
+ * annotated tag the tag object, with `peeled` the commit it names, as
+ * packed-refs records it. `peeled` is zero for every other ref. A ref
+ * read from packed-refs names itself in place in the file, so `name` is
+ * not NUL-terminated and runs `name_len` bytes.
+ */
+typedef struct {
+    const char *name;
+    size_t name_len;
+    git_oid_t oid;
+    git_oid_t peeled;
+} git_ref_t;
+
+/**
+ * The records of a packed-refs file, after its `# pack-refs with:`
+ * header: a `<hex> <name>` line per ref sorted by name, an annotated
+ * tag's followed by a `^<hex>` line with the commit it peels to. The file
+ * is mapped rather than read, and searched in place. `map` is what to
+ * unmap, NULL when the records live in an arena.
+ */
+typedef struct {
+    const char *data;
+    const char *end;
+    void *map;
+    size_t map_size;
+} packed_refs_t;
+
+typedef struct {
+    git_ref_t ref;
+    bool deleted;
+} loose_ref_t;
+
+/** A change to one ref: point `name` at `oid`, or delete it. */
+typedef struct {
+    const char *name;
+    git_oid_t oid;
+    git_oid_t peeled;
+    bool deleted;
+} ref_update_t;
+
+/** How reftables are written, from the `reftable.*` config. */
+typedef struct {
+    uint32_t block_size;
+    int restart_interval;
+    bool auto_compaction;
+} reftable_options_t;
+
+typedef struct reftable_stack reftable_stack_t;
+typedef struct reftable_iter reftable_iter_t;
+
+/**
+ * The refs of a repository, kept either by the files backend or in a
+ * reftable stack, `reftable` set for the latter. The files backend has
+ * packed-refs, and over it the loose refs, which win over a packed ref of
+ * the same name. A deleted loose ref hides the packed one. Both layers
+ * are sorted by name, so a single ref is found in O(log n) and the refs
+ * under a prefix stream out in order without sorting or copying.
+ */
+typedef struct {
+    arena_t *arena;
+    packed_refs_t packed;
+    loose_ref_t *loose;
+    size_t loose_count;
+    size_t loose_alloc;
+    reftable_stack_t *reftable;
+} ref_store_t;
+
+/** A walk over the refs whose names start with `prefix`, in name order. */
+typedef struct {
+    const ref_store_t *store;
+    const char *prefix;
+    size_t prefix_len;
+    const char *packed;
+    size_t loose;
+    reftable_iter_t *reftable;
+} ref_iter_t;
+
+/**
+ * Map the packed-refs file at `path`. A file whose header does not
+ * promise sorted records, as older writers left them, is sorted into
+ * `arena` instead. Returns -1 if the file cannot be read.
+ */
+int packed_refs_open(packed_refs_t *packed, const char *path, arena_t *arena);
+
+/** Records kept in memory, in packed-refs format, header and all. */
+void packed_refs_from_buffer(packed_refs_t *packed, const char *data, size_t size, arena_t *arena);
+
+void packed_refs_close(packed_refs_t *packed);
+
+ref_store_t ref_store_init(arena_t *arena);
+
+/**
+ * The refs of the repository at `git_dir`: its reftable stack if it has
+ * `reftable/tables.list`, and otherwise its packed-refs, if any, and the
+ * loose refs under `refs/`. Returns -1 if they cannot be read.
+ */
+int ref_store_open(ref_store_t *store, const char *git_dir, const reftable_options_t *options);
+
+void ref_store_close(ref_store_t *store);
+
+bool ref_store_lookup(const ref_store_t *store, const char *name, git_ref_t *out);
+
+/**
+ * Apply `updates` together: a single table for a reftable stack, loose
+ * refs for the files backend. Returns -1 if they cannot be written.
+ */
+int ref_store_commit(ref_store_t *store, const ref_update_t *updates, size_t count);
+
+/** Point `name` at `oid`; `peeled` may be NULL. */
+int ref_store_update(ref_store_t *store, const char *name, const git_oid_t *oid, const git_oid_t *peeled);
+
+int ref_store_delete(ref_store_t *store, const char *name);
+
+ref_iter_t ref_store_iter(const ref_store_t *store, const char *prefix);
+
+/** The next ref of the walk into `out`, or false at the end. */
+bool ref_iter_next(ref_iter_t *iter, git_ref_t *out);
+
+/** How many refs start with `prefix`, walking them. */
+size_t ref_store_count(const ref_store_t *store, const char *prefix);
+
+/**
+ * The refs pointing at `oid`, directly or once peeled, in name order,
+ * into `out` from the store's arena. A reftable stack answers from its
+ * object index; the files backend walks every ref.
+ */
+size_t ref_store_refs_at(const ref_store_t *store, const git_oid_t *oid, git_ref_t **out);
+
+#endif // REFS_H
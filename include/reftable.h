@@ -0,0 +1,80 @@
+#ifndef REFTABLE_H
+#define REFTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "oid.h"
+#include "refs.h"
+
+/**
+ * One table of a stack, mapped. Refs are kept in blocks of sorted,
+ * prefix-compressed records with a restart point every few records,
+ * where a record spells out its name whole, so a block is searched by
+ * bisecting the restarts and reading on from there. An index of the last
+ * name in each block, in levels of blocks of its own, leads to the block
+ * holding a name, and an index of object names leads to the blocks of
+ * the refs pointing at each.
+ */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const char *name;
+    uint32_t block_size;
+    uint64_t min_update_index;
+    uint64_t max_update_index;
+    uint64_t ref_index_position;
+    uint64_t obj_position;
+    int obj_id_len;
+    uint64_t obj_index_position;
+    size_t footer;
+} reftable_table_t;
+
+/**
+ * The tables under `<git_dir>/reftable`, oldest first, as `tables.list`
+ * names them. A ref is found in the newest table that has a record of
+ * it, which may say it was deleted. An update only writes a table of its
+ * own and `tables.list`, and tables are merged as the stack grows, so that
+ * each is at least twice the size of the one above it.
+ */
+struct reftable_stack {
+    arena_t *arena;
+    const char *dir;
+    reftable_options_t options;
+    reftable_table_t *tables;
+    size_t count;
+    size_t alloc;
+};
+
+/** Make `dir` and an empty `tables.list` in it. */
+int reftable_stack_create(const char *dir);
+
+/** Map the tables `dir` lists. Returns -1 if any cannot be read or is corrupt. */
+int reftable_stack_open(reftable_stack_t **out, const char *dir, const reftable_options_t *options, arena_t *arena);
+
+void reftable_stack_close(reftable_stack_t *stack);
+
+bool reftable_stack_lookup(const reftable_stack_t *stack, const char *name, git_ref_t *out);
+
+/**
+ * Write `updates` as one new table on top of the stack, and compact it
+ * after if `auto_compaction` is set. Of several updates to one name the
+ * last counts. Returns -1 if the stack is locked or cannot be written.
+ */
+int reftable_stack_add(reftable_stack_t *stack, const ref_update_t *updates, size_t count);
+
+/** A walk over the refs of the stack starting with `prefix`, in name order. */
+reftable_iter_t* reftable_stack_iter(const reftable_stack_t *stack, const char *prefix);
+
+/** Ref names come out copied into the stack's arena. */
+bool reftable_iter_next(reftable_iter_t *iter, git_ref_t *out);
+
+/**
+ * The refs pointing at `oid`, directly or peeled, in name order. Only
+ * the blocks the object index names for it are read in each table.
+ */
+size_t reftable_stack_refs_at(const reftable_stack_t *stack, const git_oid_t *oid, git_ref_t **out);
+
+#endif // REFTABLE_H
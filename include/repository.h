@@ -0,0 +1,109 @@
+#ifndef REPOSITORY_H
+#define REPOSITORY_H
+
+#include "git_context.h"
+#include "git_types.h"
+#include "index.h"
+#include "object_store.h"
+#include "refs.h"
+#include "sparse_checkout.h"
+
+typedef struct {
+    const char *path;
+    bool deleted;
+} git_worktree_change_t;
+
+typedef struct {
+    git_worktree_change_t *changes;
+    size_t change_count;
+    size_t hashed_count;
+} git_refresh_result_t;
+
+/**
+ * Files written or removed by this invocation, layered over the mock
+ * worktree. Sorted by path; a NULL content marks a removed file.
+ */
+typedef struct {
+    git_worktree_file_t *files;
+    size_t count;
+    size_t alloc;
+    const char **dirs;
+    size_t dir_count;
+    size_t dir_alloc;
+} git_worktree_overlay_t;
+
+/**
+ * A commit of the history. `object` is its commit object as git stores
+ * it, headers then message, for filters that read the raw text. `date` is
+ * its commit time in seconds since the epoch and `tz` the zone it was made
+ * in, in minutes east of UTC; the mock dates carry no zone and are read as
+ * UTC.
+ */
+typedef struct {
+    const git_commit_t *commit;
+    const git_object_t *object;
+    git_oid_t tree;
+    long long date;
+    int tz;
+    int parents[2];
+    int parent_count;
+} git_commit_node_t;
+
+typedef struct commit_graph commit_graph_t;
+
+typedef struct {
+    const git_stash_entry_t *entry;
+    int base;
+    git_oid_t tree;
+} git_stash_node_t;
+
+/**
+ * Repository state shared by the commands of one invocation.
+ * It is materialized from the mock data on first use and lives in the
+ * context arena. `commits` indexes the history; `head` is the position of
+ * the checked-out commit and `head_ref` its branch, NULL when detached.
+ * `stashes` holds the stash entries, newest first, with their trees.
+ * `refs` holds the branches, remote-tracking branches and tags: those of
+ * `$GIT_DIR` when it is set, the mock ones as a packed-refs image when
+ * not. `graph` is the commit graph once commit_graph_open() has written
+ * it.
+ */
+typedef struct git_repository {
+    git_context_t *ctx;
+    git_odb_t odb;
+    git_index_t index;
+    git_worktree_overlay_t worktree;
+    git_sparse_checkout_t sparse;
+    git_commit_node_t *commits;
+    int commit_count;
+    git_stash_node_t *stashes;
+    int stash_count;
+    ref_store_t refs;
+    commit_graph_t *graph;
+    const char *head_ref;
+    int head;
+} git_repository_t;
+
+git_repository_t* repo_open(git_context_t *ctx);
+void repo_close(git_repository_t *repo);
+void repo_stage_worktree_file(git_repository_t *repo, const char *path);
+void repo_refresh_index(git_repository_t *repo, bool stage, git_refresh_result_t *result);
+/** Point the index entry of `path` at its file in `tree`, dropping it if the tree has none. */
+void repo_reset_path(git_repository_t *repo, const git_oid_t *tree, const char *path);
+
+int repo_find_commit(const git_repository_t *repo, const char *hash);
+int repo_resolve_commit(const git_repository_t *repo, const char *rev);
+
+/** The position of the commit whose object is `oid`, or -1. */
+int repo_find_commit_oid(const git_repository_t *repo, const git_oid_t *oid);
+int repo_find_stash(const git_repository_t *repo, const char *name);
+void repo_set_head(git_repository_t *repo, const char *ref, int commit);
+
+const git_worktree_file_t* repo_worktree_file(const git_repository_t *repo, const char *path);
+bool repo_worktree_matches(const git_repository_t *repo, const char *path, const git_oid_t *oid);
+void repo_write_worktree_file(git_repository_t *repo, const char *path, const char *content,
+                              const git_stat_data_t *st);
+void repo_remove_worktree_file(git_repository_t *repo, const char *path);
+bool repo_worktree_mkdir(git_repository_t *repo, const char *path, size_t len);
+
+#endif // REPOSITORY_H
@@ -0,0 +1,121 @@
+#ifndef REVISION_H
+#define REVISION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "commit_graph.h"
+#include "repository.h"
+
+typedef struct {
+    int pos;
+    unsigned seq;
+} rev_entry_t;
+
+/**
+ * Commits by priority, highest first: by generation when `generations` is
+ * set, then by commit date, then first queued first.
+ */
+typedef struct {
+    const git_repository_t *repo;
+    const uint32_t *generations;
+    rev_entry_t *items;
+    size_t count;
+    size_t alloc;
+    unsigned next_seq;
+} rev_queue_t;
+
+rev_queue_t rev_queue_init(const git_repository_t *repo, const uint32_t *generations);
+void rev_queue_push(rev_queue_t *queue, arena_t *arena, int pos);
+
+/** The position of the highest commit, taken out, or -1 when empty. */
+int rev_queue_pop(rev_queue_t *queue);
+
+typedef struct {
+    int pos;
+    bool uninteresting;
+} rev_tip_t;
+
+/**
+ * A walk over the commits reachable from the interesting tips but from
+ * no uninteresting one. Without uninteresting tips commits stream out
+ * newest first as the walk reaches them.
+ *
+ * Otherwise the walk is limited: uninteresting commits pass their mark on
+ * to their parents, and the walk stops once only uninteresting commits are
+ * queued, so it costs what the range does rather than what the history
+ * does. With a commit graph the queue runs by generation, which settles
+ * each commit's mark before it is taken out. Without one it runs by date
+ * and walks a few commits further, in case of clock skew.
+ *
+ * Commits dated after `until` are walked but not shown. Those before
+ * `since` count as uninteresting, so the walk goes no further than them
+ * and a limited walk stops as it would at the end of a range.
+ *
+ * With `topo_order` no commit comes out before one of its children, and
+ * a line of history runs unbroken until it merges, as `--graph` draws it.
+ * Given generations an unlimited walk still streams: `indegree` counts the
+ * children of commits only down to the lowest generation taken out so
+ * far. Otherwise the commits are collected first, then sorted.
+ */
+typedef struct {
+    git_repository_t *repo;
+    const commit_graph_t *graph;
+    unsigned char *flags;
+    rev_tip_t *tips;
+    size_t tip_count;
+    size_t tip_alloc;
+    size_t interesting_tips;
+    rev_queue_t queue;
+    int *stack;
+    size_t stack_alloc;
+    int *results;
+    size_t result_count;
+    size_t next_result;
+    long long since;
+    long long until;
+    bool limited;
+    bool topo_order;
+    bool prepared;
+    int *indegree;
+    int *topo_stack;
+    size_t topo_count;
+    uint32_t min_generation;
+} rev_walk_t;
+
+rev_walk_t rev_walk_init(git_repository_t *repo);
+
+/**
+ * Resolve a revision expression to a commit position: a name that
+ * repo_resolve_commit() knows, optionally followed by `@{upstream}` (or
+ * `@{u}`, and bare for the current branch), then any run of `~<n>` and
+ * `^<n>` steps. Returns -1 if it names no commit.
+ */
+int rev_resolve(git_repository_t *repo, const char *expr);
+
+/**
+ * The upstream `branch` tracks by its `branch.<name>.remote` and
+ * `.merge` settings, as a name rev_resolve() takes. An empty `branch`,
+ * `HEAD` or `@` means the current branch. NULL if there is no upstream
+ * or HEAD is detached.
+ */
+const char* rev_upstream_name(git_repository_t *repo, const char *branch);
+
+void rev_add_tip(rev_walk_t *walk, int pos, bool uninteresting);
+
+/**
+ * Add the tips of a revision argument: `<rev>`, `^<rev>`, `A..B` or the
+ * symmetric `A...B`, whose merge bases become uninteresting. An empty side
+ * of a range means HEAD. `negate` flips every tip, as `--not` does.
+ * Returns -1, adding nothing, if any part does not resolve.
+ */
+int rev_parse_arg(rev_walk_t *walk, const char *arg, bool negate);
+
+/** The next commit of the walk, newest first, or -1 at the end. */
+int rev_walk_next(rev_walk_t *walk);
+
+/** Whether the commit at `pos` was found reachable from an uninteresting tip. */
+bool rev_walk_excluded(const rev_walk_t *walk, int pos);
+
+#endif // REVISION_H
@@ -0,0 +1,64 @@
+#ifndef SHORTLOG_H
+#define SHORTLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "mailmap.h"
+#include "repository.h"
+
+#define SHORTLOG_GROUP_AUTHOR    (1u << 0)
+#define SHORTLOG_GROUP_COMMITTER (1u << 1)
+#define SHORTLOG_GROUP_TRAILER   (1u << 2)
+
+/**
+ * What `shortlog` counts a commit under: its author, its committer and
+ * the values of the trailers named `trailers`, as `groups` selects. The
+ * same identity counts once per commit however many of those name it.
+ * Identities are "Name", or "Name <email>" with `email`, mapped through
+ * `mailmap` when it is set. `subjects` keeps the commits of each, not just
+ * their number.
+ */
+typedef struct {
+    unsigned groups;
+    const char **trailers;
+    size_t trailer_count;
+    bool email;
+    bool subjects;
+    const mailmap_t *mailmap;
+} shortlog_options_t;
+
+/**
+ * One identity and what was counted under it. `commits`, when kept,
+ * indexes the list handed to shortlog_collect(), in its order.
+ */
+typedef struct {
+    const char *ident;
+    size_t len;
+    uint64_t hash;
+    size_t count;
+    size_t *commits;
+} shortlog_entry_t;
+
+/** An open-addressing table of identities; `slots` hold entry numbers, from 1. */
+typedef struct {
+    shortlog_entry_t *entries;
+    size_t count;
+    size_t alloc;
+    uint32_t *slots;
+    size_t capacity;
+} shortlog_table_t;
+
+/**
+ * Count the commits at `positions` on `workers` threads (0 means one per
+ * core). Each thread takes a contiguous run of them into a table of its
+ * own, so counting shares nothing; the tables are merged in run order
+ * afterwards, which keeps each identity's commits in list order without
+ * sorting them. Returns -1 if a commit has no object to read.
+ */
+int shortlog_collect(git_repository_t *repo, const int *positions, size_t count, const shortlog_options_t *opts,
+                     int workers, arena_t *arena, shortlog_table_t *out);
+
+#endif // SHORTLOG_H
@@ -0,0 +1,47 @@
+#ifndef SPARSE_CHECKOUT_H
+#define SPARSE_CHECKOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+struct git_repository;
+
+typedef struct {
+    const char **slots;
+    size_t capacity;
+    size_t count;
+} sparse_dir_set_t;
+
+/**
+ * Cone-mode sparse-checkout. Each directory in the cone is included with
+ * everything below it; its ancestors contribute only the files directly
+ * inside them, and top-level files are always present. Both kinds of
+ * directory are kept in hash sets, so testing a path costs one lookup per
+ * path component.
+ */
+typedef struct {
+    arena_t *arena;
+    bool enabled;
+    sparse_dir_set_t recursive;
+    sparse_dir_set_t parents;
+    const char **dirs;
+    size_t dir_count;
+    size_t dir_alloc;
+} git_sparse_checkout_t;
+
+void sparse_checkout_init(git_sparse_checkout_t *sc, arena_t *arena);
+void sparse_checkout_clear(git_sparse_checkout_t *sc);
+bool sparse_checkout_add_dir(git_sparse_checkout_t *sc, const char *dir);
+bool sparse_checkout_includes(const git_sparse_checkout_t *sc, const char *path);
+bool sparse_checkout_excludes_dir(const git_sparse_checkout_t *sc, const char *dir, size_t len);
+
+/**
+ * Bring the skip-worktree bits of the index and the worktree in line with
+ * the cone: files entering it are checked out, files leaving it are
+ * removed unless they carry local changes. Returns -1 on failure.
+ */
+int sparse_checkout_update_worktree(struct git_repository *repo);
+
+#endif // SPARSE_CHECKOUT_H
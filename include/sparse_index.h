@@ -0,0 +1,20 @@
+#ifndef SPARSE_INDEX_H
+#define SPARSE_INDEX_H
+
+#include "index.h"
+#include "object_store.h"
+#include "sparse_checkout.h"
+
+/**
+ * Sparse index: every directory entirely outside the sparse-checkout cone
+ * is collapsed into a single entry naming its tree, so the index grows
+ * with the cone rather than with the repository. Code that needs paths
+ * inside such a directory expands the index back to full first; the
+ * cache-tree is kept valid across both conversions.
+ */
+int sparse_index_convert(git_index_t *index, git_odb_t *odb, const git_sparse_checkout_t *sc);
+void sparse_index_ensure_full(git_index_t *index, const git_odb_t *odb);
+long sparse_index_find_dir(const git_index_t *index, const char *path);
+void sparse_index_expand_for_path(git_index_t *index, const git_odb_t *odb, const char *path);
+
+#endif // SPARSE_INDEX_H
@@ -0,0 +1,28 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <stddef.h>
+
+#include "arena.h"
+
+/**
+ * Growable, always NUL-terminated string buffer backed by an arena.
+ * Capacity doubles on demand, so appending n bytes costs O(n) overall.
+ */
+typedef struct {
+    arena_t *arena;
+    char *buf;
+    size_t len;
+    size_t alloc;
+} strbuf_t;
+
+strbuf_t strbuf_init(arena_t *arena, size_t hint);
+void strbuf_grow(strbuf_t *sb, size_t extra);
+void strbuf_add(strbuf_t *sb, const char *data, size_t len);
+void strbuf_addstr(strbuf_t *sb, const char *str);
+void strbuf_addch(strbuf_t *sb, char c);
+void strbuf_addf(strbuf_t *sb, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void strbuf_reset(strbuf_t *sb);
+
+#endif // STRBUF_H
@@ -0,0 +1,33 @@
+#ifndef TRACKING_H
+#define TRACKING_H
+
+#include <stdbool.h>
+
+#include "merge_base.h"
+#include "repository.h"
+
+typedef enum {
+    TRACKING_NONE,
+    TRACKING_GONE,
+    TRACKING_COUNTED,
+    TRACKING_DIFFERENT,
+} tracking_state_t;
+
+/**
+ * How the current branch stands against its upstream. Without counting,
+ * as `status.aheadBehind = false` asks, all that is known of a branch not
+ * at its upstream is that it is DIFFERENT.
+ */
+typedef struct {
+    tracking_state_t state;
+    const char *upstream;
+    ahead_behind_t counts;
+} tracking_t;
+
+/** Where HEAD's branch stands against its upstream; commits are counted only if `count` is set. */
+tracking_t tracking_find(git_repository_t *repo, bool count);
+
+/** The "Your branch is ..." lines status and checkout show; nothing for TRACKING_NONE. */
+void tracking_print(const tracking_t *tracking);
+
+#endif // TRACKING_H
@@ -0,0 +1,29 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "object_store.h"
+#include "oid.h"
+
+typedef struct {
+    const char *name;
+    size_t name_len;
+    unsigned int mode;
+    const git_oid_t *oid;
+} git_tree_entry_t;
+
+typedef struct {
+    const char *cursor;
+    const char *end;
+} git_tree_iter_t;
+
+git_tree_iter_t tree_iter_init(const git_object_t *tree);
+bool tree_iter_next(git_tree_iter_t *it, git_tree_entry_t *entry);
+int tree_entry_cmp(const git_tree_entry_t *a, const git_tree_entry_t *b);
+bool tree_entry_is_dir(const git_tree_entry_t *entry);
+bool tree_lookup_path(const git_odb_t *odb, const git_oid_t *tree_oid, const char *path,
+                      git_tree_entry_t *entry);
+
+#endif // TREE_H
@@ -0,0 +1,74 @@
+#ifndef TREE_DIFF_H
+#define TREE_DIFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "object_store.h"
+#include "oid.h"
+
+typedef enum {
+    DIFF_ADDED = 'A',
+    DIFF_DELETED = 'D',
+    DIFF_MODIFIED = 'M',
+    DIFF_RENAMED = 'R',
+    DIFF_COPIED = 'C',
+} git_diff_status_t;
+
+/**
+ * One changed file. `old_path` equals `path` unless rename detection
+ * paired the entry with a source file, in which case `similarity` is the
+ * percentage of content they share.
+ */
+typedef struct {
+    git_diff_status_t status;
+    const char *path;
+    const char *old_path;
+    int similarity;
+    git_oid_t old_oid;
+    git_oid_t new_oid;
+    unsigned int old_mode;
+    unsigned int new_mode;
+} git_diff_entry_t;
+
+typedef struct {
+    arena_t *arena;
+    git_diff_entry_t *entries;
+    size_t count;
+    size_t alloc;
+} git_diff_list_t;
+
+/**
+ * Paths a diff is limited to: files at or below any of them, with no
+ * trailing slash. An empty pathspec matches every file.
+ */
+typedef struct {
+    const char *const *paths;
+    size_t count;
+} git_pathspec_t;
+
+git_diff_list_t diff_list_init(arena_t *arena);
+
+/**
+ * Whether `path` is at or below a pathspec entry or, when it is a
+ * directory, leads down to one.
+ */
+bool pathspec_matches(const git_pathspec_t *pathspec, const char *path, size_t len, bool is_dir);
+
+/**
+ * Recursive file-level diff of two trees, in path order. Subtrees with the
+ * same object name on both sides are skipped without being read. A NULL
+ * tree stands for the empty tree.
+ */
+int tree_diff(const git_odb_t *odb, const git_oid_t *old_tree, const git_oid_t *new_tree,
+              git_diff_list_t *out);
+
+/**
+ * tree_diff restricted to `pathspec`. Subtrees that neither lie inside
+ * the pathspec nor lead to one of its entries are skipped unread.
+ */
+int tree_diff_limited(const git_odb_t *odb, const git_oid_t *old_tree, const git_oid_t *new_tree,
+                      const git_pathspec_t *pathspec, git_diff_list_t *out);
+
+#endif // TREE_DIFF_H
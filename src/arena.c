@@ -0,0 +1,152 @@
+#include "arena.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT          (sizeof(max_align_t))
+
+struct arena_block {
+    arena_block_t *next;
+    size_t capacity;
+    size_t used;
+    max_align_t data[];
+};
+
+static size_t align_up(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static arena_block_t* new_block(size_t capacity)
+{
+    arena_block_t *block = malloc(sizeof(*block) + capacity);
+    if (!block) {
+        fprintf(stderr, "fatal: out of memory, failed to allocate %zu bytes\n", capacity);
+        exit(128);
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+arena_t arena_init(size_t block_size)
+{
+    arena_t arena = {
+        .head = NULL,
+        .block_size = block_size ? align_up(block_size) : ARENA_DEFAULT_BLOCK_SIZE,
+    };
+    return arena;
+}
+
+void arena_free(arena_t *arena)
+{
+    arena_block_t *block = arena->head;
+    
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
+
+void* arena_alloc(arena_t *arena, size_t size)
+{
+    size = align_up(size ? size : 1);
+    
+    // Oversized requests get a dedicated block kept behind the current one,
+    // so the remaining space of the head block is not wasted.
+    if (size > arena->block_size / 4) {
+        arena_block_t *block = new_block(size);
+        block->used = size;
+        if (arena->head) {
+            block->next = arena->head->next;
+            arena->head->next = block;
+        } else {
+            arena->head = block;
+        }
+        return block->data;
+    }
+    
+    arena_block_t *head = arena->head;
+    if (!head || head->capacity - head->used < size) {
+        head = new_block(arena->block_size);
+        head->next = arena->head;
+        arena->head = head;
+    }
+    
+    void *ptr = (char *)head->data + head->used;
+    head->used += size;
+    return ptr;
+}
+
+void* arena_calloc(arena_t *arena, size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size) {
+        fprintf(stderr, "fatal: arena allocation overflow\n");
+        exit(128);
+    }
+    
+    void *ptr = arena_alloc(arena, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void* arena_realloc(arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+        return arena_alloc(arena, new_size);
+    if (new_size <= old_size)
+        return ptr;
+    
+    // The most recent allocation of the head block can grow in place.
+    arena_block_t *head = arena->head;
+    size_t old_aligned = align_up(old_size ? old_size : 1);
+    size_t new_aligned = align_up(new_size);
+    if (head && (char *)ptr + old_aligned == (char *)head->data + head->used &&
+        head->used - old_aligned + new_aligned <= head->capacity) {
+        head->used += new_aligned - old_aligned;
+        return ptr;
+    }
+    
+    void *new_ptr = arena_alloc(arena, new_size);
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+char* arena_strndup(arena_t *arena, const char *str, size_t len)
+{
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(arena_t *arena, const char *str)
+{
+    return arena_strndup(arena, str, strlen(str));
+}
+
+char* arena_sprintf(arena_t *arena, const char *format, ...)
+{
+    va_list args, args_copy;
+    
+    va_start(args, format);
+    va_copy(args_copy, args);
+    int len = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    
+    if (len < 0) {
+        va_end(args);
+        return arena_strdup(arena, "");
+    }
+    
+    char *str = arena_alloc(arena, (size_t)len + 1);
+    vsnprintf(str, (size_t)len + 1, format, args);
+    va_end(args);
+    return str;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "branch_switch.h"
+#include "colors.h"
+#include "config_utils.h"
+#include "parallel_checkout.h"
+#include "revision.h"
+#include "tracking.h"
+
+int branch_switch_worktree(git_repository_t *repo, int target, const char *label,
+                           const branch_switch_options_t *opts)
+{
+    checkout_switch_options_t switch_opts = {
+        .force = opts->force,
+        .merge = opts->merge,
+        .style = opts->style,
+        .old_label = repo->head_ref ? repo->head_ref : "HEAD",
+        .new_label = label,
+    };
+    // An unborn HEAD has nothing checked out yet
+    const git_oid_t *old_tree = repo->head >= 0 ? &repo->commits[repo->head].tree : NULL;
+    return checkout_switch_tree(repo, old_tree, &repo->commits[target].tree, &switch_opts) < 0 ? -1 : 0;
+}
+
+static void print_detached_head(const char *name, const git_commit_t *commit, bool advise)
+{
+    // Only a detach the user did not ask for by name gets the advice
+    if (advise) {
+        printf("Note: switching to '" COLOR_YELLOW("%s") "'.\n\n", name);
+        printf("You are in 'detached HEAD' state. You can look around, make experimental\n");
+        printf("changes and commit them, and you can discard any commits you make in this\n");
+        printf("state without impacting any branches by switching back to a branch.\n\n");
+    }
+    printf("HEAD is now at " COLOR_YELLOW("%s") " " COLOR_BLUE("%s") "\n", commit->hash, commit->message);
+}
+
+int branch_switch_to(git_repository_t *repo, const char *name, const char *branch, int target,
+                     const branch_switch_options_t *opts)
+{
+    if (branch_switch_worktree(repo, target, name, opts) < 0)
+        return 1;
+    repo_set_head(repo, branch, target);
+    
+    if (opts->quiet)
+        return 0;
+    if (!branch) {
+        print_detached_head(name, repo->commits[target].commit, !opts->detach);
+        return 0;
+    }
+    
+    tracking_t tracking = tracking_find(repo, true);
+    printf("Switched to branch '" COLOR_GREEN("%s") "'\n", branch);
+    tracking_print(&tracking);
+    return 0;
+}
+
+int branch_switch_create(git_repository_t *repo, const char *branch, const char *start, bool reset, bool track,
+                         const branch_switch_options_t *opts)
+{
+    arena_t *arena = &repo->ctx->arena;
+    const char *refname = arena_sprintf(arena, "refs/heads/%s", branch);
+    git_ref_t existing, upstream;
+    
+    int target = rev_resolve(repo, start);
+    if (target < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "invalid reference: %s\n", start);
+        return 128;
+    }
+    bool exists = ref_store_lookup(&repo->refs, refname, &existing);
+    if (exists && !reset) {
+        fprintf(stderr, COLOR_RED("fatal: ") "a branch named '%s' already exists\n", branch);
+        return 128;
+    }
+    
+    if (branch_switch_worktree(repo, target, branch, opts) < 0)
+        return 1;
+    if (ref_store_update(&repo->refs, refname, &repo->commits[target].object->oid, NULL) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot lock ref '%s'\n", refname);
+        return 128;
+    }
+    repo_set_head(repo, branch, target);
+    
+    // The upstream is what rev_upstream_name() reads back: the remote and its branch
+    const char *slash = strchr(start, '/');
+    bool tracks = track && slash &&
+                  ref_store_lookup(&repo->refs, arena_sprintf(arena, "refs/remotes/%s", start), &upstream);
+    if (tracks) {
+        config_set_override(repo->ctx, arena_sprintf(arena, "branch.%s.remote", branch),
+                            arena_strndup(arena, start, (size_t)(slash - start)));
+        config_set_override(repo->ctx, arena_sprintf(arena, "branch.%s.merge", branch),
+                            arena_sprintf(arena, "refs/heads/%s", slash + 1));
+    }
+    
+    if (opts->quiet)
+        return 0;
+    if (tracks)
+        printf("branch '" COLOR_GREEN("%s") "' set up to track '" COLOR_CYAN("%s") "'.\n", branch, start);
+    if (exists)
+        printf("Reset branch '" COLOR_GREEN("%s") "'\n", branch);
+    else
+        printf("Switched to a new branch '" COLOR_GREEN("%s") "'\n", branch);
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include "colors.h"
 #include "git_types.h"
 #include "mock_data.h"
+#include "repository.h"
 
 ARGUS_OPTIONS(
     add_options,
@@ -22,6 +23,8 @@ ARGUS_OPTIONS(
             HELP("Suppress output")),
         OPTION_FLAG('f', "force", 
             HELP("Allow adding ignored files")),
+        OPTION_FLAG('\0', "sparse", 
+            HELP("Allow updating entries outside of the sparse-checkout cone")),
     GROUP_END(),
     
     GROUP_START("Mode options"),
@@ -89,32 +92,52 @@ static int handle_interactive_modes(argus_t *argus)
     return -1;
 }
 
-static int handle_special_modes(argus_t *argus)
+static int handle_special_modes(argus_t *argus, git_context_t *ctx)
 {
     bool all = argus_get(argus, "all").as_bool;
     bool update = argus_get(argus, "update").as_bool;
     bool intent_to_add = argus_get(argus, "intent-to-add").as_bool;
     bool dry_run = argus_get(argus, "dry-run").as_bool;
+    bool verbose = argus_get(argus, "verbose").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
+    bool sparse = argus_get(argus, "sparse").as_bool;
     
     if (all || update || intent_to_add) {
         int file_count;
         const git_file_status_t *files = get_mock_file_status(&file_count);
+        git_repository_t *repo = repo_open(ctx);
         
         const char *mode_desc = all ? "all tracked and untracked" : 
                                update ? "tracked" : "intent-to-add";
         
-        if (dry_run) {
-            for (int i = 0; i < file_count; i++) {
-                bool should_process = all || 
-                                    (update && files[i].modified) ||
-                                    (intent_to_add && strcmp(files[i].status, "untracked") == 0);
-                if (should_process) {
-                    const char *action = intent_to_add ? "intent-to-add" : "add";
-                    printf("%s '%s'\n", action, files[i].filename);
+        // Tracked files: only entries whose stat data changed get rehashed
+        if (all || update) {
+            git_refresh_result_t refresh;
+            repo_refresh_index(repo, !dry_run, &refresh);
+            
+            if ((dry_run || verbose) && !quiet) {
+                for (size_t i = 0; i < refresh.change_count; i++) {
+                    const char *action = refresh.changes[i].deleted ? "remove" : "add";
+                    printf("%s '%s'\n", action, refresh.changes[i].path);
                 }
             }
-        } else if (!quiet) {
+        }
+        
+        for (int i = 0; i < file_count; i++) {
+            if (strcmp(files[i].status, "untracked") != 0 || !(all || intent_to_add))
+                continue;
+            if (!sparse && !sparse_checkout_includes(&repo->sparse, files[i].filename))
+                continue;
+            
+            if (!dry_run)
+                repo_stage_worktree_file(repo, files[i].filename);
+            if ((dry_run || verbose) && !quiet) {
+                const char *action = intent_to_add ? "intent-to-add" : "add";
+                printf("%s '%s'\n", action, files[i].filename);
+            }
+        }
+        
+        if (!dry_run && !verbose && !quiet) {
             const char *action = intent_to_add ? "Recording intent for" : "Adding";
             printf("%s %s files...\n", action, mode_desc);
         }
@@ -124,7 +147,19 @@ static int handle_special_modes(argus_t *argus)
     return -1;
 }
 
-static void process_pathspecs(argus_t *argus)
+static void print_sparse_advice(const char **paths, int count)
+{
+    printf("The following paths and/or pathspecs matched paths that exist\n");
+    printf("outside of your sparse-checkout definition, so will not be\n");
+    printf("updated in the index:\n");
+    for (int i = 0; i < count; i++)
+        printf("%s\n", paths[i]);
+    printf(COLOR_BLUE("hint: If you intend to update such entries, try one of the following:") "\n");
+    printf(COLOR_BLUE("hint: * Use the --sparse option.") "\n");
+    printf(COLOR_BLUE("hint: * Disable or modify the sparsity rules.") "\n");
+}
+
+static int process_pathspecs(argus_t *argus, git_context_t *ctx)
 {
     bool verbose = argus_get(argus, "verbose").as_bool;
     bool dry_run = argus_get(argus, "dry-run").as_bool;
@@ -137,13 +172,25 @@ static void process_pathspecs(argus_t *argus)
         printf("%s\n", action);
     }
     
+    bool sparse = argus_get(argus, "sparse").as_bool;
+    git_repository_t *repo = repo_open(ctx);
+    const char **outside = arena_alloc(&ctx->arena, (size_t)argus_count(argus, "pathspec") * sizeof(*outside));
+    int outside_count = 0;
     argus_array_it_t it = argus_array_it(argus, "pathspec");
     int file_count = 0;
     
     while (argus_array_next(&it)) {
         const char *pathspec = it.value.as_string;
+        
+        if (!sparse && !sparse_checkout_includes(&repo->sparse, pathspec)) {
+            outside[outside_count++] = pathspec;
+            continue;
+        }
         file_count++;
         
+        if (!dry_run)
+            repo_stage_worktree_file(repo, pathspec);
+        
         if ((dry_run || verbose) && !quiet) {
             const char *action = intent_to_add ? "intent-to-add" : "add";
             const char *force_note = force ? " (forced)" : "";
@@ -157,11 +204,17 @@ static void process_pathspecs(argus_t *argus)
         else
             printf(COLOR_GREEN("Added %d file(s) to index") "\n", file_count);
     }
+    
+    if (outside_count > 0) {
+        print_sparse_advice(outside, outside_count);
+        return 1;
+    }
+    return 0;
 }
 
 int add_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     bool all = argus_get(argus, "all").as_bool;
     bool update = argus_get(argus, "update").as_bool;
@@ -178,7 +231,7 @@ int add_handler(argus_t *argus, void *data)
     if ((result = handle_interactive_modes(argus)) != -1)
         return result;
     
-    if ((result = handle_special_modes(argus)) != -1)
+    if ((result = handle_special_modes(argus, ctx)) != -1)
         return result;
     
     if (!argus_is_set(argus, "pathspec")) {
@@ -189,6 +242,5 @@ int add_handler(argus_t *argus, void *data)
         return 1;
     }
     
-    process_pathspecs(argus);
-    return 0;
+    return process_pathspecs(argus, ctx);
 }
\ No newline at end of file
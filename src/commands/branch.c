@@ -7,12 +7,14 @@
 #include "commands/git.h"
 #include "colors.h"
 #include "git_types.h"
-#include "mock_data.h"
+#include "merge_base.h"
+#include "repository.h"
+#include "revision.h"
 
 ARGUS_OPTIONS(
     branch_options,
     HELP_OPTION(),
-    
+
     GROUP_START("List options"),
         OPTION_FLAG('v', "verbose", 
             HELP("Show hash and commit subject line for each head")),
@@ -31,10 +33,13 @@ ARGUS_OPTIONS(
             HELP("Print only branches that are not merged"), 
             HINT("commit"), 
             FLAGS(FLAG_OPTIONAL)),
+        OPTION_STRING('\0', "points-at", 
+            HELP("Print only branches of the object"), 
+            HINT("object")),
         OPTION_FLAG('\0', "show-current", 
             HELP("Print the name of the current branch")),
     GROUP_END(),
-    
+
     GROUP_START("Action options"),
         OPTION_FLAG('d', "delete", 
             HELP("Delete fully merged branch")),
@@ -81,14 +86,47 @@ ARGUS_OPTIONS(
         FLAGS(FLAG_OPTIONAL)),
 )
 
-static int handle_branch_deletion(argus_t *argus, const char *branchname)
+/* The abbreviated name of the commit at `oid` as the history knows it, or of the object. */
+static void short_hash(const git_repository_t *repo, const git_oid_t *oid, char *out)
+{
+    int pos = repo_find_commit_oid(repo, oid);
+    
+    if (pos >= 0) {
+        snprintf(out, GIT_OID_HEXSZ + 1, "%s", repo->commits[pos].commit->hash);
+        return;
+    }
+    oid_to_hex(oid, out);
+    out[7] = '\0';
+}
+
+static int handle_branch_deletion(argus_t *argus, git_repository_t *repo, const char *branchname)
 {
     bool force_delete = argus_get(argus, "D").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
+    bool remote = argus_get(argus, "remotes").as_bool;
+    const char *refname = arena_sprintf(&repo->ctx->arena, "refs/%s/%s", remote ? "remotes" : "heads", branchname);
+    char hash[GIT_OID_HEXSZ + 1];
+    git_ref_t ref;
+    
+    if (!ref_store_lookup(&repo->refs, refname, &ref)) {
+        fprintf(stderr, COLOR_RED("error: ") "%sbranch '%s' not found.\n", remote ? "remote-tracking " : "",
+                branchname);
+        return 1;
+    }
+    if (!remote && repo->head_ref && strcmp(repo->head_ref, branchname) == 0) {
+        fprintf(stderr, COLOR_RED("error: ") "cannot delete branch '%s' that is checked out\n", branchname);
+        return 1;
+    }
+    if (ref_store_delete(&repo->refs, refname) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot lock ref '%s'\n", refname);
+        return 128;
+    }
     
+    short_hash(repo, &ref.oid, hash);
     if (!quiet) {
         const char *forced_str = force_delete ? " [forced]" : "";
-        printf("Deleted branch " COLOR_GREEN("%s") " (was " COLOR_YELLOW("abc1234") ")%s.\n", branchname, forced_str);
+        printf("Deleted %sbranch " COLOR_GREEN("%s") " (was " COLOR_YELLOW("%s") ")%s.\n",
+               remote ? "remote-tracking " : "", branchname, hash, forced_str);
     }
     
     return 0;
@@ -142,12 +180,29 @@ static int handle_branch_upstream(argus_t *argus, const char *branchname)
     return set_upstream || unset_upstream ? 0 : 1;
 }
 
-static int handle_branch_creation(argus_t *argus, const char *branchname, const char *start_point)
+static int handle_branch_creation(argus_t *argus, git_repository_t *repo, const char *branchname,
+                                  const char *start_point)
 {
     const char *track_mode = argus_get(argus, "track").as_string;
     bool force = argus_get(argus, "force").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
     const char *start = start_point ? start_point : "HEAD";
+    const char *refname = arena_sprintf(&repo->ctx->arena, "refs/heads/%s", branchname);
+    git_ref_t existing;
+    
+    int pos = rev_resolve(repo, start);
+    if (pos < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "not a valid object name: '%s'\n", start);
+        return 128;
+    }
+    if (!force && ref_store_lookup(&repo->refs, refname, &existing)) {
+        fprintf(stderr, COLOR_RED("fatal: ") "a branch named '%s' already exists\n", branchname);
+        return 128;
+    }
+    if (ref_store_update(&repo->refs, refname, &repo->commits[pos].object->oid, NULL) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot lock ref '%s'\n", refname);
+        return 128;
+    }
     
     if (!quiet) {
         const char *action = force ? "Reset" : "Created";
@@ -161,64 +216,243 @@ static int handle_branch_creation(argus_t *argus, const char *branchname, const
     return 0;
 }
 
-static void display_local_branches(const git_branch_t *branches, int count, bool verbose, bool merged, bool no_merged)
+static void print_branch(git_repository_t *repo, const git_ref_t *ref, size_t prefix_len, bool remote, bool verbose,
+                         const char *tracking)
 {
-    for (int i = 0; i < count; i++) {
-        const git_branch_t *branch = &branches[i];
-        
-        if (merged && i > 1) continue;
-        if (no_merged && i <= 1) continue;
-        
-        const char *prefix = strcmp(branch->type, "current") == 0 ? "* " : "  ";
-        
+    const char *name = ref->name + prefix_len;
+    int len = (int)(ref->name_len - prefix_len);
+    int pos = repo_find_commit_oid(repo, &ref->oid);
+    char hash[GIT_OID_HEXSZ + 1];
+    const char *message = pos >= 0 ? repo->commits[pos].commit->message : "";
+    
+    short_hash(repo, &ref->oid, hash);
+    
+    if (remote) {
         if (verbose) 
-            printf("%s" COLOR_GREEN("%-10s") " " COLOR_YELLOW("%s") " %s\n", prefix, branch->name, branch->hash, branch->message);
+            printf("  " COLOR_CYAN("%-20.*s") " " COLOR_YELLOW("%s") " %s\n", len, name, hash, message);
         else 
-            printf("%s" COLOR_GREEN("%s") "\n", prefix, branch->name);
+            printf("  " COLOR_CYAN("%.*s") "\n", len, name);
+        return;
+    }
+    
+    bool current = repo->head_ref && strlen(repo->head_ref) == (size_t)len && strncmp(repo->head_ref, name, len) == 0;
+    const char *prefix = current ? "* " : "  ";
+    
+    if (verbose) 
+        printf("%s" COLOR_GREEN("%-10.*s") " " COLOR_YELLOW("%s") " %s%s\n", prefix, len, name, hash,
+               tracking ? tracking : "", message);
+    else 
+        printf("%s" COLOR_GREEN("%.*s") "\n", prefix, len, name);
+}
+
+/*
+ * Which of the branches the commit `rev` names has merged: those that
+ * are their own merge base with it. A single batched walk answers for
+ * all of them. Returns -1 if `rev` names no commit.
+ */
+static int find_merged_branches(git_repository_t *repo, const char *rev, const git_ref_t *refs, size_t count,
+                                bool *merged)
+{
+    arena_t *arena = &repo->ctx->arena;
+    int target = rev_resolve(repo, rev);
+    if (target < 0)
+        return -1;
+    
+    int *tips = arena_alloc(arena, (count + 1) * sizeof(*tips));
+    size_t *owners = arena_alloc(arena, (count + 1) * sizeof(*owners));
+    size_t tip_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        merged[i] = false;
+        int pos = repo_find_commit_oid(repo, &refs[i].oid);
+        if (pos >= 0) {
+            owners[tip_count] = i;
+            tips[tip_count++] = pos;
+        }
     }
+    
+    merge_base_list_t *bases = arena_alloc(arena, (tip_count + 1) * sizeof(*bases));
+    merge_bases_batch(repo, target, tips, tip_count, arena, bases);
+    for (size_t i = 0; i < tip_count; i++)
+        merged[owners[i]] = bases[i].count == 1 && bases[i].commits[0] == tips[i];
+    return 0;
 }
 
-static void display_remote_branches(const git_branch_t *branches, int count, bool verbose)
+/*
+ * The branches --merged and --no-merged leave in the listing, or NULL
+ * to list them all. Either option without a commit means HEAD.
+ */
+static int filter_merged_branches(argus_t *argus, git_repository_t *repo, const git_ref_t *refs, size_t count,
+                                  bool **shown)
 {
-    for (int i = 0; i < count; i++) {
-        const git_branch_t *branch = &branches[i];
+    static const char *const filters[] = { "merged", "no-merged" };
+    arena_t *arena = &repo->ctx->arena;
+    
+    *shown = NULL;
+    for (int f = 0; f < 2; f++) {
+        if (!argus_is_set(argus, filters[f]))
+            continue;
         
-        if (verbose) 
-            printf("  " COLOR_CYAN("%-20s") " " COLOR_YELLOW("%s") " %s\n", branch->name, branch->hash, branch->message);
-        else 
-            printf("  " COLOR_CYAN("%s") "\n", branch->name);
+        const char *rev = argus_get(argus, filters[f]).as_string;
+        bool *merged = arena_alloc(arena, (count + 1) * sizeof(*merged));
+        if (find_merged_branches(repo, rev ? rev : "HEAD", refs, count, merged) < 0) {
+            fprintf(stderr, COLOR_RED("fatal: ") "malformed object name %s\n", rev ? rev : "HEAD");
+            return -1;
+        }
+        
+        if (!*shown) {
+            *shown = arena_alloc(arena, (count + 1) * sizeof(**shown));
+            for (size_t i = 0; i < count; i++)
+                (*shown)[i] = true;
+        }
+        for (size_t i = 0; i < count; i++)
+            (*shown)[i] = (*shown)[i] && merged[i] == (f == 0);
+    }
+    return 0;
+}
+
+/*
+ * The `[<upstream>: ahead <n>, behind <m>] ` note -v shows for each
+ * branch, NULL for one that tracks nothing. The counts of all branches
+ * come from a single walk rather than one each.
+ */
+static const char** find_tracking_notes(git_repository_t *repo, const git_ref_t *refs, size_t count)
+{
+    arena_t *arena = &repo->ctx->arena;
+    const char **notes = arena_calloc(arena, count + 1, sizeof(*notes));
+    const char **upstreams = arena_calloc(arena, count + 1, sizeof(*upstreams));
+    int *tips = arena_alloc(arena, (count + 1) * sizeof(*tips));
+    int *bases = arena_alloc(arena, (count + 1) * sizeof(*bases));
+    size_t *owners = arena_alloc(arena, (count + 1) * sizeof(*owners));
+    size_t pair_count = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        const char *branch = arena_strndup(arena, refs[i].name + 11, refs[i].name_len - 11);
+        upstreams[i] = rev_upstream_name(repo, branch);
+        if (!upstreams[i])
+            continue;
+        
+        int tip = repo_find_commit_oid(repo, &refs[i].oid);
+        int base = rev_resolve(repo, upstreams[i]);
+        if (tip < 0 || base < 0) {
+            notes[i] = arena_sprintf(arena, "[" COLOR_BLUE("%s") ": gone] ", upstreams[i]);
+            continue;
+        }
+        owners[pair_count] = i;
+        tips[pair_count] = tip;
+        bases[pair_count++] = base;
+    }
+    
+    ahead_behind_t *counts = arena_alloc(arena, (pair_count + 1) * sizeof(*counts));
+    merge_base_ahead_behind(repo, tips, bases, pair_count, counts);
+    for (size_t k = 0; k < pair_count; k++) {
+        int ahead = counts[k].ahead, behind = counts[k].behind;
+        const char *state = "";
+        if (ahead && behind)
+            state = arena_sprintf(arena, ": ahead %d, behind %d", ahead, behind);
+        else if (ahead)
+            state = arena_sprintf(arena, ": ahead %d", ahead);
+        else if (behind)
+            state = arena_sprintf(arena, ": behind %d", behind);
+        notes[owners[k]] = arena_sprintf(arena, "[" COLOR_BLUE("%s") "%s] ", upstreams[owners[k]], state);
+    }
+    return notes;
+}
+
+/*
+ * The branches under `prefix` that point at what --points-at names, from
+ * the refs the store finds at the object. Returns -1 if it names none.
+ */
+static int find_branches_at(argus_t *argus, git_repository_t *repo, const char *prefix, git_ref_t **out,
+                            size_t *count)
+{
+    const char *points_at = argus_get(argus, "points-at").as_string;
+    size_t prefix_len = strlen(prefix);
+    git_ref_t *refs;
+    
+    int pos = rev_resolve(repo, points_at);
+    if (pos < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "malformed object name %s\n", points_at);
+        return -1;
+    }
+    
+    size_t found = ref_store_refs_at(&repo->refs, &repo->commits[pos].object->oid, &refs);
+    *count = 0;
+    for (size_t i = 0; i < found; i++) {
+        if (refs[i].name_len > prefix_len && strncmp(refs[i].name, prefix, prefix_len) == 0)
+            refs[(*count)++] = refs[i];
+    }
+    *out = refs;
+    return 0;
+}
+
+/*
+ * List the branches under `prefix`. A plain listing streams them from the
+ * ref store in name order as they are found; --merged, --no-merged and -v
+ * answer for all branches with one batched walk, so those collect the
+ * refs first, and --points-at has the store look them up by object.
+ */
+static int list_branches(argus_t *argus, git_repository_t *repo, const char *prefix, bool verbose)
+{
+    arena_t *arena = &repo->ctx->arena;
+    size_t prefix_len = strlen(prefix);
+    bool remote = strcmp(prefix, "refs/remotes/") == 0;
+    bool points_at = argus_is_set(argus, "points-at");
+    ref_iter_t iter = ref_store_iter(&repo->refs, prefix);
+    git_ref_t ref;
+    
+    if (!verbose && !points_at && !argus_is_set(argus, "merged") && !argus_is_set(argus, "no-merged")) {
+        while (ref_iter_next(&iter, &ref))
+            print_branch(repo, &ref, prefix_len, remote, false, NULL);
+        return 0;
+    }
+    
+    git_ref_t *refs = NULL;
+    size_t count = 0, alloc = 0;
+    if (points_at && find_branches_at(argus, repo, prefix, &refs, &count) < 0)
+        return -1;
+    while (!points_at && ref_iter_next(&iter, &ref)) {
+        if (count == alloc) {
+            size_t grown = alloc ? alloc * 2 : 16;
+            refs = arena_realloc(arena, refs, alloc * sizeof(*refs), grown * sizeof(*refs));
+            alloc = grown;
+        }
+        refs[count++] = ref;
+    }
+    
+    bool *shown;
+    if (filter_merged_branches(argus, repo, refs, count, &shown) < 0)
+        return -1;
+    
+    const char **tracking = verbose && !remote ? find_tracking_notes(repo, refs, count) : NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (!shown || shown[i])
+            print_branch(repo, &refs[i], prefix_len, remote, verbose, tracking ? tracking[i] : NULL);
     }
+    return 0;
 }
 
-static void display_branch_list(argus_t *argus, bool verbose, bool remotes, bool all)
+static int display_branch_list(argus_t *argus, git_context_t *ctx, bool verbose, bool remotes, bool all)
 {
     const char *contains = argus_get(argus, "contains").as_string;
     const char *format = argus_get(argus, "format").as_string;
-    const char *merged = argus_get(argus, "merged").as_string;
-    const char *no_merged = argus_get(argus, "no-merged").as_string;
     bool quiet = argus_get(argus, "quiet").as_bool;
     
     if (format) {
         if (!quiet) printf("Using custom format: %s\n", format);
         printf("main\t\tabc1234\tAdd new feature\n");
         printf("develop\t\tdef5678\tFix bug\n");
-        return;
+        return 0;
     }
     
     if (contains && !quiet)
         printf("Branches containing commit '%s':\n", contains);
     
-    int branch_count, remote_branch_count;
-    const git_branch_t *branches = get_mock_branches(&branch_count);
-    const git_branch_t *remote_branches = get_mock_remote_branches(&remote_branch_count);
-    
-    bool filter_merged = (merged != NULL);
-    bool filter_no_merged = (no_merged != NULL);
-    
-    if (!remotes)
-        display_local_branches(branches, branch_count, verbose, filter_merged, filter_no_merged);
-    if (all || remotes)
-        display_remote_branches(remote_branches, remote_branch_count, verbose);
+    git_repository_t *repo = repo_open(ctx);
+    if (!remotes && list_branches(argus, repo, "refs/heads/", verbose) < 0)
+        return 128;
+    if ((all || remotes) && list_branches(argus, repo, "refs/remotes/", verbose) < 0)
+        return 128;
+    return 0;
 }
 
 static bool has_deletion_flags(argus_t *argus)
@@ -244,7 +478,7 @@ static bool has_action_flags(argus_t *argus)
 
 int branch_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     const char *branchname = argus_get(argus, "branchname").as_string;
     const char *start_point = argus_get(argus, "start-point").as_string;
@@ -261,7 +495,7 @@ int branch_handler(argus_t *argus, void *data)
     
     if (has_deletion_flags(argus) && branchname) {
         if (!quiet) printf("Deleting branch '%s'...\n", branchname);
-        return handle_branch_deletion(argus, branchname);
+        return handle_branch_deletion(argus, repo_open(ctx), branchname);
     }
     
     if (has_move_copy_flags(argus) && branchname)
@@ -271,8 +505,7 @@ int branch_handler(argus_t *argus, void *data)
         return handle_branch_upstream(argus, branchname);
     
     if (branchname && !has_action_flags(argus))
-        return handle_branch_creation(argus, branchname, start_point);
+        return handle_branch_creation(argus, repo_open(ctx), branchname, start_point);
     
-    display_branch_list(argus, verbose, remotes, all);
-    return 0;
+    return display_branch_list(argus, ctx, verbose, remotes, all);
 }
\ No newline at end of file
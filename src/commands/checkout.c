@@ -5,14 +5,19 @@
 #include <unistd.h>
 
 #include "commands/git.h"
+#include "branch_switch.h"
 #include "colors.h"
 #include "git_types.h"
 #include "mock_data.h"
+#include "parallel_checkout.h"
+#include "repository.h"
+#include "revision.h"
+#include "tree.h"
 
 ARGUS_OPTIONS(
     checkout_options,
     HELP_OPTION(),
-    
+
     GROUP_START("Branch options"),
         OPTION_FLAG('b', NULL, 
             HELP("Create and checkout a new branch")),
@@ -27,7 +32,7 @@ ARGUS_OPTIONS(
         OPTION_FLAG('\0', "no-track", 
             HELP("Do not set upstream tracking")),
     GROUP_END(),
-    
+
     GROUP_START("Action options"),
         OPTION_FLAG('f', "force", 
             HELP("Force checkout (discard local modifications)")),
@@ -40,7 +45,7 @@ ARGUS_OPTIONS(
         OPTION_FLAG('p', "patch", 
             HELP("Interactively select hunks")),
     GROUP_END(),
-    
+
     GROUP_START("Output options"),
         OPTION_FLAG('q', "quiet", 
             HELP("Suppress feedback messages")),
@@ -75,12 +80,26 @@ static int handle_patch_mode(argus_t *argus)
     return -1;
 }
 
-static int handle_branch_creation(argus_t *argus, const char *tree_ish)
+static branch_switch_options_t switch_options_from(argus_t *argus, git_context_t *ctx)
+{
+    // --conflict implies --merge
+    const char *conflict_style = argus_get(argus, "conflict").as_string;
+    
+    return (branch_switch_options_t){
+        .force = argus_get(argus, "force").as_bool,
+        .merge = argus_get(argus, "merge").as_bool || conflict_style,
+        .style = merge_style_from_config(ctx, conflict_style),
+        .quiet = argus_get(argus, "quiet").as_bool,
+        .detach = argus_get(argus, "detach").as_bool,
+    };
+}
+
+// -b/-B: create <tree-ish> as a branch at the first <pathspec>, taken as the start point, or at HEAD
+static int handle_branch_creation(argus_t *argus, git_context_t *ctx, const char *tree_ish)
 {
     bool create_branch = argus_get(argus, "b").as_bool;
     bool force_create = argus_get(argus, "B").as_bool;
-    bool quiet = argus_get(argus, "quiet").as_bool;
-    const char *track_mode = argus_get(argus, "track").as_string;
+    bool track = argus_get(argus, "track").as_string && !argus_get(argus, "no-track").as_bool;
     
     if (create_branch || force_create) {
         if (!tree_ish) {
@@ -88,122 +107,121 @@ static int handle_branch_creation(argus_t *argus, const char *tree_ish)
             return 1;
         }
         
-        int commit_count;
-        const git_commit_t *commits = get_mock_commits(&commit_count);
-        const git_commit_t *latest = &commits[0];
+        const char *start = "HEAD";
+        argus_array_it_t it = argus_array_it(argus, "pathspec");
+        if (argus_is_set(argus, "pathspec") && argus_array_next(&it))
+            start = it.value.as_string;
         
-        const char *action = force_create ? "Reset" : "Switched to a new";
-        
-        if (!quiet) {
-            printf("%s branch '" COLOR_GREEN("%s") "'\n", action, tree_ish);
-            if (force_create)
-                printf("Your branch is now at " COLOR_YELLOW("%s") " " COLOR_BLUE("%s") "\n", 
-                       latest->hash, latest->message);
-        }
-        
-        if (track_mode && !quiet) {
-            int remote_count;
-            const git_remote_t *remotes = get_mock_remotes(&remote_count);
-            const char *remote_name = remote_count > 0 ? remotes[0].name : "origin";
-            printf("Branch '" COLOR_GREEN("%s") "' set up to track remote branch 'main' from '%s' by %s.\n", 
-                   tree_ish, remote_name, track_mode);
-        }
-        
-        return 0;
+        branch_switch_options_t opts = switch_options_from(argus, ctx);
+        return branch_switch_create(repo_open(ctx), tree_ish, start, force_create, track, &opts);
     }
     return -1;
 }
 
-static int handle_detached_head(argus_t *argus, const char *tree_ish)
+/*
+ * Whether `path` names a file to check out: one of `tree` when the index
+ * entries are reset from a tree-ish, and otherwise one of the index.
+ */
+static bool pathspec_matches(git_repository_t *repo, const char *path, const git_oid_t *tree)
 {
-    bool detach = argus_get(argus, "detach").as_bool;
-    bool quiet = argus_get(argus, "quiet").as_bool;
+    git_tree_entry_t entry;
     
-    if (detach && tree_ish) {
-        if (!quiet) {
-            int commit_count;
-            const git_commit_t *commits = get_mock_commits(&commit_count);
-            const git_commit_t *target_commit = &commits[0];
-            
-            printf("Note: switching to '" COLOR_YELLOW("%s") "'.\n\n", tree_ish);
-            printf("You are in 'detached HEAD' state. You can look around, make experimental\n");
-            printf("changes and commit them, and you can discard any commits you make in this\n");
-            printf("state without impacting any branches by switching back to a branch.\n\n");
-            printf("HEAD is now at " COLOR_YELLOW("%s") " " COLOR_BLUE("%s") "\n", 
-                   target_commit->hash, target_commit->message);
-        }
-        return 0;
-    }
-    return -1;
+    if (tree)
+        return tree_lookup_path(&repo->odb, tree, path, &entry) && !tree_entry_is_dir(&entry);
+    return index_find(&repo->index, path) >= 0;
 }
 
-static int handle_file_checkout(argus_t *argus)
+static int handle_file_checkout(argus_t *argus, git_context_t *ctx, const char *tree_ish)
 {
-    bool merge = argus_get(argus, "merge").as_bool;
     bool force = argus_get(argus, "force").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
-    const char *conflict_style = argus_get(argus, "conflict").as_string;
     
     if (!argus_is_set(argus, "pathspec"))
         return -1;
-
-    if (merge && !quiet)
-        printf("Merging changes to files...\n");
-
-    if (conflict_style && !quiet)
-        printf("Using conflict style: %s\n", conflict_style);
     
-    int file_status_count;
-    const git_file_status_t *file_statuses = get_mock_file_status(&file_status_count);
-        
+    git_repository_t *repo = repo_open(ctx);
+    parallel_checkout_t pc = parallel_checkout_init(repo);
+    const git_oid_t *tree = NULL;
+    
+    if (tree_ish) {
+        int commit = rev_resolve(repo, tree_ish);
+        if (commit < 0) {
+            fprintf(stderr, COLOR_RED("fatal: ") "invalid reference: %s\n", tree_ish);
+            return 128;
+        }
+        tree = &repo->commits[commit].tree;
+    }
+    
+    // Every pathspec is checked before any index entry changes
     argus_array_it_t it = argus_array_it(argus, "pathspec");
+    while (argus_array_next(&it)) {
+        if (!pathspec_matches(repo, it.value.as_string, tree)) {
+            printf(COLOR_RED("error: ") "pathspec '%s' did not match any file(s) known to git\n",
+                   it.value.as_string);
+            return 1;
+        }
+    }
+    
+    it = argus_array_it(argus, "pathspec");
     int file_count = 0;
-
+    
     while (argus_array_next(&it)) {
+        const char *path = it.value.as_string;
+        
+        // Checking out from a tree-ish also updates the index entries
+        if (tree)
+            repo_reset_path(repo, tree, path);
+        
+        const git_index_entry_t *entry = &repo->index.entries[index_find(&repo->index, path)];
+        parallel_checkout_add(&pc, entry->path, &entry->oid, entry->mode);
         file_count++;
         
         if (!quiet) {
-            const git_file_status_t *file_status = file_count <= file_status_count ? 
-                &file_statuses[file_count - 1] : &file_statuses[0];
-            
             const char *status_msg = force ? 
                 "Checked out '%s' (" COLOR_YELLOW("local modifications overwritten") ")\n" :
                 "Updated '%s'\n";
-            printf(status_msg, file_status->filename);
+            printf(status_msg, path);
         }
     }
-
+    
+    if (parallel_checkout_run(&pc) < 0)
+        return 128;
+    
     if (!quiet && file_count > 0)
         printf("Updated %d file(s)\n", file_count);
     
     return 0;
 }
 
-static int switch_branch(argus_t *argus, const char *tree_ish)
+/*
+ * Check out <tree-ish>. HEAD follows it when it names a local branch and
+ * --detach was not given; any other commit leaves HEAD detached at it.
+ */
+static int switch_branch(argus_t *argus, git_context_t *ctx, const char *tree_ish)
 {
-    bool quiet = argus_get(argus, "quiet").as_bool;
+    bool detach = argus_get(argus, "detach").as_bool;
     
     if (tree_ish) {
-        if (!quiet) {
-            int branch_count, remote_count;
-            const git_branch_t *branches = get_mock_branches(&branch_count);
-            const git_remote_t *remotes = get_mock_remotes(&remote_count);
-            
-            bool branch_exists = false;
-            for (int i = 0; i < branch_count; i++) {
-                if (strcmp(branches[i].name, tree_ish) == 0) {
-                    branch_exists = true;
-                    break;
-                }
+        git_repository_t *repo = repo_open(ctx);
+        branch_switch_options_t opts = switch_options_from(argus, ctx);
+        git_ref_t ref;
+        
+        // A local branch wins over a tag or remote-tracking branch of the same name
+        if (!detach && ref_store_lookup(&repo->refs, arena_sprintf(&ctx->arena, "refs/heads/%s", tree_ish), &ref)) {
+            int target = repo_find_commit_oid(repo, &ref.oid);
+            if (target < 0) {
+                fprintf(stderr, COLOR_RED("fatal: ") "invalid reference: %s\n", tree_ish);
+                return 128;
             }
-            
-            const char *remote_name = remote_count > 0 ? remotes[0].name : "origin";
-            
-            printf("Switched to branch '" COLOR_GREEN("%s") "'\n", tree_ish);
-            if (branch_exists)
-                printf("Your branch is up to date with '%s/%s'.\n", remote_name, tree_ish);
+            return branch_switch_to(repo, tree_ish, tree_ish, target, &opts);
         }
-        return 0;
+        
+        int target = rev_resolve(repo, tree_ish);
+        if (target < 0) {
+            printf(COLOR_RED("error: ") "pathspec '%s' did not match any file(s) known to git\n", tree_ish);
+            return 1;
+        }
+        return branch_switch_to(repo, tree_ish, NULL, target, &opts);
     }
     return -1;
 }
@@ -231,7 +249,7 @@ static void show_current_status(void)
 
 int checkout_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     const char *tree_ish = argus_get(argus, "tree-ish").as_string;
     int result;
@@ -239,16 +257,13 @@ int checkout_handler(argus_t *argus, void *data)
     if ((result = handle_patch_mode(argus)) != -1) 
         return result;
     
-    if ((result = handle_branch_creation(argus, tree_ish)) != -1) 
-        return result;
-    
-    if ((result = handle_detached_head(argus, tree_ish)) != -1) 
+    if ((result = handle_branch_creation(argus, ctx, tree_ish)) != -1) 
         return result;
     
-    if ((result = handle_file_checkout(argus)) != -1) 
+    if ((result = handle_file_checkout(argus, ctx, tree_ish)) != -1) 
         return result;
     
-    if ((result = switch_branch(argus, tree_ish)) != -1) 
+    if ((result = switch_branch(argus, ctx, tree_ish)) != -1) 
         return result;
     
     show_current_status();
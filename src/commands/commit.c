@@ -1,14 +1,26 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <argus.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "argus/regex.h"
 
 #include "commands/git.h"
 #include "colors.h"
+#include "config_utils.h"
+#include "git_context.h"
 #include "git_types.h"
 #include "mock_data.h"
+#include "repository.h"
+#include "strbuf.h"
 
 #define ARGUS_RE_AUTHOR_EMAIL                                                                  \
     MAKE_REGEX(                                                                                \
@@ -51,6 +63,11 @@ ARGUS_OPTIONS(
 
         OPTION_FLAG('s', "signoff",
             HELP("Add a Signed-off-by trailer")),
+
+        OPTION_STRING('\0', "cleanup",
+            HELP("How to strip spaces and #comments from the message"),
+            VALIDATOR(V_CHOICE_STR("strip", "whitespace", "verbatim", "scissors", "default")),
+            DEFAULT("default")),
     GROUP_END(),
 
     GROUP_START("Commit contents options"),
@@ -91,12 +108,16 @@ static bool validate_commit_message(argus_t *argus)
     return true;
 }
 
-static int handle_dry_run(argus_t *argus)
+static int handle_dry_run(argus_t *argus, git_context_t *ctx)
 {
     bool dry_run = argus_get(argus, "dry-run").as_bool;
     
     if (dry_run) {
-        printf("On branch " COLOR_GREEN("main") "\n");
+        git_repository_t *repo = repo_open(ctx);
+        if (repo->head_ref)
+            printf("On branch " COLOR_GREEN("%s") "\n", repo->head_ref);
+        else if (repo->head >= 0)
+            printf(COLOR_RED("HEAD detached at %s") "\n", repo->commits[repo->head].commit->hash);
         printf("Changes to be committed:\n");
         
         int file_count;
@@ -134,59 +155,245 @@ static void handle_patch_mode(argus_t *argus)
     }
 }
 
-static char* read_message_from_file(const char *filename)
+typedef enum {
+    CLEANUP_VERBATIM,
+    CLEANUP_WHITESPACE,
+    CLEANUP_STRIP,
+    CLEANUP_SCISSORS,
+} cleanup_mode_t;
+
+typedef struct {
+    strbuf_t buf;
+    cleanup_mode_t cleanup;
+    bool pending_blank_line;
+    bool cut;
+} message_builder_t;
+
+static const char scissors_line[] = "# ------------------------ >8 ------------------------";
+
+static cleanup_mode_t parse_cleanup_mode(const char *mode)
 {
-    if (!filename || strlen(filename) == 0)
-        return NULL;
+    if (mode && strcmp(mode, "verbatim") == 0)
+        return CLEANUP_VERBATIM;
+    if (mode && strcmp(mode, "strip") == 0)
+        return CLEANUP_STRIP;
+    if (mode && strcmp(mode, "scissors") == 0)
+        return CLEANUP_SCISSORS;
+    // Messages given with -m or -F are not edited, so "default" means "whitespace"
+    return CLEANUP_WHITESPACE;
+}
+
+static void message_add_line(message_builder_t *mb, const char *line, size_t len)
+{
+    if (mb->cleanup == CLEANUP_VERBATIM) {
+        strbuf_add(&mb->buf, line, len);
+        strbuf_addch(&mb->buf, '\n');
+        return;
+    }
+    
+    if (mb->cleanup == CLEANUP_SCISSORS && len == sizeof(scissors_line) - 1 &&
+        memcmp(line, scissors_line, len) == 0) {
+        mb->cut = true;
+        return;
+    }
+    
+    if (mb->cleanup == CLEANUP_STRIP && len > 0 && line[0] == '#')
+        return;
+    
+    while (len > 0 && isspace((unsigned char)line[len - 1]))
+        len--;
+    
+    // Runs of blank lines collapse into one; leading and trailing ones vanish
+    if (len == 0) {
+        mb->pending_blank_line = mb->buf.len > 0;
+        return;
+    }
+    
+    if (mb->pending_blank_line) {
+        strbuf_addch(&mb->buf, '\n');
+        mb->pending_blank_line = false;
+    }
+    strbuf_add(&mb->buf, line, len);
+    strbuf_addch(&mb->buf, '\n');
+}
+
+static void message_add_text(message_builder_t *mb, const char *text, size_t len)
+{
+    const char *end = text + len;
+    
+    while (text < end && !mb->cut) {
+        const char *eol = memchr(text, '\n', (size_t)(end - text));
+        size_t line_len = eol ? (size_t)(eol - text) : (size_t)(end - text);
         
-    FILE *file = fopen(filename, "r");
-    if (!file)
-        return NULL;
+        message_add_line(mb, text, line_len);
+        text += line_len + (eol ? 1 : 0);
+    }
+}
+
+static void message_add_paragraph(message_builder_t *mb, const char *text)
+{
+    if (mb->buf.len > 0) {
+        if (mb->cleanup == CLEANUP_VERBATIM)
+            strbuf_addch(&mb->buf, '\n');
+        else
+            mb->pending_blank_line = true;
+    }
+    message_add_text(mb, text, strlen(text));
+}
+
+static bool message_add_file(message_builder_t *mb, const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    // The caller reports errno, so the close on the way out must not clobber it
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return false;
+    }
+    
+    if (st.st_size > 0) {
+        size_t size = (size_t)st.st_size;
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            int saved_errno = errno;
+            close(fd);
+            errno = saved_errno;
+            return false;
+        }
         
-    static char buffer[1024];
-    if (fgets(buffer, sizeof(buffer), file)) {
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len-1] == '\n')
-            buffer[len-1] = '\0';
-        fclose(file);
-        return buffer;
+        strbuf_grow(&mb->buf, size);
+        message_add_text(mb, map, size);
+        munmap(map, size);
     }
     
-    fclose(file);
-    return NULL;
+    close(fd);
+    return true;
+}
+
+static bool is_trailer_line(const char *line, size_t len)
+{
+    size_t i = 0;
+    
+    while (i < len && (isalnum((unsigned char)line[i]) || line[i] == '-'))
+        i++;
+    return i > 0 && i + 1 < len && line[i] == ':' && line[i + 1] == ' ';
 }
 
-static const char* get_commit_message(argus_t *argus)
+static bool ends_with_trailer_block(const strbuf_t *sb)
 {
+    size_t end = sb->len;
+    bool has_lines = false;
+    
+    while (end > 0) {
+        size_t start = end - 1;
+        while (start > 0 && sb->buf[start - 1] != '\n')
+            start--;
+        
+        size_t line_len = end - 1 - start;
+        if (line_len == 0)
+            break;
+        if (!is_trailer_line(sb->buf + start, line_len))
+            return false;
+        
+        has_lines = true;
+        end = start;
+    }
+    // A message made of a single trailer-looking paragraph is just a subject
+    return has_lines && end > 0;
+}
+
+static void message_add_signoff(message_builder_t *mb, git_context_t *ctx)
+{
+    const char *trailer = arena_sprintf(&ctx->arena, "Signed-off-by: %s <%s>",
+                                        config_get(ctx, "user.name", "unknown"),
+                                        config_get(ctx, "user.email", "unknown"));
+    size_t trailer_len = strlen(trailer);
+    
+    // Do not repeat our own sign-off when it already closes the message
+    if (mb->buf.len > trailer_len &&
+        memcmp(mb->buf.buf + mb->buf.len - trailer_len - 1, trailer, trailer_len) == 0 &&
+        (mb->buf.len == trailer_len + 1 || mb->buf.buf[mb->buf.len - trailer_len - 2] == '\n'))
+        return;
+    
+    if (mb->buf.len > 0 && !ends_with_trailer_block(&mb->buf))
+        strbuf_addch(&mb->buf, '\n');
+    strbuf_addstr(&mb->buf, trailer);
+    strbuf_addch(&mb->buf, '\n');
+}
+
+static const char* get_commit_message(argus_t *argus, git_context_t *ctx)
+{
+    const char *file = argus_get(argus, "file").as_string;
+    bool signoff = argus_get(argus, "signoff").as_bool;
+    
+    message_builder_t mb = {
+        .buf = strbuf_init(&ctx->arena, 0),
+        .cleanup = parse_cleanup_mode(argus_get(argus, "cleanup").as_string),
+        .pending_blank_line = false,
+        .cut = false,
+    };
+    
     printf("message count: %ld\n", argus_count(argus, "message"));
     if (argus_is_set(argus, "message")) {
-        static char concatenated_message[2048];
-        concatenated_message[0] = '\0';
-        
         argus_array_it_t it = argus_array_it(argus, "message");
-        bool first = true;
-        
-        while (argus_array_next(&it)) {
-            if (!first) {
-                strcat(concatenated_message, "\n\n");
-            }
-            strcat(concatenated_message, it.value.as_string);
-            first = false;
+        while (argus_array_next(&it))
+            message_add_paragraph(&mb, it.value.as_string);
+    } else if (file && strlen(file) > 0) {
+        if (!message_add_file(&mb, file)) {
+            printf(COLOR_RED("fatal: ") "could not read log file '%s': %s\n", file, strerror(errno));
+            return NULL;
         }
-        
-        if (strlen(concatenated_message) > 0)
-            return concatenated_message;
+    } else {
+        message_add_paragraph(&mb, "Add new feature");
     }
     
-    const char *file = argus_get(argus, "file").as_string;
-    char *file_message = read_message_from_file(file);
-    if (file_message)
-        return file_message;
-        
-    return "Add new feature";
+    if (mb.buf.len == 0) {
+        printf(COLOR_RED("Aborting commit due to empty commit message.") "\n");
+        return NULL;
+    }
+    
+    if (signoff)
+        message_add_signoff(&mb, ctx);
+    
+    return mb.buf.buf;
+}
+
+static const char* format_identity(git_context_t *ctx, const char *author)
+{
+    if (author && strchr(author, '<'))
+        return author;
+    return arena_sprintf(&ctx->arena, "%s <%s>", config_get(ctx, "user.name", "unknown"),
+                         author && strlen(author) > 0 ? author : config_get(ctx, "user.email", "unknown"));
 }
 
-static void create_commit(argus_t *argus)
+static git_oid_t write_commit_object(git_repository_t *repo, git_context_t *ctx, const char *parent,
+                                     const char *author, const char *message)
+{
+    char tree_hex[GIT_OID_HEXSZ + 1];
+    long now = (long)time(NULL);
+    
+    // Only directories invalidated since the index was read get new trees
+    cache_tree_update(&repo->index, &repo->odb);
+    oid_to_hex(&repo->index.cache_tree->oid, tree_hex);
+    
+    strbuf_t buf = strbuf_init(&ctx->arena, strlen(message) + 256);
+    strbuf_addf(&buf, "tree %s\n", tree_hex);
+    if (parent)
+        strbuf_addf(&buf, "parent %s\n", parent);
+    strbuf_addf(&buf, "author %s %ld +0000\n", author, now);
+    strbuf_addf(&buf, "committer %s %ld +0000\n", format_identity(ctx, NULL), now);
+    strbuf_addch(&buf, '\n');
+    strbuf_addstr(&buf, message);
+    
+    return odb_write(&repo->odb, OBJ_COMMIT, buf.buf, buf.len)->oid;
+}
+
+static int create_commit(argus_t *argus, git_context_t *ctx)
 {
     bool verbose = argus_get(argus, "verbose").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
@@ -195,23 +402,47 @@ static void create_commit(argus_t *argus)
     bool all = argus_get(argus, "all").as_bool;
     const char *author = argus_get(argus, "author").as_string;
     
-    const char *message = get_commit_message(argus);
+    const char *message = get_commit_message(argus, ctx);
+    if (!message)
+        return 1;
+    
+    int file_count;
+    const git_file_status_t *files = get_mock_file_status(&file_count);
+    git_repository_t *repo = repo_open(ctx);
     
-    int commit_count;
-    const git_commit_t *commits = get_mock_commits(&commit_count);
+    if (repo->head < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "could not resolve HEAD commit\n");
+        return 128;
+    }
     
-    if (amend)
-        printf("[" COLOR_GREEN("main") " " COLOR_YELLOW("%s") "]" " " COLOR_BLUE("%s") "\n", 
-               commits[0].hash, message);
-    else
-        printf("[" COLOR_GREEN("main") " " COLOR_YELLOW("def5678") "]" " " COLOR_BLUE("%s") "\n", 
-               message);
+    // An amended commit takes the place of HEAD, so it gets HEAD's first parent
+    const git_commit_node_t *head = &repo->commits[repo->head];
+    const git_commit_node_t *parent_node = !amend ? head
+                                         : head->parent_count > 0 ? &repo->commits[head->parents[0]] : NULL;
+    char parent_hex[GIT_OID_HEXSZ + 1];
+    const char *parent = NULL;
+    if (parent_node) {
+        oid_to_hex(&parent_node->object->oid, parent_hex);
+        parent = parent_hex;
+    }
+    
+    if (all) {
+        git_refresh_result_t refresh;
+        repo_refresh_index(repo, true, &refresh);
+    }
+    
+    git_oid_t commit_oid = write_commit_object(repo, ctx, parent,
+                                               format_identity(ctx, author), message);
+    char commit_hex[GIT_OID_HEXSZ + 1];
+    oid_to_hex(&commit_oid, commit_hex);
+    
+    int subject_len = (int)strcspn(message, "\n");
+    printf("[" COLOR_GREEN("%s") " " COLOR_YELLOW("%.7s") "]" " " COLOR_BLUE("%.*s") "\n",
+           repo->head_ref ? repo->head_ref : "detached HEAD", commit_hex, subject_len, message);
     
     if (author && strlen(author) > 0)
         printf("Author: %s\n", author);
     
-    int file_count;
-    const git_file_status_t *files = get_mock_file_status(&file_count);
     int changed_files = 0;
     
     for (int i = 0; i < file_count; i++) {
@@ -233,24 +464,23 @@ static void create_commit(argus_t *argus)
         printf(" %d files changed, 15 insertions(+), 3 deletions(-)\n", changed_files);
     }
     
-    if (signoff) {
-        printf("\n%s\n\nSigned-off-by: John Doe <john.doe@example.com>\n", message);
-    }
+    if (signoff)
+        printf("\n%s", message);
+    
+    return 0;
 }
 
 int commit_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     if (!validate_commit_message(argus))
         return 1;
     
-    int dry_run_result = handle_dry_run(argus);
+    int dry_run_result = handle_dry_run(argus, ctx);
     if (dry_run_result != -1)
         return dry_run_result;
     
     handle_patch_mode(argus);
-    create_commit(argus);
-    
-    return 0;
+    return create_commit(argus, ctx);
 }
\ No newline at end of file
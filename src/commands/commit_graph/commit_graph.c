@@ -0,0 +1,24 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "commands/git.h"
+#include "commands/commit_graph.h"
+
+ARGUS_OPTIONS(
+    commit_graph_options,
+    HELP_OPTION(),
+
+    SUBCOMMAND("write", commit_graph_write_options,
+        HELP("Write the commit-graph file for the history"),
+        ACTION(commit_graph_write_handler)),
+)
+
+int commit_graph_handler(argus_t *argus, void *data)
+{
+    if (argus_has_command(argus))
+        return argus_exec(argus, data);
+    
+    argus_print_help(argus);
+    return 1;
+}
@@ -0,0 +1,33 @@
+#include <argus.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/commit_graph.h"
+#include "colors.h"
+#include "commit_graph.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    commit_graph_write_options,
+    HELP_OPTION(),
+
+    OPTION_FLAG('\0', "changed-paths", HELP("Compute and write a changed-path filter for each commit")),
+)
+
+int commit_graph_write_handler(argus_t *argus, void *data) {
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+
+    if (!getenv("GIT_DIR")) {
+        printf(COLOR_RED("fatal: ") "not a git repository: GIT_DIR is not set\n");
+        return 128;
+    }
+
+    if (commit_graph_write(repo, argus_get(argus, "changed-paths").as_bool) < 0) {
+        printf(COLOR_RED("fatal: ") "unable to write commit-graph: %s\n", strerror(errno));
+        return 128;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <argus.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "commands/git.h"
+#include "colors.h"
+#include "describe.h"
+#include "index.h"
+#include "repository.h"
+#include "revision.h"
+
+#define DESCRIBE_DEFAULT_ABBREV     7
+#define DESCRIBE_DEFAULT_CANDIDATES 10
+#define DESCRIBE_MIN_ABBREV         4
+
+ARGUS_OPTIONS(
+    describe_options,
+    HELP_OPTION(),
+
+    OPTION_FLAG('\0', "tags", HELP("Use any tag, including lightweight ones")),
+    OPTION_INT('\0', "abbrev", HELP("Use <n> digits of the commit name, 0 for the tag alone"), HINT("n")),
+    OPTION_INT('\0', "candidates", HELP("Consider up to <n> tags, 0 for exact matches only"), HINT("n")),
+    OPTION_STRING('\0', "dirty",
+        HELP("Append <mark> when the working tree has changes"),
+        HINT("mark"),
+        DEFAULT("-dirty"),
+        FLAGS(FLAG_OPTIONAL)),
+
+    POSITIONAL_MANY_STRING("commit-ish", HELP("Commits to describe, HEAD by default"), FLAGS(FLAG_OPTIONAL)),
+)
+
+/* Whether the index or the tracked files differ from HEAD. */
+static bool worktree_is_dirty(git_repository_t *repo)
+{
+    git_refresh_result_t refresh;
+    
+    repo_refresh_index(repo, false, &refresh);
+    if (refresh.change_count > 0)
+        return true;
+    if (cache_tree_update(&repo->index, &repo->odb) < 0)
+        return true;
+    return oid_cmp(&repo->index.cache_tree->oid, &repo->commits[repo->head].tree) != 0;
+}
+
+/* The shortest prefix of the commit's name, no shorter than `abbrev`, that no other commit shares. */
+static int unique_abbrev(const git_repository_t *repo, int pos, int abbrev)
+{
+    const char *hash = repo->commits[pos].commit->hash;
+    int len = (int)strlen(hash), shared = 0;
+    
+    for (int i = 0; i < repo->commit_count; i++) {
+        const char *other = repo->commits[i].commit->hash;
+        int common = 0;
+        if (i == pos)
+            continue;
+        while (hash[common] && hash[common] == other[common])
+            common++;
+        if (common > shared)
+            shared = common;
+    }
+    if (abbrev <= shared)
+        abbrev = shared + 1;
+    return abbrev < len ? abbrev : len;
+}
+
+static int describe_one(git_repository_t *repo, const describe_names_t *names, const describe_options_t *opts,
+                        const char *arg, int abbrev, const char *dirty)
+{
+    int pos = rev_resolve(repo, arg);
+    if (pos < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "Not a valid object name %s\n", arg);
+        return 128;
+    }
+    
+    const char *hash = repo->commits[pos].commit->hash;
+    describe_result_t result;
+    if (describe_commit(repo, names, pos, opts, &result) < 0) {
+        if (opts->candidates <= 0)
+            fprintf(stderr, COLOR_RED("fatal: ") "no tag exactly matches '%s'\n", hash);
+        else if (result.unannotated)
+            fprintf(stderr, COLOR_RED("fatal: ") "No annotated tags can describe '%s'.\n"
+                    "However, there were unannotated tags: try --tags.\n", hash);
+        else
+            fprintf(stderr, COLOR_RED("fatal: ") "No tags can describe '%s'.\n"
+                    "Try --always, or create some tags.\n", hash);
+        return 128;
+    }
+    
+    printf("%s", result.name->name);
+    if (result.depth > 0 && abbrev > 0)
+        printf("-%d-g%.*s", result.depth, unique_abbrev(repo, pos, abbrev), hash);
+    printf("%s\n", dirty ? dirty : "");
+    return 0;
+}
+
+int describe_handler(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+    bool has_commits = argus_is_set(argus, "commit-ish");
+    const char *dirty = NULL;
+    int abbrev = DESCRIBE_DEFAULT_ABBREV;
+    describe_options_t opts = {
+        .tags = argus_get(argus, "tags").as_bool,
+        .candidates = DESCRIBE_DEFAULT_CANDIDATES,
+    };
+    
+    if (argus_is_set(argus, "abbrev")) {
+        abbrev = argus_get(argus, "abbrev").as_int;
+        if (abbrev != 0 && abbrev < DESCRIBE_MIN_ABBREV)
+            abbrev = DESCRIBE_MIN_ABBREV;
+    }
+    if (argus_is_set(argus, "candidates"))
+        opts.candidates = argus_get(argus, "candidates").as_int;
+    
+    if (argus_is_set(argus, "dirty")) {
+        if (has_commits) {
+            fprintf(stderr, COLOR_RED("fatal: ") "options '--dirty' and 'commit-ishes' cannot be used together\n");
+            return 128;
+        }
+        if (repo->head >= 0 && worktree_is_dirty(repo))
+            dirty = argus_get(argus, "dirty").as_string;
+    }
+    
+    describe_names_t names = describe_names_build(repo, &ctx->arena);
+    if (names.count == 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "No names found, cannot describe anything.\n");
+        return 128;
+    }
+    
+    if (!has_commits)
+        return describe_one(repo, &names, &opts, "HEAD", abbrev, dirty);
+    
+    argus_array_it_t it = argus_array_it(argus, "commit-ish");
+    while (argus_array_next(&it)) {
+        int status = describe_one(repo, &names, &opts, it.value.as_string, abbrev, NULL);
+        if (status != 0)
+            return status;
+    }
+    return 0;
+}
@@ -1,13 +1,17 @@
 #include <argus.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "commands/git.h"
 #include "colors.h"
+#include "git_context.h"
 #include "git_types.h"
 #include "mock_data.h"
+#include "reftable.h"
 
 ARGUS_OPTIONS(
     init_options,
@@ -17,12 +21,17 @@ ARGUS_OPTIONS(
         OPTION_FLAG('q', "quiet", HELP("Only print error and warning messages")),
         OPTION_FLAG(0, "bare", HELP("Create a bare repository")),
     GROUP_END(),
-    
+
     GROUP_START("Branch options"),
         OPTION_STRING('b', "initial-branch", HELP("Use the specified name for the initial branch"), 
                       DEFAULT("main")),
     GROUP_END(),
 
+    GROUP_START("Storage options"),
+        OPTION_STRING(0, "ref-format", HELP("Specify the reference format to use"), HINT("format"),
+                      VALIDATOR(V_CHOICE_STR("files", "reftable")), DEFAULT("files")),
+    GROUP_END(),
+
     POSITIONAL_STRING("directory", HELP("Directory to initialize as git repository"),
                       DEFAULT("."), FLAGS(FLAG_OPTIONAL)),
 )
@@ -78,15 +87,87 @@ static void initialize_standard_repository(argus_t *argus, const char *directory
     display_initial_branch_info(argus, initial_branch);
 }
 
-int init_handler(argus_t *argus, void *data)
+static int make_dir(const char *path)
+{
+    if (mkdir(path, 0777) < 0 && errno != EEXIST) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot mkdir %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int write_file(const char *path, const char *content)
+{
+    FILE *file = fopen(path, "wx");
+    
+    if (!file || fputs(content, file) == EOF || fclose(file) == EOF) {
+        fprintf(stderr, COLOR_RED("fatal: ") "could not write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Lay down a repository whose refs live in a reftable stack: the stack,
+ * HEAD on the initial branch, `extensions.refStorage` in the config, and
+ * the objects directories. `refs/heads` is a file, as git makes it, so
+ * that a git without reftable support refuses the repository instead of
+ * finding no branches in it. An existing repository is never converted.
+ */
+static int create_reftable(git_context_t *ctx, const char *directory, const char *initial_branch, bool bare)
 {
-    (void)data;
+    const char *git_dir = bare ? directory : arena_sprintf(&ctx->arena, "%s/.git", directory);
+    const char *head = arena_sprintf(&ctx->arena, "%s/HEAD", git_dir);
+    struct stat st;
+    
+    if (stat(bare ? head : git_dir, &st) == 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "%s already exists; not converting it to reftable\n", git_dir);
+        return -1;
+    }
+    
+    const char *config = arena_sprintf(&ctx->arena,
+                                       "[core]\n"
+                                       "\trepositoryformatversion = 1\n"
+                                       "\tfilemode = true\n"
+                                       "\tbare = %s\n"
+                                       "[extensions]\n"
+                                       "\trefStorage = reftable\n",
+                                       bare ? "true" : "false");
+    if (make_dir(directory) < 0 || make_dir(git_dir) < 0 ||
+        make_dir(arena_sprintf(&ctx->arena, "%s/objects", git_dir)) < 0 ||
+        make_dir(arena_sprintf(&ctx->arena, "%s/objects/info", git_dir)) < 0 ||
+        make_dir(arena_sprintf(&ctx->arena, "%s/objects/pack", git_dir)) < 0 ||
+        make_dir(arena_sprintf(&ctx->arena, "%s/refs", git_dir)) < 0)
+        return -1;
+    
+    const char *reftable_dir = arena_sprintf(&ctx->arena, "%s/reftable", git_dir);
+    if (reftable_stack_create(reftable_dir) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot create %s/tables.list: %s\n", reftable_dir, strerror(errno));
+        return -1;
+    }
+    
+    if (write_file(arena_sprintf(&ctx->arena, "%s/refs/heads", git_dir),
+                   "this repository uses the reftable format\n") < 0 ||
+        write_file(arena_sprintf(&ctx->arena, "%s/config", git_dir), config) < 0)
+        return -1;
+    // Written last: a directory with HEAD in it is a repository
+    return write_file(head, arena_sprintf(&ctx->arena, "ref: refs/heads/%s\n", initial_branch));
+}
 
+int init_handler(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    
     const char *initial_branch = argus_get(argus, "initial-branch").as_string;
     const char *directory = argus_get(argus, "directory").as_string;
+    const char *ref_format = argus_get(argus, "ref-format").as_string;
+    bool bare = argus_get(argus, "bare").as_bool;
     
     int result;
     
+    if (strcmp(ref_format, "reftable") == 0 && create_reftable(ctx, directory, initial_branch, bare) < 0)
+        return 128;
+    
     if ((result = handle_bare_repository(argus, directory, initial_branch)) != -1)
         return result;
     
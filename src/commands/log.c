@@ -2,17 +2,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "commands/git.h"
 #include "colors.h"
+#include "commit_graph.h"
+#include "commit_grep.h"
+#include "config_utils.h"
+#include "date.h"
+#include "decorate.h"
+#include "diff.h"
+#include "diff_pipeline.h"
 #include "git_types.h"
-#include "mock_data.h"
+#include "log_graph.h"
+#include "mailmap.h"
+#include "repository.h"
+#include "revision.h"
 
 ARGUS_OPTIONS(
     log_options,
     HELP_OPTION(),
-    
+
     GROUP_START("Output format"),
         OPTION_FLAG('\0', "oneline", HELP("Show each commit on a single line")),
         OPTION_STRING('\0', "pretty",
@@ -22,31 +33,54 @@ ARGUS_OPTIONS(
             FLAGS(FLAG_OPTIONAL)),
         OPTION_STRING('\0', "format", HELP("Custom format string")),
         OPTION_FLAG('\0', "abbrev-commit", HELP("Show abbreviated commit hash")),
+        OPTION_STRING('\0', "date",
+            HELP("Date format: default, relative, local, iso, iso-strict, rfc, short, raw, unix or format:<strftime>"),
+            HINT("format")),
     GROUP_END(),
-    
+
     GROUP_START("Display options"),
         OPTION_FLAG('\0', "graph", HELP("Draw graphical commit history")),
+        OPTION_FLAG('\0', "topo-order", HELP("Show no parent before all of its children, as --graph does")),
         OPTION_STRING('\0', "decorate",
             HELP("Show ref names"),
             VALIDATOR(V_CHOICE_STR("short", "full", "no")),
             DEFAULT("short"),
             FLAGS(FLAG_OPTIONAL)),
+        OPTION_FLAG('\0', "use-mailmap", HELP("Show authors as .mailmap maps them")),
     GROUP_END(),
-    
+
     GROUP_START("Diff options"),
         OPTION_FLAG('p', "patch", HELP("Generate patch")),
         OPTION_FLAG('\0', "stat", HELP("Generate diffstat")),
+        OPTION_FLAG('\0', "numstat", HELP("Show added and deleted line counts")),
         OPTION_FLAG('\0', "shortstat", HELP("Show summary line only")),
         OPTION_FLAG('\0', "name-only", HELP("Show only filenames")),
         OPTION_FLAG('\0', "name-status", HELP("Show filenames with status")),
+        OPTION_STRING('\0', "diff-algorithm",
+            HELP("Choose a diff algorithm"),
+            VALIDATOR(V_CHOICE_STR("myers", "minimal", "patience", "histogram"))),
+        OPTION_FLAG('M', "find-renames", HELP("Detect renames")),
+        OPTION_FLAG('C', "find-copies", HELP("Detect copies as well as renames")),
+        OPTION_FLAG('\0', "no-renames", HELP("Turn off rename detection")),
     GROUP_END(),
-    
+
     GROUP_START("Limit options"),
         OPTION_INT('n', "max-count", HELP("Limit number of commits"), HINT("number")),
         OPTION_INT('\0', "skip", HELP("Skip commits"), HINT("number")),
+        OPTION_STRING('\0', "since", HELP("Show commits more recent than date"), HINT("date")),
+        OPTION_STRING('\0', "until", HELP("Show commits older than date"), HINT("date")),
+        OPTION_ARRAY_STRING('\0', "not", HELP("Exclude commits reachable from revision"), HINT("revision")),
+        OPTION_ARRAY_STRING('\0', "grep", HELP("Show commits whose message matches pattern"), HINT("pattern")),
+        OPTION_ARRAY_STRING('\0', "author", HELP("Show commits by an author matching pattern"), HINT("pattern")),
+        OPTION_ARRAY_STRING('\0', "committer", HELP("Show commits by a committer matching pattern"),
+            HINT("pattern")),
+        OPTION_FLAG('i', "regexp-ignore-case", HELP("Match patterns regardless of case")),
+        OPTION_FLAG('\0', "all-match", HELP("Show commits matching every --grep pattern")),
+        OPTION_FLAG('\0', "invert-grep", HELP("Show commits whose message does not match --grep")),
     GROUP_END(),
-    
-    POSITIONAL_MANY_STRING("revision", HELP("Show commits from revisions"), FLAGS(FLAG_OPTIONAL)),
+
+    POSITIONAL_MANY_STRING("revision", HELP("Show commits from revisions, or only those touching paths"),
+        FLAGS(FLAG_OPTIONAL)),
 )
 
 static void format_commit_hash(const git_commit_t *commit, argus_t *argus, char *display_hash)
@@ -61,142 +95,556 @@ static void format_commit_hash(const git_commit_t *commit, argus_t *argus, char
         strcpy(display_hash, commit->hash);
 }
 
-static void print_commit_decorations(int commit_index, argus_t *argus)
+static void print_commit_oneline(strbuf_t *out, const git_commit_t *commit, const char *display_hash,
+                                 const char *decorations)
 {
-    const char *decorate = argus_get(argus, "decorate").as_string;
+    strbuf_addf(out, COLOR_YELLOW("%s") "%s %s\n", display_hash, decorations, commit->message);
+}
+
+static void print_commit_standard(strbuf_t *out, const git_commit_t *commit, argus_t *argus, const char *display_hash,
+                                  const char *decorations, const char *ident, const char *date)
+{
+    const char *pretty = argus_get(argus, "pretty").as_string;
     
-    if (decorate && strcmp(decorate, "no") != 0) {
-        if (commit_index == 0)
-            printf(" (HEAD -> " COLOR_GREEN("main") ", " COLOR_CYAN("origin/main") ")");
-        else if (commit_index == 2)
-            printf(COLOR_BLUE(" (tag: v1.0.0)"));
+    strbuf_addf(out, "commit " COLOR_YELLOW("%s") "%s\n", display_hash, decorations);
+    
+    if (pretty && (strcmp(pretty, "full") == 0 || strcmp(pretty, "fuller") == 0)) {
+        strbuf_addf(out, "Author: " COLOR_BLUE("%s") "\n", ident);
+        strbuf_addf(out, "Commit: " COLOR_BLUE("%s") "\n", ident);
+    } else {
+        strbuf_addf(out, "Author: " COLOR_BLUE("%s") "\n", ident);
     }
+    
+    strbuf_addf(out, "Date:   %s\n\n", date);
+    strbuf_addf(out, "    %s\n", commit->message);
 }
 
-static void print_commit_oneline(const git_commit_t *commit, argus_t *argus, const char *display_hash)
+static diff_options_t log_diff_options(argus_t *argus, git_context_t *ctx)
 {
-    bool graph = argus_get(argus, "graph").as_bool;
+    diff_options_t opts = diff_options_init(ctx);
+    const char *algorithm = argus_get(argus, "diff-algorithm").as_string;
+    
+    if (algorithm)
+        opts.algorithm = diff_algorithm_from_config(ctx, algorithm);
+    if (argus_get(argus, "find-renames").as_bool)
+        opts.detect = DIFF_DETECT_RENAMES;
+    if (argus_get(argus, "find-copies").as_bool)
+        opts.detect = DIFF_DETECT_COPIES;
+    if (argus_get(argus, "no-renames").as_bool)
+        opts.detect = DIFF_DETECT_NONE;
     
-    if (graph)
-        printf("* ");
-    printf(COLOR_YELLOW("%s") " %s\n", display_hash, commit->message);
+    if (argus_get(argus, "patch").as_bool)
+        opts.format |= DIFF_FORMAT_PATCH;
+    if (argus_get(argus, "stat").as_bool)
+        opts.format |= DIFF_FORMAT_STAT;
+    if (argus_get(argus, "numstat").as_bool)
+        opts.format |= DIFF_FORMAT_NUMSTAT;
+    if (argus_get(argus, "shortstat").as_bool)
+        opts.format |= DIFF_FORMAT_SHORTSTAT;
+    if (argus_get(argus, "name-only").as_bool)
+        opts.format |= DIFF_FORMAT_NAME_ONLY;
+    if (argus_get(argus, "name-status").as_bool)
+        opts.format |= DIFF_FORMAT_NAME_STATUS;
+    return opts;
+}
+
+/* Bloom keys of each pathspec entry, for ruling commits out unread. */
+typedef struct {
+    git_pathspec_t pathspec;
+    bloom_key_t **keys;
+    size_t *key_counts;
+} log_paths_t;
+
+// Whether the path-limited graph shows a commit, judged once per commit
+typedef enum {
+    LOG_UNJUDGED,
+    LOG_VISIBLE,
+    LOG_HIDDEN,
+} log_visibility_t;
+
+typedef struct {
+    argus_t *argus;
+    git_repository_t *repo;
+    int *shown;
+    size_t shown_count;
+    int max_count;
+    int skip;
+    bool show_diff;
+    log_graph_t *graph;
+    rev_walk_t *revs;
+    const commit_grep_t *grep;
+    const log_paths_t *paths;
+    const commit_graph_t *changed_paths;
+    date_formatter_t dates;
+    const decoration_map_t *decorations;
+    bool full_decorations;
+    const mailmap_t *mailmap;
+    bool use_mailmap;
+    log_visibility_t *visible;
+    int *nearest;
+} log_walk_t;
+
+/* The grep filters read the raw commit object, before any formatting. */
+static bool commit_passes_grep(const commit_grep_t *grep, const git_repository_t *repo, int pos)
+{
+    const git_object_t *object = repo->commits[pos].object;
+    return grep->count == 0 || commit_grep_match(grep, object->data, object->size);
 }
 
-static void print_commit_standard(const git_commit_t *commit, argus_t *argus, const char *display_hash, int commit_index)
+static bool differs_in_paths(git_repository_t *repo, const git_oid_t *old_tree, const git_oid_t *new_tree,
+                             const git_pathspec_t *pathspec)
 {
-    bool graph = argus_get(argus, "graph").as_bool;
-    const char *pretty = argus_get(argus, "pretty").as_string;
+    arena_t scratch = arena_init(4096);
+    git_diff_list_t diff = diff_list_init(&scratch);
+    bool differs = tree_diff_limited(&repo->odb, old_tree, new_tree, pathspec, &diff) < 0 || diff.count > 0;
     
-    if (graph)
-        printf("* ");
-    printf("commit " COLOR_YELLOW("%s"), display_hash);
+    arena_free(&scratch);
+    return differs;
+}
+
+/*
+ * A commit touches the pathspec when it differs there from every parent.
+ * Filters from `commit-graph write --changed-paths` settle most commits
+ * without reading a tree; the rest, and all of them without a file, are
+ * diffed.
+ */
+static bool commit_touches_paths(git_repository_t *repo, const commit_graph_t *graph, const log_paths_t *paths,
+                                 int pos)
+{
+    const git_commit_node_t *node = &repo->commits[pos];
+    bool maybe = false;
     
-    print_commit_decorations(commit_index, argus);
-    printf("\n");
+    for (size_t i = 0; i < paths->pathspec.count && !maybe; i++)
+        maybe = commit_graph_maybe_changed(graph, pos, paths->keys[i], paths->key_counts[i]);
+    if (!maybe)
+        return false;
     
-    if (pretty && (strcmp(pretty, "full") == 0 || strcmp(pretty, "fuller") == 0)) {
-        printf("Author: " COLOR_BLUE("%s <%s>") "\n", commit->author, commit->email);
-        printf("Commit: " COLOR_BLUE("%s <%s>") "\n", commit->author, commit->email);
-    } else {
-        printf("Author: " COLOR_BLUE("%s <%s>") "\n", commit->author, commit->email);
+    if (node->parent_count == 0)
+        return differs_in_paths(repo, NULL, &node->tree, &paths->pathspec);
+    for (int p = 0; p < node->parent_count; p++) {
+        if (!differs_in_paths(repo, &repo->commits[node->parents[p]].tree, &node->tree, &paths->pathspec))
+            return false;
     }
+    return true;
+}
+
+/*
+ * The next commit to show, taken from the walk only when the pipeline
+ * asks for it, so rows print as the walk reaches them and --max-count
+ * stops it early. -1 at the end.
+ */
+static int next_shown(log_walk_t *walk)
+{
+    bool limited = walk->paths->pathspec.count > 0;
+    int pos;
     
-    printf("Date:   %s\n\n", commit->date);
-    printf("    %s\n", commit->message);
+    if (walk->max_count > 0 && (int)walk->shown_count >= walk->max_count)
+        return -1;
+    while ((pos = rev_walk_next(walk->revs)) >= 0) {
+        bool shown = commit_passes_grep(walk->grep, walk->repo, pos) &&
+                     (!limited || commit_touches_paths(walk->repo, walk->changed_paths, walk->paths, pos));
+        if (shown && walk->skip > 0) {
+            walk->skip--;
+            shown = false;
+        }
+        if (walk->visible)
+            walk->visible[pos] = shown ? LOG_VISIBLE : LOG_HIDDEN;
+        if (shown)
+            return pos;
+    }
+    return -1;
 }
 
-static void print_commit_stats(argus_t *argus)
+/*
+ * Producer side of the diff pipeline: a commit is diffed against its
+ * first parent. Merges, and commits shown without a diff, get an empty
+ * diff.
+ */
+static bool next_commit_trees(void *data, size_t i, const git_oid_t **old_tree, const git_oid_t **new_tree)
 {
-    bool stat = argus_get(argus, "stat").as_bool;
-    bool numstat = argus_get(argus, "numstat").as_bool;
-    bool shortstat = argus_get(argus, "shortstat").as_bool;
-    bool name_only = argus_get(argus, "name-only").as_bool;
-    bool name_status = argus_get(argus, "name-status").as_bool;
+    log_walk_t *walk = data;
+    if (i >= walk->shown_count) {
+        int pos = next_shown(walk);
+        if (pos < 0)
+            return false;
+        walk->shown[walk->shown_count++] = pos;
+    }
     
-    if (stat) {
-        printf("\n src/main.c     | 15 " COLOR_GREEN("+++++++") COLOR_RED("------") "\n");
-        printf(" src/utils.c    |  8 " COLOR_GREEN("+++++++") "\n");
-        printf(" 2 files changed, 17 insertions(+), 6 deletions(-)\n");
-    } else if (numstat) {
-        printf("\n17\t6\tsrc/main.c\n");
-        printf("8\t0\tsrc/utils.c\n");
-    } else if (shortstat) {
-        printf("\n 2 files changed, 17 insertions(+), 6 deletions(-)\n");
-    } else if (name_only) {
-        printf("\nsrc/main.c\n");
-        printf("src/utils.c\n");
-    } else if (name_status) {
-        printf("\nM\tsrc/main.c\n");
-        printf("A\tsrc/utils.c\n");
+    const git_commit_node_t *node = &walk->repo->commits[walk->shown[i]];
+    *old_tree = *new_tree = NULL;
+    *new_tree = &node->tree;
+    if (!walk->show_diff || node->parent_count > 1)
+        *old_tree = &node->tree;
+    else if (node->parent_count == 1)
+        *old_tree = &walk->repo->commits[node->parents[0]].tree;
+    return true;
+}
+
+/*
+ * Under a path limit a parent may not be shown, and the graph draws the
+ * line on to its nearest shown ancestor along first parents instead.
+ * `nearest` caches the answer, so each commit is walked past once. An
+ * ancestor the walk has not reached yet is judged when first asked.
+ */
+static int first_parent(const git_repository_t *repo, int pos)
+{
+    return repo->commits[pos].parent_count > 0 ? repo->commits[pos].parents[0] : -1;
+}
+
+static bool commit_visible(log_walk_t *walk, int pos)
+{
+    if (walk->visible[pos] == LOG_UNJUDGED) {
+        bool shown = !rev_walk_excluded(walk->revs, pos) && commit_passes_grep(walk->grep, walk->repo, pos) &&
+                     commit_touches_paths(walk->repo, walk->changed_paths, walk->paths, pos);
+        walk->visible[pos] = shown ? LOG_VISIBLE : LOG_HIDDEN;
     }
+    return walk->visible[pos] == LOG_VISIBLE;
 }
 
-static void print_commit_patch(argus_t *argus)
+static int shown_ancestor(log_walk_t *walk, int pos)
 {
-    bool patch = argus_get(argus, "patch").as_bool;
+    int at = pos;
+    
+    while (at >= 0 && walk->nearest[at] == -2 && !commit_visible(walk, at))
+        at = first_parent(walk->repo, at);
     
-    if (patch) {
-        printf("\ndiff --git a/src/main.c b/src/main.c\n");
-        printf("index abc1234..def5678 100644\n");
-        printf(COLOR_RED("---") " a/src/main.c\n");
-        printf(COLOR_GREEN("+++") " b/src/main.c\n");
-        printf("@@ -10,6 +10,9 @@ int main() {\n");
-        printf("+    // New functionality added\n");
-        printf("     return 0;\n");
-        printf(" }\n");
+    int found = at < 0 ? -1 : commit_visible(walk, at) ? at : walk->nearest[at];
+    for (int p = pos; p != at; p = first_parent(walk->repo, p))
+        walk->nearest[p] = found;
+    return found;
+}
+
+static int graph_parents(log_walk_t *walk, int pos, int *parents)
+{
+    const git_commit_node_t *node = &walk->repo->commits[pos];
+    int count = 0;
+    
+    for (int p = 0; p < node->parent_count; p++) {
+        int parent = walk->visible ? shown_ancestor(walk, node->parents[p]) : node->parents[p];
+        if (parent < 0 || rev_walk_excluded(walk->revs, parent) || !commit_passes_grep(walk->grep, walk->repo, parent))
+            continue;
+        if (count == 0 || parents[0] != parent)
+            parents[count++] = parent;
+    }
+    return count;
+}
+
+/* Copy `text` line by line, each after the graph prefix of its row. */
+static void add_graph_lines(log_graph_t *graph, strbuf_t *out, const char *text)
+{
+    while (*text) {
+        const char *end = strchr(text, '\n');
+        size_t len = end ? (size_t)(end - text) : strlen(text);
+        log_graph_prefix(graph, out);
+        strbuf_add(out, text, len);
+        strbuf_addch(out, '\n');
+        text += end ? len + 1 : len;
     }
 }
 
-static void display_commits(argus_t *argus, const git_commit_t *commits, int start, int end)
+static void commit_identity(const log_walk_t *walk, const git_commit_t *commit, bool mapped, const char **name,
+                            size_t *name_len, const char **email, size_t *email_len)
 {
+    *name = commit->author;
+    *name_len = strlen(commit->author);
+    *email = commit->email;
+    *email_len = strlen(commit->email);
+    if (mapped && walk->mailmap)
+        mailmap_map(walk->mailmap, name, name_len, email, email_len);
+}
+
+/*
+ * Expand a --format, or "format:" or "tformat:", string: %H, %h, %an, %ae,
+ * %aN and %aE (as .mailmap maps them), %ad, %s, %d, %n and %%. Other
+ * placeholders are copied as they are.
+ */
+static void format_commit_custom(strbuf_t *out, log_walk_t *walk, const git_commit_t *commit, int pos,
+                                 const char *format, const char *decorations)
+{
+    const char *name, *email;
+    size_t name_len, email_len;
+    
+    if (strncmp(format, "format:", 7) == 0)
+        format += 7;
+    else if (strncmp(format, "tformat:", 8) == 0)
+        format += 8;
+    for (const char *p = format; *p; p++) {
+        if (*p != '%' || !p[1]) {
+            strbuf_addch(out, *p);
+            continue;
+        }
+        
+        p++;
+        if (*p == 'a' && p[1] && strchr("neNEd", p[1])) {
+            char field = *++p;
+            if (field == 'd') {
+                date_format(&walk->dates, walk->repo->commits[pos].date, walk->repo->commits[pos].tz, out);
+                continue;
+            }
+            commit_identity(walk, commit, walk->use_mailmap || field == 'N' || field == 'E', &name, &name_len,
+                            &email, &email_len);
+            if (field == 'n' || field == 'N')
+                strbuf_add(out, name, name_len);
+            else
+                strbuf_add(out, email, email_len);
+            continue;
+        }
+        switch (*p) {
+        case 'H': strbuf_addstr(out, commit->hash); break;
+        case 'h': strbuf_addf(out, "%.7s", commit->hash); break;
+        case 's': strbuf_addstr(out, commit->message); break;
+        case 'd': strbuf_addstr(out, decorations); break;
+        case 'n': strbuf_addch(out, '\n'); break;
+        case '%': strbuf_addch(out, '%'); break;
+        default:
+            strbuf_addch(out, '%');
+            strbuf_addch(out, *p);
+            break;
+        }
+    }
+    strbuf_addch(out, '\n');
+}
+
+static int emit_commit(void *data, size_t i, const strbuf_t *diff)
+{
+    log_walk_t *walk = data;
+    argus_t *argus = walk->argus;
     bool oneline = argus_get(argus, "oneline").as_bool;
     const char *pretty = argus_get(argus, "pretty").as_string;
     const char *custom_format = argus_get(argus, "format").as_string;
+    int pos = walk->shown[i];
+    const git_commit_t *commit = walk->repo->commits[pos].commit;
+    char display_hash[41];
+    arena_t scratch = arena_init(4096);
+    strbuf_t text = strbuf_init(&scratch, 1024);
     
-    for (int i = start; i < end; i++) {
-        const git_commit_t *commit = &commits[i];
-        char display_hash[41];
-        
-        format_commit_hash(commit, argus, display_hash);
+    strbuf_t refs = strbuf_init(&scratch, 64);
+    
+    format_commit_hash(commit, argus, display_hash);
+    if (walk->decorations)
+        decoration_format(walk->decorations, &walk->repo->commits[pos].object->oid, walk->full_decorations, &refs);
+    
+    if (oneline || (pretty && strcmp(pretty, "oneline") == 0)) {
+        print_commit_oneline(&text, commit, display_hash, refs.buf);
+        strbuf_add(&text, diff->buf, diff->len);
+    } else if (custom_format) {
+        format_commit_custom(&text, walk, commit, pos, custom_format, refs.buf);
+    } else {
+        const char *name, *email;
+        size_t name_len, email_len;
+        strbuf_t date = strbuf_init(&scratch, 64);
+        strbuf_t ident = strbuf_init(&scratch, 64);
+        date_format(&walk->dates, walk->repo->commits[pos].date, walk->repo->commits[pos].tz, &date);
+        commit_identity(walk, commit, walk->use_mailmap, &name, &name_len, &email, &email_len);
+        strbuf_addf(&ident, "%.*s <%.*s>", (int)name_len, name, (int)email_len, email);
+        print_commit_standard(&text, commit, argus, display_hash, refs.buf, ident.buf, date.buf);
+        if (diff->len > 0)
+            strbuf_addf(&text, "\n%s", diff->buf);
+        strbuf_addch(&text, '\n');
+    }
+    
+    if (walk->graph) {
+        int parents[2];
+        strbuf_t out = strbuf_init(&scratch, text.len + text.len / 2);
+        log_graph_commit(walk->graph, pos, parents, graph_parents(walk, pos, parents), &out);
+        add_graph_lines(walk->graph, &out, text.buf);
+        fwrite(out.buf, 1, out.len, stdout);
+    } else {
+        fwrite(text.buf, 1, text.len, stdout);
+    }
+    
+    arena_free(&scratch);
+    return 0;
+}
+
+/*
+ * Compile --author, --committer and --grep into `grep`, each option
+ * as many times as given, along with --all-match and --invert-grep.
+ */
+static int parse_log_grep(argus_t *argus, commit_grep_t *grep)
+{
+    static const struct {
+        const char *option;
+        commit_grep_field_t field;
+    } filters[] = {
+        { "author", COMMIT_GREP_AUTHOR },
+        { "committer", COMMIT_GREP_COMMITTER },
+        { "grep", COMMIT_GREP_MESSAGE },
+    };
+    
+    for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        if (!argus_is_set(argus, filters[i].option))
+            continue;
         
-        if (oneline || (pretty && strcmp(pretty, "oneline") == 0)) {
-            print_commit_oneline(commit, argus, display_hash);
-        } else if (custom_format) {
-            printf("%s %s by %s\n", display_hash, commit->message, commit->author);
-        } else {
-            print_commit_standard(commit, argus, display_hash, i);
-            print_commit_stats(argus);
-            print_commit_patch(argus);
-            printf("\n");
+        argus_array_it_t it = argus_array_it(argus, filters[i].option);
+        while (argus_array_next(&it)) {
+            if (commit_grep_add(grep, filters[i].field, it.value.as_string) < 0) {
+                fprintf(stderr, COLOR_RED("fatal: ") "command line, '%s': %s\n", it.value.as_string, grep->error);
+                return 128;
+            }
         }
     }
+    grep->all_match = argus_get(argus, "all-match").as_bool;
+    grep->invert = argus_get(argus, "invert-grep").as_bool;
+    return 0;
 }
 
-int log_handler(argus_t *argus, void *data)
+static int parse_log_dates(argus_t *argus, long long now, rev_walk_t *revs, date_mode_t *mode)
 {
-    (void)data;
-    
-    int total_count;
-    const git_commit_t *commits = get_mock_commits(&total_count);
-    int max_count = argus_get(argus, "max-count").as_int;
-    int skip = argus_get(argus, "skip").as_int;
+    const char *format = argus_get(argus, "date").as_string;
+    const char *bounds[] = { "since", "until" };
     
-    int start_index = skip;
-    int end_count = total_count;
-    
-    if (max_count > 0)
-        end_count = start_index + max_count;
-    if (end_count > total_count)
-        end_count = total_count;
+    *mode = (date_mode_t){ .type = DATE_NORMAL };
+    if (format && date_mode_parse(format, mode) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "unknown date format %s\n", format);
+        return 128;
+    }
+    for (size_t i = 0; i < 2; i++) {
+        const char *text = argus_get(argus, bounds[i]).as_string;
+        long long when;
+        int tz;
+        if (!text)
+            continue;
+        if (date_parse(text, now, true, &when, &tz) < 0) {
+            fprintf(stderr, COLOR_RED("fatal: ") "invalid date '%s'\n", text);
+            return 128;
+        }
+        *(i == 0 ? &revs->since : &revs->until) = when;
+    }
+    return 0;
+}
+
+/*
+ * Arguments that name commits, ranges included, set up the walk; the
+ * rest are paths, as after "--". A trailing slash is dropped, and "."
+ * limits nothing. With no commit named the walk starts at HEAD.
+ */
+static int parse_log_args(argus_t *argus, git_repository_t *repo, rev_walk_t *revs, log_paths_t *paths)
+{
+    arena_t *arena = &repo->ctx->arena;
+    size_t alloc = (size_t)argus_count(argus, "revision") + 1;
+    const char **list = arena_alloc(arena, alloc * sizeof(*list));
+    bool everything = false;
     
+    paths->pathspec = (git_pathspec_t){ list, 0 };
     if (argus_is_set(argus, "revision")) {
         argus_array_it_t it = argus_array_it(argus, "revision");
         while (argus_array_next(&it)) {
-            printf("Showing commits for revision: %s\n", it.value.as_string);
+            const char *arg = it.value.as_string;
+            if (rev_parse_arg(revs, arg, false) == 0)
+                continue;
+            if (strpbrk(arg, "^~") || strstr(arg, "..") || strstr(arg, "@{")) {
+                fprintf(stderr, COLOR_RED("fatal: ") "bad revision '%s'\n", arg);
+                return 128;
+            }
+            
+            size_t len = strlen(arg);
+            while (len > 1 && arg[len - 1] == '/')
+                len--;
+            if (strncmp(arg, "./", 2) == 0 && len > 2) {
+                arg += 2;
+                len -= 2;
+            }
+            if ((len == 1 && arg[0] == '.') || len == 0)
+                everything = true;
+            else
+                list[paths->pathspec.count++] = arena_strndup(arena, arg, len);
+        }
+    }
+    if (everything)
+        paths->pathspec.count = 0;
+    
+    if (argus_is_set(argus, "not")) {
+        argus_array_it_t it = argus_array_it(argus, "not");
+        while (argus_array_next(&it)) {
+            if (rev_parse_arg(revs, it.value.as_string, true) < 0) {
+                fprintf(stderr, COLOR_RED("fatal: ") "bad revision '%s'\n", it.value.as_string);
+                return 128;
+            }
+        }
+    }
+    if (revs->interesting_tips == 0 && repo->head >= 0)
+        rev_add_tip(revs, repo->head, false);
+    
+    paths->keys = arena_alloc(arena, alloc * sizeof(*paths->keys));
+    paths->key_counts = arena_alloc(arena, alloc * sizeof(*paths->key_counts));
+    for (size_t i = 0; i < paths->pathspec.count; i++)
+        paths->key_counts[i] = bloom_keys_for_path(arena, list[i], &paths->keys[i]);
+    return 0;
+}
+
+int log_handler(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+    
+    rev_walk_t revs = rev_walk_init(repo);
+    commit_grep_t grep = commit_grep_init(&ctx->arena, argus_get(argus, "regexp-ignore-case").as_bool);
+    long long now = (long long)time(NULL);
+    date_mode_t date_mode;
+    log_paths_t paths;
+    if (parse_log_grep(argus, &grep) != 0 || parse_log_dates(argus, now, &revs, &date_mode) != 0 ||
+        parse_log_args(argus, repo, &revs, &paths) != 0) {
+        commit_grep_free(&grep);
+        return 128;
+    }
+    
+    // git draws the graph over a topological order
+    revs.topo_order = argus_get(argus, "graph").as_bool || argus_get(argus, "topo-order").as_bool;
+    
+    diff_options_t opts = log_diff_options(argus, ctx);
+    opts.pathspec = paths.pathspec;
+    log_walk_t walk = {
+        .argus = argus,
+        .repo = repo,
+        .shown = arena_alloc(&ctx->arena, ((size_t)repo->commit_count + 1) * sizeof(int)),
+        .max_count = argus_get(argus, "max-count").as_int,
+        .skip = argus_get(argus, "skip").as_int,
+        .revs = &revs,
+        .grep = &grep,
+        .paths = &paths,
+        .changed_paths = paths.pathspec.count > 0 ? commit_graph_open_changed_paths(repo) : NULL,
+        .dates = date_formatter_init(date_mode, now),
+        .show_diff = opts.format != 0 && !argus_get(argus, "format").as_string,
+    };
+    const char *decorate = argus_get(argus, "decorate").as_string;
+    decoration_map_t decorations;
+    if (decorate && strcmp(decorate, "no") != 0) {
+        decorations = decoration_map_build(repo, &ctx->arena);
+        walk.decorations = &decorations;
+        walk.full_decorations = strcmp(decorate, "full") == 0;
+    }
+    
+    // The mailmap is only read when something shows mapped identities
+    const char *format = argus_get(argus, "format").as_string;
+    mailmap_t mailmap;
+    walk.use_mailmap = argus_get(argus, "use-mailmap").as_bool || config_get_bool(ctx, "log.mailmap", false);
+    if (walk.use_mailmap || (format && (strstr(format, "%aN") || strstr(format, "%aE")))) {
+        mailmap = mailmap_init(&ctx->arena);
+        mailmap_read(&mailmap, repo);
+        walk.mailmap = &mailmap;
+    }
+    log_graph_t graph;
+    if (argus_get(argus, "graph").as_bool) {
+        graph = log_graph_init(&ctx->arena, repo->commit_count);
+        walk.graph = &graph;
+        if (paths.pathspec.count > 0) {
+            walk.visible = arena_calloc(&ctx->arena, (size_t)repo->commit_count + 1, sizeof(*walk.visible));
+            walk.nearest = arena_alloc(&ctx->arena, ((size_t)repo->commit_count + 1) * sizeof(*walk.nearest));
+            for (int pos = 0; pos < repo->commit_count; pos++)
+                walk.nearest[pos] = -2;
         }
-        printf("\n");
     }
     
-    display_commits(argus, commits, start_index, end_count);
+    // Commits are diffed ahead on worker threads and printed in log order
+    int rc = diff_pipeline_run(repo, &opts, next_commit_trees, emit_commit, &walk) < 0 ? 128 : 0;
+    commit_grep_free(&grep);
+    if (rc != 0)
+        return rc;
+    if (walk.graph) {
+        strbuf_t rest = strbuf_init(&ctx->arena, 256);
+        log_graph_flush(walk.graph, &rest);
+        fwrite(rest.buf, 1, rest.len, stdout);
+    }
     return 0;
-}
\ No newline at end of file
+}
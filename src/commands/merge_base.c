@@ -0,0 +1,92 @@
+#include <argus.h>
+#include <stdio.h>
+
+#include "commands/git.h"
+#include "colors.h"
+#include "merge_base.h"
+#include "repository.h"
+#include "revision.h"
+
+ARGUS_OPTIONS(
+    merge_base_options,
+    HELP_OPTION(),
+
+    OPTION_FLAG('a', "all", HELP("Output all common ancestors")),
+    OPTION_FLAG('\0', "octopus", HELP("Find ancestors for a single n-way merge")),
+    OPTION_FLAG('\0', "independent", HELP("List revs not reachable from others")),
+    OPTION_FLAG('\0', "is-ancestor", HELP("Is the first one ancestor of the other?")),
+
+    POSITIONAL_MANY_STRING("commit", HELP("Commits to find the merge bases of")),
+)
+
+/* The positions of the commit arguments, or NULL if one names no commit. */
+static int* resolve_commits(argus_t *argus, git_repository_t *repo, size_t *count)
+{
+    int *commits = arena_alloc(&repo->ctx->arena, (argus_count(argus, "commit") + 1) * sizeof(*commits));
+    argus_array_it_t it = argus_array_it(argus, "commit");
+    
+    *count = 0;
+    while (argus_array_next(&it)) {
+        int pos = rev_resolve(repo, it.value.as_string);
+        if (pos < 0) {
+            fprintf(stderr, COLOR_RED("fatal: ") "Not a valid object name %s\n", it.value.as_string);
+            return NULL;
+        }
+        commits[(*count)++] = pos;
+    }
+    return commits;
+}
+
+static int print_commits(const git_repository_t *repo, merge_base_list_t list, bool all)
+{
+    if (list.count == 0)
+        return 1;
+    
+    for (size_t i = 0; i < list.count && (all || i == 0); i++)
+        printf("%s\n", repo->commits[list.commits[i]].commit->hash);
+    return 0;
+}
+
+int merge_base_handler(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    bool all = argus_get(argus, "all").as_bool;
+    bool octopus = argus_get(argus, "octopus").as_bool;
+    bool independent = argus_get(argus, "independent").as_bool;
+    bool is_ancestor = argus_get(argus, "is-ancestor").as_bool;
+    
+    if (octopus + independent + is_ancestor > 1) {
+        fprintf(stderr, COLOR_RED("fatal: ") "options '--octopus', '--independent' and '--is-ancestor' "
+                "cannot be used together\n");
+        return 128;
+    }
+    if (all && (independent || is_ancestor)) {
+        fprintf(stderr, COLOR_RED("fatal: ") "options '%s' and '--all' cannot be used together\n",
+                independent ? "--independent" : "--is-ancestor");
+        return 128;
+    }
+    
+    git_repository_t *repo = repo_open(ctx);
+    size_t count;
+    int *commits = resolve_commits(argus, repo, &count);
+    if (!commits)
+        return 128;
+    
+    if (is_ancestor) {
+        if (count != 2) {
+            fprintf(stderr, COLOR_RED("fatal: ") "--is-ancestor takes exactly two commits\n");
+            return 128;
+        }
+        return merge_base_is_ancestor(repo, commits[0], commits[1]) ? 0 : 1;
+    }
+    if (octopus)
+        return print_commits(repo, merge_bases_octopus(repo, commits, count, &ctx->arena), all);
+    if (independent)
+        return print_commits(repo, merge_base_independent(repo, commits, count, &ctx->arena), true);
+    
+    if (count < 2) {
+        fprintf(stderr, COLOR_RED("fatal: ") "merge-base needs at least two commits\n");
+        return 128;
+    }
+    return print_commits(repo, merge_bases_many(repo, commits[0], commits + 1, count - 1, &ctx->arena), all);
+}
@@ -7,22 +7,26 @@
 #include "commands/git.h"
 #include "colors.h"
 #include "git_types.h"
+#include "merge.h"
+#include "merge_base.h"
 #include "mock_data.h"
+#include "parallel_checkout.h"
+#include "repository.h"
 
 ARGUS_OPTIONS(
     pull_options,
     HELP_OPTION(),
-    
+
     GROUP_START("General options"),
         OPTION_FLAG('q', "quiet", HELP("Operate quietly")),
         OPTION_FLAG('v', "verbose", HELP("Be more verbose")),
     GROUP_END(),
-    
+
     GROUP_START("Fetch options"),
         OPTION_FLAG('\0', "all", HELP("Fetch all remotes")),
         OPTION_FLAG('t', "tags", HELP("Fetch all tags")),
     GROUP_END(),
-    
+
     GROUP_START("Merge options"),  
         OPTION_FLAG('\0', "no-commit", HELP("Do not commit the merge")),
         OPTION_FLAG('\0', "ff-only", HELP("Only allow fast-forward")),
@@ -30,11 +34,11 @@ ARGUS_OPTIONS(
         OPTION_FLAG('\0', "squash", HELP("Squash commits")),
         OPTION_FLAG('\0', "autostash", HELP("Automatically stash/unstash")),
     GROUP_END(),
-    
+
     GROUP_START("Rebase options"),
         OPTION_FLAG('r', "rebase", HELP("Rebase instead of merge")),
     GROUP_END(),
-    
+
     POSITIONAL_STRING("repository", HELP("Repository to pull from"), DEFAULT("origin"), FLAGS(FLAG_OPTIONAL)),
     POSITIONAL_STRING("refspec", HELP("Refspec to pull"), FLAGS(FLAG_OPTIONAL)),
 )
@@ -83,57 +87,136 @@ static void execute_fetch(argus_t *argus, const char *repository, const char *re
     }
 }
 
-static void execute_merge_or_rebase(argus_t *argus)
+static int execute_rebase(argus_t *argus)
 {
-    bool rebase = argus_get(argus, "rebase").as_bool;
-    bool ff_only = argus_get(argus, "ff-only").as_bool;
-    bool no_ff = argus_get(argus, "no-ff").as_bool;
     bool quiet = argus_get(argus, "quiet").as_bool;
     bool verbose = argus_get(argus, "verbose").as_bool;
-    const char *strategy = argus_get(argus, "strategy").as_string;
     
-    if (rebase) {
-        if (!quiet)
-            printf(COLOR_BLUE("Rebasing...") "\n");
-        printf("Successfully rebased and updated refs/heads/main.\n");
-        
-        if (verbose) {
-            printf("First, rewinding head to replay your work on top of it...\n");
-            printf("Applying: Add new feature implementation\n");
-            printf("Applying: Fix validation bug in user input\n");
-            printf("Applying: Update documentation for new API\n");
-        }
-    } else {
-        if (ff_only) {
-            printf(COLOR_GREEN("Updating abc1234..def5678") "\n");
-            printf(COLOR_GREEN("Fast-forward") "\n");
-        } else if (no_ff) {
-            printf("Merge made by the '%s' strategy.\n", strategy ? strategy : "ort");
-        } else {
-            printf(COLOR_GREEN("Updating abc1234..def5678") "\n");
-            printf(COLOR_GREEN("Fast-forward") "\n");
-        }
-        
-        if (!quiet) {
-            printf(" src/main.c           | 8 " COLOR_GREEN("+++++") COLOR_RED("---") "\n");
-            printf(" tests/test_api.c     | 12 " COLOR_GREEN("+++++++++") COLOR_RED("---") "\n");
-            printf(" docs/README.md       | 3 " COLOR_GREEN("+++") "\n");
-            printf(" 3 files changed, 20 insertions(" COLOR_GREEN("+") "), 6 deletions(" COLOR_RED("-") ")\n");
-        }
+    if (!quiet)
+        printf(COLOR_BLUE("Rebasing...") "\n");
+    printf("Successfully rebased and updated refs/heads/main.\n");
+    
+    if (verbose) {
+        printf("First, rewinding head to replay your work on top of it...\n");
+        printf("Applying: Add new feature implementation\n");
+        printf("Applying: Fix validation bug in user input\n");
+        printf("Applying: Update documentation for new API\n");
     }
+    return 0;
+}
+
+static int fast_forward(argus_t *argus, git_repository_t *repo, int upstream)
+{
+    bool quiet = argus_get(argus, "quiet").as_bool;
+    checkout_switch_options_t opts = { .force = false };
+    
+    if (!quiet) {
+        printf(COLOR_GREEN("Updating %s..%s") "\n", repo->commits[repo->head].commit->hash,
+               repo->commits[upstream].commit->hash);
+        printf(COLOR_GREEN("Fast-forward") "\n");
+    }
+    
+    if (checkout_switch_tree(repo, &repo->commits[repo->head].tree, &repo->commits[upstream].tree, &opts) < 0)
+        return 1;
+    repo_set_head(repo, repo->head_ref, upstream);
+    return 0;
+}
+
+/*
+ * The whole merge runs on trees in memory; the index and worktree are
+ * only written once the result is known and local changes are safe.
+ */
+static int three_way_merge(argus_t *argus, git_repository_t *repo, int base, int upstream,
+                           const char *upstream_name)
+{
+    bool quiet = argus_get(argus, "quiet").as_bool;
+    bool no_commit = argus_get(argus, "no-commit").as_bool;
+    
+    merge_options_t opts = {
+        .ancestor_label = "merged common ancestors",
+        .ours_label = "HEAD",
+        .theirs_label = upstream_name,
+        .style = merge_style_from_config(repo->ctx, NULL),
+    };
+    merge_result_t result = merge_result_init(&repo->ctx->arena);
+    const git_oid_t *base_tree = base >= 0 ? &repo->commits[base].tree : NULL;
+    
+    if (merge_trees(&repo->odb, base_tree, &repo->commits[repo->head].tree, &repo->commits[upstream].tree,
+                    &opts, &result) < 0) {
+        printf(COLOR_RED("fatal: ") "unable to read tree\n");
+        return 128;
+    }
+    
+    if (merge_check_local_changes(repo, &result) > 0)
+        return 2;
+    if (merge_result_apply(repo, &result) < 0)
+        return 128;
+    
+    if (!quiet)
+        merge_result_print(&result, &opts);
+    
+    if (result.conflict_count > 0) {
+        printf("Automatic merge failed; fix conflicts and then commit the result.\n");
+        return 1;
+    }
+    
+    if (no_commit)
+        printf("Automatic merge went well; stopped before committing as requested\n");
+    else if (!quiet)
+        printf("Merge made by the 'ort' strategy.\n");
+    return 0;
+}
+
+static int execute_merge(argus_t *argus, git_context_t *ctx, const char *repository, const char *refspec)
+{
+    bool ff_only = argus_get(argus, "ff-only").as_bool;
+    bool no_ff = argus_get(argus, "no-ff").as_bool;
+    
+    git_repository_t *repo = repo_open(ctx);
+    const char *branch = refspec ? refspec : repo->head_ref;
+    if (!branch) {
+        printf(COLOR_RED("fatal: ") "You are not currently on a branch.\n");
+        return 1;
+    }
+    
+    char *upstream_name = arena_sprintf(&ctx->arena, "%s/%s", repository, branch);
+    int upstream = repo_resolve_commit(repo, upstream_name);
+    if (upstream < 0) {
+        printf(COLOR_RED("fatal: ") "couldn't find remote ref %s\n", branch);
+        return 1;
+    }
+    
+    merge_base_list_t bases = merge_bases_many(repo, repo->head, &upstream, 1, &ctx->arena);
+    int base = bases.count > 0 ? bases.commits[0] : -1;
+    if (base == upstream) {
+        if (!argus_get(argus, "quiet").as_bool)
+            printf("Already up to date.\n");
+        return 0;
+    }
+    if (base == repo->head && !no_ff)
+        return fast_forward(argus, repo, upstream);
+    
+    if (ff_only) {
+        printf(COLOR_RED("fatal: ") "Not possible to fast-forward, aborting.\n");
+        return 128;
+    }
+    return three_way_merge(argus, repo, base, upstream, upstream_name);
 }
 
 int pull_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     const char *repository = argus_get(argus, "repository").as_string;
     const char *refspec = argus_get(argus, "refspec").as_string;
     
     handle_autostash(argus, true);
     execute_fetch(argus, repository, refspec);
-    execute_merge_or_rebase(argus);
-    handle_autostash(argus, false);
     
-    return 0;
+    int result = argus_get(argus, "rebase").as_bool ? execute_rebase(argus)
+                                                     : execute_merge(argus, ctx, repository, refspec);
+    if (result == 0)
+        handle_autostash(argus, false);
+    
+    return result;
 }
\ No newline at end of file
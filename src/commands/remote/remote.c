@@ -42,10 +42,8 @@ ARGUS_OPTIONS(
 
 int remote_handler(argus_t *argus, void *data)
 {
-    (void)data;
-    
     if (argus_has_command(argus))
-        return argus_exec(argus, NULL);
+        return argus_exec(argus, data);
     
     bool verbose = argus_get(argus, "verbose").as_bool;
     
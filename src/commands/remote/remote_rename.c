@@ -5,6 +5,9 @@
 
 #include "commands/remote.h"
 #include "colors.h"
+#include "git_types.h"
+#include "mock_data.h"
+#include "repository.h"
 
 
 ARGUS_OPTIONS(
@@ -21,16 +24,67 @@ ARGUS_OPTIONS(
 )
 
 
-int remote_rename_handler(argus_t *argus, void *data) {
-    (void)data;
+static bool remote_exists(git_repository_t *repo, const char *name, const char *prefix)
+{
+    int remote_count;
+    const git_remote_t *remotes = get_mock_remotes(&remote_count);
     
+    for (int i = 0; i < remote_count; i++) {
+        if (strcmp(remotes[i].name, name) == 0)
+            return true;
+    }
+    return ref_store_count(&repo->refs, prefix) > 0;
+}
+
+/*
+ * Move the remote-tracking branches of <old> under <new> as one update:
+ * a delete and a create for each, which a reftable stack writes as a
+ * single table of its own.
+ */
+int remote_rename_handler(argus_t *argus, void *data) {
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+
     const char *old_name = argus_get(argus, "old").as_string;
     const char *new_name = argus_get(argus, "new").as_string;
-    
+    const char *old_prefix = arena_sprintf(&ctx->arena, "refs/remotes/%s/", old_name);
+    const char *new_prefix = arena_sprintf(&ctx->arena, "refs/remotes/%s/", new_name);
+    size_t old_len = strlen(old_prefix);
+
+    if (!remote_exists(repo, old_name, old_prefix)) {
+        fprintf(stderr, COLOR_RED("error: ") "No such remote: '%s'\n", old_name);
+        return 2;
+    }
+    if (remote_exists(repo, new_name, new_prefix)) {
+        fprintf(stderr, COLOR_RED("error: ") "remote %s already exists.\n", new_name);
+        return 3;
+    }
+
+    size_t count = ref_store_count(&repo->refs, old_prefix);
+    ref_update_t *updates = arena_calloc(&ctx->arena, 2 * count + 1, sizeof(*updates));
+    ref_iter_t iter = ref_store_iter(&repo->refs, old_prefix);
+    git_ref_t ref;
+    size_t n = 0;
+
     printf("Renaming remote '" COLOR_CYAN("%s") "' to '" COLOR_CYAN("%s") "'\n", old_name, new_name);
     printf(COLOR_BLUE("Updating remote-tracking branches:") "\n");
-    printf("  " COLOR_CYAN("%s/main") " -> " COLOR_CYAN("%s/main") "\n", old_name, new_name);
-    printf("  " COLOR_CYAN("%s/develop") " -> " COLOR_CYAN("%s/develop") "\n", old_name, new_name);
-    
+    while (n < 2 * count && ref_iter_next(&iter, &ref)) {
+        int len = (int)(ref.name_len - old_len);
+        const char *branch = ref.name + old_len;
+
+        updates[n++] = (ref_update_t){ .name = arena_strndup(&ctx->arena, ref.name, ref.name_len), .deleted = true };
+        updates[n++] = (ref_update_t){
+            .name = arena_sprintf(&ctx->arena, "%s%.*s", new_prefix, len, branch),
+            .oid = ref.oid,
+            .peeled = ref.peeled,
+        };
+        printf("  " COLOR_CYAN("%s/%.*s") " -> " COLOR_CYAN("%s/%.*s") "\n", old_name, len, branch, new_name, len,
+               branch);
+    }
+
+    if (ref_store_commit(&repo->refs, updates, n) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "cannot lock ref '%s'\n", new_prefix);
+        return 128;
+    }
     return 0;
-}
\ No newline at end of file
+}
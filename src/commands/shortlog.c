@@ -0,0 +1,198 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "commands/git.h"
+#include "colors.h"
+#include "config_utils.h"
+#include "mailmap.h"
+#include "repository.h"
+#include "revision.h"
+#include "shortlog.h"
+#include "strbuf.h"
+
+ARGUS_OPTIONS(
+    shortlog_options,
+    HELP_OPTION(),
+
+    OPTION_FLAG('s', "summary", HELP("Suppress commit descriptions, only provide commit count")),
+    OPTION_FLAG('n', "numbered", HELP("Sort by number of commits rather than by name")),
+    OPTION_FLAG('e', "email", HELP("Show the email address of each author")),
+    OPTION_FLAG('c', "committer", HELP("Group by committer rather than author")),
+    OPTION_ARRAY_STRING('\0', "group", HELP("Group by author, committer or trailer:<key>"), HINT("type")),
+
+    POSITIONAL_MANY_STRING("revision", HELP("Summarize commits from revisions"), FLAGS(FLAG_OPTIONAL)),
+)
+
+typedef struct {
+    const shortlog_entry_t *entry;
+} shortlog_row_t;
+
+static int compare_by_name(const void *a, const void *b)
+{
+    return strcmp(((const shortlog_row_t *)a)->entry->ident, ((const shortlog_row_t *)b)->entry->ident);
+}
+
+static int compare_by_count(const void *a, const void *b)
+{
+    const shortlog_entry_t *x = ((const shortlog_row_t *)a)->entry;
+    const shortlog_entry_t *y = ((const shortlog_row_t *)b)->entry;
+    
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return strcmp(x->ident, y->ident);
+}
+
+static int parse_groups(argus_t *argus, arena_t *arena, shortlog_options_t *opts)
+{
+    opts->groups = argus_get(argus, "committer").as_bool ? SHORTLOG_GROUP_COMMITTER : 0;
+    if (!argus_is_set(argus, "group")) {
+        opts->groups |= opts->groups ? 0 : SHORTLOG_GROUP_AUTHOR;
+        return 0;
+    }
+    
+    opts->trailers = arena_alloc(arena, (size_t)argus_count(argus, "group") * sizeof(*opts->trailers));
+    argus_array_it_t it = argus_array_it(argus, "group");
+    while (argus_array_next(&it)) {
+        const char *group = it.value.as_string;
+        if (strcmp(group, "author") == 0) {
+            opts->groups |= SHORTLOG_GROUP_AUTHOR;
+        } else if (strcmp(group, "committer") == 0) {
+            opts->groups |= SHORTLOG_GROUP_COMMITTER;
+        } else if (strncasecmp(group, "trailer:", 8) == 0 && group[8]) {
+            opts->groups |= SHORTLOG_GROUP_TRAILER;
+            opts->trailers[opts->trailer_count++] = group + 8;
+        } else {
+            fprintf(stderr, COLOR_RED("fatal: ") "unknown group type: %s\n", group);
+            return 128;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The walk, newest first, into `positions`. Arguments are revisions and
+ * ranges as for log; with none the walk starts at HEAD.
+ */
+static int walk_revisions(argus_t *argus, git_repository_t *repo, int **positions, size_t *count)
+{
+    rev_walk_t revs = rev_walk_init(repo);
+    size_t alloc = 64;
+    
+    if (argus_is_set(argus, "revision")) {
+        argus_array_it_t it = argus_array_it(argus, "revision");
+        while (argus_array_next(&it)) {
+            if (rev_parse_arg(&revs, it.value.as_string, false) < 0) {
+                fprintf(stderr, COLOR_RED("fatal: ") "bad revision '%s'\n", it.value.as_string);
+                return 128;
+            }
+        }
+    }
+    if (revs.interesting_tips == 0 && repo->head >= 0)
+        rev_add_tip(&revs, repo->head, false);
+    
+    *positions = arena_alloc(&repo->ctx->arena, alloc * sizeof(**positions));
+    *count = 0;
+    for (int pos; (pos = rev_walk_next(&revs)) >= 0;) {
+        if (*count == alloc) {
+            *positions = arena_realloc(&repo->ctx->arena, *positions, alloc * sizeof(**positions),
+                                       2 * alloc * sizeof(**positions));
+            alloc *= 2;
+        }
+        (*positions)[(*count)++] = pos;
+    }
+    return 0;
+}
+
+/*
+ * A commit's subject as shortlog shows it: its first paragraph on one
+ * line, without a leading "[PATCH ...]".
+ */
+static void add_subject(strbuf_t *out, const git_object_t *object)
+{
+    const char *text = object->data, *end = text + object->size;
+    const char *body = NULL;
+    
+    for (const char *p = text; (p = memchr(p, '\n', (size_t)(end - p))) && p + 1 < end; p++) {
+        if (p[1] == '\n') {
+            body = p + 2;
+            break;
+        }
+    }
+    if (!body)
+        return;
+    if (strncmp(body, "[PATCH", 6) == 0) {
+        const char *close = memchr(body, ']', (size_t)(end - body));
+        if (close)
+            body = close + 1;
+    }
+    while (body < end && (*body == ' ' || *body == '\t'))
+        body++;
+    
+    bool space = false;
+    for (const char *p = body; p < end && !(p[0] == '\n' && p + 1 < end && p[1] == '\n'); p++) {
+        if (*p == '\n' || *p == ' ' || *p == '\t') {
+            space = true;
+            continue;
+        }
+        if (space && out->len > 0 && out->buf[out->len - 1] != ' ')
+            strbuf_addch(out, ' ');
+        space = false;
+        strbuf_addch(out, *p);
+    }
+}
+
+int shortlog_handler(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+    bool summary = argus_get(argus, "summary").as_bool;
+    shortlog_options_t opts = {
+        .email = argus_get(argus, "email").as_bool,
+        .subjects = !summary,
+    };
+    int *positions;
+    size_t count;
+    
+    if (parse_groups(argus, &ctx->arena, &opts) != 0 || walk_revisions(argus, repo, &positions, &count) != 0)
+        return 128;
+    
+    // Contributors are counted under their canonical identities
+    mailmap_t mailmap = mailmap_init(&ctx->arena);
+    mailmap_read(&mailmap, repo);
+    opts.mailmap = &mailmap;
+    
+    shortlog_table_t table;
+    if (shortlog_collect(repo, positions, count, &opts, config_get_int(ctx, "shortlog.workers", 0), &ctx->arena,
+                         &table) < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "unable to read commit object\n");
+        return 128;
+    }
+    
+    shortlog_row_t *rows = arena_alloc(&ctx->arena, (table.count + 1) * sizeof(*rows));
+    for (size_t i = 0; i < table.count; i++)
+        rows[i].entry = &table.entries[i];
+    qsort(rows, table.count, sizeof(*rows), argus_get(argus, "numbered").as_bool ? compare_by_count : compare_by_name);
+    
+    strbuf_t out = strbuf_init(&ctx->arena, 4096);
+    for (size_t i = 0; i < table.count; i++) {
+        const shortlog_entry_t *entry = rows[i].entry;
+        if (summary) {
+            strbuf_addf(&out, "%6zu\t%s\n", entry->count, entry->ident);
+            continue;
+        }
+        
+        // The walk runs newest first; each author's list reads oldest first
+        strbuf_addf(&out, "%s (%zu):\n", entry->ident, entry->count);
+        for (size_t c = entry->count; c-- > 0;) {
+            strbuf_addstr(&out, "      ");
+            add_subject(&out, repo->commits[positions[entry->commits[c]]].object);
+            strbuf_addch(&out, '\n');
+        }
+        strbuf_addch(&out, '\n');
+    }
+    fwrite(out.buf, 1, out.len, stdout);
+    return 0;
+}
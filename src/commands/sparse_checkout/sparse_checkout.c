@@ -0,0 +1,60 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/git.h"
+#include "commands/sparse_checkout.h"
+#include "colors.h"
+#include "config_utils.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    sparse_checkout_options,
+    HELP_OPTION(),
+
+    SUBCOMMAND("init", sparse_checkout_init_options,
+        HELP("Enable sparse-checkout with only the top-level files present"),
+        ACTION(sparse_checkout_init_handler)),
+    SUBCOMMAND("set", sparse_checkout_set_options,
+        HELP("Replace the sparse-checkout cone with the given directories"),
+        ACTION(sparse_checkout_set_handler)),
+    SUBCOMMAND("add", sparse_checkout_add_options,
+        HELP("Add directories to the sparse-checkout cone"),
+        ACTION(sparse_checkout_add_handler)),
+    SUBCOMMAND("list", sparse_checkout_list_options,
+        HELP("List the directories in the sparse-checkout cone"),
+        ACTION(sparse_checkout_list_handler)),
+)
+
+int sparse_checkout_add_directories(argus_t *argus, void *data)
+{
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+    
+    argus_array_it_t it = argus_array_it(argus, "directories");
+    while (argus_array_next(&it)) {
+        const char *dir = it.value.as_string;
+        
+        // Cone mode compiles directories, not gitignore-style patterns
+        if (strpbrk(dir, "*?[]\\")) {
+            printf(COLOR_RED("fatal: ") "specify directories rather than patterns: '%s'\n", dir);
+            return 128;
+        }
+        sparse_checkout_add_dir(&repo->sparse, dir);
+    }
+    
+    repo->sparse.enabled = true;
+    config_set_override(ctx, "core.sparseCheckout", "true");
+    config_set_override(ctx, "core.sparseCheckoutCone", "true");
+    return sparse_checkout_update_worktree(repo) < 0 ? 1 : 0;
+}
+
+int sparse_checkout_handler(argus_t *argus, void *data)
+{
+    if (argus_has_command(argus))
+        return argus_exec(argus, data);
+    
+    argus_print_help(argus);
+    return 1;
+}
@@ -0,0 +1,25 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/sparse_checkout.h"
+#include "colors.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    sparse_checkout_add_options,
+    HELP_OPTION(),
+    POSITIONAL_MANY_STRING("directories",
+        HELP("Directories to add to the cone")),
+)
+
+int sparse_checkout_add_handler(argus_t *argus, void *data) {
+    git_context_t *ctx = data;
+    
+    if (!repo_open(ctx)->sparse.enabled) {
+        printf(COLOR_RED("fatal: ") "no sparse-checkout to add to\n");
+        return 128;
+    }
+    return sparse_checkout_add_directories(argus, data);
+}
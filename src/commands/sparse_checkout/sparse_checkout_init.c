@@ -0,0 +1,33 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/sparse_checkout.h"
+#include "config_utils.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    sparse_checkout_init_options,
+    HELP_OPTION(),
+    OPTION_FLAG(0, "cone", HELP("Match directories instead of patterns (the only supported mode)")),
+    OPTION_FLAG(0, "sparse-index", HELP("Collapse directories outside the cone in the index")),
+)
+
+int sparse_checkout_init_handler(argus_t *argus, void *data) {
+    git_context_t *ctx = data;
+    git_repository_t *repo = repo_open(ctx);
+    bool sparse_index = argus_get(argus, "sparse-index").as_bool;
+    
+    if (sparse_index)
+        config_set_override(ctx, "index.sparse", "true");
+    
+    // Re-running init keeps an existing cone and at most converts the index
+    if (repo->sparse.enabled && (repo->index.sparse || !sparse_index))
+        return 0;
+    
+    repo->sparse.enabled = true;
+    config_set_override(ctx, "core.sparseCheckout", "true");
+    config_set_override(ctx, "core.sparseCheckoutCone", "true");
+    return sparse_checkout_update_worktree(repo) < 0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/sparse_checkout.h"
+#include "colors.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    sparse_checkout_list_options,
+    HELP_OPTION(),
+)
+
+int sparse_checkout_list_handler(argus_t *argus, void *data) {
+    (void)argus;
+    git_context_t *ctx = data;
+    const git_sparse_checkout_t *sparse = &repo_open(ctx)->sparse;
+    
+    if (!sparse->enabled) {
+        printf(COLOR_RED("fatal: ") "this worktree is not sparse\n");
+        return 128;
+    }
+    
+    for (size_t i = 0; i < sparse->dir_count; i++)
+        printf("%s\n", sparse->dirs[i]);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include <argus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commands/sparse_checkout.h"
+#include "config_utils.h"
+#include "repository.h"
+
+ARGUS_OPTIONS(
+    sparse_checkout_set_options,
+    HELP_OPTION(),
+    OPTION_FLAG(0, "cone", HELP("Match directories instead of patterns (the only supported mode)")),
+    OPTION_FLAG(0, "sparse-index", HELP("Collapse directories outside the cone in the index")),
+    POSITIONAL_MANY_STRING("directories",
+        HELP("Directories to include with everything below them"),
+        FLAGS(FLAG_OPTIONAL)),
+)
+
+int sparse_checkout_set_handler(argus_t *argus, void *data) {
+    git_context_t *ctx = data;
+    
+    if (argus_get(argus, "sparse-index").as_bool)
+        config_set_override(ctx, "index.sparse", "true");
+    sparse_checkout_clear(&repo_open(ctx)->sparse);
+    return sparse_checkout_add_directories(argus, data);
+}
@@ -46,10 +46,8 @@ ARGUS_OPTIONS(
 
 int stash_handler(argus_t *argus, void *data)
 {
-    (void)data;
-    
     if (argus_has_command(argus))
-        return argus_exec(argus, NULL);
+        return argus_exec(argus, data);
     
     const char *message = argus_get(argus, "message").as_string;
     bool include_untracked = argus_get(argus, "include-untracked").as_bool;
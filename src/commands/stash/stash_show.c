@@ -5,6 +5,10 @@
 
 #include "commands/stash.h"
 #include "colors.h"
+#include "diff.h"
+#include "repository.h"
+#include "diff_rename.h"
+#include "tree_diff.h"
 
 ARGUS_OPTIONS(
     stash_show_options,
@@ -17,6 +21,10 @@ ARGUS_OPTIONS(
         0, "stat",
         HELP("Show diffstat")
     ),
+    OPTION_FLAG(
+        0, "numstat",
+        HELP("Show added and deleted line counts")
+    ),
     OPTION_FLAG(
         0, "name-only",
         HELP("Show only names of changed files")
@@ -29,51 +37,39 @@ ARGUS_OPTIONS(
 )
 
 int stash_show_handler(argus_t *argus, void *data) {
-    (void)data;
+    git_context_t *ctx = data;
     
     const char *stash = argus_get(argus, "stash").as_string;
-    bool patch = argus_get(argus, "patch").as_bool;
-    bool stat = argus_get(argus, "stat").as_bool;
-    bool name_only = argus_get(argus, "name-only").as_bool;
-    bool name_status = argus_get(argus, "name-status").as_bool;
+    git_repository_t *repo = repo_open(ctx);
+    int pos = repo_find_stash(repo, stash);
+    if (pos < 0) {
+        printf(COLOR_RED("error: ") "%s is not a valid reference\n", stash);
+        return 1;
+    }
     
-    printf("Showing %s\n", stash);
+    diff_options_t opts = diff_options_init(ctx);
+    if (argus_get(argus, "patch").as_bool)
+        opts.format |= DIFF_FORMAT_PATCH;
+    if (argus_get(argus, "stat").as_bool)
+        opts.format |= DIFF_FORMAT_STAT;
+    if (argus_get(argus, "numstat").as_bool)
+        opts.format |= DIFF_FORMAT_NUMSTAT;
+    if (argus_get(argus, "name-only").as_bool)
+        opts.format |= DIFF_FORMAT_NAME_ONLY;
+    if (argus_get(argus, "name-status").as_bool)
+        opts.format |= DIFF_FORMAT_NAME_STATUS;
+    if (!opts.format)
+        opts.format = DIFF_FORMAT_STAT;
     
-    if (name_only) {
-        printf("src/main.c\n");
-        printf("src/utils.c\n");
-        printf("README.md\n");
-    } else if (name_status) {
-        printf("M\tsrc/main.c\n");
-        printf("M\tsrc/utils.c\n");
-        printf("A\tREADME.md\n");
-    } else if (patch) {
-        printf("diff --git a/src/main.c b/src/main.c\n");
-        printf("index abc1234..def5678 100644\n");
-        printf(COLOR_RED("---") " a/src/main.c\n");
-        printf(COLOR_GREEN("+++") " b/src/main.c\n");
-        printf("@@ -10,6 +10,9 @@ int main() {\n");
-        printf("     printf(\"Hello World\\n\");\n");
-        printf("+    // TODO: Add more functionality\n");
-        printf("+    printf(\"Debug: Starting application\\n\");\n");
-        printf("+\n");
-        printf("     return 0;\n");
-        printf(" }\n");
-    } else if (stat) {
-        printf(" README.md   |  5 " COLOR_GREEN("+++++") "\n");
-        printf(" src/main.c |  3 " COLOR_GREEN("+++") "\n");
-        printf(" src/utils.c|  8 " COLOR_GREEN("++++++++") "\n");
-        printf(" 3 files changed, 16 insertions(+)\n");
-        printf("\nDetailed statistics:\n");
-        printf("  Total lines added: 16\n");
-        printf("  Total lines removed: 0\n");
-        printf("  Files modified: 3\n");
-    } else {
-        printf(" README.md   |  5 " COLOR_GREEN("+++++") "\n");
-        printf(" src/main.c |  3 " COLOR_GREEN("+++") "\n");
-        printf(" src/utils.c|  8 " COLOR_GREEN("++++++++") "\n");
-        printf(" 3 files changed, 16 insertions(+)\n");
-    }
+    // A stash is shown as the changes it recorded on top of its base commit
+    const git_stash_node_t *node = &repo->stashes[pos];
+    git_diff_list_t diff = diff_list_init(&ctx->arena);
+    strbuf_t out = strbuf_init(&ctx->arena, 4096);
+    if (tree_diff(&repo->odb, &repo->commits[node->base].tree, &node->tree, &diff) < 0 ||
+        diff_detect_renames(&repo->odb, &diff, &opts) < 0 ||
+        diff_output(&repo->odb, &ctx->arena, &diff, &opts, &out) < 0)
+        return 128;
     
+    fputs(out.buf, stdout);
     return 0;
-}
\ No newline at end of file
+}
@@ -6,13 +6,16 @@
 
 #include "commands/git.h"
 #include "colors.h"
+#include "config_utils.h"
 #include "git_types.h"
 #include "mock_data.h"
+#include "repository.h"
+#include "tracking.h"
 
 ARGUS_OPTIONS(
     status_options,
     HELP_OPTION(),
-    
+
     GROUP_START("Output format"),
         OPTION_FLAG('s', "short", HELP("Show status concisely")),
         OPTION_STRING('\0', "porcelain",
@@ -22,13 +25,13 @@ ARGUS_OPTIONS(
         OPTION_FLAG('v', "verbose", HELP("Show staged diff")),
         OPTION_FLAG('z', "null", HELP("Terminate entries with NUL")),
     GROUP_END(),
-    
+
     GROUP_START("Display options"),
         OPTION_FLAG('b', "branch", HELP("Show branch information")),
         OPTION_FLAG('\0', "show-stash", HELP("Show stash information")),
         OPTION_FLAG('\0', "ahead-behind", HELP("Compute full ahead/behind values")),
     GROUP_END(),
-    
+
     GROUP_START("File filtering"),
         OPTION_STRING('u', "untracked-files",
             HELP("Show untracked files"),
@@ -41,31 +44,53 @@ ARGUS_OPTIONS(
             DEFAULT("no"),
             FLAGS(FLAG_OPTIONAL)),
     GROUP_END(),
-    
+
     POSITIONAL_MANY_STRING("pathspec",
         HELP("Paths to limit the status output"),
         FLAGS(FLAG_OPTIONAL)),
 )
 
-static void print_porcelain_status(argus_t *argus, const git_file_status_t files[], int count)
+static tracking_t find_tracking(argus_t *argus, git_repository_t *repo)
+{
+    bool count = argus_get(argus, "ahead-behind").as_bool || config_get_bool(repo->ctx, "status.aheadBehind", true);
+    return tracking_find(repo, count);
+}
+
+static void print_porcelain_branch(argus_t *argus, git_repository_t *repo, const char *term)
+{
+    if (!repo->head_ref) {
+        printf("## HEAD (no branch)%s", term);
+        return;
+    }
+    
+    tracking_t tracking = find_tracking(argus, repo);
+    printf("## %s", repo->head_ref);
+    if (tracking.state != TRACKING_NONE)
+        printf("...%s", tracking.upstream);
+    
+    if (tracking.state == TRACKING_GONE)
+        printf(" [gone]");
+    else if (tracking.state == TRACKING_DIFFERENT)
+        printf(" [different]");
+    else if (tracking.counts.ahead && tracking.counts.behind)
+        printf(" [ahead %d, behind %d]", tracking.counts.ahead, tracking.counts.behind);
+    else if (tracking.counts.ahead)
+        printf(" [ahead %d]", tracking.counts.ahead);
+    else if (tracking.counts.behind)
+        printf(" [behind %d]", tracking.counts.behind);
+    printf("%s", term);
+}
+
+static void print_porcelain_status(argus_t *argus, git_repository_t *repo, const git_file_status_t files[], int count)
 {
     bool show_branch = argus_get(argus, "branch").as_bool;
     bool null_term = argus_get(argus, "null").as_bool;
-    bool ahead_behind = argus_get(argus, "ahead-behind").as_bool;
     const char *untracked_mode = argus_get(argus, "untracked-files").as_string;
     const char *ignored_mode = argus_get(argus, "ignored").as_string;
     const char *term = null_term ? "\0" : "\n";
     
-    int branch_count;
-    const git_branch_t *branches = get_mock_branches(&branch_count);
-    const char *current = branch_count > 0 ? branches[0].name : "main";
-    
-    if (show_branch) {
-        if (ahead_behind)
-            printf("## %s...origin/%s [ahead 2, behind 1]%s", current, current, term);
-        else
-            printf("## %s...origin/%s%s", current, current, term);
-    }
+    if (show_branch)
+        print_porcelain_branch(argus, repo, term);
     
     for (int i = 0; i < count; i++) {
         const git_file_status_t *file = &files[i];
@@ -83,27 +108,51 @@ static void print_porcelain_status(argus_t *argus, const git_file_status_t files
     }
 }
 
-static void print_standard_status(argus_t *argus, const git_file_status_t files[], int count)
+static void print_sparse_status(const git_repository_t *repo)
+{
+    if (!repo->sparse.enabled)
+        return;
+    
+    // Collapsed directories hide how many files they hold
+    if (repo->index.sparse) {
+        printf("You are in a sparse checkout.\n\n");
+        return;
+    }
+    
+    size_t present = 0;
+    for (size_t i = 0; i < repo->index.count; i++) {
+        if (!repo->index.entries[i].skip_worktree)
+            present++;
+    }
+    
+    size_t percent = repo->index.count ? present * 100 / repo->index.count : 100;
+    printf("You are in a sparse checkout with %zu%% of tracked files present.\n\n", percent);
+}
+
+static void print_tracking(argus_t *argus, git_repository_t *repo)
+{
+    tracking_t tracking = find_tracking(argus, repo);
+    
+    if (tracking.state == TRACKING_NONE)
+        return;
+    tracking_print(&tracking);
+    printf("\n");
+}
+
+static void print_standard_status(argus_t *argus, git_repository_t *repo, const git_file_status_t files[], int count)
 {
     bool verbose = argus_get(argus, "verbose").as_bool;
     bool show_stash = argus_get(argus, "show-stash").as_bool;
-    bool ahead_behind = argus_get(argus, "ahead-behind").as_bool;
     const char *untracked_mode = argus_get(argus, "untracked-files").as_string;
     const char *ignored_mode = argus_get(argus, "ignored").as_string;
     
-    int branch_count, remote_count;
-    const git_branch_t *branches = get_mock_branches(&branch_count);
-    const git_remote_t *remotes = get_mock_remotes(&remote_count);
-    
-    const char *current = branch_count > 0 ? branches[0].name : "main";
-    const char *remote = remote_count > 0 ? remotes[0].name : "origin";
-    
-    printf("On branch " COLOR_GREEN("%s") "\n", current);
+    if (repo->head_ref)
+        printf("On branch " COLOR_GREEN("%s") "\n", repo->head_ref);
+    else if (repo->head >= 0)
+        printf(COLOR_RED("HEAD detached at %s") "\n", repo->commits[repo->head].commit->hash);
+    print_tracking(argus, repo);
     
-    if (ahead_behind)
-        printf("Your branch is ahead of '%s/%s' by 2 commits, behind by 1.\n\n", remote, current);
-    else
-        printf("Your branch is up to date with '" COLOR_CYAN("%s/%s") "'.\n\n", remote, current);
+    print_sparse_status(repo);
     
     if (show_stash)
         printf("Your stash currently has 2 entries\n\n");
@@ -165,7 +214,7 @@ static void print_standard_status(argus_t *argus, const git_file_status_t files[
     printf("nothing added to commit but untracked files present (use \"git add\" to track)\n");
 }
 
-static int handle_porcelain_format(argus_t *argus)
+static int handle_porcelain_format(argus_t *argus, git_context_t *ctx)
 {
     bool short_format = argus_get(argus, "short").as_bool;
     const char *porcelain = argus_get(argus, "porcelain").as_string;
@@ -173,13 +222,13 @@ static int handle_porcelain_format(argus_t *argus)
     if (porcelain || short_format) {
         int file_count;
         const git_file_status_t *files = get_mock_file_status(&file_count);
-        print_porcelain_status(argus, files, file_count);
+        print_porcelain_status(argus, repo_open(ctx), files, file_count);
         return 0;
     }
     return -1;
 }
 
-static void display_standard_status(argus_t *argus)
+static void display_standard_status(argus_t *argus, git_context_t *ctx)
 {
     int file_count;
     const git_file_status_t *files = get_mock_file_status(&file_count);
@@ -193,18 +242,18 @@ static void display_standard_status(argus_t *argus)
         printf("\n");
     }
     
-    print_standard_status(argus, files, file_count);
+    print_standard_status(argus, repo_open(ctx), files, file_count);
 }
 
 int status_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     int result;
     
-    if ((result = handle_porcelain_format(argus)) != -1)
+    if ((result = handle_porcelain_format(argus, ctx)) != -1)
         return result;
     
-    display_standard_status(argus);
+    display_standard_status(argus, ctx);
     return 0;
 }
\ No newline at end of file
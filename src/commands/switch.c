@@ -5,20 +5,25 @@
 #include <unistd.h>
 
 #include "commands/git.h"
+#include "branch_switch.h"
 #include "colors.h"
 #include "git_types.h"
+#include "git_context.h"
 #include "mock_data.h"
+#include "repository.h"
+#include "revision.h"
 
 ARGUS_OPTIONS(
     switch_options,
     HELP_OPTION(),
-    
+
     GROUP_START("Branch creation"),
         OPTION_FLAG('c', "create", HELP("Create a new branch and switch to it")),
         OPTION_FLAG('C', "force-create", HELP("Similar to --create except if <new-branch> already exists, reset it")),
         OPTION_STRING('\0', "orphan", HELP("Create a new orphan branch")),
+        OPTION_FLAG('d', "detach", HELP("Detach HEAD at named commit")),
     GROUP_END(),
-    
+
     GROUP_START("Branch tracking"),
         OPTION_STRING('t', "track",
             HELP("Set upstream info for new branch"),
@@ -27,7 +32,7 @@ ARGUS_OPTIONS(
         OPTION_FLAG('\0', "guess", HELP("If <branch> is not found but there does exist a tracking branch")),
         OPTION_FLAG('\0', "no-guess", HELP("Do not try to match remote branches")),
     GROUP_END(),
-    
+
     GROUP_START("Worktree options"),
         OPTION_FLAG('f', "force", HELP("Throw away local modifications")),
         OPTION_FLAG('m', "merge", HELP("Perform a 3-way merge between current branch, working tree and new branch")),
@@ -36,11 +41,11 @@ ARGUS_OPTIONS(
             VALIDATOR(V_CHOICE_STR("merge", "diff3", "zdiff3")),
             FLAGS(FLAG_OPTIONAL)),
     GROUP_END(),
-    
+
     GROUP_START("Display options"),
         OPTION_FLAG('q', "quiet", HELP("Suppress feedback messages")),
     GROUP_END(),
-    
+
     POSITIONAL_STRING("branch", HELP("Branch to switch to"), FLAGS(FLAG_OPTIONAL)),
     POSITIONAL_STRING("start-point", HELP("Start point for new branch"), FLAGS(FLAG_OPTIONAL)),
 )
@@ -76,12 +81,24 @@ static int handle_orphan_branch(argus_t *argus)
     return -1;
 }
 
-static int handle_branch_creation(argus_t *argus, const char *branch)
+static branch_switch_options_t switch_options_from(argus_t *argus, git_context_t *ctx)
+{
+    // --conflict implies --merge
+    const char *conflict_style = argus_get(argus, "conflict").as_string;
+    
+    return (branch_switch_options_t){
+        .force = argus_get(argus, "force").as_bool,
+        .merge = argus_get(argus, "merge").as_bool || conflict_style,
+        .style = merge_style_from_config(ctx, conflict_style),
+        .quiet = argus_get(argus, "quiet").as_bool,
+        .detach = argus_get(argus, "detach").as_bool,
+    };
+}
+
+static int handle_branch_creation(argus_t *argus, git_context_t *ctx, const char *branch)
 {
     bool create = argus_get(argus, "create").as_bool;
     bool force_create = argus_get(argus, "force-create").as_bool;
-    bool quiet = argus_get(argus, "quiet").as_bool;
-    const char *track_mode = argus_get(argus, "track").as_string;
     
     if (create || force_create) {
         if (!branch) {
@@ -89,95 +106,92 @@ static int handle_branch_creation(argus_t *argus, const char *branch)
             return 1;
         }
         
-        int commit_count, remote_count;
-        const git_commit_t *commits = get_mock_commits(&commit_count);
-        const git_remote_t *remotes = get_mock_remotes(&remote_count);
-        
-        if (force_create && !quiet) {
-            printf("Reset branch '" COLOR_GREEN("%s") "' (was at " COLOR_YELLOW("%s") ")\n", 
-                   branch, commit_count > 0 ? commits[0].hash : "abc1234");
-        }
-        
-        if (!quiet)
-            printf("Switched to a new branch '" COLOR_GREEN("%s") "'\n", branch);
-        
-        if (track_mode && !quiet) {
-            const char *remote = remote_count > 0 ? remotes[0].name : "origin";
-            printf("Branch '" COLOR_GREEN("%s") "' set up to track remote branch 'main' from '%s' by %s.\n", 
-                   branch, remote, track_mode);
-        }
-        
-        return 0;
-    }
-    return -1;
-}
-
-static int handle_merge_conflicts(argus_t *argus)
-{
-    bool merge = argus_get(argus, "merge").as_bool;
-    const char *conflict_style = argus_get(argus, "conflict").as_string;
-    bool quiet = argus_get(argus, "quiet").as_bool;
-    
-    if (merge) {
-        if (conflict_style && !quiet)
-            printf("Using conflict style: %s\n", conflict_style);
-        
-        int file_count;
-        const git_file_status_t *files = get_mock_file_status(&file_count);
-        
-        printf("Auto-merging conflicted files...\n");
-        if (file_count > 0)
-            printf("CONFLICT (content): Merge conflict in %s\n", files[0].filename);
-        printf("Automatic merge failed; fix conflicts and then commit the result.\n");
-        return 1;
+        const char *start_point = argus_get(argus, "start-point").as_string;
+        branch_switch_options_t opts = switch_options_from(argus, ctx);
+        return branch_switch_create(repo_open(ctx), branch, start_point ? start_point : "HEAD", force_create,
+                                    argus_get(argus, "track").as_string != NULL, &opts);
     }
     return -1;
 }
 
-static bool check_branch_exists(const char *branch)
+static bool check_branch_exists(git_context_t *ctx, const char *branch)
 {
-    int branch_count;
-    const git_branch_t *branches = get_mock_branches(&branch_count);
+    git_repository_t *repo = repo_open(ctx);
+    git_ref_t ref;
     
-    for (int i = 0; i < branch_count; i++) {
-        if (strcmp(branches[i].name, branch) == 0)
-            return true;
-    }
-    return false;
+    return ref_store_lookup(&repo->refs, arena_sprintf(&ctx->arena, "refs/heads/%s", branch), &ref);
 }
 
-static int handle_branch_guessing(argus_t *argus, const char *branch)
+/*
+ * A <branch> that only a remote has becomes a new local branch tracking
+ * it. One lookup per remote, rather than a pass over every
+ * remote-tracking branch.
+ */
+static int handle_branch_guessing(argus_t *argus, git_context_t *ctx, const char *branch)
 {
     bool no_guess = argus_get(argus, "no-guess").as_bool;
-    bool quiet = argus_get(argus, "quiet").as_bool;
+    bool detach = argus_get(argus, "detach").as_bool;
     
-    if (!check_branch_exists(branch) && !no_guess) {
-        int remote_branch_count;
-        const git_branch_t *remote_branches = get_mock_remote_branches(&remote_branch_count);
+    if (!detach && !no_guess && !check_branch_exists(ctx, branch)) {
+        git_repository_t *repo = repo_open(ctx);
+        int remote_count;
+        const git_remote_t *remotes = get_mock_remotes(&remote_count);
         
-        for (int i = 0; i < remote_branch_count; i++) {
-            const char *remote_name = strchr(remote_branches[i].name, '/');
-            if (remote_name && strcmp(remote_name + 1, branch) == 0) {
-                if (!quiet) {
-                    printf("Branch '" COLOR_GREEN("%s") "' set up to track remote branch '" COLOR_CYAN("%s") "'.\n", 
-                           branch, remote_branches[i].name);
-                    printf("Switched to a new branch '" COLOR_GREEN("%s") "'\n", branch);
-                }
-                return 0;
+        for (int i = 0; i < remote_count; i++) {
+            const char *tracking = arena_sprintf(&ctx->arena, "%s/%s", remotes[i].name, branch);
+            git_ref_t ref;
+            if (ref_store_lookup(&repo->refs, arena_sprintf(&ctx->arena, "refs/remotes/%s", tracking), &ref)) {
+                branch_switch_options_t opts = switch_options_from(argus, ctx);
+                return branch_switch_create(repo, branch, tracking, false, true, &opts);
             }
         }
     }
     return -1;
 }
 
-static int perform_branch_switch(argus_t *argus, const char *branch)
+// What a name that is not a local branch names instead, as git reports it
+static const char* describe_non_branch(git_repository_t *repo, const char *name)
+{
+    git_ref_t ref;
+    
+    if (ref_store_lookup(&repo->refs, arena_sprintf(&repo->ctx->arena, "refs/tags/%s", name), &ref))
+        return "tag";
+    if (ref_store_lookup(&repo->refs, arena_sprintf(&repo->ctx->arena, "refs/remotes/%s", name), &ref))
+        return "remote-tracking branch";
+    return "commit";
+}
+
+/*
+ * <branch> is looked up as refs/heads/<branch> only, so a tag of the same
+ * name never shadows it. Anything else takes --detach.
+ */
+static int perform_branch_switch(argus_t *argus, git_context_t *ctx, const char *branch)
 {
     bool quiet = argus_get(argus, "quiet").as_bool;
     bool force = argus_get(argus, "force").as_bool;
-    
-    if (!check_branch_exists(branch)) {
-        printf(COLOR_RED("error: ") "pathspec '%s' did not match any file(s) known to git\n", branch);
-        return 1;
+    bool detach = argus_get(argus, "detach").as_bool;
+    git_repository_t *repo = repo_open(ctx);
+    branch_switch_options_t opts = switch_options_from(argus, ctx);
+    git_ref_t ref;
+    int target;
+    
+    if (detach) {
+        target = rev_resolve(repo, branch);
+    } else if (ref_store_lookup(&repo->refs, arena_sprintf(&ctx->arena, "refs/heads/%s", branch), &ref)) {
+        target = repo_find_commit_oid(repo, &ref.oid);
+    } else {
+        if (rev_resolve(repo, branch) < 0) {
+            fprintf(stderr, COLOR_RED("fatal: ") "invalid reference: %s\n", branch);
+            return 128;
+        }
+        fprintf(stderr, COLOR_RED("fatal: ") "a branch is expected, got %s '%s'\n", describe_non_branch(repo, branch),
+                branch);
+        fprintf(stderr, "hint: If you want to detach HEAD at the commit, try again with the --detach option.\n");
+        return 128;
+    }
+    if (target < 0) {
+        fprintf(stderr, COLOR_RED("fatal: ") "invalid reference: %s\n", branch);
+        return 128;
     }
     
     int file_count;
@@ -191,20 +205,15 @@ static int perform_branch_switch(argus_t *argus, const char *branch)
         }
     }
     
-    if (has_modifications && force && !quiet)
+    int result = branch_switch_to(repo, branch, detach ? NULL : branch, target, &opts);
+    if (result == 0 && has_modifications && force && !quiet)
         printf(COLOR_YELLOW("warning: ") "local modifications were discarded\n");
-    
-    if (!quiet) {
-        printf("Switched to branch '" COLOR_GREEN("%s") "'\n", branch);
-        printf("Your branch is up to date with 'origin/%s'.\n", branch);
-    }
-    
-    return 0;
+    return result;
 }
 
 int switch_handler(argus_t *argus, void *data)
 {
-    (void)data;
+    git_context_t *ctx = data;
     
     const char *branch = argus_get(argus, "branch").as_string;
     int result;
@@ -215,14 +224,11 @@ int switch_handler(argus_t *argus, void *data)
     if ((result = handle_orphan_branch(argus)) != -1)
         return result;
     
-    if ((result = handle_branch_creation(argus, branch)) != -1)
+    if ((result = handle_branch_creation(argus, ctx, branch)) != -1)
         return result;
     
-    if ((result = handle_merge_conflicts(argus)) != -1)
+    if ((result = handle_branch_guessing(argus, ctx, branch)) != -1)
         return result;
     
-    if ((result = handle_branch_guessing(argus, branch)) != -1)
-        return result;
-    
-    return perform_branch_switch(argus, branch);
-}
\ No newline at end of file
+    return perform_branch_switch(argus, ctx, branch);
+}
@@ -0,0 +1,628 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "commit_graph.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config_utils.h"
+#include "strbuf.h"
+#include "tree_diff.h"
+
+#define GRAPH_MAX_WORKERS   64
+#define GRAPH_SCRATCH_ARENA (64 * 1024)
+
+// Seeds and hashing of git's changed-path filters, version 2
+#define BLOOM_SEED_0 0x293ae76f
+#define BLOOM_SEED_1 0x7e646e2c
+#define BLOOM_VERSION 2
+
+// Layout of git's commit-graph file, version 1
+#define GRAPH_SIGNATURE      "CGPH"
+#define GRAPH_VERSION        1
+#define GRAPH_HASH_SHA1      1
+#define GRAPH_HEADER_SIZE    8
+#define GRAPH_CHUNK_ENTRY    12
+#define GRAPH_FANOUT_SIZE    (256 * 4)
+#define GRAPH_DATA_WIDTH     (GIT_OID_RAWSZ + 16)
+#define GRAPH_PARENT_NONE    0x70000000u
+#define GRAPH_GENERATION_MAX 0x3fffffffu
+#define BDAT_HEADER_SIZE     12
+
+#define CHUNK_OID_FANOUT   0x4f494446 // "OIDF"
+#define CHUNK_OID_LOOKUP   0x4f49444c // "OIDL"
+#define CHUNK_COMMIT_DATA  0x43444154 // "CDAT"
+#define CHUNK_BLOOM_INDEX  0x42494458 // "BIDX"
+#define CHUNK_BLOOM_DATA   0x42444154 // "BDAT"
+
+typedef struct {
+    const char *start;
+    size_t len;
+} graph_path_t;
+
+typedef struct {
+    git_repository_t *repo;
+    bloom_filter_t *filters;
+    atomic_size_t next;
+    atomic_bool failed;
+} graph_shared_t;
+
+typedef struct {
+    graph_shared_t *shared;
+    arena_t scratch;
+    arena_t results;
+} graph_worker_t;
+
+typedef struct {
+    const git_oid_t *oid;
+    int pos;
+} graph_entry_t;
+
+static void put_be(strbuf_t *sb, uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        strbuf_addch(sb, (char)((value >> (8 * i)) & 0xff));
+}
+
+static uint64_t get_be(const unsigned char *p, int bytes)
+{
+    uint64_t value = 0;
+    
+    for (int i = 0; i < bytes; i++)
+        value = value << 8 | p[i];
+    return value;
+}
+
+static uint32_t rotate_left(uint32_t value, int count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static uint32_t murmur3_seeded(uint32_t seed, const char *data, size_t len)
+{
+    const uint32_t c1 = 0xcc9e2d51, c2 = 0x1b873593;
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t blocks = len / 4;
+    
+    for (size_t i = 0; i < blocks; i++) {
+        const unsigned char *b = bytes + 4 * i;
+        uint32_t k = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+        k *= c1;
+        k = rotate_left(k, 15);
+        k *= c2;
+        seed ^= k;
+        seed = rotate_left(seed, 13) * 5 + 0xe6546b64;
+    }
+    
+    const unsigned char *tail = bytes + blocks * 4;
+    uint32_t k1 = 0;
+    switch (len & 3) {
+    case 3:
+        k1 ^= (uint32_t)tail[2] << 16;
+        // fall through
+    case 2:
+        k1 ^= (uint32_t)tail[1] << 8;
+        // fall through
+    case 1:
+        k1 ^= tail[0];
+        k1 *= c1;
+        k1 = rotate_left(k1, 15);
+        k1 *= c2;
+        seed ^= k1;
+        break;
+    }
+    
+    seed ^= (uint32_t)len;
+    seed ^= seed >> 16;
+    seed *= 0x85ebca6b;
+    seed ^= seed >> 13;
+    seed *= 0xc2b2ae35;
+    seed ^= seed >> 16;
+    return seed;
+}
+
+static void bloom_key_init(bloom_key_t *key, const char *path, size_t len)
+{
+    uint32_t hash0 = murmur3_seeded(BLOOM_SEED_0, path, len);
+    uint32_t hash1 = murmur3_seeded(BLOOM_SEED_1, path, len);
+    
+    for (int i = 0; i < BLOOM_NUM_HASHES; i++)
+        key->hashes[i] = hash0 + (uint32_t)i * hash1;
+}
+
+static bool bloom_filter_contains(const bloom_filter_t *filter, const bloom_key_t *key)
+{
+    uint64_t bits = (uint64_t)filter->len * 8;
+    
+    for (int i = 0; i < BLOOM_NUM_HASHES; i++) {
+        uint64_t pos = key->hashes[i] % bits;
+        if (!(filter->data[pos / 8] & (1u << (pos & 7))))
+            return false;
+    }
+    return true;
+}
+
+static int graph_path_cmp(const void *a, const void *b)
+{
+    const graph_path_t *x = a, *y = b;
+    size_t len = x->len < y->len ? x->len : y->len;
+    int cmp = memcmp(x->start, y->start, len);
+    return cmp ? cmp : (x->len > y->len) - (x->len < y->len);
+}
+
+static void push_path(arena_t *arena, graph_path_t **paths, size_t *count, size_t *alloc, const char *start,
+                      size_t len)
+{
+    if (*count == *alloc) {
+        *paths = arena_realloc(arena, *paths, *alloc * sizeof(**paths), *alloc * 2 * sizeof(**paths));
+        *alloc *= 2;
+    }
+    (*paths)[(*count)++] = (graph_path_t){ start, len };
+}
+
+/*
+ * The filter of one commit: its changed files and their leading
+ * directories, each added once.
+ */
+static int compute_filter(graph_worker_t *worker, int pos, bloom_filter_t *filter)
+{
+    const git_repository_t *repo = worker->shared->repo;
+    const git_commit_node_t *node = &repo->commits[pos];
+    const git_oid_t *parent = node->parent_count ? &repo->commits[node->parents[0]].tree : NULL;
+    git_diff_list_t diff = diff_list_init(&worker->scratch);
+    unsigned char *data;
+    
+    if (tree_diff(&repo->odb, parent, &node->tree, &diff) < 0)
+        return -1;
+    
+    size_t count = 0, alloc = diff.count * 2 + 1;
+    graph_path_t *paths = arena_alloc(&worker->scratch, alloc * sizeof(*paths));
+    for (size_t i = 0; i < diff.count && diff.count <= BLOOM_MAX_CHANGED_PATHS; i++) {
+        const char *path = diff.entries[i].path;
+        for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/'))
+            push_path(&worker->scratch, &paths, &count, &alloc, path, (size_t)(slash - path));
+        push_path(&worker->scratch, &paths, &count, &alloc, path, strlen(path));
+    }
+    
+    qsort(paths, count, sizeof(*paths), graph_path_cmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || graph_path_cmp(&paths[unique - 1], &paths[i]) != 0)
+            paths[unique++] = paths[i];
+    }
+    
+    if (diff.count > BLOOM_MAX_CHANGED_PATHS || unique > BLOOM_MAX_CHANGED_PATHS) {
+        data = arena_alloc(&worker->results, 1);
+        data[0] = 0xff;
+        *filter = (bloom_filter_t){ data, 1 };
+        return 0;
+    }
+    
+    // An empty filter still takes a byte, and rules every path out
+    size_t len = (unique * BLOOM_BITS_PER_ENTRY + 7) / 8;
+    if (len == 0)
+        len = 1;
+    data = arena_calloc(&worker->results, len, 1);
+    for (size_t i = 0; i < unique; i++) {
+        bloom_key_t key;
+        bloom_key_init(&key, paths[i].start, paths[i].len);
+        for (int h = 0; h < BLOOM_NUM_HASHES; h++) {
+            uint64_t bit = key.hashes[h] % ((uint64_t)len * 8);
+            data[bit / 8] |= (unsigned char)(1u << (bit & 7));
+        }
+    }
+    *filter = (bloom_filter_t){ data, len };
+    return 0;
+}
+
+static void* graph_worker(void *arg)
+{
+    graph_worker_t *worker = arg;
+    graph_shared_t *shared = worker->shared;
+    
+    for (;;) {
+        size_t pos = atomic_fetch_add(&shared->next, 1);
+        if (pos >= (size_t)shared->repo->commit_count || atomic_load(&shared->failed))
+            break;
+        if (compute_filter(worker, (int)pos, &shared->filters[pos]) < 0)
+            atomic_store(&shared->failed, true);
+        arena_free(&worker->scratch);
+    }
+    return NULL;
+}
+
+static int resolve_worker_count(git_repository_t *repo)
+{
+    int workers = config_get_int(repo->ctx, "commitGraph.workers", 0);
+    
+    if (workers <= 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > GRAPH_MAX_WORKERS)
+        workers = GRAPH_MAX_WORKERS;
+    if (workers > repo->commit_count)
+        workers = repo->commit_count;
+    return workers < 1 ? 1 : workers;
+}
+
+static bloom_filter_t* compute_changed_paths(git_repository_t *repo)
+{
+    arena_t *arena = &repo->ctx->arena;
+    graph_shared_t shared = {
+        .repo = repo,
+        .filters = arena_calloc(arena, (size_t)repo->commit_count + 1, sizeof(*shared.filters)),
+    };
+    atomic_init(&shared.next, 0);
+    atomic_init(&shared.failed, false);
+    
+    int workers = resolve_worker_count(repo);
+    graph_worker_t slots[GRAPH_MAX_WORKERS];
+    pthread_t threads[GRAPH_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        slots[i] = (graph_worker_t){
+            .shared = &shared,
+            .scratch = arena_init(GRAPH_SCRATCH_ARENA),
+            .results = arena_init(0),
+        };
+    }
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, graph_worker, &slots[started + 1]) != 0)
+            break;
+        started++;
+    }
+    
+    // The main thread works too, and finishes alone if no thread started
+    graph_worker(&slots[0]);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    
+    // Filters move out of the per-worker arenas before those go
+    bool failed = atomic_load(&shared.failed);
+    for (int pos = 0; !failed && pos < repo->commit_count; pos++) {
+        bloom_filter_t *filter = &shared.filters[pos];
+        unsigned char *data = arena_alloc(arena, filter->len);
+        memcpy(data, filter->data, filter->len);
+        filter->data = data;
+    }
+    for (int i = 0; i < workers; i++)
+        arena_free(&slots[i].results);
+    return failed ? NULL : shared.filters;
+}
+
+/*
+ * Generations in one pass over the history: a commit is finished once
+ * its parents are, with an explicit stack standing in for recursion.
+ */
+static uint32_t* write_generations(git_repository_t *repo)
+{
+    arena_t *arena = &repo->ctx->arena;
+    uint32_t *generations = arena_calloc(arena, (size_t)repo->commit_count + 1, sizeof(*generations));
+    arena_t scratch = arena_init(0);
+    int *stack = arena_alloc(&scratch, ((size_t)repo->commit_count + 1) * sizeof(*stack));
+    
+    for (int start = 0; start < repo->commit_count; start++) {
+        size_t depth = 0;
+        if (generations[start])
+            continue;
+        
+        stack[depth++] = start;
+        while (depth > 0) {
+            const git_commit_node_t *node = &repo->commits[stack[depth - 1]];
+            uint32_t generation = 1;
+            bool ready = true;
+            for (int p = 0; p < node->parent_count; p++) {
+                uint32_t parent = generations[node->parents[p]];
+                if (!parent) {
+                    stack[depth++] = node->parents[p];
+                    ready = false;
+                    break;
+                }
+                if (parent + 1 > generation)
+                    generation = parent + 1;
+            }
+            if (ready)
+                generations[stack[--depth]] = generation;
+        }
+    }
+    arena_free(&scratch);
+    return generations;
+}
+
+const commit_graph_t* commit_graph_open(git_repository_t *repo)
+{
+    if (repo->graph)
+        return repo->graph;
+    if (!config_get_bool(repo->ctx, "core.commitGraph", true))
+        return NULL;
+    
+    commit_graph_t *graph = arena_calloc(&repo->ctx->arena, 1, sizeof(*graph));
+    graph->generations = write_generations(repo);
+    graph->commit_count = repo->commit_count;
+    repo->graph = graph;
+    return graph;
+}
+
+static const char* graph_file_path(git_repository_t *repo)
+{
+    const char *git_dir = getenv("GIT_DIR");
+    return git_dir ? arena_sprintf(&repo->ctx->arena, "%s/objects/info/commit-graph", git_dir) : NULL;
+}
+
+static int graph_entry_cmp(const void *a, const void *b)
+{
+    return oid_cmp(((const graph_entry_t *)a)->oid, ((const graph_entry_t *)b)->oid);
+}
+
+static int write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+// Written under a lock file and renamed over the old graph, so readers see one or the other
+static int write_graph_file(const char *path, const strbuf_t *data, arena_t *arena)
+{
+    const char *lock = arena_sprintf(arena, "%s.lock", path);
+    int fd = open(lock, O_WRONLY | O_CREAT | O_EXCL, 0444);
+    if (fd < 0)
+        return -1;
+    
+    int status = write_all(fd, data->buf, data->len);
+    if (close(fd) < 0 || status < 0 || rename(lock, path) < 0) {
+        int saved = errno;
+        unlink(lock);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+int commit_graph_write(git_repository_t *repo, bool changed_paths)
+{
+    arena_t *arena = &repo->ctx->arena;
+    const char *path = graph_file_path(repo);
+    size_t count = (size_t)repo->commit_count;
+    
+    if (!path) {
+        errno = ENOENT;
+        return -1;
+    }
+    
+    uint32_t *generations = repo->graph ? repo->graph->generations : write_generations(repo);
+    bloom_filter_t *filters = changed_paths ? compute_changed_paths(repo) : NULL;
+    if (changed_paths && !filters) {
+        errno = ENOENT; // a tree the filters diff is missing
+        return -1;
+    }
+    
+    graph_entry_t *sorted = arena_alloc(arena, (count + 1) * sizeof(*sorted));
+    uint32_t *graph_pos = arena_alloc(arena, (count + 1) * sizeof(*graph_pos));
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = (graph_entry_t){ &repo->commits[i].object->oid, (int)i };
+    qsort(sorted, count, sizeof(*sorted), graph_entry_cmp);
+    for (size_t i = 0; i < count; i++)
+        graph_pos[sorted[i].pos] = (uint32_t)i;
+    
+    size_t bloom_len = 0;
+    for (size_t i = 0; filters && i < count; i++)
+        bloom_len += filters[i].len;
+    
+    const uint32_t ids[] = { CHUNK_OID_FANOUT, CHUNK_OID_LOOKUP, CHUNK_COMMIT_DATA, CHUNK_BLOOM_INDEX,
+                             CHUNK_BLOOM_DATA };
+    const uint64_t sizes[] = { GRAPH_FANOUT_SIZE, count * GIT_OID_RAWSZ, count * GRAPH_DATA_WIDTH, count * 4,
+                               BDAT_HEADER_SIZE + bloom_len };
+    int chunk_count = filters ? 5 : 3;
+    uint64_t offset = GRAPH_HEADER_SIZE + (uint64_t)(chunk_count + 1) * GRAPH_CHUNK_ENTRY;
+    strbuf_t out = strbuf_init(arena, (size_t)offset + GRAPH_FANOUT_SIZE + count * (GRAPH_DATA_WIDTH + 28) +
+                                      bloom_len + BDAT_HEADER_SIZE + GIT_OID_RAWSZ);
+    
+    strbuf_add(&out, GRAPH_SIGNATURE, 4);
+    put_be(&out, GRAPH_VERSION, 1);
+    put_be(&out, GRAPH_HASH_SHA1, 1);
+    put_be(&out, (uint64_t)chunk_count, 1);
+    put_be(&out, 0, 1);
+    for (int i = 0; i < chunk_count; i++) {
+        put_be(&out, ids[i], 4);
+        put_be(&out, offset, 8);
+        offset += sizes[i];
+    }
+    put_be(&out, 0, 4);
+    put_be(&out, offset, 8);
+    
+    size_t below = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        while (below < count && sorted[below].oid->id[0] <= byte)
+            below++;
+        put_be(&out, below, 4);
+    }
+    for (size_t i = 0; i < count; i++)
+        strbuf_add(&out, (const char *)sorted[i].oid->id, GIT_OID_RAWSZ);
+    for (size_t i = 0; i < count; i++) {
+        const git_commit_node_t *node = &repo->commits[sorted[i].pos];
+        uint64_t generation = generations[sorted[i].pos];
+        uint64_t date = (uint64_t)node->date & 0x3ffffffffull;
+        strbuf_add(&out, (const char *)node->tree.id, GIT_OID_RAWSZ);
+        for (int p = 0; p < 2; p++)
+            put_be(&out, p < node->parent_count ? graph_pos[node->parents[p]] : GRAPH_PARENT_NONE, 4);
+        put_be(&out, (generation > GRAPH_GENERATION_MAX ? GRAPH_GENERATION_MAX : generation) << 34 | date, 8);
+    }
+    
+    if (filters) {
+        uint64_t end = 0;
+        for (size_t i = 0; i < count; i++) {
+            end += filters[sorted[i].pos].len;
+            put_be(&out, end, 4);
+        }
+        put_be(&out, BLOOM_VERSION, 4);
+        put_be(&out, BLOOM_NUM_HASHES, 4);
+        put_be(&out, BLOOM_BITS_PER_ENTRY, 4);
+        for (size_t i = 0; i < count; i++)
+            strbuf_add(&out, (const char *)filters[sorted[i].pos].data, filters[sorted[i].pos].len);
+    }
+    
+    git_oid_t checksum;
+    oid_hash_buffer(out.buf, out.len, &checksum);
+    strbuf_add(&out, (const char *)checksum.id, GIT_OID_RAWSZ);
+    return write_graph_file(path, &out, arena);
+}
+
+static bool find_chunk(const unsigned char *data, size_t size, int chunk_count, uint32_t id,
+                       const unsigned char **start, size_t *len)
+{
+    for (int i = 0; i < chunk_count; i++) {
+        const unsigned char *entry = data + GRAPH_HEADER_SIZE + (size_t)i * GRAPH_CHUNK_ENTRY;
+        if (get_be(entry, 4) != id)
+            continue;
+        
+        uint64_t offset = get_be(entry + 4, 8), end = get_be(entry + GRAPH_CHUNK_ENTRY + 4, 8);
+        if (offset > end || end > size - GIT_OID_RAWSZ)
+            return false;
+        *start = data + offset;
+        *len = (size_t)(end - offset);
+        return true;
+    }
+    return false;
+}
+
+// The position of `oid` in the file's sorted object names, narrowed by its first byte
+static long graph_find_oid(const unsigned char *fanout, const unsigned char *oids, const git_oid_t *oid)
+{
+    size_t low = oid->id[0] ? (size_t)get_be(fanout + 4 * (oid->id[0] - 1), 4) : 0;
+    size_t high = (size_t)get_be(fanout + 4 * oid->id[0], 4);
+    
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = memcmp(oids + mid * GIT_OID_RAWSZ, oid->id, GIT_OID_RAWSZ);
+        if (cmp == 0)
+            return (long)mid;
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return -1;
+}
+
+/*
+ * Map the commit-graph file and point each commit at its filter there.
+ * A commit the file does not know keeps an empty filter, which rules
+ * nothing out. NULL if the file is missing, damaged, or has no filters
+ * of the kind this reader computes keys for.
+ */
+static bloom_filter_t* read_changed_paths(git_repository_t *repo, commit_graph_t *graph)
+{
+    const char *path = graph_file_path(repo);
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0)
+        return NULL;
+    
+    struct stat st;
+    size_t min_size = GRAPH_HEADER_SIZE + GRAPH_CHUNK_ENTRY + GIT_OID_RAWSZ;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < min_size) {
+        close(fd);
+        return NULL;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+    
+    const unsigned char *data = map, *fanout, *oids, *index, *bloom;
+    size_t fanout_len, oids_len, index_len, bloom_len;
+    int chunk_count = data[6];
+    bool valid = memcmp(data, GRAPH_SIGNATURE, 4) == 0 && data[4] == GRAPH_VERSION && data[5] == GRAPH_HASH_SHA1 &&
+                 size >= GRAPH_HEADER_SIZE + (size_t)(chunk_count + 1) * GRAPH_CHUNK_ENTRY + GIT_OID_RAWSZ &&
+                 find_chunk(data, size, chunk_count, CHUNK_OID_FANOUT, &fanout, &fanout_len) &&
+                 fanout_len == GRAPH_FANOUT_SIZE &&
+                 find_chunk(data, size, chunk_count, CHUNK_OID_LOOKUP, &oids, &oids_len) &&
+                 find_chunk(data, size, chunk_count, CHUNK_BLOOM_INDEX, &index, &index_len) &&
+                 find_chunk(data, size, chunk_count, CHUNK_BLOOM_DATA, &bloom, &bloom_len) &&
+                 bloom_len >= BDAT_HEADER_SIZE && get_be(bloom, 4) == BLOOM_VERSION &&
+                 get_be(bloom + 4, 4) == BLOOM_NUM_HASHES && get_be(bloom + 8, 4) == BLOOM_BITS_PER_ENTRY;
+    size_t entries = valid ? (size_t)get_be(fanout + GRAPH_FANOUT_SIZE - 4, 4) : 0;
+    if (!valid || oids_len < entries * GIT_OID_RAWSZ || index_len < entries * 4) {
+        munmap(map, size);
+        return NULL;
+    }
+    
+    graph->map = data;
+    graph->map_size = size;
+    bloom += BDAT_HEADER_SIZE;
+    bloom_len -= BDAT_HEADER_SIZE;
+    
+    bloom_filter_t *filters = arena_calloc(&repo->ctx->arena, (size_t)repo->commit_count + 1, sizeof(*filters));
+    for (int pos = 0; pos < repo->commit_count; pos++) {
+        long found = graph_find_oid(fanout, oids, &repo->commits[pos].object->oid);
+        if (found < 0)
+            continue;
+        
+        uint64_t start = found > 0 ? get_be(index + 4 * (found - 1), 4) : 0;
+        uint64_t end = get_be(index + 4 * found, 4);
+        if (start <= end && end <= bloom_len)
+            filters[pos] = (bloom_filter_t){ bloom + start, (size_t)(end - start) };
+    }
+    return filters;
+}
+
+const commit_graph_t* commit_graph_open_changed_paths(git_repository_t *repo)
+{
+    if (!commit_graph_open(repo) || !config_get_bool(repo->ctx, "commitGraph.readChangedPaths", true))
+        return NULL;
+    
+    if (!repo->graph->changed_paths_read) {
+        repo->graph->filters = read_changed_paths(repo, repo->graph);
+        repo->graph->changed_paths_read = true;
+    }
+    return repo->graph->filters ? repo->graph : NULL;
+}
+
+void commit_graph_close(commit_graph_t *graph)
+{
+    if (graph && graph->map)
+        munmap((void *)graph->map, graph->map_size);
+}
+
+size_t bloom_keys_for_path(arena_t *arena, const char *path, bloom_key_t **keys)
+{
+    size_t count = 1;
+    
+    for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/'))
+        count++;
+    
+    *keys = arena_alloc(arena, count * sizeof(**keys));
+    bloom_key_init(&(*keys)[0], path, strlen(path));
+    size_t i = 1;
+    for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/'))
+        bloom_key_init(&(*keys)[i++], path, (size_t)(slash - path));
+    return count;
+}
+
+bool commit_graph_maybe_changed(const commit_graph_t *graph, int pos, const bloom_key_t *keys, size_t count)
+{
+    if (!graph || !graph->filters || pos < 0 || pos >= graph->commit_count || graph->filters[pos].len == 0)
+        return true;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (!bloom_filter_contains(&graph->filters[pos], &keys[i]))
+            return false;
+    }
+    return true;
+}
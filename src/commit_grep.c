@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 200809L
+#include "commit_grep.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef struct {
+    const char *text;
+    size_t len;
+} grep_span_t;
+
+static inline unsigned char fold_byte(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+commit_grep_t commit_grep_init(arena_t *arena, bool ignore_case)
+{
+    commit_grep_t grep = {
+        .arena = arena,
+        .ignore_case = ignore_case,
+    };
+    return grep;
+}
+
+int commit_grep_add(commit_grep_t *grep, commit_grep_field_t field, const char *pattern)
+{
+    if (grep->count == grep->alloc) {
+        size_t alloc = grep->alloc ? grep->alloc * 2 : 4;
+        grep->patterns = arena_realloc(grep->arena, grep->patterns, grep->alloc * sizeof(*grep->patterns),
+                                       alloc * sizeof(*grep->patterns));
+        grep->alloc = alloc;
+    }
+    
+    commit_grep_pattern_t *entry = &grep->patterns[grep->count];
+    *entry = (commit_grep_pattern_t){ .field = field };
+    grep->fields |= 1u << field;
+    
+    // None of the metacharacters of a basic regular expression
+    if (!strpbrk(pattern, ".[]*^$\\")) {
+        char *literal = arena_strdup(grep->arena, pattern);
+        entry->len = strlen(literal);
+        for (size_t i = 0; grep->ignore_case && i < entry->len; i++)
+            literal[i] = (char)fold_byte((unsigned char)literal[i]);
+        entry->literal = literal;
+        grep->count++;
+        return 0;
+    }
+    
+    int flags = REG_NOSUB | REG_NEWLINE | (grep->ignore_case ? REG_ICASE : 0);
+    int err = regcomp(&entry->regex, pattern, flags);
+    if (err != 0) {
+        char message[256];
+        regerror(err, &entry->regex, message, sizeof(message));
+        grep->error = arena_strdup(grep->arena, message);
+        return -1;
+    }
+    grep->count++;
+    return 0;
+}
+
+void commit_grep_free(commit_grep_t *grep)
+{
+    for (size_t i = 0; i < grep->count; i++) {
+        if (!grep->patterns[i].literal)
+            regfree(&grep->patterns[i].regex);
+    }
+    grep->count = 0;
+}
+
+static bool bytes_equal(const unsigned char *text, const unsigned char *literal, size_t len, bool ignore_case)
+{
+    if (!ignore_case)
+        return memcmp(text, literal, len) == 0;
+    for (size_t i = 0; i < len; i++) {
+        if (fold_byte(text[i]) != literal[i])
+            return false;
+    }
+    return true;
+}
+
+#ifdef __SSE2__
+static inline __m128i fold_block(__m128i block)
+{
+    // Shifted down, 'A'..'Z' become -128..-103, below every other byte
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8((char)('A' + 128)));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+#endif
+
+/*
+ * Find the literal at 16 starting positions at once: only where its first
+ * and last bytes both line up is the rest compared. Returns its offset,
+ * or -1.
+ */
+static long find_literal(const unsigned char *text, size_t size, const unsigned char *literal, size_t len,
+                         bool ignore_case)
+{
+    if (len == 0)
+        return 0;
+    if (len > size)
+        return -1;
+    
+    size_t i = 0, starts = size - len + 1;
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8((char)literal[0]);
+    const __m128i last = _mm_set1_epi8((char)literal[len - 1]);
+    for (; i + 16 <= starts; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i tail = _mm_loadu_si128((const __m128i *)(text + i + len - 1));
+        if (ignore_case) {
+            head = fold_block(head);
+            tail = fold_block(tail);
+        }
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first),
+                                                                  _mm_cmpeq_epi8(tail, last)));
+        while (mask) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (bytes_equal(text + at, literal, len, ignore_case))
+                return (long)at;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    
+    for (; i < starts; i++) {
+        if (bytes_equal(text + i, literal, len, ignore_case))
+            return (long)i;
+    }
+    return -1;
+}
+
+static bool pattern_matches(const commit_grep_t *grep, const commit_grep_pattern_t *entry, grep_span_t span)
+{
+    if (entry->literal)
+        return find_literal((const unsigned char *)span.text, span.len, (const unsigned char *)entry->literal,
+                            entry->len, grep->ignore_case) >= 0;
+
+#ifdef REG_STARTEND
+    regmatch_t range = { .rm_so = 0, .rm_eo = (regoff_t)span.len };
+    return regexec(&entry->regex, span.text, 1, &range, REG_STARTEND) == 0;
+#else
+    arena_t scratch = arena_init(span.len + 1);
+    bool matched = regexec(&entry->regex, arena_strndup(&scratch, span.text, span.len), 0, NULL, 0) == 0;
+    arena_free(&scratch);
+    return matched;
+#endif
+}
+
+/*
+ * Whether the patterns for `field` accept `span`: any one of them, or with
+ * `all` every one. A field nobody asked about accepts anything.
+ */
+static bool field_matches(const commit_grep_t *grep, commit_grep_field_t field, grep_span_t span, bool all)
+{
+    bool asked = false;
+    
+    for (size_t i = 0; i < grep->count; i++) {
+        if (grep->patterns[i].field != field)
+            continue;
+        asked = true;
+        if (pattern_matches(grep, &grep->patterns[i], span) != all)
+            return !all;
+    }
+    return all || !asked;
+}
+
+// "Name <email>" of an identity header, without the date that follows
+static grep_span_t identity_span(const char *start, const char *end)
+{
+    const char *close = end;
+    while (close > start && close[-1] != '>')
+        close--;
+    return (grep_span_t){ start, (size_t)((close > start ? close : end) - start) };
+}
+
+static grep_span_t header_span(const char *header, size_t size, const char *key)
+{
+    size_t key_len = strlen(key);
+    const char *end = header + size;
+    long at = find_literal((const unsigned char *)header, size, (const unsigned char *)key, key_len, false);
+    if (at < 0)
+        return (grep_span_t){ end, 0 };
+    
+    const char *start = header + at + key_len;
+    const char *eol = memchr(start, '\n', (size_t)(end - start));
+    return identity_span(start, eol ? eol : end);
+}
+
+bool commit_grep_match(const commit_grep_t *grep, const char *buffer, size_t size)
+{
+    const unsigned char *text = (const unsigned char *)buffer;
+    long blank = find_literal(text, size, (const unsigned char *)"\n\n", 2, false);
+    size_t header_len = blank < 0 ? size : (size_t)blank + 1;
+    grep_span_t message = { buffer + size, 0 };
+    
+    if (blank >= 0)
+        message = (grep_span_t){ buffer + blank + 2, size - (size_t)blank - 2 };
+    if ((grep->fields & (1u << COMMIT_GREP_AUTHOR)) &&
+        !field_matches(grep, COMMIT_GREP_AUTHOR, header_span(buffer, header_len, "\nauthor "), false))
+        return false;
+    if ((grep->fields & (1u << COMMIT_GREP_COMMITTER)) &&
+        !field_matches(grep, COMMIT_GREP_COMMITTER, header_span(buffer, header_len, "\ncommitter "), false))
+        return false;
+    
+    bool message_matches = field_matches(grep, COMMIT_GREP_MESSAGE, message, grep->all_match);
+    // Inverting leaves commits alone when no message pattern was given
+    if (grep->invert && (grep->fields & (1u << COMMIT_GREP_MESSAGE)))
+        return !message_matches;
+    return message_matches;
+}
@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "config_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "git_types.h"
+#include "mock_data.h"
+
+void config_set_override(git_context_t *ctx, const char *key, const char *value)
+{
+    git_config_entry_t *entries = arena_realloc(&ctx->arena, ctx->config_overrides,
+                                                ctx->config_override_count * sizeof(*entries),
+                                                (ctx->config_override_count + 1) * sizeof(*entries));
+    
+    entries[ctx->config_override_count++] = (git_config_entry_t){
+        .key = arena_strdup(&ctx->arena, key),
+        .value = arena_strdup(&ctx->arena, value ? value : "true"),
+        .scope = "command",
+    };
+    ctx->config_overrides = entries;
+}
+
+const char* config_get(git_context_t *ctx, const char *key, const char *fallback)
+{
+    // -c overrides win, and the last one given on the command line counts
+    for (int i = ctx->config_override_count - 1; i >= 0; i--) {
+        if (strcasecmp(ctx->config_overrides[i].key, key) == 0)
+            return ctx->config_overrides[i].value;
+    }
+    
+    int config_count;
+    const git_config_entry_t *configs = get_mock_config_entries("local", &config_count);
+    
+    for (int i = 0; i < config_count; i++) {
+        if (strcasecmp(configs[i].key, key) == 0)
+            return configs[i].value;
+    }
+    return fallback;
+}
+
+int config_get_int(git_context_t *ctx, const char *key, int fallback)
+{
+    const char *value = config_get(ctx, key, NULL);
+    if (!value)
+        return fallback;
+    
+    char *end;
+    long number = strtol(value, &end, 10);
+    return end != value && *end == '\0' ? (int)number : fallback;
+}
+
+bool config_get_bool(git_context_t *ctx, const char *key, bool fallback)
+{
+    const char *value = config_get(ctx, key, NULL);
+    if (!value)
+        return fallback;
+    
+    if (strcasecmp(value, "true") == 0 || strcasecmp(value, "yes") == 0 ||
+        strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0)
+        return true;
+    if (strcasecmp(value, "false") == 0 || strcasecmp(value, "no") == 0 ||
+        strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0)
+        return false;
+    return fallback;
+}
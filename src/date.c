@@ -0,0 +1,399 @@
+#define _POSIX_C_SOURCE 200809L
+#include "date.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char weekday_names[][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char month_names[][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
+
+typedef struct {
+    long long year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int weekday;
+    int yday;
+} date_civil_t;
+
+static long long floor_div(long long a, long long b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// Days since the epoch of a Gregorian date, counting years from March
+static long long days_from_civil(long long year, int month, int day)
+{
+    long long y = month <= 2 ? year - 1 : year;
+    long long era = floor_div(y, 400);
+    long long year_of_era = y - era * 400;
+    long long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static date_civil_t civil_from_time(long long time)
+{
+    long long days = floor_div(time, 86400);
+    long long seconds = time - days * 86400;
+    long long z = days + 719468;
+    long long era = floor_div(z, 146097);
+    long long day_of_era = z - era * 146097;
+    long long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    long long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    long long month_index = (5 * day_of_year + 2) / 153;
+    date_civil_t civil = {
+        .month = (int)(month_index < 10 ? month_index + 3 : month_index - 9),
+        .day = (int)(day_of_year - (153 * month_index + 2) / 5 + 1),
+        .hour = (int)(seconds / 3600),
+        .minute = (int)(seconds / 60 % 60),
+        .second = (int)(seconds % 60),
+        // The epoch fell on a Thursday
+        .weekday = (int)((days % 7 + 11) % 7),
+    };
+    
+    civil.year = year_of_era + era * 400 + (civil.month <= 2);
+    civil.yday = (int)(days - days_from_civil(civil.year, 1, 1));
+    return civil;
+}
+
+// Minutes east of UTC of the local zone at `time`
+static int local_offset(long long time)
+{
+    time_t t = (time_t)time;
+    struct tm tm;
+    
+    if (!localtime_r(&t, &tm))
+        return 0;
+    long long local = days_from_civil(tm.tm_year + 1900LL, tm.tm_mon + 1, tm.tm_mday) * 86400 +
+                      tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    return (int)floor_div(local - time, 60);
+}
+
+int date_mode_parse(const char *text, date_mode_t *mode)
+{
+    static const struct {
+        const char *name;
+        date_mode_type_t type;
+    } modes[] = {
+        { "default", DATE_NORMAL },
+        { "relative", DATE_RELATIVE },
+        { "iso", DATE_ISO },
+        { "iso8601", DATE_ISO },
+        { "iso-strict", DATE_ISO_STRICT },
+        { "iso8601-strict", DATE_ISO_STRICT },
+        { "rfc", DATE_RFC },
+        { "rfc2822", DATE_RFC },
+        { "short", DATE_SHORT },
+        { "raw", DATE_RAW },
+        { "unix", DATE_UNIX },
+    };
+    
+    *mode = (date_mode_t){ .type = DATE_NORMAL };
+    if (strncmp(text, "format:", 7) == 0 || strncmp(text, "format-local:", 13) == 0) {
+        mode->type = DATE_STRFTIME;
+        mode->local = text[6] == '-';
+        mode->strftime_format = strchr(text, ':') + 1;
+        return 0;
+    }
+    if (strcmp(text, "local") == 0) {
+        mode->local = true;
+        return 0;
+    }
+    
+    size_t len = strlen(text);
+    if (len > 6 && strcmp(text + len - 6, "-local") == 0) {
+        mode->local = true;
+        len -= 6;
+    }
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strlen(modes[i].name) == len && strncmp(text, modes[i].name, len) == 0) {
+            mode->type = modes[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int month_number(const char *name)
+{
+    for (int i = 0; i < 12; i++) {
+        if (strncmp(name, month_names[i], 3) == 0)
+            return i + 1;
+    }
+    return 0;
+}
+
+// An optional trailing zone, "Z", "+hhmm" or "+hh:mm"; 1 if there is one
+static int parse_zone(const char *text, int *offset)
+{
+    int hours, minutes, used = 0;
+    
+    while (*text == ' ')
+        text++;
+    if (*text == '\0')
+        return 0;
+    if (text[0] == 'Z' && text[1] == '\0') {
+        *offset = 0;
+        return 1;
+    }
+    if ((text[0] != '+' && text[0] != '-') ||
+        (sscanf(text + 1, "%2d:%2d%n", &hours, &minutes, &used) != 2 &&
+         sscanf(text + 1, "%2d%2d%n", &hours, &minutes, &used) != 2) ||
+        text[1 + used] != '\0' || minutes >= 60)
+        return -1;
+    *offset = (text[0] == '-' ? -1 : 1) * (hours * 60 + minutes);
+    return 1;
+}
+
+// "<n> <unit>s ago", counting months and years on the calendar
+static int parse_relative(const char *text, long long now, long long *time)
+{
+    static const struct {
+        const char *unit;
+        long long seconds;
+    } units[] = {
+        { "second", 1 }, { "minute", 60 }, { "hour", 3600 }, { "day", 86400 }, { "week", 604800 },
+        { "month", 0 }, { "year", 0 },
+    };
+    long long count;
+    char unit[16];
+    int used = 0;
+    
+    if (sscanf(text, "%lld%*[ .]%15[a-z]%*[ .]ago%n", &count, unit, &used) != 2 || used == 0 || text[used])
+        return -1;
+    
+    size_t len = strlen(unit);
+    if (len > 1 && unit[len - 1] == 's')
+        unit[--len] = '\0';
+    for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+        if (strcmp(unit, units[i].unit) != 0)
+            continue;
+        if (units[i].seconds > 0) {
+            *time = now - count * units[i].seconds;
+            return 0;
+        }
+        
+        date_civil_t civil = civil_from_time(now);
+        long long months = civil.year * 12 + civil.month - 1 - count * (unit[0] == 'y' ? 12 : 1);
+        long long year = floor_div(months, 12);
+        int month = (int)(months - year * 12) + 1;
+        long long next = month == 12 ? days_from_civil(year + 1, 1, 1) : days_from_civil(year, month + 1, 1);
+        int last_day = (int)(next - days_from_civil(year, month, 1));
+        int day = civil.day < last_day ? civil.day : last_day;
+        *time = days_from_civil(year, month, day) * 86400 + civil.hour * 3600 + civil.minute * 60 + civil.second;
+        return 0;
+    }
+    return -1;
+}
+
+int date_parse(const char *text, long long now, bool local, long long *time, int *tz)
+{
+    int year, month, day, hour = 0, minute = 0, second = 0, used = 0, offset = 0;
+    char weekday[4], month_name[4];
+    const char *rest;
+    
+    *tz = 0;
+    if (strcmp(text, "now") == 0 || strcmp(text, "yesterday") == 0) {
+        *time = text[0] == 'y' ? now - 86400 : now;
+        *tz = local ? local_offset(*time) : 0;
+        return 0;
+    }
+    if (text[0] == '@') {
+        char *end;
+        *time = strtoll(text + 1, &end, 10);
+        return end > text + 1 && *end == '\0' ? 0 : -1;
+    }
+    if (parse_relative(text, now, time) == 0) {
+        *tz = local ? local_offset(*time) : 0;
+        return 0;
+    }
+    
+    if (sscanf(text, "%4d-%2d-%2d%n", &year, &month, &day, &used) == 3) {
+        rest = text + used;
+        if ((*rest == ' ' || *rest == 'T') && sscanf(rest + 1, "%2d:%2d%n", &hour, &minute, &used) == 2) {
+            rest += 1 + used;
+            if (*rest == ':' && sscanf(rest + 1, "%2d%n", &second, &used) == 1)
+                rest += 1 + used;
+        }
+    } else if (sscanf(text, "%3s %3s %d %d:%d:%d %d%n", weekday, month_name, &day, &hour, &minute, &second, &year,
+                      &used) == 7 ||
+               sscanf(text, "%3s, %d %3s %d %d:%d:%d%n", weekday, &day, month_name, &year, &hour, &minute, &second,
+                      &used) == 7) {
+        month = month_number(month_name);
+        rest = text + used;
+    } else {
+        return -1;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return -1;
+    
+    long long civil = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    int zone = parse_zone(rest, &offset);
+    if (zone < 0)
+        return -1;
+    if (zone == 0 && local) {
+        // The offset in effect at the local time, not at the same UTC time
+        offset = local_offset(civil);
+        offset = local_offset(civil - offset * 60LL);
+    }
+    *time = civil - offset * 60LL;
+    *tz = offset;
+    return 0;
+}
+
+date_formatter_t date_formatter_init(date_mode_t mode, long long now)
+{
+    date_formatter_t formatter = {
+        .mode = mode,
+        .now = now,
+    };
+    
+    for (int i = 0; i < DATE_ZONE_CACHE; i++)
+        formatter.zone_days[i] = LLONG_MIN;
+    return formatter;
+}
+
+static int cached_local_offset(date_formatter_t *formatter, long long time)
+{
+    long long day = floor_div(time, 86400);
+    size_t slot = (size_t)(day & (DATE_ZONE_CACHE - 1));
+    
+    if (formatter->zone_days[slot] != day) {
+        int start = local_offset(day * 86400);
+        int end = local_offset(day * 86400 + 86399);
+        formatter->zone_days[slot] = day;
+        formatter->zone_offsets[slot] = start == end ? start : INT_MIN;
+    }
+    return formatter->zone_offsets[slot] != INT_MIN ? formatter->zone_offsets[slot] : local_offset(time);
+}
+
+static void add_ago(strbuf_t *out, long long count, const char *unit)
+{
+    strbuf_addf(out, "%lld %s%s ago", count, unit, count == 1 ? "" : "s");
+}
+
+// Rounded as git rounds them
+static void format_relative(long long now, long long time, strbuf_t *out)
+{
+    long long diff = now - time;
+    
+    if (time > now) {
+        strbuf_addstr(out, "in the future");
+    } else if (diff < 90) {
+        add_ago(out, diff, "second");
+    } else if ((diff = (diff + 30) / 60) < 90) {
+        add_ago(out, diff, "minute");
+    } else if ((diff = (diff + 30) / 60) < 36) {
+        add_ago(out, diff, "hour");
+    } else if ((diff = (diff + 12) / 24) < 14) {
+        add_ago(out, diff, "day");
+    } else if (diff < 70) {
+        add_ago(out, (diff + 3) / 7, "week");
+    } else if (diff < 365) {
+        add_ago(out, (diff + 15) / 30, "month");
+    } else if (diff < 1825) {
+        long long total_months = (diff * 12 * 2 + 365) / (365 * 2);
+        long long years = total_months / 12, months = total_months % 12;
+        if (months > 0) {
+            strbuf_addf(out, "%lld year%s, ", years, years == 1 ? "" : "s");
+            add_ago(out, months, "month");
+        } else {
+            add_ago(out, years, "year");
+        }
+    } else {
+        add_ago(out, (diff + 183) / 365, "year");
+    }
+}
+
+// strftime() knows no zone of ours, so %z is filled in beforehand
+static void format_strftime(const char *format, const date_civil_t *civil, const char *zone, strbuf_t *out)
+{
+    char pattern[256], text[256];
+    size_t len = 0;
+    
+    for (const char *p = format; *p && len + 6 < sizeof(pattern); p++) {
+        if (p[0] == '%' && p[1] == 'z') {
+            memcpy(pattern + len, zone, 5);
+            len += 5;
+            p++;
+        } else if (p[0] == '%' && p[1]) {
+            pattern[len++] = *p++;
+            pattern[len++] = *p;
+        } else {
+            pattern[len++] = *p;
+        }
+    }
+    pattern[len] = '\0';
+    
+    struct tm tm = {
+        .tm_year = (int)(civil->year - 1900),
+        .tm_mon = civil->month - 1,
+        .tm_mday = civil->day,
+        .tm_hour = civil->hour,
+        .tm_min = civil->minute,
+        .tm_sec = civil->second,
+        .tm_wday = civil->weekday,
+        .tm_yday = civil->yday,
+    };
+    strbuf_add(out, text, strftime(text, sizeof(text), pattern, &tm));
+}
+
+void date_format(date_formatter_t *formatter, long long time, int tz, strbuf_t *out)
+{
+    const date_mode_t *mode = &formatter->mode;
+    char zone[8];
+    
+    if (mode->type == DATE_UNIX) {
+        strbuf_addf(out, "%lld", time);
+        return;
+    }
+    if (mode->type == DATE_RELATIVE) {
+        format_relative(formatter->now, time, out);
+        return;
+    }
+    if (mode->local)
+        tz = cached_local_offset(formatter, time);
+    
+    int minutes = tz < 0 ? -tz : tz;
+    snprintf(zone, sizeof(zone), "%c%02d%02d", tz < 0 ? '-' : '+', minutes / 60 % 100, minutes % 60);
+    if (mode->type == DATE_RAW) {
+        strbuf_addf(out, "%lld %s", time, zone);
+        return;
+    }
+    
+    date_civil_t c = civil_from_time(time + tz * 60LL);
+    switch (mode->type) {
+    case DATE_ISO:
+        strbuf_addf(out, "%04lld-%02d-%02d %02d:%02d:%02d %s", c.year, c.month, c.day, c.hour, c.minute, c.second,
+                    zone);
+        break;
+    case DATE_ISO_STRICT:
+        strbuf_addf(out, "%04lld-%02d-%02dT%02d:%02d:%02d%.3s:%s", c.year, c.month, c.day, c.hour, c.minute,
+                    c.second, zone, zone + 3);
+        break;
+    case DATE_RFC:
+        strbuf_addf(out, "%s, %d %s %lld %02d:%02d:%02d %s", weekday_names[c.weekday], c.day,
+                    month_names[c.month - 1], c.year, c.hour, c.minute, c.second, zone);
+        break;
+    case DATE_SHORT:
+        strbuf_addf(out, "%04lld-%02d-%02d", c.year, c.month, c.day);
+        break;
+    case DATE_STRFTIME:
+        format_strftime(mode->strftime_format, &c, zone, out);
+        break;
+    default:
+        strbuf_addf(out, "%s %s %d %02d:%02d:%02d %lld", weekday_names[c.weekday], month_names[c.month - 1], c.day,
+                    c.hour, c.minute, c.second, c.year);
+        // Local times leave the zone out
+        if (!mode->local)
+            strbuf_addf(out, " %s", zone);
+        break;
+    }
+}
@@ -0,0 +1,139 @@
+#include "decorate.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "colors.h"
+
+static const char *const ref_prefixes[] = {
+    [DECORATION_HEAD] = "",
+    [DECORATION_LOCAL] = "refs/heads/",
+    [DECORATION_REMOTE] = "refs/remotes/",
+    [DECORATION_TAG] = "refs/tags/",
+};
+
+// Bits of the name past those that pick the slot
+static uint32_t oid_check(const git_oid_t *oid)
+{
+    uint32_t check;
+    memcpy(&check, oid->id + sizeof(uint64_t), sizeof(check));
+    return check;
+}
+
+/* The slot of `oid`, or the empty one it would take. */
+static decoration_slot_t* find_slot(const decoration_map_t *map, const git_oid_t *oid)
+{
+    uint64_t hash;
+    uint32_t check = oid_check(oid);
+    
+    // Object names are already uniformly distributed
+    memcpy(&hash, oid->id, sizeof(hash));
+    size_t slot = (size_t)(hash & (map->capacity - 1));
+    while (map->slots[slot].entry &&
+           (map->slots[slot].check != check || oid_cmp(&map->entries[map->slots[slot].entry - 1].oid, oid) != 0))
+        slot = (slot + 1) & (map->capacity - 1);
+    return &map->slots[slot];
+}
+
+// Each ref goes in front, so the list ends up in reverse order of adding
+static void add_decoration(decoration_map_t *map, decoration_t *decoration, const git_oid_t *oid)
+{
+    decoration_slot_t *slot = find_slot(map, oid);
+    
+    if (!slot->entry) {
+        map->entries[map->entry_count] = (decoration_entry_t){ .oid = *oid };
+        *slot = (decoration_slot_t){ .check = oid_check(oid), .entry = (uint32_t)++map->entry_count };
+    }
+    decoration_entry_t *entry = &map->entries[slot->entry - 1];
+    decoration->next = entry->first;
+    entry->first = decoration;
+}
+
+static decoration_type_t ref_type(const char *name)
+{
+    for (decoration_type_t type = DECORATION_LOCAL; type <= DECORATION_TAG; type++) {
+        if (strncmp(name, ref_prefixes[type], strlen(ref_prefixes[type])) == 0)
+            return type;
+    }
+    return DECORATION_LOCAL;
+}
+
+decoration_map_t decoration_map_build(const git_repository_t *repo, arena_t *arena)
+{
+    size_t ref_count = ref_store_count(&repo->refs, "");
+    size_t capacity = 16;
+    
+    // At most half full, with a slot for HEAD
+    while (capacity < 2 * (ref_count + 1))
+        capacity *= 2;
+    decoration_map_t map = {
+        .slots = arena_calloc(arena, capacity, sizeof(*map.slots)),
+        .capacity = capacity,
+        .entries = arena_alloc(arena, (ref_count + 1) * sizeof(*map.entries)),
+    };
+    decoration_t *decorations = arena_alloc(arena, (ref_count + 1) * sizeof(*decorations));
+    
+    ref_iter_t iter = ref_store_iter(&repo->refs, "");
+    git_ref_t ref;
+    for (size_t i = 0; i < ref_count && ref_iter_next(&iter, &ref); i++) {
+        const char *name = arena_strndup(arena, ref.name, ref.name_len);
+        decorations[i] = (decoration_t){ .name = name, .type = ref_type(name) };
+        add_decoration(&map, &decorations[i], oid_is_zero(&ref.peeled) ? &ref.oid : &ref.peeled);
+    }
+    if (repo->head >= 0) {
+        decoration_t *head = &decorations[ref_count];
+        *head = (decoration_t){ .name = "HEAD", .type = DECORATION_HEAD };
+        add_decoration(&map, head, &repo->commits[repo->head].object->oid);
+    }
+    if (repo->head_ref)
+        map.head_ref = arena_sprintf(arena, "refs/heads/%s", repo->head_ref);
+    return map;
+}
+
+const decoration_t* decoration_lookup(const decoration_map_t *map, const git_oid_t *oid)
+{
+    const decoration_slot_t *slot = find_slot(map, oid);
+    return slot->entry ? map->entries[slot->entry - 1].first : NULL;
+}
+
+static void add_name(strbuf_t *out, const decoration_t *decoration, bool full)
+{
+    const char *name = decoration->name + (full ? 0 : strlen(ref_prefixes[decoration->type]));
+    
+    switch (decoration->type) {
+    case DECORATION_HEAD:   strbuf_addstr(out, name); break;
+    case DECORATION_LOCAL:  strbuf_addf(out, COLOR_GREEN("%s"), name); break;
+    case DECORATION_REMOTE: strbuf_addf(out, COLOR_CYAN("%s"), name); break;
+    case DECORATION_TAG:    strbuf_addf(out, COLOR_BLUE("tag: %s"), name); break;
+    }
+}
+
+void decoration_format(const decoration_map_t *map, const git_oid_t *oid, bool full, strbuf_t *out)
+{
+    const decoration_t *first = decoration_lookup(map, oid);
+    const decoration_t *branch = NULL;
+    
+    if (!first)
+        return;
+    
+    // HEAD, added last, leads; the branch it is on follows it as "HEAD -> main"
+    if (first->type == DECORATION_HEAD && map->head_ref) {
+        for (const decoration_t *d = first->next; d && !branch; d = d->next) {
+            if (strcmp(d->name, map->head_ref) == 0)
+                branch = d;
+        }
+    }
+    
+    const char *separator = " (";
+    for (const decoration_t *d = first; d; d = d->next) {
+        if (d == branch)
+            continue;
+        strbuf_addstr(out, separator);
+        add_name(out, d, full);
+        if (d->type == DECORATION_HEAD && branch) {
+            strbuf_addstr(out, " -> ");
+            add_name(out, branch, full);
+        }
+        separator = ", ";
+    }
+    strbuf_addch(out, ')');
+}
@@ -0,0 +1,258 @@
+#include "describe.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "object_store.h"
+#include "revision.h"
+
+#define DESCRIBE_SEEN   (1u << 0)
+#define DESCRIBE_QUEUED (1u << 31)
+
+/*
+ * A tag met on the walk. `depth` counts the walked commits that do not
+ * reach it, and `queued` the commits now queued that do.
+ */
+typedef struct {
+    const describe_name_t *name;
+    int depth;
+    uint32_t flag;
+    size_t queued;
+} describe_match_t;
+
+typedef struct {
+    git_repository_t *repo;
+    uint32_t *flags;
+    rev_queue_t queue;
+    describe_match_t matches[DESCRIBE_MAX_CANDIDATES];
+    int match_count;
+} describe_walk_t;
+
+/* The slot of `oid`, or the empty one it would take. */
+static uint32_t* find_slot(const describe_names_t *names, const git_oid_t *oid)
+{
+    uint64_t hash;
+    
+    // Object names are already uniformly distributed
+    memcpy(&hash, oid->id, sizeof(hash));
+    size_t slot = (size_t)(hash & (names->capacity - 1));
+    while (names->slots[slot] && oid_cmp(&names->entries[names->slots[slot] - 1].commit, oid) != 0)
+        slot = (slot + 1) & (names->capacity - 1);
+    return &names->slots[slot];
+}
+
+// The date of the tagger line, 0 without one
+static long long tagger_date(const git_object_t *tag)
+{
+    const char *end = tag->data + tag->size;
+    
+    for (const char *line = tag->data; line < end && *line != '\n';) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        eol = eol ? eol : end;
+        if (strncmp(line, "tagger ", 7) == 0) {
+            const char *close = line;
+            for (const char *p = line; p < eol; p++) {
+                if (*p == '>')
+                    close = p;
+            }
+            return close > line ? strtoll(close + 1, NULL, 10) : 0;
+        }
+        line = eol + 1;
+    }
+    return 0;
+}
+
+// Whether a tag for a commit already named should take the name over
+static bool replaces(const describe_name_t *old, const describe_name_t *new)
+{
+    if (old->annotated != new->annotated)
+        return new->annotated;
+    return new->annotated && new->date > old->date;
+}
+
+describe_names_t describe_names_build(const git_repository_t *repo, arena_t *arena)
+{
+    size_t tag_count = ref_store_count(&repo->refs, "refs/tags/");
+    size_t capacity = 16;
+    
+    while (capacity < 2 * tag_count)
+        capacity *= 2;
+    describe_names_t names = {
+        .entries = arena_alloc(arena, (tag_count + 1) * sizeof(*names.entries)),
+        .slots = arena_calloc(arena, capacity, sizeof(*names.slots)),
+        .capacity = capacity,
+    };
+    
+    ref_iter_t iter = ref_store_iter(&repo->refs, "refs/tags/");
+    git_ref_t ref;
+    while (ref_iter_next(&iter, &ref)) {
+        bool annotated = !oid_is_zero(&ref.peeled);
+        const git_object_t *tag = annotated ? odb_read(&repo->odb, &ref.oid) : NULL;
+        describe_name_t name = {
+            .commit = annotated ? ref.peeled : ref.oid,
+            .name = arena_strndup(arena, ref.name + 10, ref.name_len - 10),
+            .date = tag ? tagger_date(tag) : 0,
+            .annotated = annotated,
+        };
+        uint32_t *slot = find_slot(&names, &name.commit);
+        if (!*slot) {
+            names.entries[names.count] = name;
+            *slot = (uint32_t)++names.count;
+        } else if (replaces(&names.entries[*slot - 1], &name)) {
+            names.entries[*slot - 1] = name;
+        }
+    }
+    return names;
+}
+
+const describe_name_t* describe_names_lookup(const describe_names_t *names, const git_oid_t *oid)
+{
+    uint32_t slot = *find_slot(names, oid);
+    return slot ? &names->entries[slot - 1] : NULL;
+}
+
+static void queue_commit(describe_walk_t *walk, int pos)
+{
+    walk->flags[pos] |= DESCRIBE_QUEUED;
+    for (int m = 0; m < walk->match_count; m++) {
+        if (walk->flags[pos] & walk->matches[m].flag)
+            walk->matches[m].queued++;
+    }
+    rev_queue_push(&walk->queue, &walk->repo->ctx->arena, pos);
+}
+
+static int next_commit(describe_walk_t *walk)
+{
+    int pos = rev_queue_pop(&walk->queue);
+    if (pos < 0)
+        return -1;
+    
+    walk->flags[pos] &= ~DESCRIBE_QUEUED;
+    for (int m = 0; m < walk->match_count; m++) {
+        if (walk->flags[pos] & walk->matches[m].flag)
+            walk->matches[m].queued--;
+    }
+    return pos;
+}
+
+/*
+ * Pass the marks of the commit at `pos` to its parents, queueing those
+ * not seen yet. A parent already queued counts towards each tag it
+ * newly reaches.
+ */
+static void mark_parents(describe_walk_t *walk, int pos)
+{
+    const git_commit_node_t *node = &walk->repo->commits[pos];
+    uint32_t marks = walk->flags[pos] & ~DESCRIBE_QUEUED;
+    
+    for (int i = 0; i < node->parent_count; i++) {
+        int parent = node->parents[i];
+        uint32_t added = marks & ~walk->flags[parent];
+        
+        if (!(walk->flags[parent] & DESCRIBE_SEEN)) {
+            walk->flags[parent] |= marks;
+            queue_commit(walk, parent);
+            continue;
+        }
+        walk->flags[parent] |= added;
+        for (int m = 0; added && (walk->flags[parent] & DESCRIBE_QUEUED) && m < walk->match_count; m++) {
+            if (added & walk->matches[m].flag)
+                walk->matches[m].queued++;
+        }
+    }
+}
+
+// The fewest commits, then the first found
+static describe_match_t* best_match(describe_walk_t *walk)
+{
+    describe_match_t *best = &walk->matches[0];
+    
+    for (int m = 1; m < walk->match_count; m++) {
+        if (walk->matches[m].depth < best->depth)
+            best = &walk->matches[m];
+    }
+    return best;
+}
+
+/*
+ * Once every queued commit reaches the best tag, so does everything the
+ * walk would still take out: its count stays put, while any other tag's
+ * can only grow, and a tag met later comes after more commits than it
+ * has.
+ */
+static bool settled(describe_walk_t *walk)
+{
+    return walk->match_count > 0 && best_match(walk)->queued == walk->queue.count;
+}
+
+/*
+ * With no room for more tags, walk on until only commits reaching the
+ * best one are left, counting those that do not.
+ */
+static void finish_depth(describe_walk_t *walk, describe_match_t *best)
+{
+    for (int pos; (pos = next_commit(walk)) >= 0;) {
+        if (!(walk->flags[pos] & best->flag))
+            best->depth++;
+        else if (best->queued == walk->queue.count)
+            break;
+        mark_parents(walk, pos);
+    }
+}
+
+int describe_commit(git_repository_t *repo, const describe_names_t *names, int pos, const describe_options_t *opts,
+                    describe_result_t *out)
+{
+    const describe_name_t *name = describe_names_lookup(names, &repo->commits[pos].object->oid);
+    
+    *out = (describe_result_t){ .unannotated = name && !name->annotated };
+    if (name && (opts->tags || name->annotated)) {
+        out->name = name;
+        return 0;
+    }
+    if (opts->candidates <= 0)
+        return -1;
+    
+    describe_walk_t walk = {
+        .repo = repo,
+        .flags = arena_calloc(&repo->ctx->arena, (size_t)repo->commit_count + 1, sizeof(*walk.flags)),
+        .queue = rev_queue_init(repo, NULL),
+    };
+    int candidates = opts->candidates < DESCRIBE_MAX_CANDIDATES ? opts->candidates : DESCRIBE_MAX_CANDIDATES;
+    int seen = 0, gave_up = -1;
+    
+    walk.flags[pos] = DESCRIBE_SEEN;
+    queue_commit(&walk, pos);
+    for (int c; (c = next_commit(&walk)) >= 0;) {
+        seen++;
+        name = describe_names_lookup(names, &repo->commits[c].object->oid);
+        if (name && !opts->tags && !name->annotated) {
+            out->unannotated = true;
+        } else if (name && walk.match_count < candidates) {
+            describe_match_t *match = &walk.matches[walk.match_count++];
+            *match = (describe_match_t){ .name = name, .depth = seen - 1, .flag = 1u << walk.match_count };
+            walk.flags[c] |= match->flag;
+        } else if (name) {
+            gave_up = c;
+            break;
+        }
+        
+        for (int m = 0; m < walk.match_count; m++) {
+            if (!(walk.flags[c] & walk.matches[m].flag))
+                walk.matches[m].depth++;
+        }
+        mark_parents(&walk, c);
+        if (settled(&walk))
+            break;
+    }
+    if (walk.match_count == 0)
+        return -1;
+    
+    describe_match_t *best = best_match(&walk);
+    if (gave_up >= 0) {
+        queue_commit(&walk, gave_up);
+        finish_depth(&walk, best);
+    }
+    out->name = best->name;
+    out->depth = best->depth;
+    return 0;
+}
@@ -0,0 +1,450 @@
+#include "diff.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "colors.h"
+#include "config_utils.h"
+
+#define BINARY_SNIFF_SIZE 8000
+#define FUNCNAME_MAX 80
+#define DEFAULT_RENAME_LIMIT 1000
+
+#ifdef NO_COLOR
+    #define DIFF_COLOR(code) ""
+    #define DIFF_RESET ""
+#else
+    #define DIFF_COLOR(code) code
+    #define DIFF_RESET ANSI_RESET
+#endif
+
+typedef struct {
+    diff_file_stat_t stat;
+    diff_file_t old_file;
+    diff_file_t new_file;
+    diff_hunk_list_t hunks;
+} diff_filepair_t;
+
+diff_algorithm_t diff_algorithm_from_config(git_context_t *ctx, const char *name)
+{
+    if (!name)
+        name = config_get(ctx, "diff.algorithm", "myers");
+    
+    if (strcmp(name, "patience") == 0)
+        return DIFF_ALGORITHM_PATIENCE;
+    if (strcmp(name, "histogram") == 0)
+        return DIFF_ALGORITHM_HISTOGRAM;
+    return DIFF_ALGORITHM_MYERS;
+}
+
+static diff_detect_t detect_from_config(git_context_t *ctx)
+{
+    const char *renames = config_get(ctx, "diff.renames", NULL);
+    
+    if (renames && (strcmp(renames, "copies") == 0 || strcmp(renames, "copy") == 0))
+        return DIFF_DETECT_COPIES;
+    return config_get_bool(ctx, "diff.renames", true) ? DIFF_DETECT_RENAMES : DIFF_DETECT_NONE;
+}
+
+diff_options_t diff_options_init(git_context_t *ctx)
+{
+    diff_options_t opts = {
+        .algorithm = diff_algorithm_from_config(ctx, NULL),
+        .format = 0,
+        .context = 3,
+        .stat_width = 80,
+        .detect = detect_from_config(ctx),
+        .rename_score = 50,
+        .rename_limit = config_get_int(ctx, "diff.renameLimit", DEFAULT_RENAME_LIMIT),
+        .pathspec = { NULL, 0 },
+    };
+    return opts;
+}
+
+static bool buffer_is_binary(const git_object_t *blob)
+{
+    if (!blob)
+        return false;
+    size_t len = blob->size < BINARY_SNIFF_SIZE ? blob->size : BINARY_SNIFF_SIZE;
+    return memchr(blob->data, '\0', len) != NULL;
+}
+
+/*
+ * "a => b", with the leading directories and trailing part the paths share
+ * pulled out of braces: "src/{a => b}/file.c".
+ */
+static const char* rename_display_name(arena_t *arena, const char *a, const char *b)
+{
+    size_t len_a = strlen(a), len_b = strlen(b);
+    size_t prefix = 0, suffix = 0;
+    
+    for (size_t i = 0; a[i] && a[i] == b[i]; i++) {
+        if (a[i] == '/')
+            prefix = i + 1;
+    }
+    
+    // A shared prefix ends in a slash the suffix may reuse
+    size_t floor = prefix ? prefix - 1 : 0;
+    for (size_t i = len_a, j = len_b; i > floor && j > floor && a[i - 1] == b[j - 1]; i--, j--) {
+        if (a[i - 1] == '/')
+            suffix = len_a - (i - 1);
+    }
+    
+    size_t mid_a = len_a > prefix + suffix ? len_a - prefix - suffix : 0;
+    size_t mid_b = len_b > prefix + suffix ? len_b - prefix - suffix : 0;
+    if (prefix + suffix == 0)
+        return arena_sprintf(arena, "%s => %s", a, b);
+    return arena_sprintf(arena, "%.*s{%.*s => %.*s}%s", (int)prefix, a, (int)mid_a, a + prefix, (int)mid_b,
+                         b + prefix, a + len_a - suffix);
+}
+
+static int load_filepair(const git_odb_t *odb, line_intern_t *intern, const diff_options_t *opts,
+                         const git_diff_entry_t *entry, diff_filepair_t *pair)
+{
+    const git_object_t *old_blob = NULL, *new_blob = NULL;
+    
+    if (entry->status != DIFF_ADDED && !(old_blob = odb_read(odb, &entry->old_oid)))
+        return -1;
+    if (entry->status != DIFF_DELETED && !(new_blob = odb_read(odb, &entry->new_oid)))
+        return -1;
+    
+    pair->stat = (diff_file_stat_t){
+        .entry = entry,
+        .name = strcmp(entry->old_path, entry->path) != 0 ?
+                rename_display_name(intern->arena, entry->old_path, entry->path) : entry->path,
+        .binary = buffer_is_binary(old_blob) || buffer_is_binary(new_blob),
+        .old_size = old_blob ? old_blob->size : 0,
+        .new_size = new_blob ? new_blob->size : 0,
+    };
+    pair->hunks = diff_hunk_list_init(intern->arena);
+    pair->old_file = (diff_file_t){ NULL, 0 };
+    pair->new_file = (diff_file_t){ NULL, 0 };
+    if (pair->stat.binary)
+        return 0;
+    
+    if (old_blob)
+        diff_file_load(&pair->old_file, intern, old_blob->data, old_blob->size);
+    if (new_blob)
+        diff_file_load(&pair->new_file, intern, new_blob->data, new_blob->size);
+    
+    // A pure mode change or rename has nothing to diff
+    if (old_blob && new_blob && oid_cmp(&entry->old_oid, &entry->new_oid) == 0)
+        return 0;
+    
+    diff_lines(intern->arena, &pair->old_file, &pair->new_file, opts->algorithm, &pair->hunks);
+    for (size_t i = 0; i < pair->hunks.count; i++) {
+        pair->stat.deleted += pair->hunks.hunks[i].old_count;
+        pair->stat.added += pair->hunks.hunks[i].new_count;
+    }
+    return 0;
+}
+
+static void emit_names(const git_diff_list_t *diff, bool with_status, strbuf_t *out)
+{
+    for (size_t i = 0; i < diff->count; i++) {
+        const git_diff_entry_t *entry = &diff->entries[i];
+        bool paired = entry->status == DIFF_RENAMED || entry->status == DIFF_COPIED;
+        
+        if (with_status && paired)
+            strbuf_addf(out, "%c%03d\t%s\t", (char)entry->status, entry->similarity, entry->old_path);
+        else if (with_status)
+            strbuf_addf(out, "%c\t", (char)entry->status);
+        strbuf_addstr(out, entry->path);
+        strbuf_addch(out, '\n');
+    }
+}
+
+static void emit_numstat(const diff_filepair_t *pairs, size_t count, strbuf_t *out)
+{
+    for (size_t i = 0; i < count; i++) {
+        const diff_file_stat_t *stat = &pairs[i].stat;
+        if (stat->binary)
+            strbuf_addf(out, "-\t-\t%s\n", stat->name);
+        else
+            strbuf_addf(out, "%d\t%d\t%s\n", stat->added, stat->deleted, stat->name);
+    }
+}
+
+static void emit_summary(const diff_filepair_t *pairs, size_t count, strbuf_t *out)
+{
+    int insertions = 0, deletions = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        insertions += pairs[i].stat.added;
+        deletions += pairs[i].stat.deleted;
+    }
+    
+    strbuf_addf(out, " %zu file%s changed", count, count == 1 ? "" : "s");
+    if (insertions || !deletions)
+        strbuf_addf(out, ", %d insertion%s(+)", insertions, insertions == 1 ? "" : "s");
+    if (deletions || !insertions)
+        strbuf_addf(out, ", %d deletion%s(-)", deletions, deletions == 1 ? "" : "s");
+    strbuf_addch(out, '\n');
+}
+
+static int scale_linear(int it, int width, int max_change)
+{
+    return it ? 1 + (it * (width - 1) / max_change) : 0;
+}
+
+static void emit_run(strbuf_t *out, const char *color, char c, int count)
+{
+    if (count == 0)
+        return;
+    strbuf_addstr(out, color);
+    strbuf_grow(out, (size_t)count);
+    memset(out->buf + out->len, c, (size_t)count);
+    out->len += (size_t)count;
+    out->buf[out->len] = '\0';
+    strbuf_addstr(out, DIFF_RESET);
+}
+
+static void emit_stat(const diff_filepair_t *pairs, size_t count, const diff_options_t *opts, strbuf_t *out)
+{
+    int name_width = 0, max_change = 0, number_width = 1;
+    
+    for (size_t i = 0; i < count; i++) {
+        const diff_file_stat_t *stat = &pairs[i].stat;
+        int len = (int)strlen(stat->name);
+        if (len > name_width)
+            name_width = len;
+        if (!stat->binary && stat->added + stat->deleted > max_change)
+            max_change = stat->added + stat->deleted;
+    }
+    for (int n = max_change; n >= 10; n /= 10)
+        number_width++;
+    for (size_t i = 0; i < count; i++) {
+        if (pairs[i].stat.binary && number_width < 3)
+            number_width = 3;
+    }
+    
+    // " name | count graph"
+    int graph_width = opts->stat_width - name_width - number_width - 6;
+    if (graph_width < 6)
+        graph_width = 6;
+    
+    for (size_t i = 0; i < count; i++) {
+        const diff_file_stat_t *stat = &pairs[i].stat;
+        strbuf_addf(out, " %-*s | ", name_width, stat->name);
+        
+        if (stat->binary && oid_cmp(&stat->entry->old_oid, &stat->entry->new_oid) == 0) {
+            strbuf_addstr(out, "Bin\n");
+            continue;
+        }
+        if (stat->binary) {
+            strbuf_addf(out, "%-*s %zu -> %zu bytes\n", number_width, "Bin", stat->old_size, stat->new_size);
+            continue;
+        }
+        
+        int add = stat->added, del = stat->deleted;
+        strbuf_addf(out, "%*d", number_width, add + del);
+        if (max_change > graph_width) {
+            int total = scale_linear(add + del, graph_width, max_change);
+            if (total < 2 && add && del)
+                total = 2;
+            if (add < del) {
+                add = scale_linear(add, graph_width, max_change);
+                del = total - add;
+            } else {
+                del = scale_linear(del, graph_width, max_change);
+                add = total - del;
+            }
+        }
+        if (add + del > 0)
+            strbuf_addch(out, ' ');
+        emit_run(out, DIFF_COLOR(ANSI_GREEN), '+', add);
+        emit_run(out, DIFF_COLOR(ANSI_RED), '-', del);
+        strbuf_addch(out, '\n');
+    }
+    emit_summary(pairs, count, out);
+}
+
+static void emit_patch_line(strbuf_t *out, const char *color, char sign, const diff_line_t *line)
+{
+    size_t len = line->len;
+    bool has_newline = len > 0 && line->start[len - 1] == '\n';
+    
+    strbuf_addstr(out, color);
+    strbuf_addch(out, sign);
+    strbuf_add(out, line->start, has_newline ? len - 1 : len);
+    strbuf_addstr(out, *color ? DIFF_RESET : "");
+    strbuf_addch(out, '\n');
+    if (!has_newline)
+        strbuf_addstr(out, "\\ No newline at end of file\n");
+}
+
+/*
+ * The default hunk header context: the closest line before the hunk that
+ * starts with a letter, '_' or '$', as a function definition would.
+ */
+static const diff_line_t* find_funcname(const diff_file_t *file, int before)
+{
+    for (int i = before - 1; i >= 0; i--) {
+        unsigned char c = (unsigned char)file->lines[i].start[0];
+        if (file->lines[i].len > 0 && (isalpha(c) || c == '_' || c == '$'))
+            return &file->lines[i];
+    }
+    return NULL;
+}
+
+static void emit_range_header(strbuf_t *out, char sign, int start, int count)
+{
+    strbuf_addf(out, "%c%d", sign, count ? start + 1 : start);
+    if (count != 1)
+        strbuf_addf(out, ",%d", count);
+}
+
+static void emit_hunks(const diff_filepair_t *pair, const diff_options_t *opts, strbuf_t *out)
+{
+    const diff_hunk_t *hunks = pair->hunks.hunks;
+    const diff_file_t *a = &pair->old_file, *b = &pair->new_file;
+    size_t count = pair->hunks.count;
+    int context = opts->context;
+    
+    for (size_t first = 0; first < count;) {
+        // Hunks whose context would touch are shown as one
+        size_t last = first;
+        while (last + 1 < count &&
+               hunks[last + 1].old_start - (hunks[last].old_start + hunks[last].old_count) <= 2 * context)
+            last++;
+        
+        int old_begin = hunks[first].old_start - context;
+        if (old_begin < 0)
+            old_begin = 0;
+        int old_end = hunks[last].old_start + hunks[last].old_count + context;
+        if (old_end > a->count)
+            old_end = a->count;
+        int new_begin = hunks[first].new_start - (hunks[first].old_start - old_begin);
+        int new_end = hunks[last].new_start + hunks[last].new_count +
+                      (old_end - (hunks[last].old_start + hunks[last].old_count));
+        
+        strbuf_addstr(out, DIFF_COLOR(ANSI_CYAN) "@@ ");
+        emit_range_header(out, '-', old_begin, old_end - old_begin);
+        strbuf_addch(out, ' ');
+        emit_range_header(out, '+', new_begin, new_end - new_begin);
+        strbuf_addstr(out, " @@" DIFF_RESET);
+        
+        const diff_line_t *funcname = find_funcname(a, old_begin);
+        if (funcname) {
+            size_t len = funcname->len < FUNCNAME_MAX ? funcname->len : FUNCNAME_MAX;
+            while (len > 0 && isspace((unsigned char)funcname->start[len - 1]))
+                len--;
+            strbuf_addch(out, ' ');
+            strbuf_add(out, funcname->start, len);
+        }
+        strbuf_addch(out, '\n');
+        
+        int i = old_begin;
+        for (size_t h = first; h <= last; h++) {
+            for (; i < hunks[h].old_start; i++)
+                emit_patch_line(out, "", ' ', &a->lines[i]);
+            for (int k = 0; k < hunks[h].old_count; k++)
+                emit_patch_line(out, DIFF_COLOR(ANSI_RED), '-', &a->lines[hunks[h].old_start + k]);
+            for (int k = 0; k < hunks[h].new_count; k++)
+                emit_patch_line(out, DIFF_COLOR(ANSI_GREEN), '+', &b->lines[hunks[h].new_start + k]);
+            i = hunks[h].old_start + hunks[h].old_count;
+        }
+        for (; i < old_end; i++)
+            emit_patch_line(out, "", ' ', &a->lines[i]);
+        
+        first = last + 1;
+    }
+}
+
+static void emit_patch(const diff_filepair_t *pair, const diff_options_t *opts, strbuf_t *out)
+{
+    const git_diff_entry_t *entry = pair->stat.entry;
+    char old_hex[41], new_hex[41];
+    
+    oid_to_hex(&entry->old_oid, old_hex);
+    oid_to_hex(&entry->new_oid, new_hex);
+    if (entry->status == DIFF_ADDED)
+        memset(old_hex, '0', 40);
+    if (entry->status == DIFF_DELETED)
+        memset(new_hex, '0', 40);
+    
+    bool paired = entry->status == DIFF_RENAMED || entry->status == DIFF_COPIED;
+    bool one_sided = entry->status == DIFF_ADDED || entry->status == DIFF_DELETED;
+    
+    strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "diff --git a/%s b/%s" DIFF_RESET "\n", entry->old_path, entry->path);
+    if (entry->status == DIFF_ADDED) {
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "new file mode %06o" DIFF_RESET "\n", entry->new_mode);
+    } else if (entry->status == DIFF_DELETED) {
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "deleted file mode %06o" DIFF_RESET "\n", entry->old_mode);
+    } else if (entry->old_mode != entry->new_mode) {
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "old mode %06o" DIFF_RESET "\n", entry->old_mode);
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "new mode %06o" DIFF_RESET "\n", entry->new_mode);
+    }
+    
+    if (paired) {
+        const char *verb = entry->status == DIFF_RENAMED ? "rename" : "copy";
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "similarity index %d%%" DIFF_RESET "\n", entry->similarity);
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "%s from %s" DIFF_RESET "\n", verb, entry->old_path);
+        strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "%s to %s" DIFF_RESET "\n", verb, entry->path);
+    }
+    
+    if (!one_sided && oid_cmp(&entry->old_oid, &entry->new_oid) == 0)
+        return;
+    
+    strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "index %.7s..%.7s", old_hex, new_hex);
+    if (!one_sided && entry->old_mode == entry->new_mode)
+        strbuf_addf(out, " %06o", entry->new_mode);
+    strbuf_addstr(out, DIFF_RESET "\n");
+    
+    const char *old_name = entry->status == DIFF_ADDED ? "/dev/null" : "a/";
+    const char *new_name = entry->status == DIFF_DELETED ? "/dev/null" : "b/";
+    const char *old_path = entry->status == DIFF_ADDED ? "" : entry->old_path;
+    const char *new_path = entry->status == DIFF_DELETED ? "" : entry->path;
+    
+    if (pair->stat.binary) {
+        strbuf_addf(out, "Binary files %s%s and %s%s differ\n", old_name, old_path, new_name, new_path);
+        return;
+    }
+    if (pair->hunks.count == 0)
+        return;
+    
+    strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "--- %s%s" DIFF_RESET "\n", old_name, old_path);
+    strbuf_addf(out, DIFF_COLOR(ANSI_BOLD) "+++ %s%s" DIFF_RESET "\n", new_name, new_path);
+    emit_hunks(pair, opts, out);
+}
+
+int diff_output(const git_odb_t *odb, arena_t *arena, const git_diff_list_t *diff, const diff_options_t *opts,
+                strbuf_t *out)
+{
+    unsigned int format = opts->format;
+    size_t start = out->len;
+    
+    if (format & DIFF_FORMAT_NAME_STATUS)
+        emit_names(diff, true, out);
+    else if (format & DIFF_FORMAT_NAME_ONLY)
+        emit_names(diff, false, out);
+    
+    unsigned int needs_lines = DIFF_FORMAT_PATCH | DIFF_FORMAT_STAT | DIFF_FORMAT_NUMSTAT | DIFF_FORMAT_SHORTSTAT;
+    if (!(format & needs_lines) || diff->count == 0)
+        return 0;
+    
+    line_intern_t intern;
+    line_intern_init(&intern, arena);
+    diff_filepair_t *pairs = arena_alloc(arena, diff->count * sizeof(*pairs));
+    for (size_t i = 0; i < diff->count; i++) {
+        if (load_filepair(odb, &intern, opts, &diff->entries[i], &pairs[i]) < 0) {
+            printf("fatal: unable to read blob for '%s'\n", diff->entries[i].path);
+            return -1;
+        }
+    }
+    
+    if (format & DIFF_FORMAT_NUMSTAT)
+        emit_numstat(pairs, diff->count, out);
+    if (format & DIFF_FORMAT_STAT)
+        emit_stat(pairs, diff->count, opts, out);
+    else if (format & DIFF_FORMAT_SHORTSTAT)
+        emit_summary(pairs, diff->count, out);
+    
+    if (format & DIFF_FORMAT_PATCH) {
+        if (out->len > start)
+            strbuf_addch(out, '\n');
+        for (size_t i = 0; i < diff->count; i++)
+            emit_patch(&pairs[i], opts, out);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "diff_pipeline.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "config_utils.h"
+#include "diff_rename.h"
+#include "tree_diff.h"
+
+#define PIPELINE_MAX_WORKERS       64
+#define PIPELINE_WINDOW_PER_WORKER 4
+#define PIPELINE_SLOT_ARENA        (64 * 1024)
+
+typedef struct {
+    const git_oid_t *old_tree;
+    const git_oid_t *new_tree;
+    arena_t arena;
+    strbuf_t out;
+    int status;
+    bool done;
+} pipeline_slot_t;
+
+/*
+ * Slots form a ring of `window` entries. Pairs in [emitted, produced) are
+ * in flight; workers claim them in order through `claimed`.
+ */
+typedef struct {
+    const git_odb_t *odb;
+    const diff_options_t *opts;
+    pipeline_slot_t *slots;
+    size_t window;
+    size_t produced;
+    size_t claimed;
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t slot_done;
+} pipeline_t;
+
+static void run_slot(const git_odb_t *odb, const diff_options_t *opts, pipeline_slot_t *slot)
+{
+    git_diff_list_t diff = diff_list_init(&slot->arena);
+    
+    slot->out = strbuf_init(&slot->arena, 4096);
+    slot->status = 0;
+    if (tree_diff_limited(odb, slot->old_tree, slot->new_tree, &opts->pathspec, &diff) < 0 ||
+        diff_detect_renames(odb, &diff, opts) < 0 ||
+        diff_output(odb, &slot->arena, &diff, opts, &slot->out) < 0)
+        slot->status = -1;
+}
+
+static void* pipeline_worker(void *arg)
+{
+    pipeline_t *p = arg;
+    
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->claimed == p->produced && !p->stopping)
+            pthread_cond_wait(&p->work_ready, &p->lock);
+        if (p->claimed == p->produced)
+            break;
+        
+        pipeline_slot_t *slot = &p->slots[p->claimed++ % p->window];
+        pthread_mutex_unlock(&p->lock);
+        run_slot(p->odb, p->opts, slot);
+        pthread_mutex_lock(&p->lock);
+        
+        slot->done = true;
+        pthread_cond_broadcast(&p->slot_done);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static int resolve_worker_count(git_repository_t *repo, const diff_options_t *opts)
+{
+    unsigned int needs_blobs = DIFF_FORMAT_PATCH | DIFF_FORMAT_STAT | DIFF_FORMAT_NUMSTAT | DIFF_FORMAT_SHORTSTAT;
+    int workers = config_get_int(repo->ctx, "log.workers", 0);
+    
+    // Name-only formats are cheaper to compute than to hand off, unless
+    // rename detection has to read the blobs anyway
+    if (!(opts->format & needs_blobs) && opts->detect == DIFF_DETECT_NONE)
+        return 1;
+    if (workers <= 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > PIPELINE_MAX_WORKERS)
+        workers = PIPELINE_MAX_WORKERS;
+    return workers < 1 ? 1 : workers;
+}
+
+static int run_inline(git_repository_t *repo, const diff_options_t *opts, diff_pipeline_next_fn next,
+                      diff_pipeline_emit_fn emit, void *data)
+{
+    pipeline_slot_t slot;
+    int result = 0;
+    
+    for (size_t i = 0; result == 0 && next(data, i, &slot.old_tree, &slot.new_tree); i++) {
+        slot.arena = arena_init(PIPELINE_SLOT_ARENA);
+        run_slot(&repo->odb, opts, &slot);
+        result = slot.status < 0 ? -1 : emit(data, i, &slot.out);
+        arena_free(&slot.arena);
+    }
+    return result;
+}
+
+int diff_pipeline_run(git_repository_t *repo, const diff_options_t *opts, diff_pipeline_next_fn next,
+                      diff_pipeline_emit_fn emit, void *data)
+{
+    int workers = resolve_worker_count(repo, opts);
+    if (workers == 1)
+        return run_inline(repo, opts, next, emit, data);
+    
+    pipeline_t p = {
+        .odb = &repo->odb,
+        .opts = opts,
+        .window = (size_t)workers * PIPELINE_WINDOW_PER_WORKER,
+    };
+    p.slots = arena_calloc(&repo->ctx->arena, p.window, sizeof(*p.slots));
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.work_ready, NULL);
+    pthread_cond_init(&p.slot_done, NULL);
+    
+    pthread_t threads[PIPELINE_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, pipeline_worker, &p) != 0)
+            break;
+        started++;
+    }
+    if (started == 0) {
+        pthread_mutex_destroy(&p.lock);
+        pthread_cond_destroy(&p.work_ready);
+        pthread_cond_destroy(&p.slot_done);
+        return run_inline(repo, opts, next, emit, data);
+    }
+    
+    int result = 0;
+    bool exhausted = false;
+    size_t emitted = 0;
+    while (result == 0) {
+        // Keep the window full, then hand out the oldest result
+        while (!exhausted && p.produced - emitted < p.window) {
+            pipeline_slot_t *slot = &p.slots[p.produced % p.window];
+            const git_oid_t *old_tree, *new_tree;
+            if (!next(data, p.produced, &old_tree, &new_tree)) {
+                exhausted = true;
+                break;
+            }
+            
+            slot->old_tree = old_tree;
+            slot->new_tree = new_tree;
+            slot->arena = arena_init(PIPELINE_SLOT_ARENA);
+            slot->done = false;
+            pthread_mutex_lock(&p.lock);
+            p.produced++;
+            pthread_cond_signal(&p.work_ready);
+            pthread_mutex_unlock(&p.lock);
+        }
+        if (emitted == p.produced)
+            break;
+        
+        pipeline_slot_t *slot = &p.slots[emitted % p.window];
+        pthread_mutex_lock(&p.lock);
+        while (!slot->done)
+            pthread_cond_wait(&p.slot_done, &p.lock);
+        pthread_mutex_unlock(&p.lock);
+        
+        result = slot->status < 0 ? -1 : emit(data, emitted, &slot->out);
+        arena_free(&slot->arena);
+        emitted++;
+    }
+    
+    // After an early stop, unclaimed pairs are dropped and claimed ones
+    // finish before their arenas go
+    pthread_mutex_lock(&p.lock);
+    size_t produced = p.produced;
+    p.stopping = true;
+    p.produced = p.claimed;
+    pthread_cond_broadcast(&p.work_ready);
+    pthread_mutex_unlock(&p.lock);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    for (; emitted < produced; emitted++)
+        arena_free(&p.slots[emitted % p.window].arena);
+    
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.work_ready);
+    pthread_cond_destroy(&p.slot_done);
+    return result;
+}
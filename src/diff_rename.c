@@ -0,0 +1,691 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "diff_rename.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Scores are fractions of RENAME_MAX_SCORE, as in git
+#define RENAME_MAX_SCORE      60000
+#define RENAME_HASHBASE       107927
+#define RENAME_SPAN_MAX       64
+#define RENAME_CANDIDATES     4
+#define RENAME_UNLIMITED      32767
+#define RENAME_MAX_WORKERS    64
+#define RENAME_PARALLEL_FILES 64
+#define RENAME_PARALLEL_PAIRS 4096
+#define BINARY_SNIFF_SIZE     8000
+#define MODE_TYPE_MASK        0170000
+
+/* Bytes of content whose spans hash to one value. */
+typedef struct {
+    uint32_t hash;
+    uint32_t bytes;
+} rename_span_t;
+
+typedef struct {
+    size_t entry;
+    const char *path;
+    const char *basename;
+    const git_oid_t *oid;
+    unsigned int mode;
+    const git_object_t *blob;
+    rename_span_t *spans;
+    size_t span_count;
+    bool hashed;
+    bool deleted;
+    int uses;
+    long source;
+    int score;
+} rename_file_t;
+
+typedef struct {
+    bool valid;
+    bool same_basename;
+    int score;
+    uint32_t dest;
+    uint32_t source;
+    size_t position;
+} rename_candidate_t;
+
+typedef struct {
+    rename_file_t *sources;
+    size_t source_count;
+    rename_file_t *dests;
+    size_t dest_count;
+    int min_score;
+    int workers;
+    arena_t arenas[RENAME_MAX_WORKERS];
+} rename_state_t;
+
+typedef void (*rename_task_fn)(rename_state_t *state, arena_t *arena, size_t i, void *data);
+
+typedef struct {
+    rename_state_t *state;
+    rename_task_fn fn;
+    void *data;
+    size_t count;
+    atomic_size_t next;
+} rename_tasks_t;
+
+typedef struct {
+    rename_tasks_t *tasks;
+    arena_t *arena;
+} rename_worker_t;
+
+static void* rename_worker(void *arg)
+{
+    rename_worker_t *worker = arg;
+    rename_tasks_t *tasks = worker->tasks;
+    
+    for (;;) {
+        size_t i = atomic_fetch_add(&tasks->next, 1);
+        if (i >= tasks->count)
+            break;
+        tasks->fn(tasks->state, worker->arena, i, tasks->data);
+    }
+    return NULL;
+}
+
+/*
+ * Run fn over [0, count) on the worker pool. Tasks only write their own
+ * results and allocate from their worker's arena, so they share nothing.
+ */
+static void run_tasks(rename_state_t *state, size_t count, bool parallel, rename_task_fn fn, void *data)
+{
+    rename_tasks_t tasks = {
+        .state = state,
+        .fn = fn,
+        .data = data,
+        .count = count,
+    };
+    atomic_init(&tasks.next, 0);
+    
+    int workers = parallel ? state->workers : 1;
+    if (workers > (int)count)
+        workers = (int)count;
+    
+    rename_worker_t slots[RENAME_MAX_WORKERS];
+    pthread_t threads[RENAME_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < workers; i++)
+        slots[i] = (rename_worker_t){ &tasks, &state->arenas[i] };
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, rename_worker, &slots[started + 1]) != 0)
+            break;
+        started++;
+    }
+    
+    rename_worker(&slots[0]);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+}
+
+static bool blob_is_binary(const git_object_t *blob)
+{
+    size_t len = blob->size < BINARY_SNIFF_SIZE ? blob->size : BINARY_SNIFF_SIZE;
+    return memchr(blob->data, '\0', len) != NULL;
+}
+
+/*
+ * Length of the span starting at `buf`: through the first newline, or
+ * RENAME_SPAN_MAX bytes. Flags a carriage return inside it, which text
+ * files drop before a newline.
+ */
+static size_t span_length(const unsigned char *buf, size_t len, bool *has_cr)
+{
+    size_t limit = len < RENAME_SPAN_MAX ? len : RENAME_SPAN_MAX;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; i + 16 <= limit; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(buf + i));
+        unsigned nl_mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        unsigned cr_mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, cr));
+        if (nl_mask) {
+            unsigned end = (unsigned)__builtin_ctz(nl_mask);
+            *has_cr |= (cr_mask & ((2u << end) - 1)) != 0;
+            return i + end + 1;
+        }
+        *has_cr |= cr_mask != 0;
+    }
+#endif
+    
+    for (; i < limit; i++) {
+        *has_cr |= buf[i] == '\r';
+        if (buf[i] == '\n')
+            return i + 1;
+    }
+    return limit;
+}
+
+static inline void span_mix(uint32_t *accum1, uint32_t *accum2, unsigned char c)
+{
+    uint32_t old = *accum1;
+    *accum1 = (*accum1 << 7) ^ (*accum2 >> 25);
+    *accum2 = (*accum2 << 7) ^ (old >> 25);
+    *accum1 += c;
+}
+
+/*
+ * The byte-at-a-time span walk for text spans holding a carriage return.
+ * Returns the input consumed; *bytes stays 0 for a trailing partial span.
+ */
+static size_t hash_crlf_span(const unsigned char *buf, size_t len, uint32_t *hash, uint32_t *bytes)
+{
+    uint32_t accum1 = 0, accum2 = 0, n = 0;
+    size_t i = 0;
+    
+    *bytes = 0;
+    while (i < len) {
+        unsigned char c = buf[i++];
+        if (c == '\r' && i < len && buf[i] == '\n')
+            continue;
+        span_mix(&accum1, &accum2, c);
+        if (++n < RENAME_SPAN_MAX && c != '\n')
+            continue;
+        *hash = (accum1 + accum2 * 0x61) % RENAME_HASHBASE;
+        *bytes = n;
+        break;
+    }
+    return i;
+}
+
+static int span_cmp(const void *a, const void *b)
+{
+    uint32_t x = ((const rename_span_t *)a)->hash, y = ((const rename_span_t *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Fingerprint a blob as byte counts per span hash, sorted by hash. Span
+ * ends are found sixteen bytes at a time; the hash itself is git's, so
+ * similarity scores come out the same.
+ */
+static void hash_file(rename_state_t *state, arena_t *arena, size_t i, void *data)
+{
+    rename_file_t *file = ((rename_file_t **)data)[i];
+    const unsigned char *buf = (const unsigned char *)file->blob->data;
+    size_t len = file->blob->size;
+    bool text = !blob_is_binary(file->blob);
+    size_t count = 0, alloc = len / 32 + 16;
+    rename_span_t *spans = arena_alloc(arena, alloc * sizeof(*spans));
+    
+    (void)state;
+    while (len > 0) {
+        bool has_cr = false;
+        size_t span = span_length(buf, len, &has_cr);
+        uint32_t hash = 0, bytes = 0;
+        
+        if (text && has_cr) {
+            span = hash_crlf_span(buf, len, &hash, &bytes);
+        } else if (span == RENAME_SPAN_MAX || buf[span - 1] == '\n') {
+            // A partial span at the end of the blob is not counted
+            uint32_t accum1 = 0, accum2 = 0;
+            for (size_t k = 0; k < span; k++)
+                span_mix(&accum1, &accum2, buf[k]);
+            hash = (accum1 + accum2 * 0x61) % RENAME_HASHBASE;
+            bytes = (uint32_t)span;
+        }
+        buf += span;
+        len -= span;
+        if (bytes == 0)
+            continue;
+        
+        if (count == alloc) {
+            spans = arena_realloc(arena, spans, alloc * sizeof(*spans), alloc * 2 * sizeof(*spans));
+            alloc *= 2;
+        }
+        spans[count++] = (rename_span_t){ hash, bytes };
+    }
+    
+    qsort(spans, count, sizeof(*spans), span_cmp);
+    size_t merged = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (merged > 0 && spans[merged - 1].hash == spans[k].hash)
+            spans[merged - 1].bytes += spans[k].bytes;
+        else
+            spans[merged++] = spans[k];
+    }
+    file->spans = spans;
+    file->span_count = merged;
+}
+
+static void hash_files(rename_state_t *state, arena_t *arena, rename_file_t **files, size_t count)
+{
+    rename_file_t **pending = arena_alloc(arena, (count + 1) * sizeof(*pending));
+    size_t pending_count = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (!files[i]->hashed) {
+            files[i]->hashed = true;
+            pending[pending_count++] = files[i];
+        }
+    }
+    if (pending_count > 0)
+        run_tasks(state, pending_count, pending_count >= RENAME_PARALLEL_FILES, hash_file, pending);
+}
+
+static int estimate_similarity(const rename_file_t *source, const rename_file_t *dest, int min_score)
+{
+    size_t source_size = source->blob->size, dest_size = dest->blob->size;
+    size_t max_size = source_size > dest_size ? source_size : dest_size;
+    size_t delta = max_size - (source_size < dest_size ? source_size : dest_size);
+    
+    if ((source->mode & MODE_TYPE_MASK) != (dest->mode & MODE_TYPE_MASK) || dest_size == 0)
+        return 0;
+    // Files this different in size cannot share enough to qualify
+    if ((uint64_t)max_size * (RENAME_MAX_SCORE - min_score) < (uint64_t)delta * RENAME_MAX_SCORE)
+        return 0;
+    
+    const rename_span_t *a = source->spans, *b = dest->spans;
+    const rename_span_t *a_end = a + source->span_count, *b_end = b + dest->span_count;
+    uint64_t copied = 0;
+    while (a < a_end && b < b_end) {
+        if (a->hash < b->hash) {
+            a++;
+        } else if (a->hash > b->hash) {
+            b++;
+        } else {
+            copied += a->bytes < b->bytes ? a->bytes : b->bytes;
+            a++;
+            b++;
+        }
+    }
+    return (int)(copied * RENAME_MAX_SCORE / max_size);
+}
+
+/* A deleted file not paired yet, which a rename may still claim. */
+static bool source_is_free(const rename_file_t *source)
+{
+    return source->deleted && source->uses == 0;
+}
+
+static const char* path_basename(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int source_oid_cmp(const void *a, const void *b)
+{
+    const rename_file_t *x = *(rename_file_t *const *)a, *y = *(rename_file_t *const *)b;
+    int cmp = oid_cmp(x->oid, y->oid);
+    return cmp ? cmp : (x > y) - (x < y);
+}
+
+/*
+ * Pair each added file with a source of the same blob, preferring a free
+ * one or one with the same basename, and the first in path order among
+ * equals. Anything but a free source makes a copy.
+ */
+static void find_exact_renames(rename_state_t *state, arena_t *arena, bool copies)
+{
+    rename_file_t **sorted = arena_alloc(arena, state->source_count * sizeof(*sorted));
+    
+    for (size_t i = 0; i < state->source_count; i++)
+        sorted[i] = &state->sources[i];
+    qsort(sorted, state->source_count, sizeof(*sorted), source_oid_cmp);
+    
+    for (size_t d = 0; d < state->dest_count; d++) {
+        rename_file_t *dest = &state->dests[d];
+        size_t lo = 0, hi = state->source_count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (oid_cmp(sorted[mid]->oid, dest->oid) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        
+        rename_file_t *best = NULL;
+        int best_rank = -1;
+        for (size_t k = lo; k < state->source_count && oid_cmp(sorted[k]->oid, dest->oid) == 0; k++) {
+            rename_file_t *source = sorted[k];
+            if ((source->mode & MODE_TYPE_MASK) != (dest->mode & MODE_TYPE_MASK) ||
+                (!copies && !source_is_free(source)))
+                continue;
+            int rank = source_is_free(source) + (strcmp(source->basename, dest->basename) == 0);
+            if (rank > best_rank) {
+                best = source;
+                best_rank = rank;
+            }
+        }
+        if (!best)
+            continue;
+        
+        best->uses++;
+        dest->source = best - state->sources;
+        dest->score = RENAME_MAX_SCORE;
+    }
+}
+
+static int basename_cmp(const void *a, const void *b)
+{
+    const rename_file_t *x = *(rename_file_t *const *)a, *y = *(rename_file_t *const *)b;
+    return strcmp(x->basename, y->basename);
+}
+
+/* Keep the files whose basename no other file in the list has. */
+static size_t unique_basenames(rename_file_t **files, size_t count)
+{
+    size_t kept = 0;
+    
+    qsort(files, count, sizeof(*files), basename_cmp);
+    for (size_t i = 0; i < count; i++) {
+        bool dup_before = i > 0 && strcmp(files[i - 1]->basename, files[i]->basename) == 0;
+        bool dup_after = i + 1 < count && strcmp(files[i + 1]->basename, files[i]->basename) == 0;
+        if (!dup_before && !dup_after)
+            files[kept++] = files[i];
+    }
+    return kept;
+}
+
+typedef struct {
+    rename_file_t **sources;
+    rename_file_t **dests;
+    int *scores;
+} rename_pairs_t;
+
+static void score_pair(rename_state_t *state, arena_t *arena, size_t i, void *data)
+{
+    rename_pairs_t *pairs = data;
+    
+    (void)arena;
+    pairs->scores[i] = estimate_similarity(pairs->sources[i], pairs->dests[i], state->min_score);
+}
+
+/*
+ * A file moved to another directory usually keeps its basename. Where a
+ * basename is unique among both the unpaired sources and the unpaired
+ * destinations, the two are tried against each other alone, against a
+ * threshold halfway between the minimum and an exact match.
+ */
+static void find_basename_renames(rename_state_t *state, arena_t *arena)
+{
+    rename_file_t **sources = arena_alloc(arena, (state->source_count + 1) * sizeof(*sources));
+    rename_file_t **dests = arena_alloc(arena, (state->dest_count + 1) * sizeof(*dests));
+    size_t source_count = 0, dest_count = 0;
+    
+    for (size_t i = 0; i < state->source_count; i++) {
+        if (source_is_free(&state->sources[i]))
+            sources[source_count++] = &state->sources[i];
+    }
+    for (size_t i = 0; i < state->dest_count; i++) {
+        if (state->dests[i].source < 0)
+            dests[dest_count++] = &state->dests[i];
+    }
+    source_count = unique_basenames(sources, source_count);
+    dest_count = unique_basenames(dests, dest_count);
+    
+    rename_pairs_t pairs = {
+        .sources = arena_alloc(arena, (source_count + 1) * sizeof(*pairs.sources)),
+        .dests = arena_alloc(arena, (source_count + 1) * sizeof(*pairs.dests)),
+    };
+    size_t count = 0;
+    for (size_t s = 0, d = 0; s < source_count && d < dest_count;) {
+        int cmp = strcmp(sources[s]->basename, dests[d]->basename);
+        if (cmp == 0) {
+            pairs.sources[count] = sources[s++];
+            pairs.dests[count++] = dests[d++];
+        } else if (cmp < 0) {
+            s++;
+        } else {
+            d++;
+        }
+    }
+    if (count == 0)
+        return;
+    
+    hash_files(state, arena, pairs.sources, count);
+    hash_files(state, arena, pairs.dests, count);
+    pairs.scores = arena_alloc(arena, count * sizeof(*pairs.scores));
+    run_tasks(state, count, count >= RENAME_PARALLEL_FILES, score_pair, &pairs);
+    
+    int threshold = state->min_score + (RENAME_MAX_SCORE - state->min_score) / 2;
+    for (size_t i = 0; i < count; i++) {
+        if (pairs.scores[i] < threshold)
+            continue;
+        pairs.sources[i]->uses++;
+        pairs.dests[i]->source = pairs.sources[i] - state->sources;
+        pairs.dests[i]->score = pairs.scores[i];
+    }
+}
+
+typedef struct {
+    rename_file_t **sources;
+    size_t source_count;
+    rename_file_t **dests;
+    rename_candidate_t *candidates;
+} rename_matrix_t;
+
+/* Whether `a` ranks below `b`; empty slots rank below everything. */
+static bool candidate_worse(const rename_candidate_t *a, const rename_candidate_t *b)
+{
+    if (!a->valid || !b->valid)
+        return !a->valid && b->valid;
+    if (a->score != b->score)
+        return a->score < b->score;
+    return a->same_basename < b->same_basename;
+}
+
+static int candidate_cmp(const void *a, const void *b)
+{
+    const rename_candidate_t *x = a, *y = b;
+    
+    if (candidate_worse(x, y))
+        return 1;
+    if (candidate_worse(y, x))
+        return -1;
+    return x->position < y->position ? -1 : x->position > y->position;
+}
+
+/*
+ * Keep the best RENAME_CANDIDATES sources for one destination, each new
+ * one replacing the first of the worst kept, so that ties between equal
+ * scores resolve the way git's do.
+ */
+static void score_dest(rename_state_t *state, arena_t *arena, size_t i, void *data)
+{
+    rename_matrix_t *matrix = data;
+    rename_file_t *dest = matrix->dests[i];
+    rename_candidate_t *best = &matrix->candidates[i * RENAME_CANDIDATES];
+    
+    (void)arena;
+    for (size_t s = 0; s < matrix->source_count; s++) {
+        rename_file_t *source = matrix->sources[s];
+        rename_candidate_t candidate = {
+            .valid = true,
+            .same_basename = strcmp(source->basename, dest->basename) == 0,
+            .score = estimate_similarity(source, dest, state->min_score),
+            .dest = (uint32_t)(dest - state->dests),
+            .source = (uint32_t)(source - state->sources),
+        };
+        
+        int worst = 0;
+        for (int k = 1; k < RENAME_CANDIDATES; k++) {
+            if (candidate_worse(&best[k], &best[worst]))
+                worst = k;
+        }
+        if (candidate_worse(&best[worst], &candidate))
+            best[worst] = candidate;
+    }
+}
+
+/*
+ * Score every unpaired destination against every candidate source, then
+ * pair greedily from the best score down: first only with unused sources,
+ * then, when looking for copies, with any.
+ */
+static void find_inexact_renames(rename_state_t *state, arena_t *arena, bool copies, int limit)
+{
+    rename_matrix_t matrix = {
+        .sources = arena_alloc(arena, (state->source_count + 1) * sizeof(*matrix.sources)),
+        .dests = arena_alloc(arena, (state->dest_count + 1) * sizeof(*matrix.dests)),
+    };
+    size_t dest_count = 0;
+    
+    for (size_t i = 0; i < state->source_count; i++) {
+        if (copies || source_is_free(&state->sources[i]))
+            matrix.sources[matrix.source_count++] = &state->sources[i];
+    }
+    for (size_t i = 0; i < state->dest_count; i++) {
+        if (state->dests[i].source < 0)
+            matrix.dests[dest_count++] = &state->dests[i];
+    }
+    if (matrix.source_count == 0 || dest_count == 0)
+        return;
+    
+    if (limit <= 0)
+        limit = RENAME_UNLIMITED;
+    uint64_t pair_count = (uint64_t)matrix.source_count * dest_count;
+    if ((matrix.source_count > (size_t)limit && dest_count > (size_t)limit) ||
+        pair_count > (uint64_t)limit * (uint64_t)limit)
+        return;
+    
+    hash_files(state, arena, matrix.sources, matrix.source_count);
+    hash_files(state, arena, matrix.dests, dest_count);
+    
+    matrix.candidates = arena_calloc(arena, dest_count * RENAME_CANDIDATES, sizeof(*matrix.candidates));
+    run_tasks(state, dest_count, pair_count >= RENAME_PARALLEL_PAIRS, score_dest, &matrix);
+    
+    size_t count = 0;
+    for (size_t i = 0; i < dest_count * RENAME_CANDIDATES; i++) {
+        if (!matrix.candidates[i].valid || matrix.candidates[i].score < state->min_score)
+            continue;
+        matrix.candidates[i].position = i;
+        matrix.candidates[count++] = matrix.candidates[i];
+    }
+    qsort(matrix.candidates, count, sizeof(*matrix.candidates), candidate_cmp);
+    
+    for (int pass = 0; pass < (copies ? 2 : 1); pass++) {
+        for (size_t i = 0; i < count; i++) {
+            rename_file_t *dest = &state->dests[matrix.candidates[i].dest];
+            rename_file_t *source = &state->sources[matrix.candidates[i].source];
+            if (dest->source >= 0 || (pass == 0 && !source_is_free(source)))
+                continue;
+            source->uses++;
+            dest->source = source - state->sources;
+            dest->score = matrix.candidates[i].score;
+        }
+    }
+}
+
+static void add_file(rename_file_t *file, size_t entry, const char *path, const git_oid_t *oid, unsigned int mode,
+                     const git_object_t *blob)
+{
+    *file = (rename_file_t){
+        .entry = entry,
+        .path = path,
+        .basename = path_basename(path),
+        .oid = oid,
+        .mode = mode,
+        .blob = blob,
+        .source = -1,
+    };
+}
+
+/*
+ * Rewrite paired destinations as renames or copies. Of the destinations
+ * sharing a deleted source, the last in path order is the rename and the
+ * source entry goes.
+ */
+static void apply_renames(git_diff_list_t *diff, rename_state_t *state)
+{
+    bool *dropped = arena_calloc(diff->arena, diff->count, sizeof(*dropped));
+    
+    for (size_t i = 0; i < state->dest_count; i++) {
+        rename_file_t *dest = &state->dests[i];
+        if (dest->source < 0)
+            continue;
+        
+        rename_file_t *source = &state->sources[dest->source];
+        git_diff_entry_t *entry = &diff->entries[dest->entry];
+        const git_diff_entry_t *origin = &diff->entries[source->entry];
+        
+        entry->status = source->deleted && --source->uses == 0 ? DIFF_RENAMED : DIFF_COPIED;
+        entry->old_path = origin->old_path;
+        entry->old_oid = origin->old_oid;
+        entry->old_mode = origin->old_mode;
+        entry->similarity = (int)((int64_t)dest->score * 100 / RENAME_MAX_SCORE);
+        if (source->deleted)
+            dropped[source->entry] = true;
+    }
+    
+    size_t kept = 0;
+    for (size_t i = 0; i < diff->count; i++) {
+        if (!dropped[i])
+            diff->entries[kept++] = diff->entries[i];
+    }
+    diff->count = kept;
+}
+
+int diff_detect_renames(const git_odb_t *odb, git_diff_list_t *diff, const diff_options_t *opts)
+{
+    bool copies = opts->detect == DIFF_DETECT_COPIES;
+    size_t source_count = 0, dest_count = 0;
+    
+    if (opts->detect == DIFF_DETECT_NONE)
+        return 0;
+    for (size_t i = 0; i < diff->count; i++) {
+        git_diff_status_t status = diff->entries[i].status;
+        if (status == DIFF_ADDED)
+            dest_count++;
+        else if (status == DIFF_DELETED || (copies && status == DIFF_MODIFIED))
+            source_count++;
+    }
+    if (source_count == 0 || dest_count == 0)
+        return 0;
+    
+    rename_state_t *state = arena_calloc(diff->arena, 1, sizeof(*state));
+    state->sources = arena_alloc(diff->arena, source_count * sizeof(*state->sources));
+    state->dests = arena_alloc(diff->arena, dest_count * sizeof(*state->dests));
+    state->min_score = (int)((int64_t)opts->rename_score * RENAME_MAX_SCORE / 100);
+    state->workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (state->workers > RENAME_MAX_WORKERS)
+        state->workers = RENAME_MAX_WORKERS;
+    if (state->workers < 1)
+        state->workers = 1;
+    
+    for (size_t i = 0; i < diff->count; i++) {
+        const git_diff_entry_t *entry = &diff->entries[i];
+        bool is_dest = entry->status == DIFF_ADDED;
+        if (!is_dest && entry->status != DIFF_DELETED && !(copies && entry->status == DIFF_MODIFIED))
+            continue;
+        
+        const git_oid_t *oid = is_dest ? &entry->new_oid : &entry->old_oid;
+        const git_object_t *blob = odb_read(odb, oid);
+        if (!blob)
+            return -1;
+        
+        if (is_dest) {
+            add_file(&state->dests[state->dest_count++], i, entry->path, oid, entry->new_mode, blob);
+        } else {
+            rename_file_t *source = &state->sources[state->source_count++];
+            add_file(source, i, entry->old_path, oid, entry->old_mode, blob);
+            source->deleted = entry->status == DIFF_DELETED;
+        }
+    }
+    
+    for (int i = 0; i < state->workers; i++)
+        state->arenas[i] = arena_init(0);
+    
+    find_exact_renames(state, diff->arena, copies);
+    // Basenames say nothing about which file a copy came from
+    if (!copies)
+        find_basename_renames(state, diff->arena);
+    find_inexact_renames(state, diff->arena, copies, opts->rename_limit);
+    apply_renames(diff, state);
+    
+    for (int i = 0; i < state->workers; i++)
+        arena_free(&state->arenas[i]);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include "git_context.h"
+
+#include "repository.h"
+
+git_context_t git_context_init(void)
+{
+    git_context_t ctx = {
+        .arena = arena_init(0),
+        .config_overrides = NULL,
+        .config_override_count = 0,
+        .repo = NULL,
+    };
+    return ctx;
+}
+
+void git_context_free(git_context_t *ctx)
+{
+    if (ctx->repo)
+        repo_close(ctx->repo);
+    arena_free(&ctx->arena);
+}
@@ -0,0 +1,271 @@
+#include "index.h"
+#include <string.h>
+
+#include "strbuf.h"
+
+#define INDEX_INITIAL_ALLOC 64
+
+cache_tree_t* cache_tree_new(arena_t *arena, const char *name, size_t name_len)
+{
+    cache_tree_t *tree = arena_calloc(arena, 1, sizeof(*tree));
+    tree->name = arena_strndup(arena, name, name_len);
+    tree->name_len = name_len;
+    tree->entry_count = -1;
+    return tree;
+}
+
+git_index_t index_init(arena_t *arena)
+{
+    git_index_t index = {
+        .arena = arena,
+        .entries = NULL,
+        .count = 0,
+        .alloc = 0,
+        .timestamp = 0,
+        .sparse = false,
+        .cache_tree = cache_tree_new(arena, "", 0),
+    };
+    return index;
+}
+
+static cache_tree_t* cache_tree_clone(arena_t *arena, const cache_tree_t *src)
+{
+    cache_tree_t *tree = arena_alloc(arena, sizeof(*tree));
+    *tree = *src;
+    if (src->subtree_count > 0) {
+        tree->subtrees = arena_alloc(arena, (size_t)src->subtree_count * sizeof(*tree->subtrees));
+        for (int i = 0; i < src->subtree_count; i++)
+            tree->subtrees[i] = cache_tree_clone(arena, src->subtrees[i]);
+    }
+    return tree;
+}
+
+git_index_t index_clone(const git_index_t *src)
+{
+    git_index_t index = *src;
+    
+    // Paths are immutable and stay shared with the source index
+    index.alloc = src->count;
+    index.entries = index.alloc ? arena_alloc(src->arena, index.alloc * sizeof(*index.entries)) : NULL;
+    if (index.count)
+        memcpy(index.entries, src->entries, index.count * sizeof(*index.entries));
+    index.cache_tree = cache_tree_clone(src->arena, src->cache_tree);
+    return index;
+}
+
+long index_find(const git_index_t *index, const char *path)
+{
+    size_t low = 0, high = index->count;
+    
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strcmp(index->entries[mid].path, path);
+        if (cmp == 0)
+            return (long)mid;
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return -(long)low - 1;
+}
+
+git_index_entry_t* index_add(git_index_t *index, const char *path, const git_oid_t *oid, unsigned int mode)
+{
+    long pos = index_find(index, path);
+    
+    cache_tree_invalidate_path(index->cache_tree, path);
+    
+    if (pos >= 0) {
+        index->entries[pos].oid = *oid;
+        index->entries[pos].mode = mode;
+        return &index->entries[pos];
+    }
+    
+    if (index->count == index->alloc) {
+        size_t new_alloc = index->alloc ? index->alloc * 2 : INDEX_INITIAL_ALLOC;
+        index->entries = arena_realloc(index->arena, index->entries,
+                                       index->alloc * sizeof(*index->entries),
+                                       new_alloc * sizeof(*index->entries));
+        index->alloc = new_alloc;
+    }
+    
+    size_t insert_at = (size_t)(-pos - 1);
+    memmove(&index->entries[insert_at + 1], &index->entries[insert_at],
+            (index->count - insert_at) * sizeof(*index->entries));
+    index->entries[insert_at] = (git_index_entry_t){
+        .path = arena_strdup(index->arena, path),
+        .oid = *oid,
+        .mode = mode,
+    };
+    index->count++;
+    return &index->entries[insert_at];
+}
+
+bool index_remove(git_index_t *index, const char *path)
+{
+    long pos = index_find(index, path);
+    if (pos < 0)
+        return false;
+    
+    cache_tree_invalidate_path(index->cache_tree, path);
+    memmove(&index->entries[pos], &index->entries[pos + 1],
+            (index->count - (size_t)pos - 1) * sizeof(*index->entries));
+    index->count--;
+    return true;
+}
+
+bool index_entry_is_sparse_dir(const git_index_entry_t *entry)
+{
+    return entry->mode == GIT_MODE_DIR;
+}
+
+bool index_entry_stat_matches(const git_index_entry_t *entry, const git_stat_data_t *st)
+{
+    return entry->stat.mtime == st->mtime && entry->stat.ctime == st->ctime &&
+           entry->stat.size == st->size && entry->stat.ino == st->ino;
+}
+
+bool index_entry_is_racy(const git_index_t *index, const git_index_entry_t *entry)
+{
+    // A file written in the same second the index was could still change
+    // without its mtime moving, so its content has to be checked.
+    return entry->stat.mtime >= index->timestamp;
+}
+
+/*
+ * Subtrees are kept in index order, where a directory's name is followed
+ * by its '/': "a-b" comes before "a", since '-' sorts before '/'.
+ */
+static int compare_subtree_names(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    size_t min_len = a_len < b_len ? a_len : b_len;
+    int cmp = memcmp(a, b, min_len);
+    
+    if (cmp != 0 || a_len == b_len)
+        return cmp;
+    unsigned char next_a = a_len > min_len ? (unsigned char)a[min_len] : '/';
+    unsigned char next_b = b_len > min_len ? (unsigned char)b[min_len] : '/';
+    return next_a - next_b;
+}
+
+static int find_subtree(const cache_tree_t *tree, const char *name, size_t name_len)
+{
+    int low = 0, high = tree->subtree_count;
+    
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const cache_tree_t *sub = tree->subtrees[mid];
+        int cmp = compare_subtree_names(sub->name, sub->name_len, name, name_len);
+        if (cmp == 0)
+            return mid;
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return -1;
+}
+
+cache_tree_t* cache_tree_subtree(const cache_tree_t *tree, const char *name, size_t name_len)
+{
+    int pos = find_subtree(tree, name, name_len);
+    return pos >= 0 ? tree->subtrees[pos] : NULL;
+}
+
+void cache_tree_invalidate_path(cache_tree_t *tree, const char *path)
+{
+    while (tree) {
+        tree->entry_count = -1;
+        
+        const char *slash = strchr(path, '/');
+        if (!slash)
+            return;
+        
+        int sub = find_subtree(tree, path, (size_t)(slash - path));
+        tree = sub >= 0 ? tree->subtrees[sub] : NULL;
+        path = slash + 1;
+    }
+}
+
+static void append_tree_entry(strbuf_t *sb, unsigned int mode, const char *name, size_t name_len,
+                              const git_oid_t *oid)
+{
+    strbuf_addf(sb, "%o ", mode);
+    strbuf_add(sb, name, name_len);
+    strbuf_addch(sb, '\0');
+    strbuf_add(sb, (const char *)oid->id, GIT_OID_RAWSZ);
+}
+
+/*
+ * Rebuild the tree of `tree`, which covers the entries starting at `first`
+ * whose paths share its first `prefix_len` bytes. Valid nodes are skipped
+ * in O(1) thanks to their recorded entry count.
+ */
+static int update_one(git_index_t *index, git_odb_t *odb, cache_tree_t *tree,
+                      size_t first, size_t prefix_len, int *written)
+{
+    if (tree->entry_count >= 0)
+        return tree->entry_count;
+    
+    const char *prefix = first < index->count ? index->entries[first].path : "";
+    strbuf_t buf = strbuf_init(index->arena, 256);
+    cache_tree_t **subtrees = NULL;
+    int subtree_count = 0, subtree_alloc = 0;
+    size_t i = first;
+    
+    while (i < index->count) {
+        const git_index_entry_t *entry = &index->entries[i];
+        if (prefix_len > 0 && strncmp(entry->path, prefix, prefix_len) != 0)
+            break;
+        
+        const char *name = entry->path + prefix_len;
+        const char *slash = strchr(name, '/');
+        if (!slash) {
+            append_tree_entry(&buf, entry->mode, name, strlen(name), &entry->oid);
+            i++;
+            continue;
+        }
+        
+        size_t name_len = (size_t)(slash - name);
+        int found = find_subtree(tree, name, name_len);
+        cache_tree_t *sub = found >= 0 ? tree->subtrees[found]
+                                       : cache_tree_new(index->arena, name, name_len);
+        
+        // A sparse directory entry already names its tree
+        if (index_entry_is_sparse_dir(entry)) {
+            sub->oid = entry->oid;
+            sub->entry_count = 1;
+            sub->subtree_count = 0;
+            i++;
+        } else {
+            i += (size_t)update_one(index, odb, sub, i, prefix_len + name_len + 1, written);
+        }
+        append_tree_entry(&buf, GIT_MODE_DIR, name, name_len, &sub->oid);
+        
+        // Directories that disappeared from the index are dropped here
+        if (subtree_count == subtree_alloc) {
+            int new_alloc = subtree_alloc ? subtree_alloc * 2 : 4;
+            subtrees = arena_realloc(index->arena, subtrees,
+                                     (size_t)subtree_alloc * sizeof(*subtrees),
+                                     (size_t)new_alloc * sizeof(*subtrees));
+            subtree_alloc = new_alloc;
+        }
+        subtrees[subtree_count++] = sub;
+    }
+    
+    tree->subtrees = subtrees;
+    tree->subtree_count = subtree_count;
+    tree->entry_count = (int)(i - first);
+    tree->oid = odb_write(odb, OBJ_TREE, buf.buf, buf.len)->oid;
+    (*written)++;
+    return tree->entry_count;
+}
+
+int cache_tree_update(git_index_t *index, git_odb_t *odb)
+{
+    int written = 0;
+    
+    update_one(index, odb, index->cache_tree, 0, 0, &written);
+    return written;
+}
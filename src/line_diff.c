@@ -0,0 +1,722 @@
+#include "line_diff.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define INTERN_INITIAL_CAPACITY 256
+#define HISTOGRAM_MAX_CHAIN 64
+
+// Weights of the indent heuristic that picks where a sliding change sits
+#define MAX_INDENT 200
+#define MAX_BLANKS 20
+#define INDENT_HEURISTIC_MAX_SLIDING 100
+#define START_OF_FILE_PENALTY 1
+#define END_OF_FILE_PENALTY 21
+#define TOTAL_BLANK_WEIGHT (-30)
+#define POST_BLANK_WEIGHT 6
+#define RELATIVE_INDENT_PENALTY (-4)
+#define RELATIVE_INDENT_WITH_BLANK_PENALTY 10
+#define RELATIVE_OUTDENT_PENALTY 24
+#define RELATIVE_OUTDENT_WITH_BLANK_PENALTY 17
+#define RELATIVE_DEDENT_PENALTY 23
+#define RELATIVE_DEDENT_WITH_BLANK_PENALTY 17
+#define INDENT_WEIGHT 60
+
+// Hashes a word at a time; lines only need a well-mixed bucket index
+static uint64_t hash_line(const char *data, size_t len)
+{
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ len;
+    size_t i = 0;
+    
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, len - i);
+    hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 29);
+}
+
+void line_intern_init(line_intern_t *intern, arena_t *arena)
+{
+    intern->arena = arena;
+    intern->capacity = INTERN_INITIAL_CAPACITY;
+    intern->count = 0;
+    intern->slots = arena_calloc(arena, intern->capacity, sizeof(*intern->slots));
+}
+
+static line_intern_slot_t* intern_slot(line_intern_slot_t *slots, size_t capacity, uint64_t hash,
+                                       const char *start, size_t len)
+{
+    size_t mask = capacity - 1;
+    size_t pos = (size_t)hash & mask;
+    
+    while (slots[pos].start) {
+        if (slots[pos].hash == hash && slots[pos].len == len && memcmp(slots[pos].start, start, len) == 0)
+            break;
+        pos = (pos + 1) & mask;
+    }
+    return &slots[pos];
+}
+
+static int intern_line(line_intern_t *intern, const char *start, size_t len)
+{
+    if ((intern->count + 1) * 2 > intern->capacity) {
+        size_t new_capacity = intern->capacity * 2;
+        line_intern_slot_t *slots = arena_calloc(intern->arena, new_capacity, sizeof(*slots));
+        for (size_t i = 0; i < intern->capacity; i++) {
+            const line_intern_slot_t *old = &intern->slots[i];
+            if (old->start)
+                *intern_slot(slots, new_capacity, old->hash, old->start, old->len) = *old;
+        }
+        intern->slots = slots;
+        intern->capacity = new_capacity;
+    }
+    
+    uint64_t hash = hash_line(start, len);
+    line_intern_slot_t *slot = intern_slot(intern->slots, intern->capacity, hash, start, len);
+    if (!slot->start) {
+        *slot = (line_intern_slot_t){ start, len, hash, (int)intern->count };
+        intern->count++;
+    }
+    return slot->id;
+}
+
+static void push_line(diff_file_t *file, line_intern_t *intern, int *alloc, const char *start, const char *end)
+{
+    if (file->count == *alloc) {
+        file->lines = arena_realloc(intern->arena, file->lines, (size_t)*alloc * sizeof(*file->lines),
+                                    (size_t)*alloc * 2 * sizeof(*file->lines));
+        *alloc *= 2;
+    }
+    file->lines[file->count++] = (diff_line_t){
+        .start = start,
+        .len = (size_t)(end - start),
+        .id = intern_line(intern, start, (size_t)(end - start)),
+    };
+}
+
+void diff_file_load(diff_file_t *file, line_intern_t *intern, const char *data, size_t size)
+{
+    const char *end = data + size;
+    const char *line = data, *scan = data;
+    int alloc = 64;
+    
+    file->lines = arena_alloc(intern->arena, (size_t)alloc * sizeof(*file->lines));
+    file->count = 0;
+    
+#ifdef __SSE2__
+    // Compare 16 bytes at once and walk the bits of the newline mask
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - scan >= 16; scan += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)scan);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        while (mask) {
+            const char *next = scan + __builtin_ctz(mask) + 1;
+            push_line(file, intern, &alloc, line, next);
+            line = next;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    
+    for (const char *newline_at; (newline_at = memchr(scan, '\n', (size_t)(end - scan)));) {
+        push_line(file, intern, &alloc, line, newline_at + 1);
+        line = scan = newline_at + 1;
+    }
+    if (line < end)
+        push_line(file, intern, &alloc, line, end);
+}
+
+diff_hunk_list_t diff_hunk_list_init(arena_t *arena)
+{
+    diff_hunk_list_t list = {
+        .arena = arena,
+        .hunks = NULL,
+        .count = 0,
+        .alloc = 0,
+    };
+    return list;
+}
+
+static void push_hunk(diff_hunk_list_t *list, int old_start, int old_count, int new_start, int new_count)
+{
+    if (list->count == list->alloc) {
+        size_t new_alloc = list->alloc ? list->alloc * 2 : 16;
+        list->hunks = arena_realloc(list->arena, list->hunks, list->alloc * sizeof(*list->hunks),
+                                    new_alloc * sizeof(*list->hunks));
+        list->alloc = new_alloc;
+    }
+    list->hunks[list->count++] = (diff_hunk_t){ old_start, old_count, new_start, new_count };
+}
+
+typedef struct {
+    arena_t *arena;
+    const int *a;
+    const int *b;
+    char *changed_a;
+    char *changed_b;
+    int *forward;
+    int *backward;
+    // Scratch indexed by line id, for patience and histogram
+    int *count_a;
+    int *count_b;
+    int *head;
+    int *next;
+} diff_env_t;
+
+static void myers_compare(diff_env_t *env, int a0, int a1, int b0, int b1);
+
+static void mark_changed(diff_env_t *env, int a0, int a1, int b0, int b1)
+{
+    memset(env->changed_a + a0, 1, (size_t)(a1 - a0));
+    memset(env->changed_b + b0, 1, (size_t)(b1 - b0));
+}
+
+/*
+ * Linear-space Myers: walk the edit graph from both corners at once and
+ * split the problem where the two searches meet, recursing on each half.
+ */
+static void myers_bisect(diff_env_t *env, int a0, int a1, int b0, int b1)
+{
+    const int *a = env->a + a0, *b = env->b + b0;
+    int n = a1 - a0, mm = b1 - b0;
+    int max_d = (n + mm + 1) / 2;
+    int offset = max_d, length = 2 * max_d + 2;
+    int delta = n - mm;
+    bool front = (delta % 2) != 0;
+    int k1start = 0, k1end = 0, k2start = 0, k2end = 0;
+    int *v1 = env->forward, *v2 = env->backward;
+    
+    for (int i = 0; i < length; i++)
+        v1[i] = v2[i] = -1;
+    v1[offset + 1] = 0;
+    v2[offset + 1] = 0;
+    
+    for (int d = 0; d < max_d; d++) {
+        for (int k1 = -d + k1start; k1 <= d - k1end; k1 += 2) {
+            int k1_offset = offset + k1;
+            int x1 = (k1 == -d || (k1 != d && v1[k1_offset - 1] < v1[k1_offset + 1]))
+                   ? v1[k1_offset + 1] : v1[k1_offset - 1] + 1;
+            int y1 = x1 - k1;
+            while (x1 < n && y1 < mm && a[x1] == b[y1]) {
+                x1++;
+                y1++;
+            }
+            v1[k1_offset] = x1;
+            
+            if (x1 > n) {
+                k1end += 2;
+            } else if (y1 > mm) {
+                k1start += 2;
+            } else if (front) {
+                int k2_offset = offset + delta - k1;
+                if (k2_offset >= 0 && k2_offset < length && v2[k2_offset] != -1 && x1 >= n - v2[k2_offset]) {
+                    myers_compare(env, a0, a0 + x1, b0, b0 + y1);
+                    myers_compare(env, a0 + x1, a1, b0 + y1, b1);
+                    return;
+                }
+            }
+        }
+        
+        for (int k2 = -d + k2start; k2 <= d - k2end; k2 += 2) {
+            int k2_offset = offset + k2;
+            int x2 = (k2 == -d || (k2 != d && v2[k2_offset - 1] < v2[k2_offset + 1]))
+                   ? v2[k2_offset + 1] : v2[k2_offset - 1] + 1;
+            int y2 = x2 - k2;
+            while (x2 < n && y2 < mm && a[n - x2 - 1] == b[mm - y2 - 1]) {
+                x2++;
+                y2++;
+            }
+            v2[k2_offset] = x2;
+            
+            if (x2 > n) {
+                k2end += 2;
+            } else if (y2 > mm) {
+                k2start += 2;
+            } else if (!front) {
+                int k1_offset = offset + delta - k2;
+                if (k1_offset >= 0 && k1_offset < length && v1[k1_offset] != -1) {
+                    int x1 = v1[k1_offset];
+                    int y1 = offset + x1 - k1_offset;
+                    if (x1 >= n - x2) {
+                        myers_compare(env, a0, a0 + x1, b0, b0 + y1);
+                        myers_compare(env, a0 + x1, a1, b0 + y1, b1);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+    
+    // No common line at all
+    mark_changed(env, a0, a1, b0, b1);
+}
+
+static void myers_compare(diff_env_t *env, int a0, int a1, int b0, int b1)
+{
+    while (a0 < a1 && b0 < b1 && env->a[a0] == env->b[b0]) {
+        a0++;
+        b0++;
+    }
+    while (a0 < a1 && b0 < b1 && env->a[a1 - 1] == env->b[b1 - 1]) {
+        a1--;
+        b1--;
+    }
+    
+    if (a0 == a1 || b0 == b1) {
+        mark_changed(env, a0, a1, b0, b1);
+        return;
+    }
+    myers_bisect(env, a0, a1, b0, b1);
+}
+
+static bool trim_common(const diff_env_t *env, int *a0, int *a1, int *b0, int *b1)
+{
+    while (*a0 < *a1 && *b0 < *b1 && env->a[*a0] == env->b[*b0]) {
+        (*a0)++;
+        (*b0)++;
+    }
+    while (*a0 < *a1 && *b0 < *b1 && env->a[*a1 - 1] == env->b[*b1 - 1]) {
+        (*a1)--;
+        (*b1)--;
+    }
+    return *a0 < *a1 && *b0 < *b1;
+}
+
+/*
+ * Patience diff: anchor on lines that occur exactly once on both sides,
+ * keep the longest run of anchors in the same order on both, and diff the
+ * gaps between them. Ranges without such lines fall back to Myers.
+ */
+static void patience_compare(diff_env_t *env, int a0, int a1, int b0, int b1)
+{
+    if (!trim_common(env, &a0, &a1, &b0, &b1)) {
+        mark_changed(env, a0, a1, b0, b1);
+        return;
+    }
+    
+    const int *a = env->a, *b = env->b;
+    for (int i = a0; i < a1; i++)
+        env->count_a[a[i]] = env->count_b[a[i]] = 0;
+    for (int j = b0; j < b1; j++)
+        env->count_a[b[j]] = env->count_b[b[j]] = 0;
+    for (int i = a0; i < a1; i++) {
+        env->count_a[a[i]]++;
+        env->head[a[i]] = i;
+    }
+    for (int j = b0; j < b1; j++)
+        env->count_b[b[j]]++;
+    
+    int limit = (a1 - a0) < (b1 - b0) ? a1 - a0 : b1 - b0;
+    int *match_a = arena_alloc(env->arena, (size_t)limit * sizeof(int));
+    int *match_b = arena_alloc(env->arena, (size_t)limit * sizeof(int));
+    int matches = 0;
+    for (int j = b0; j < b1; j++) {
+        int id = b[j];
+        if (env->count_a[id] == 1 && env->count_b[id] == 1) {
+            match_a[matches] = env->head[id];
+            match_b[matches++] = j;
+        }
+    }
+    if (matches == 0) {
+        myers_compare(env, a0, a1, b0, b1);
+        return;
+    }
+    
+    // Patience sorting: tails[k] ends the best increasing run of length k + 1
+    int *tails = arena_alloc(env->arena, (size_t)matches * sizeof(int));
+    int *prev = arena_alloc(env->arena, (size_t)matches * sizeof(int));
+    int length = 0;
+    for (int k = 0; k < matches; k++) {
+        int lo = 0, hi = length;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (match_a[tails[mid]] < match_a[k])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        prev[k] = lo > 0 ? tails[lo - 1] : -1;
+        tails[lo] = k;
+        if (lo == length)
+            length++;
+    }
+    
+    int *run = tails;
+    for (int k = tails[length - 1], pos = length - 1; k >= 0; k = prev[k])
+        run[pos--] = k;
+    
+    for (int r = 0; r < length; r++) {
+        int k = run[r];
+        patience_compare(env, a0, match_a[k], b0, match_b[k]);
+        a0 = match_a[k] + 1;
+        b0 = match_b[k] + 1;
+    }
+    patience_compare(env, a0, a1, b0, b1);
+}
+
+/*
+ * Histogram diff: split the range around the longest common run that
+ * contains its rarest line, diff the left side and loop on the right. When
+ * every common line is too frequent to be a good anchor, Myers takes over.
+ */
+static void histogram_compare(diff_env_t *env, int a0, int a1, int b0, int b1)
+{
+    const int *a = env->a, *b = env->b;
+    
+    while (trim_common(env, &a0, &a1, &b0, &b1)) {
+        for (int i = a0; i < a1; i++)
+            env->count_a[a[i]] = 0;
+        for (int j = b0; j < b1; j++)
+            env->count_a[b[j]] = 0;
+        for (int i = a1 - 1; i >= a0; i--) {
+            int id = a[i];
+            env->next[i] = env->count_a[id] ? env->head[id] : -1;
+            env->head[id] = i;
+            env->count_a[id]++;
+        }
+        
+        int best_a = 0, best_b = 0, best_len = 0, best_count = HISTOGRAM_MAX_CHAIN + 1;
+        bool has_common = false;
+        for (int j = b0; j < b1;) {
+            int id = b[j], next_j = j + 1;
+            if (env->count_a[id] == 0 || env->count_a[id] > best_count) {
+                has_common |= env->count_a[id] > 0;
+                j++;
+                continue;
+            }
+            has_common = true;
+            
+            for (int i = env->head[id]; i >= 0; i = env->next[i]) {
+                int as = i, bs = j, ae = i + 1, be = j + 1, rarest = env->count_a[id];
+                while (as > a0 && bs > b0 && a[as - 1] == b[bs - 1]) {
+                    as--;
+                    bs--;
+                    if (env->count_a[a[as]] < rarest)
+                        rarest = env->count_a[a[as]];
+                }
+                while (ae < a1 && be < b1 && a[ae] == b[be]) {
+                    if (env->count_a[a[ae]] < rarest)
+                        rarest = env->count_a[a[ae]];
+                    ae++;
+                    be++;
+                }
+                
+                if (be > next_j)
+                    next_j = be;
+                if (ae - as > best_len || rarest < best_count) {
+                    best_a = as;
+                    best_b = bs;
+                    best_len = ae - as;
+                    best_count = rarest;
+                }
+                while (env->next[i] >= 0 && env->next[i] < ae)
+                    i = env->next[i];
+            }
+            j = next_j;
+        }
+        
+        if (best_len == 0) {
+            if (has_common)
+                myers_compare(env, a0, a1, b0, b1);
+            else
+                mark_changed(env, a0, a1, b0, b1);
+            return;
+        }
+        
+        histogram_compare(env, a0, best_a, b0, best_b);
+        a0 = best_a + best_len;
+        b0 = best_b + best_len;
+    }
+    mark_changed(env, a0, a1, b0, b1);
+}
+
+static int* line_ids(arena_t *arena, const diff_file_t *file)
+{
+    int *ids = arena_alloc(arena, ((size_t)file->count + 1) * sizeof(*ids));
+    
+    for (int i = 0; i < file->count; i++)
+        ids[i] = file->lines[i].id;
+    return ids;
+}
+
+/*
+ * A run of changed lines [start, end) in one file. The changed arrays
+ * carry a zero sentinel on both ends, so walking off a run always stops.
+ */
+typedef struct {
+    int start;
+    int end;
+} change_group_t;
+
+typedef struct {
+    const diff_file_t *file;
+    char *changed;
+} compact_side_t;
+
+static void group_init(const compact_side_t *side, change_group_t *g)
+{
+    g->start = g->end = 0;
+    while (side->changed[g->end])
+        g->end++;
+}
+
+static bool group_next(const compact_side_t *side, change_group_t *g)
+{
+    if (g->end == side->file->count)
+        return false;
+    g->start = g->end + 1;
+    for (g->end = g->start; side->changed[g->end]; g->end++)
+        ;
+    return true;
+}
+
+static bool group_previous(const compact_side_t *side, change_group_t *g)
+{
+    if (g->start == 0)
+        return false;
+    g->end = g->start - 1;
+    for (g->start = g->end; side->changed[g->start - 1]; g->start--)
+        ;
+    return true;
+}
+
+static bool group_slide_down(const compact_side_t *side, change_group_t *g)
+{
+    const diff_line_t *lines = side->file->lines;
+    
+    if (g->end == side->file->count || lines[g->start].id != lines[g->end].id)
+        return false;
+    side->changed[g->start++] = 0;
+    side->changed[g->end++] = 1;
+    while (side->changed[g->end])
+        g->end++;
+    return true;
+}
+
+static bool group_slide_up(const compact_side_t *side, change_group_t *g)
+{
+    const diff_line_t *lines = side->file->lines;
+    
+    if (g->start == 0 || lines[g->start - 1].id != lines[g->end - 1].id)
+        return false;
+    side->changed[--g->start] = 1;
+    side->changed[--g->end] = 0;
+    while (side->changed[g->start - 1])
+        g->start--;
+    return true;
+}
+
+// Columns of leading whitespace, or -1 for a blank line
+static int line_indent(const diff_line_t *line)
+{
+    int indent = 0;
+    
+    for (size_t i = 0; i < line->len; i++) {
+        char c = line->start[i];
+        if (c == ' ')
+            indent++;
+        else if (c == '\t')
+            indent += 8 - indent % 8;
+        else if (c != '\n' && c != '\r' && c != '\v' && c != '\f')
+            return indent;
+        if (indent >= MAX_INDENT)
+            return MAX_INDENT;
+    }
+    return -1;
+}
+
+typedef struct {
+    int effective_indent;
+    int penalty;
+} split_score_t;
+
+/*
+ * Score splitting the file just before line `split`: blank lines and
+ * dedents make good boundaries, splitting inside a block does not.
+ */
+static void score_split(const diff_file_t *file, int split, split_score_t *score)
+{
+    bool end_of_file = split >= file->count;
+    int indent = end_of_file ? -1 : line_indent(&file->lines[split]);
+    int pre_blank = 0, pre_indent = -1, post_blank = 0, post_indent = -1;
+    
+    for (int i = split - 1; i >= 0; i--) {
+        if ((pre_indent = line_indent(&file->lines[i])) != -1)
+            break;
+        if (++pre_blank == MAX_BLANKS) {
+            pre_indent = 0;
+            break;
+        }
+    }
+    for (int i = split + 1; i < file->count; i++) {
+        if ((post_indent = line_indent(&file->lines[i])) != -1)
+            break;
+        if (++post_blank == MAX_BLANKS) {
+            post_indent = 0;
+            break;
+        }
+    }
+    
+    if (pre_indent == -1 && pre_blank == 0)
+        score->penalty += START_OF_FILE_PENALTY;
+    if (end_of_file)
+        score->penalty += END_OF_FILE_PENALTY;
+    
+    int blank_after = indent == -1 ? 1 + post_blank : 0;
+    int total_blank = pre_blank + blank_after;
+    bool any_blanks = total_blank != 0;
+    score->penalty += TOTAL_BLANK_WEIGHT * total_blank + POST_BLANK_WEIGHT * blank_after;
+    
+    if (indent == -1)
+        indent = post_indent;
+    score->effective_indent += indent;
+    
+    if (indent == -1 || pre_indent == -1 || indent == pre_indent)
+        return;
+    if (indent > pre_indent)
+        score->penalty += any_blanks ? RELATIVE_INDENT_WITH_BLANK_PENALTY : RELATIVE_INDENT_PENALTY;
+    else if (post_indent != -1 && post_indent > indent)
+        score->penalty += any_blanks ? RELATIVE_OUTDENT_WITH_BLANK_PENALTY : RELATIVE_OUTDENT_PENALTY;
+    else
+        score->penalty += any_blanks ? RELATIVE_DEDENT_WITH_BLANK_PENALTY : RELATIVE_DEDENT_PENALTY;
+}
+
+static int score_cmp(const split_score_t *a, const split_score_t *b)
+{
+    int indents = (a->effective_indent > b->effective_indent) - (a->effective_indent < b->effective_indent);
+    return INDENT_WEIGHT * indents + (a->penalty - b->penalty);
+}
+
+/*
+ * A run of changed lines bordered by a copy of its own first or last line
+ * can slide. Slide each run as far down as it goes, merging with runs it
+ * meets, then back up to line up with a change in the other file, or to
+ * the position the indent heuristic scores best. This is the placement
+ * git's xdiff produces, independent of the algorithm.
+ */
+static void compact_changes(const compact_side_t *side, const compact_side_t *other)
+{
+    change_group_t g, go;
+    
+    group_init(side, &g);
+    group_init(other, &go);
+    
+    for (;;) {
+        if (g.end != g.start) {
+            int size, earliest_end, end_matching_other;
+            do {
+                size = g.end - g.start;
+                end_matching_other = -1;
+                
+                while (group_slide_up(side, &g))
+                    group_previous(other, &go);
+                earliest_end = g.end;
+                if (go.end > go.start)
+                    end_matching_other = g.end;
+                
+                while (group_slide_down(side, &g)) {
+                    group_next(other, &go);
+                    if (go.end > go.start)
+                        end_matching_other = g.end;
+                }
+            } while (size != g.end - g.start);
+            
+            if (g.end == earliest_end) {
+                // Could not slide at all
+            } else if (end_matching_other != -1) {
+                while (go.end == go.start) {
+                    group_slide_up(side, &g);
+                    group_previous(other, &go);
+                }
+            } else {
+                int shift = earliest_end, best_shift = -1;
+                split_score_t best = { 0, 0 };
+                if (g.end - size - 1 > shift)
+                    shift = g.end - size - 1;
+                if (g.end - INDENT_HEURISTIC_MAX_SLIDING > shift)
+                    shift = g.end - INDENT_HEURISTIC_MAX_SLIDING;
+                
+                for (; shift <= g.end; shift++) {
+                    split_score_t score = { 0, 0 };
+                    score_split(side->file, shift, &score);
+                    score_split(side->file, shift - size, &score);
+                    if (best_shift == -1 || score_cmp(&score, &best) <= 0) {
+                        best = score;
+                        best_shift = shift;
+                    }
+                }
+                while (g.end > best_shift) {
+                    group_slide_up(side, &g);
+                    group_previous(other, &go);
+                }
+            }
+        }
+        
+        if (!group_next(side, &g))
+            break;
+        group_next(other, &go);
+    }
+}
+
+void diff_lines(arena_t *arena, const diff_file_t *old_file, const diff_file_t *new_file,
+                diff_algorithm_t algorithm, diff_hunk_list_t *out)
+{
+    int n = old_file->count, mm = new_file->count;
+    size_t v_size = (size_t)(n + mm + 4);
+    diff_env_t env = {
+        .arena = arena,
+        .a = line_ids(arena, old_file),
+        .b = line_ids(arena, new_file),
+        .changed_a = (char *)arena_calloc(arena, (size_t)n + 2, 1) + 1,
+        .changed_b = (char *)arena_calloc(arena, (size_t)mm + 2, 1) + 1,
+        .forward = arena_alloc(arena, v_size * sizeof(int)),
+        .backward = arena_alloc(arena, v_size * sizeof(int)),
+    };
+    
+    if (algorithm == DIFF_ALGORITHM_MYERS) {
+        myers_compare(&env, 0, n, 0, mm);
+    } else {
+        int id_count = 0;
+        for (int i = 0; i < n; i++)
+            id_count = env.a[i] >= id_count ? env.a[i] + 1 : id_count;
+        for (int j = 0; j < mm; j++)
+            id_count = env.b[j] >= id_count ? env.b[j] + 1 : id_count;
+        
+        env.count_a = arena_alloc(arena, ((size_t)id_count + 1) * sizeof(int));
+        env.count_b = arena_alloc(arena, ((size_t)id_count + 1) * sizeof(int));
+        env.head = arena_alloc(arena, ((size_t)id_count + 1) * sizeof(int));
+        env.next = arena_alloc(arena, ((size_t)n + 1) * sizeof(int));
+        
+        if (algorithm == DIFF_ALGORITHM_PATIENCE)
+            patience_compare(&env, 0, n, 0, mm);
+        else
+            histogram_compare(&env, 0, n, 0, mm);
+    }
+    
+    compact_side_t old_side = { old_file, env.changed_a }, new_side = { new_file, env.changed_b };
+    compact_changes(&old_side, &new_side);
+    compact_changes(&new_side, &old_side);
+    
+    // Unchanged lines pair up one to one, so hunks fall out of one scan
+    int i = 0, j = 0;
+    while (i < n || j < mm) {
+        if ((i < n && env.changed_a[i]) || (j < mm && env.changed_b[j])) {
+            int old_start = i, new_start = j;
+            while (i < n && env.changed_a[i])
+                i++;
+            while (j < mm && env.changed_b[j])
+                j++;
+            push_hunk(out, old_start, i - old_start, new_start, j - new_start);
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
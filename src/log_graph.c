@@ -0,0 +1,346 @@
+#include "log_graph.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define GRAPH_LANE_HINT 16
+
+// Edges leaving a merge in its post-merge row, indexed from `merge_layout`
+static const char merge_chars[] = { '/', '|', '\\' };
+
+static void ensure_lanes(log_graph_t *graph, int needed)
+{
+    int old_alloc = graph->lane_alloc;
+    
+    if (needed <= old_alloc)
+        return;
+    while (graph->lane_alloc < needed)
+        graph->lane_alloc *= 2;
+    
+    size_t old_size = (size_t)old_alloc * sizeof(int);
+    size_t new_size = (size_t)graph->lane_alloc * sizeof(int);
+    graph->lanes = arena_realloc(graph->arena, graph->lanes, old_size, new_size);
+    graph->next_lanes = arena_realloc(graph->arena, graph->next_lanes, old_size, new_size);
+    graph->parents = arena_realloc(graph->arena, graph->parents, old_size, new_size);
+    graph->mapping = arena_realloc(graph->arena, graph->mapping, 2 * old_size, 2 * new_size);
+    graph->old_mapping = arena_realloc(graph->arena, graph->old_mapping, 2 * old_size, 2 * new_size);
+    for (int i = 2 * old_alloc; i < 2 * graph->lane_alloc; i++)
+        graph->mapping[i] = graph->old_mapping[i] = -1;
+}
+
+log_graph_t log_graph_init(arena_t *arena, int commit_count)
+{
+    size_t lanes_size = GRAPH_LANE_HINT * sizeof(int);
+    log_graph_t graph = {
+        .arena = arena,
+        .lane_of = arena_alloc(arena, ((size_t)commit_count + 1) * sizeof(int)),
+        .lanes = arena_alloc(arena, lanes_size),
+        .next_lanes = arena_alloc(arena, lanes_size),
+        .lane_alloc = GRAPH_LANE_HINT,
+        .mapping = arena_alloc(arena, 2 * lanes_size),
+        .old_mapping = arena_alloc(arena, 2 * lanes_size),
+        .parents = arena_alloc(arena, lanes_size),
+        .commit = -1,
+        .state = LOG_GRAPH_PADDING,
+        .prev_state = LOG_GRAPH_PADDING,
+    };
+    
+    for (int i = 0; i < commit_count; i++)
+        graph.lane_of[i] = -1;
+    for (int i = 0; i < 2 * GRAPH_LANE_HINT; i++)
+        graph.mapping[i] = graph.old_mapping[i] = -1;
+    return graph;
+}
+
+static void update_state(log_graph_t *graph, log_graph_state_t state)
+{
+    graph->prev_state = graph->state;
+    graph->state = state;
+}
+
+static bool mapping_is_correct(const log_graph_t *graph)
+{
+    for (int i = 0; i < graph->mapping_size; i++) {
+        int target = graph->mapping[i];
+        if (target >= 0 && target != i / 2)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Place the commit at `pos` in the next lanes, reusing its lane if it has
+ * one, and record which screen column leads there. `idx` is the lane of
+ * the merge being shown when `pos` is one of its parents, or -1.
+ */
+static void insert_lane(log_graph_t *graph, int pos, int idx)
+{
+    int lane = graph->lane_of[pos];
+    int mapping_idx;
+    
+    if (lane < 0) {
+        lane = graph->next_count++;
+        graph->next_lanes[lane] = pos;
+        graph->lane_of[pos] = lane;
+    }
+    
+    if (graph->parent_count > 1 && idx > -1 && graph->merge_layout == -1) {
+        // The first parent of a merge decides whether the merge leans
+        // left, toward a parent already shown to its left, or right
+        int dist = idx - lane;
+        int shift = dist > 1 ? 2 * dist - 3 : 1;
+        
+        graph->merge_layout = dist > 0 ? 0 : 1;
+        graph->edges_added = graph->parent_count + graph->merge_layout - 2;
+        mapping_idx = graph->width + (graph->merge_layout - 1) * shift;
+        graph->width += 2 * graph->merge_layout;
+    } else if (graph->edges_added > 0 && lane == graph->mapping[graph->width - 2]) {
+        // The merge edge lands in the lane just before: join them at once
+        mapping_idx = graph->width - 2;
+        graph->edges_added = -1;
+    } else {
+        mapping_idx = graph->width;
+        graph->width += 2;
+    }
+    graph->mapping[mapping_idx] = lane;
+}
+
+/*
+ * Move on to the lanes after the current commit: every lane keeps its
+ * commit, except that the commit's own lane gives way to its parents. A
+ * commit that no lane waited for starts one at the right.
+ */
+static void update_lanes(log_graph_t *graph)
+{
+    int *lanes = graph->lanes;
+    graph->lanes = graph->next_lanes;
+    graph->next_lanes = lanes;
+    int *mapping = graph->mapping;
+    graph->mapping = graph->old_mapping;
+    graph->old_mapping = mapping;
+    graph->lane_count = graph->next_count;
+    graph->next_count = 0;
+    for (int i = 0; i < graph->lane_count; i++)
+        graph->lane_of[graph->lanes[i]] = -1;
+    
+    graph->mapping_size = 2 * (graph->lane_count + graph->parent_count);
+    for (int i = 0; i < graph->mapping_size + 2; i++)
+        graph->mapping[i] = -1;
+    graph->width = 0;
+    graph->prev_edges_added = graph->edges_added;
+    graph->edges_added = 0;
+    
+    bool seen_this = false;
+    for (int i = 0; i <= graph->lane_count; i++) {
+        int lane_commit = i < graph->lane_count ? graph->lanes[i] : graph->commit;
+        if (i == graph->lane_count && seen_this)
+            break;
+        if (lane_commit != graph->commit) {
+            insert_lane(graph, lane_commit, -1);
+            continue;
+        }
+        
+        seen_this = true;
+        graph->commit_index = i;
+        graph->merge_layout = -1;
+        for (int k = 0; k < graph->parent_count; k++)
+            insert_lane(graph, graph->parents[k], i);
+        // The commit takes up a column even without parents
+        if (graph->parent_count == 0)
+            graph->width += 2;
+    }
+    
+    while (graph->mapping_size > 1 && graph->mapping[graph->mapping_size - 1] < 0)
+        graph->mapping_size--;
+}
+
+static void output_padding_row(const log_graph_t *graph, strbuf_t *out)
+{
+    for (int i = 0; i < graph->next_count; i++)
+        strbuf_add(out, "| ", 2);
+}
+
+static void output_commit_row(log_graph_t *graph, strbuf_t *out)
+{
+    bool seen_this = false;
+    
+    for (int i = 0; i <= graph->lane_count; i++) {
+        int lane_commit = i < graph->lane_count ? graph->lanes[i] : graph->commit;
+        if (i == graph->lane_count && seen_this)
+            break;
+        
+        if (lane_commit == graph->commit) {
+            seen_this = true;
+            strbuf_addch(out, '*');
+        } else if (seen_this && graph->edges_added == 1) {
+            // A lane that came in as '\' under the last merge stays '\'
+            bool leaning = graph->prev_state == LOG_GRAPH_POST_MERGE && graph->prev_edges_added > 0 &&
+                           graph->prev_commit_index < i;
+            strbuf_addch(out, leaning ? '\\' : '|');
+        } else if (graph->prev_state == LOG_GRAPH_COLLAPSING && graph->old_mapping[2 * i + 1] == i &&
+                   graph->mapping[2 * i] < i) {
+            strbuf_addch(out, '/');
+        } else {
+            strbuf_addch(out, '|');
+        }
+        strbuf_addch(out, ' ');
+    }
+    
+    if (graph->parent_count > 1)
+        update_state(graph, LOG_GRAPH_POST_MERGE);
+    else if (mapping_is_correct(graph))
+        update_state(graph, LOG_GRAPH_PADDING);
+    else
+        update_state(graph, LOG_GRAPH_COLLAPSING);
+}
+
+static void output_post_merge_row(log_graph_t *graph, strbuf_t *out)
+{
+    bool seen_this = false;
+    bool first_parent_seen = false;
+    
+    for (int i = 0; i <= graph->lane_count; i++) {
+        int lane_commit = i < graph->lane_count ? graph->lanes[i] : graph->commit;
+        if (i == graph->lane_count && seen_this)
+            break;
+        
+        if (lane_commit == graph->commit) {
+            int idx = graph->merge_layout;
+            seen_this = true;
+            for (int k = 0; k < graph->parent_count; k++) {
+                strbuf_addch(out, merge_chars[idx]);
+                if (idx < 2)
+                    idx++;
+                else if (graph->edges_added > 0 || k < graph->parent_count - 1)
+                    strbuf_addch(out, ' ');
+            }
+            if (graph->edges_added == 0)
+                strbuf_addch(out, ' ');
+        } else if (seen_this) {
+            strbuf_addch(out, graph->edges_added > 0 ? '\\' : '|');
+            strbuf_addch(out, ' ');
+        } else {
+            strbuf_addch(out, '|');
+            if (graph->merge_layout != 0 || i != graph->commit_index - 1)
+                strbuf_addch(out, first_parent_seen ? '_' : ' ');
+        }
+        if (lane_commit == graph->parents[0])
+            first_parent_seen = true;
+    }
+    
+    update_state(graph, mapping_is_correct(graph) ? LOG_GRAPH_PADDING : LOG_GRAPH_COLLAPSING);
+}
+
+/*
+ * Lines only ever move left, one column per row, except that a single
+ * line per row may cross others with a run of '_'.
+ */
+static void output_collapsing_row(log_graph_t *graph, strbuf_t *out)
+{
+    int horizontal_edge = -1;
+    int horizontal_edge_target = -1;
+    bool used_horizontal = false;
+    
+    int *mapping = graph->mapping;
+    graph->mapping = graph->old_mapping;
+    graph->old_mapping = mapping;
+    for (int i = 0; i < graph->mapping_size; i++)
+        graph->mapping[i] = -1;
+    
+    for (int i = 0; i < graph->mapping_size; i++) {
+        int target = graph->old_mapping[i];
+        if (target < 0)
+            continue;
+        
+        if (target * 2 == i) {
+            graph->mapping[i] = target;
+        } else if (graph->mapping[i - 1] < 0) {
+            // Nothing to the left: move left by one
+            graph->mapping[i - 1] = target;
+            if (horizontal_edge == -1) {
+                horizontal_edge = i;
+                horizontal_edge_target = target;
+                for (int j = target * 2 + 3; j < i - 2; j += 2)
+                    graph->mapping[j] = target;
+            }
+        } else if (graph->mapping[i - 1] != target) {
+            // Another line is to the left: cross over it
+            graph->mapping[i - 2] = target;
+            if (horizontal_edge == -1) {
+                horizontal_edge = i - 1;
+                horizontal_edge_target = target;
+                for (int j = target * 2 + 3; j < i - 2; j += 2)
+                    graph->mapping[j] = target;
+            }
+        }
+        // A line to the left headed for the same lane absorbs this one
+    }
+    
+    if (graph->mapping[graph->mapping_size - 1] < 0)
+        graph->mapping_size--;
+    
+    for (int i = 0; i < graph->mapping_size; i++) {
+        int target = graph->mapping[i];
+        if (target < 0) {
+            strbuf_addch(out, ' ');
+        } else if (target * 2 == i) {
+            strbuf_addch(out, '|');
+        } else if (target == horizontal_edge_target && i != horizontal_edge - 1) {
+            // Only the first segment of the run carries on to the next row
+            if (i != target * 2 + 3)
+                graph->mapping[i] = -1;
+            used_horizontal = true;
+            strbuf_addch(out, '_');
+        } else {
+            if (used_horizontal && i < horizontal_edge)
+                graph->mapping[i] = -1;
+            strbuf_addch(out, '/');
+        }
+    }
+    
+    if (mapping_is_correct(graph))
+        update_state(graph, LOG_GRAPH_PADDING);
+}
+
+void log_graph_commit(log_graph_t *graph, int pos, const int *parents, int parent_count, strbuf_t *out)
+{
+    log_graph_flush(graph, out);
+    ensure_lanes(graph, graph->next_count + parent_count + 1);
+    
+    graph->commit = pos;
+    memcpy(graph->parents, parents, (size_t)parent_count * sizeof(*parents));
+    graph->parent_count = parent_count;
+    graph->prev_commit_index = graph->commit_index;
+    update_lanes(graph);
+    graph->state = LOG_GRAPH_COMMIT;
+}
+
+void log_graph_prefix(log_graph_t *graph, strbuf_t *out)
+{
+    size_t start = out->len;
+    
+    switch (graph->state) {
+    case LOG_GRAPH_PADDING:
+        output_padding_row(graph, out);
+        break;
+    case LOG_GRAPH_COMMIT:
+        output_commit_row(graph, out);
+        break;
+    case LOG_GRAPH_POST_MERGE:
+        output_post_merge_row(graph, out);
+        break;
+    case LOG_GRAPH_COLLAPSING:
+        output_collapsing_row(graph, out);
+        break;
+    }
+    
+    for (size_t drawn = out->len - start; drawn < (size_t)graph->width; drawn++)
+        strbuf_addch(out, ' ');
+}
+
+void log_graph_flush(log_graph_t *graph, strbuf_t *out)
+{
+    while (graph->state != LOG_GRAPH_PADDING) {
+        log_graph_prefix(graph, out);
+        strbuf_addch(out, '\n');
+    }
+}
@@ -0,0 +1,188 @@
+#include "mailmap.h"
+#include <string.h>
+#include <strings.h>
+
+#include "config_utils.h"
+
+#define MAILMAP_INITIAL_CAPACITY 64
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+static inline unsigned char fold_byte(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static uint64_t hash_folded(uint64_t hash, const char *text, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ fold_byte((unsigned char)text[i])) * FNV_PRIME;
+    return hash;
+}
+
+// An email alone, or an email and a name, the NUL keeping the two apart
+static uint64_t key_hash(const char *email, size_t email_len, const char *name, size_t name_len)
+{
+    uint64_t hash = hash_folded(FNV_OFFSET, email, email_len);
+    if (name)
+        hash = hash_folded(hash_folded(hash, "", 1), name, name_len);
+    return hash;
+}
+
+static bool equals_folded(const char *key, const char *text, size_t len)
+{
+    return strncasecmp(key, text, len) == 0 && key[len] == '\0';
+}
+
+/* The entry for a key, or NULL, with the slot it has or would take. */
+static mailmap_entry_t* find_entry(const mailmap_t *map, uint64_t hash, const char *email, size_t email_len,
+                                   const char *name, size_t name_len, size_t *slot_out)
+{
+    size_t slot = (size_t)(hash & (map->capacity - 1));
+    
+    for (; map->slots[slot]; slot = (slot + 1) & (map->capacity - 1)) {
+        mailmap_entry_t *entry = &map->entries[map->slots[slot] - 1];
+        if (entry->hash != hash || !entry->old_name != !name)
+            continue;
+        if (equals_folded(entry->old_email, email, email_len) &&
+            (!name || equals_folded(entry->old_name, name, name_len)))
+            return entry;
+    }
+    if (slot_out)
+        *slot_out = slot;
+    return NULL;
+}
+
+static void mailmap_grow(mailmap_t *map)
+{
+    size_t capacity = map->capacity * 2;
+    uint32_t *slots = arena_calloc(map->arena, capacity, sizeof(*slots));
+    
+    for (size_t i = 0; i < map->count; i++) {
+        size_t slot = (size_t)(map->entries[i].hash & (capacity - 1));
+        while (slots[slot])
+            slot = (slot + 1) & (capacity - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    map->slots = slots;
+    map->capacity = capacity;
+}
+
+mailmap_t mailmap_init(arena_t *arena)
+{
+    mailmap_t map = {
+        .arena = arena,
+        .slots = arena_calloc(arena, MAILMAP_INITIAL_CAPACITY, sizeof(*map.slots)),
+        .capacity = MAILMAP_INITIAL_CAPACITY,
+    };
+    return map;
+}
+
+static void add_mapping(mailmap_t *map, const char *name, const char *email, const char *old_name,
+                        const char *old_email)
+{
+    size_t email_len = strlen(old_email), name_len = old_name ? strlen(old_name) : 0;
+    uint64_t hash = key_hash(old_email, email_len, old_name, name_len);
+    size_t slot;
+    mailmap_entry_t *entry = find_entry(map, hash, old_email, email_len, old_name, name_len, &slot);
+    
+    if (!entry) {
+        if ((map->count + 1) * 2 > map->capacity) {
+            mailmap_grow(map);
+            find_entry(map, hash, old_email, email_len, old_name, name_len, &slot);
+        }
+        if (map->count == map->alloc) {
+            size_t alloc = map->alloc ? map->alloc * 2 : 16;
+            map->entries = arena_realloc(map->arena, map->entries, map->alloc * sizeof(*map->entries),
+                                         alloc * sizeof(*map->entries));
+            map->alloc = alloc;
+        }
+        entry = &map->entries[map->count++];
+        *entry = (mailmap_entry_t){ .old_name = old_name, .old_email = old_email, .hash = hash };
+        map->slots[slot] = (uint32_t)map->count;
+    }
+    if (name)
+        entry->name = name;
+    if (email)
+        entry->email = email;
+}
+
+/*
+ * "Name <email>" at `*text`, either half possibly missing; a blank name
+ * is none. Moves past the closing '>' and returns whether there was an
+ * email.
+ */
+static bool parse_identity(mailmap_t *map, const char **text, const char *end, const char **name, const char **email)
+{
+    const char *open = memchr(*text, '<', (size_t)(end - *text));
+    const char *close = open ? memchr(open, '>', (size_t)(end - open)) : NULL;
+    *name = *email = NULL;
+    if (!close)
+        return false;
+    
+    const char *start = *text, *stop = open;
+    while (start < stop && (*start == ' ' || *start == '\t'))
+        start++;
+    while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t'))
+        stop--;
+    if (stop > start)
+        *name = arena_strndup(map->arena, start, (size_t)(stop - start));
+    *email = arena_strndup(map->arena, open + 1, (size_t)(close - open - 1));
+    *text = close + 1;
+    return true;
+}
+
+void mailmap_add(mailmap_t *map, const char *text, size_t len)
+{
+    const char *end = text + len;
+    
+    while (text < end) {
+        const char *eol = memchr(text, '\n', (size_t)(end - text));
+        const char *line_end = eol ? eol : end;
+        const char *name, *email, *old_name, *old_email;
+        
+        if (*text != '#' && parse_identity(map, &text, line_end, &name, &email)) {
+            // With a second identity, the first is what it becomes
+            if (parse_identity(map, &text, line_end, &old_name, &old_email))
+                add_mapping(map, name, email, old_name, old_email);
+            else
+                add_mapping(map, name, NULL, NULL, email);
+        }
+        text = eol ? eol + 1 : end;
+    }
+}
+
+void mailmap_read(mailmap_t *map, git_repository_t *repo)
+{
+    const char *paths[] = { ".mailmap", config_get(repo->ctx, "mailmap.file", NULL) };
+    
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        const git_worktree_file_t *file = paths[i] ? repo_worktree_file(repo, paths[i]) : NULL;
+        if (file)
+            mailmap_add(map, file->content, strlen(file->content));
+    }
+}
+
+bool mailmap_map(const mailmap_t *map, const char **name, size_t *name_len, const char **email, size_t *email_len)
+{
+    if (map->count == 0)
+        return false;
+    
+    uint64_t email_hash = hash_folded(FNV_OFFSET, *email, *email_len);
+    uint64_t both_hash = hash_folded(hash_folded(email_hash, "", 1), *name, *name_len);
+    const mailmap_entry_t *entry = find_entry(map, both_hash, *email, *email_len, *name, *name_len, NULL);
+    if (!entry)
+        entry = find_entry(map, email_hash, *email, *email_len, NULL, 0, NULL);
+    if (!entry || (!entry->name && !entry->email))
+        return false;
+    
+    if (entry->name) {
+        *name = entry->name;
+        *name_len = strlen(entry->name);
+    }
+    if (entry->email) {
+        *email = entry->email;
+        *email_len = strlen(entry->email);
+    }
+    return true;
+}
@@ -4,6 +4,8 @@
 #include <string.h>
 
 #include "commands/git.h"
+#include "config_utils.h"
+#include "git_context.h"
 
 ARGUS_OPTIONS(
     main_options,
@@ -49,6 +51,18 @@ ARGUS_OPTIONS(
         "log", log_options, 
         HELP("Show commit logs"), 
         ACTION(log_handler)),
+    SUBCOMMAND(
+        "shortlog", shortlog_options, 
+        HELP("Summarize git log output"), 
+        ACTION(shortlog_handler)),
+    SUBCOMMAND(
+        "describe", describe_options, 
+        HELP("Give an object a human readable name based on an available ref"), 
+        ACTION(describe_handler)),
+    SUBCOMMAND(
+        "merge-base", merge_base_options, 
+        HELP("Find as good common ancestors as possible for a merge"), 
+        ACTION(merge_base_handler)),
     SUBCOMMAND(
         "remote", remote_options, 
         HELP("Manage set of tracked repositories")),
@@ -83,6 +97,12 @@ ARGUS_OPTIONS(
         "switch", switch_options, 
         HELP("Switch branches"), 
         ACTION(switch_handler)),
+    SUBCOMMAND(
+        "sparse-checkout", sparse_checkout_options, 
+        HELP("Reduce your working tree to a subset of tracked files")),
+    SUBCOMMAND(
+        "commit-graph", commit_graph_options, 
+        HELP("Write and verify Git commit-graph files")),
 )
 
 
@@ -102,14 +122,21 @@ int main(int argc, char **argv)
         return ARGUS_ERROR_NO_COMMAND;
     }
 
+    git_context_t ctx = git_context_init();
+    
+    argus_map_it_t config_it = argus_map_it(&argus, "c");
+    while (argus_map_next(&config_it))
+        config_set_override(&ctx, config_it.key, config_it.value.as_string);
+
     if (argus_get(&argus, "verbose").as_bool) {
         printf("Git configuration:\n");
         printf("  Verbose mode: enabled\n");
         printf("\n");
     }
     
-    status = argus_exec(&argus, NULL);
+    status = argus_exec(&argus, &ctx);
 
+    git_context_free(&ctx);
     argus_free(&argus);    
     return status;
 }
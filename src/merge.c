@@ -0,0 +1,396 @@
+#include "merge.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "config_utils.h"
+#include "line_diff.h"
+#include "parallel_checkout.h"
+#include "sparse_index.h"
+#include "tree.h"
+#include "tree_diff.h"
+
+#define MARKER_SIZE 7
+
+typedef struct {
+    const diff_file_t *file;
+    int start;
+    int end;
+} line_range_t;
+
+merge_style_t merge_style_from_config(git_context_t *ctx, const char *name)
+{
+    if (!name)
+        name = config_get(ctx, "merge.conflictStyle", "merge");
+    
+    if (strcmp(name, "diff3") == 0)
+        return MERGE_STYLE_DIFF3;
+    if (strcmp(name, "zdiff3") == 0)
+        return MERGE_STYLE_ZDIFF3;
+    return MERGE_STYLE_MERGE;
+}
+
+merge_result_t merge_result_init(arena_t *arena)
+{
+    merge_result_t result = {
+        .arena = arena,
+        .entries = NULL,
+        .count = 0,
+        .alloc = 0,
+        .conflict_count = 0,
+    };
+    return result;
+}
+
+static void emit_range(strbuf_t *out, const line_range_t *range, bool terminate)
+{
+    for (int i = range->start; i < range->end; i++)
+        strbuf_add(out, range->file->lines[i].start, range->file->lines[i].len);
+    
+    // Markers must start on their own line
+    if (terminate && out->len > 0 && out->buf[out->len - 1] != '\n' && range->end > range->start)
+        strbuf_addch(out, '\n');
+}
+
+static void emit_marker(strbuf_t *out, char c, const char *label)
+{
+    for (int i = 0; i < MARKER_SIZE; i++)
+        strbuf_addch(out, c);
+    if (label)
+        strbuf_addf(out, " %s", label);
+    strbuf_addch(out, '\n');
+}
+
+static bool ranges_equal(const line_range_t *a, const line_range_t *b)
+{
+    if (a->end - a->start != b->end - b->start)
+        return false;
+    for (int i = 0; i < a->end - a->start; i++) {
+        if (a->file->lines[a->start + i].id != b->file->lines[b->start + i].id)
+            return false;
+    }
+    return true;
+}
+
+static void emit_conflict(strbuf_t *out, line_range_t base, line_range_t ours, line_range_t theirs,
+                          const merge_options_t *opts)
+{
+    line_range_t prefix = { ours.file, ours.start, ours.start };
+    line_range_t suffix = { ours.file, ours.end, ours.end };
+    
+    // Lines both sides agree on are moved out of the conflict, except in
+    // plain diff3 which shows each side exactly as it was
+    if (opts->style != MERGE_STYLE_DIFF3) {
+        while (ours.start < ours.end && theirs.start < theirs.end &&
+               ours.file->lines[ours.start].id == theirs.file->lines[theirs.start].id) {
+            ours.start++;
+            theirs.start++;
+        }
+        while (ours.end > ours.start && theirs.end > theirs.start &&
+               ours.file->lines[ours.end - 1].id == theirs.file->lines[theirs.end - 1].id) {
+            ours.end--;
+            theirs.end--;
+        }
+        prefix.end = ours.start;
+        suffix.start = ours.end;
+    }
+    
+    emit_range(out, &prefix, true);
+    emit_marker(out, '<', opts->ours_label);
+    emit_range(out, &ours, true);
+    if (opts->style != MERGE_STYLE_MERGE) {
+        emit_marker(out, '|', opts->ancestor_label);
+        emit_range(out, &base, true);
+    }
+    emit_marker(out, '=', NULL);
+    emit_range(out, &theirs, true);
+    emit_marker(out, '>', opts->theirs_label);
+    emit_range(out, &suffix, false);
+}
+
+/*
+ * The range a side's hunks in [first, last) replace, widened to cover the
+ * base lines [lo, hi) of the whole chunk. Without hunks the side kept the
+ * base lines, shifted by its running offset.
+ */
+static line_range_t side_range(const diff_file_t *file, const diff_hunk_t *hunks, size_t first, size_t last,
+                               int lo, int hi, int offset)
+{
+    line_range_t range = { file, lo + offset, hi + offset };
+    
+    if (first < last) {
+        const diff_hunk_t *head = &hunks[first], *tail = &hunks[last - 1];
+        range.start = head->new_start - (head->old_start - lo);
+        range.end = tail->new_start + tail->new_count + (hi - (tail->old_start + tail->old_count));
+    }
+    return range;
+}
+
+int merge_file(arena_t *arena, const merge_buffer_t *base, const merge_buffer_t *ours,
+               const merge_buffer_t *theirs, const merge_options_t *opts, strbuf_t *out)
+{
+    line_intern_t intern;
+    diff_file_t base_file, ours_file, theirs_file;
+    
+    line_intern_init(&intern, arena);
+    diff_file_load(&base_file, &intern, base->data, base->size);
+    diff_file_load(&ours_file, &intern, ours->data, ours->size);
+    diff_file_load(&theirs_file, &intern, theirs->data, theirs->size);
+    
+    diff_hunk_list_t ours_hunks = diff_hunk_list_init(arena);
+    diff_hunk_list_t theirs_hunks = diff_hunk_list_init(arena);
+    diff_lines(arena, &base_file, &ours_file, DIFF_ALGORITHM_HISTOGRAM, &ours_hunks);
+    diff_lines(arena, &base_file, &theirs_file, DIFF_ALGORITHM_HISTOGRAM, &theirs_hunks);
+    
+    const diff_hunk_t *h1 = ours_hunks.hunks, *h2 = theirs_hunks.hunks;
+    size_t i1 = 0, i2 = 0;
+    int base_pos = 0, ours_offset = 0, theirs_offset = 0, conflicts = 0;
+    
+    while (i1 < ours_hunks.count || i2 < theirs_hunks.count) {
+        int lo;
+        if (i1 == ours_hunks.count)
+            lo = h2[i2].old_start;
+        else if (i2 == theirs_hunks.count)
+            lo = h1[i1].old_start;
+        else
+            lo = h1[i1].old_start < h2[i2].old_start ? h1[i1].old_start : h2[i2].old_start;
+        
+        // Grow the chunk while a hunk of either side overlaps or touches it
+        int hi = lo;
+        size_t j1 = i1, j2 = i2;
+        for (bool grown = true; grown;) {
+            grown = false;
+            while (j1 < ours_hunks.count && h1[j1].old_start <= hi) {
+                if (h1[j1].old_start + h1[j1].old_count > hi)
+                    hi = h1[j1].old_start + h1[j1].old_count;
+                j1++;
+                grown = true;
+            }
+            while (j2 < theirs_hunks.count && h2[j2].old_start <= hi) {
+                if (h2[j2].old_start + h2[j2].old_count > hi)
+                    hi = h2[j2].old_start + h2[j2].old_count;
+                j2++;
+                grown = true;
+            }
+        }
+        
+        line_range_t unchanged = { &base_file, base_pos, lo };
+        line_range_t base_range = { &base_file, lo, hi };
+        line_range_t ours_range = side_range(&ours_file, h1, i1, j1, lo, hi, ours_offset);
+        line_range_t theirs_range = side_range(&theirs_file, h2, i2, j2, lo, hi, theirs_offset);
+        
+        emit_range(out, &unchanged, false);
+        if (j1 == i1) {
+            emit_range(out, &theirs_range, false);
+        } else if (j2 == i2 || ranges_equal(&ours_range, &theirs_range)) {
+            emit_range(out, &ours_range, false);
+        } else {
+            emit_conflict(out, base_range, ours_range, theirs_range, opts);
+            conflicts++;
+        }
+        
+        ours_offset = ours_range.end - hi;
+        theirs_offset = theirs_range.end - hi;
+        base_pos = hi;
+        i1 = j1;
+        i2 = j2;
+    }
+    
+    line_range_t rest = { &base_file, base_pos, base_file.count };
+    emit_range(out, &rest, false);
+    return conflicts;
+}
+
+static merge_entry_t* push_entry(merge_result_t *result, const char *path)
+{
+    if (result->count == result->alloc) {
+        size_t new_alloc = result->alloc ? result->alloc * 2 : 16;
+        result->entries = arena_realloc(result->arena, result->entries, result->alloc * sizeof(*result->entries),
+                                        new_alloc * sizeof(*result->entries));
+        result->alloc = new_alloc;
+    }
+    
+    merge_entry_t *entry = &result->entries[result->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->path = path;
+    return entry;
+}
+
+static bool read_blob(const git_odb_t *odb, const git_oid_t *oid, merge_buffer_t *buf)
+{
+    const git_object_t *blob = odb_read(odb, oid);
+    if (!blob || blob->type != OBJ_BLOB)
+        return false;
+    
+    buf->data = blob->data;
+    buf->size = blob->size;
+    return true;
+}
+
+static int merge_path(git_odb_t *odb, const git_diff_entry_t *ours, const git_diff_entry_t *theirs,
+                      const merge_options_t *opts, merge_result_t *result)
+{
+    bool ours_deleted = ours->status == DIFF_DELETED;
+    bool theirs_deleted = theirs->status == DIFF_DELETED;
+    
+    if (ours_deleted && theirs_deleted)
+        return 0;
+    if (!ours_deleted && !theirs_deleted && oid_cmp(&ours->new_oid, &theirs->new_oid) == 0 &&
+        ours->new_mode == theirs->new_mode)
+        return 0;
+    
+    if (ours_deleted || theirs_deleted) {
+        const git_diff_entry_t *modified = ours_deleted ? theirs : ours;
+        merge_entry_t *entry = push_entry(result, modified->path);
+        entry->oid = modified->new_oid;
+        entry->mode = modified->new_mode;
+        entry->deleted_by_ours = ours_deleted;
+        entry->conflict = MERGE_CONFLICT_MODIFY_DELETE;
+        result->conflict_count++;
+        return 0;
+    }
+    
+    merge_buffer_t base_buf = { "", 0 }, ours_buf, theirs_buf;
+    bool added = ours->status == DIFF_ADDED;
+    if ((!added && !read_blob(odb, &ours->old_oid, &base_buf)) || !read_blob(odb, &ours->new_oid, &ours_buf) ||
+        !read_blob(odb, &theirs->new_oid, &theirs_buf))
+        return -1;
+    
+    strbuf_t merged = strbuf_init(result->arena, ours_buf.size + theirs_buf.size / 4 + 64);
+    int conflicts = merge_file(result->arena, &base_buf, &ours_buf, &theirs_buf, opts, &merged);
+    
+    merge_entry_t *entry = push_entry(result, ours->path);
+    entry->oid = odb_write(odb, OBJ_BLOB, merged.buf, merged.len)->oid;
+    entry->mode = ours->new_mode != ours->old_mode || added ? ours->new_mode : theirs->new_mode;
+    entry->auto_merged = true;
+    if (conflicts > 0) {
+        entry->conflict = added ? MERGE_CONFLICT_ADD_ADD : MERGE_CONFLICT_CONTENT;
+        result->conflict_count++;
+    }
+    return 0;
+}
+
+int merge_trees(git_odb_t *odb, const git_oid_t *base, const git_oid_t *ours, const git_oid_t *theirs,
+                const merge_options_t *opts, merge_result_t *out)
+{
+    git_diff_list_t ours_diff = diff_list_init(out->arena);
+    git_diff_list_t theirs_diff = diff_list_init(out->arena);
+    
+    if (tree_diff(odb, base, ours, &ours_diff) < 0 || tree_diff(odb, base, theirs, &theirs_diff) < 0)
+        return -1;
+    
+    // Both lists are in path order; paths only we changed are already in place
+    size_t i = 0, j = 0;
+    while (i < ours_diff.count || j < theirs_diff.count) {
+        int cmp = i == ours_diff.count ? 1
+                : j == theirs_diff.count ? -1
+                : strcmp(ours_diff.entries[i].path, theirs_diff.entries[j].path);
+        
+        if (cmp < 0) {
+            i++;
+            continue;
+        }
+        if (cmp > 0) {
+            const git_diff_entry_t *change = &theirs_diff.entries[j++];
+            merge_entry_t *entry = push_entry(out, change->path);
+            entry->oid = change->new_oid;
+            entry->mode = change->new_mode;
+            entry->deleted = change->status == DIFF_DELETED;
+            continue;
+        }
+        if (merge_path(odb, &ours_diff.entries[i++], &theirs_diff.entries[j++], opts, out) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void merge_result_print(const merge_result_t *result, const merge_options_t *opts)
+{
+    for (size_t i = 0; i < result->count; i++) {
+        const merge_entry_t *entry = &result->entries[i];
+        
+        if (entry->auto_merged)
+            printf("Auto-merging %s\n", entry->path);
+        
+        switch (entry->conflict) {
+        case MERGE_CONFLICT_CONTENT:
+            printf("CONFLICT (content): Merge conflict in %s\n", entry->path);
+            break;
+        case MERGE_CONFLICT_ADD_ADD:
+            printf("CONFLICT (add/add): Merge conflict in %s\n", entry->path);
+            break;
+        case MERGE_CONFLICT_MODIFY_DELETE: {
+            const char *deleter = entry->deleted_by_ours ? opts->ours_label : opts->theirs_label;
+            const char *modifier = entry->deleted_by_ours ? opts->theirs_label : opts->ours_label;
+            printf("CONFLICT (modify/delete): %s deleted in %s and modified in %s.  Version %s of %s left in tree.\n",
+                   entry->path, deleter, modifier, modifier, entry->path);
+            break;
+        }
+        case MERGE_CLEAN:
+            break;
+        }
+    }
+}
+
+int merge_check_local_changes(const git_repository_t *repo, const merge_result_t *result)
+{
+    const git_oid_t *head_tree = &repo->commits[repo->head].tree;
+    int dirty = 0;
+    
+    for (size_t i = 0; i < result->count; i++) {
+        const char *path = result->entries[i].path;
+        git_tree_entry_t head_entry;
+        const git_oid_t *head_oid = tree_lookup_path(&repo->odb, head_tree, path, &head_entry) ? head_entry.oid : NULL;
+        long pos = index_find(&repo->index, path);
+        const git_oid_t *staged = pos >= 0 ? &repo->index.entries[pos].oid : NULL;
+        
+        if (sparse_index_find_dir(&repo->index, path) >= 0)
+            continue;
+        
+        bool clean = head_oid ? staged && oid_cmp(staged, head_oid) == 0 : !staged;
+        if (clean && !(pos >= 0 && repo->index.entries[pos].skip_worktree))
+            clean = repo_worktree_matches(repo, path, staged);
+        if (clean)
+            continue;
+        
+        if (dirty++ == 0)
+            printf("error: Your local changes to the following files would be overwritten by merge:\n");
+        printf("\t%s\n", path);
+    }
+    
+    if (dirty > 0) {
+        printf("Please commit your changes or stash them before you merge.\n");
+        printf("Aborting\n");
+    }
+    return dirty;
+}
+
+int merge_result_apply(git_repository_t *repo, const merge_result_t *result)
+{
+    parallel_checkout_t pc = parallel_checkout_init(repo);
+    
+    for (size_t i = 0; i < result->count; i++) {
+        const merge_entry_t *entry = &result->entries[i];
+        sparse_index_expand_for_path(&repo->index, &repo->odb, entry->path);
+        
+        // Conflicts leave the index at our version and only touch the worktree
+        if (entry->conflict != MERGE_CLEAN) {
+            if (entry->conflict != MERGE_CONFLICT_MODIFY_DELETE || entry->deleted_by_ours)
+                parallel_checkout_add(&pc, entry->path, &entry->oid, entry->mode);
+            continue;
+        }
+        
+        if (entry->deleted) {
+            long pos = index_find(&repo->index, entry->path);
+            if (pos >= 0 && !repo->index.entries[pos].skip_worktree)
+                repo_remove_worktree_file(repo, entry->path);
+            index_remove(&repo->index, entry->path);
+            continue;
+        }
+        
+        git_index_entry_t *index_entry = index_add(&repo->index, entry->path, &entry->oid, entry->mode);
+        index_entry->skip_worktree = !sparse_checkout_includes(&repo->sparse, entry->path);
+        if (!index_entry->skip_worktree)
+            parallel_checkout_add(&pc, entry->path, &entry->oid, entry->mode);
+    }
+    return parallel_checkout_run(&pc);
+}
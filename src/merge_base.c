@@ -0,0 +1,440 @@
+#include "merge_base.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "commit_graph.h"
+#include "revision.h"
+
+// Marks for removing redundant commits
+#define REDUNDANT_CANDIDATE 0x01
+#define REDUNDANT_REACHED   0x02
+
+/*
+ * Paint of a batch of queries. `paint` holds the queries whose other
+ * commit reaches a commit and `stale` those for which a merge base found
+ * already does; `from_one` is the paint of the commit all of them share.
+ */
+typedef struct {
+    git_repository_t *repo;
+    arena_t *scratch;
+    const uint32_t *generations;
+    unsigned char *from_one;
+    uint64_t *paint;
+    uint64_t *stale;
+    uint64_t queries;
+    rev_queue_t queue;
+} paint_walk_t;
+
+typedef struct {
+    int *commits;
+    size_t count;
+    size_t alloc;
+} found_list_t;
+
+/*
+ * Paint of an ahead/behind walk, a bit for each distinct commit of the
+ * pairs. `paint` is NULL for a commit no pair has reached yet.
+ */
+typedef struct {
+    arena_t *scratch;
+    uint64_t **paint;
+    size_t words;
+    size_t bit_count;
+    rev_queue_t queue;
+} count_walk_t;
+
+static const uint32_t* walk_generations(git_repository_t *repo)
+{
+    const commit_graph_t *graph = commit_graph_open(repo);
+    return graph ? graph->generations : NULL;
+}
+
+static void found_add(arena_t *arena, found_list_t *list, int pos)
+{
+    if (list->count == list->alloc) {
+        size_t alloc = list->alloc ? list->alloc * 2 : 4;
+        list->commits = arena_realloc(arena, list->commits, list->alloc * sizeof(*list->commits),
+                                      alloc * sizeof(*list->commits));
+        list->alloc = alloc;
+    }
+    list->commits[list->count++] = pos;
+}
+
+/* Whether the commit can still turn out a merge base of some query. */
+static bool paint_is_live(const paint_walk_t *walk, int pos)
+{
+    uint64_t reaching = walk->from_one[pos] ? walk->queries : walk->paint[pos];
+    return (reaching & ~walk->stale[pos]) != 0;
+}
+
+static bool queue_has_live(const paint_walk_t *walk)
+{
+    for (size_t i = 0; i < walk->queue.count; i++) {
+        if (paint_is_live(walk, walk->queue.items[i].pos))
+            return true;
+    }
+    return false;
+}
+
+// A commit is queued again whenever it takes on paint it did not have
+static void paint_commit(paint_walk_t *walk, int pos, bool from_one, uint64_t paint, uint64_t stale)
+{
+    if (!(from_one && !walk->from_one[pos]) && !(paint & ~walk->paint[pos]) && !(stale & ~walk->stale[pos]))
+        return;
+    
+    walk->from_one[pos] |= from_one;
+    walk->paint[pos] |= paint;
+    walk->stale[pos] |= stale;
+    rev_queue_push(&walk->queue, walk->scratch, pos);
+}
+
+/*
+ * Paint down from `one` and from each of `twos`, the i-th with bit i of
+ * the paint. A commit painted from both sides is a merge base of the
+ * queries whose bits it carries, unless a merge base found before reaches
+ * it; either way those queries are stale below it.
+ */
+static void paint_down(paint_walk_t *walk, int one, const int *twos, const uint64_t *bits, size_t count,
+                       found_list_t *found)
+{
+    paint_commit(walk, one, true, 0, 0);
+    for (size_t i = 0; i < count; i++)
+        paint_commit(walk, twos[i], false, bits[i], 0);
+    
+    while (queue_has_live(walk)) {
+        int pos = rev_queue_pop(&walk->queue);
+        uint64_t bases = walk->from_one[pos] ? walk->paint[pos] & ~walk->stale[pos] : 0;
+        
+        for (size_t q = 0; bases && q < MERGE_BASE_BATCH; q++) {
+            if ((bases >> q) & 1)
+                found_add(walk->scratch, &found[q], pos);
+        }
+        walk->stale[pos] |= bases;
+        
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        for (int p = 0; p < node->parent_count; p++)
+            paint_commit(walk, node->parents[p], walk->from_one[pos], walk->paint[pos], walk->stale[pos]);
+    }
+}
+
+/*
+ * Drop duplicates from `commits`, then every commit another of them
+ * reaches, keeping the order. The walk down from all of them at once
+ * ends when a single one is left unreached, or with a commit graph when
+ * it is below the lowest of them.
+ */
+static size_t remove_redundant(git_repository_t *repo, arena_t *scratch, const uint32_t *generations, int *commits,
+                               size_t count)
+{
+    unsigned char *marks = arena_calloc(scratch, (size_t)repo->commit_count + 1, 1);
+    rev_queue_t queue = rev_queue_init(repo, generations);
+    uint32_t min_generation = UINT32_MAX;
+    size_t kept = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        int pos = commits[i];
+        if (marks[pos] & REDUNDANT_CANDIDATE)
+            continue;
+        marks[pos] |= REDUNDANT_CANDIDATE;
+        commits[kept++] = pos;
+        rev_queue_push(&queue, scratch, pos);
+        if (generations && generations[pos] < min_generation)
+            min_generation = generations[pos];
+    }
+    
+    // One left unreached can only be reached through another one reached, which would be a cycle
+    size_t unreached = kept;
+    for (int pos; unreached > 1 && (pos = rev_queue_pop(&queue)) >= 0;) {
+        if (generations && generations[pos] < min_generation)
+            break;
+        
+        const git_commit_node_t *node = &repo->commits[pos];
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            if (marks[parent] & REDUNDANT_REACHED)
+                continue;
+            marks[parent] |= REDUNDANT_REACHED;
+            if (marks[parent] & REDUNDANT_CANDIDATE)
+                unreached--;
+            rev_queue_push(&queue, scratch, parent);
+        }
+    }
+    
+    count = kept;
+    kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(marks[commits[i]] & REDUNDANT_REACHED))
+            commits[kept++] = commits[i];
+    }
+    return kept;
+}
+
+/* The merge bases found for a query without the redundant ones, newest first, copied to `arena`. */
+static merge_base_list_t finish_bases(git_repository_t *repo, arena_t *scratch, const uint32_t *generations,
+                                      found_list_t *found, arena_t *arena)
+{
+    merge_base_list_t list = { .count = found->count };
+    
+    if (list.count > 1)
+        list.count = remove_redundant(repo, scratch, generations, found->commits, found->count);
+    list.commits = arena_alloc(arena, (list.count + 1) * sizeof(*list.commits));
+    
+    // Insertion keeps bases of the same date in the order they were found
+    for (size_t i = 0; i < list.count; i++) {
+        int pos = found->commits[i];
+        size_t at = i;
+        while (at > 0 && repo->commits[list.commits[at - 1]].date < repo->commits[pos].date) {
+            list.commits[at] = list.commits[at - 1];
+            at--;
+        }
+        list.commits[at] = pos;
+    }
+    return list;
+}
+
+static paint_walk_t paint_walk_init(git_repository_t *repo, arena_t *scratch, const uint32_t *generations)
+{
+    size_t count = (size_t)repo->commit_count + 1;
+    paint_walk_t walk = {
+        .repo = repo,
+        .scratch = scratch,
+        .generations = generations,
+        .from_one = arena_calloc(scratch, count, sizeof(*walk.from_one)),
+        .paint = arena_calloc(scratch, count, sizeof(*walk.paint)),
+        .stale = arena_calloc(scratch, count, sizeof(*walk.stale)),
+        .queue = rev_queue_init(repo, generations),
+    };
+    return walk;
+}
+
+merge_base_list_t merge_bases_many(git_repository_t *repo, int one, const int *twos, size_t count, arena_t *arena)
+{
+    arena_t scratch = arena_init(0);
+    const uint32_t *generations = walk_generations(repo);
+    paint_walk_t walk = paint_walk_init(repo, &scratch, generations);
+    uint64_t *bits = arena_alloc(&scratch, (count + 1) * sizeof(*bits));
+    found_list_t found = { 0 };
+    
+    // Every other commit paints as the same single query
+    for (size_t i = 0; i < count; i++)
+        bits[i] = 1;
+    walk.queries = 1;
+    paint_down(&walk, one, twos, bits, count, &found);
+    
+    merge_base_list_t list = finish_bases(repo, &scratch, generations, &found, arena);
+    arena_free(&scratch);
+    return list;
+}
+
+void merge_bases_batch(git_repository_t *repo, int one, const int *twos, size_t count, arena_t *arena,
+                       merge_base_list_t *out)
+{
+    const uint32_t *generations = walk_generations(repo);
+    uint64_t bits[MERGE_BASE_BATCH];
+    
+    for (size_t q = 0; q < MERGE_BASE_BATCH; q++)
+        bits[q] = (uint64_t)1 << q;
+    
+    for (size_t start = 0; start < count; start += MERGE_BASE_BATCH) {
+        size_t batch = count - start < MERGE_BASE_BATCH ? count - start : MERGE_BASE_BATCH;
+        arena_t scratch = arena_init(0);
+        paint_walk_t walk = paint_walk_init(repo, &scratch, generations);
+        found_list_t found[MERGE_BASE_BATCH] = { { 0 } };
+        
+        walk.queries = batch == MERGE_BASE_BATCH ? UINT64_MAX : ((uint64_t)1 << batch) - 1;
+        paint_down(&walk, one, twos + start, bits, batch, found);
+        for (size_t q = 0; q < batch; q++)
+            out[start + q] = finish_bases(repo, &scratch, generations, &found[q], arena);
+        arena_free(&scratch);
+    }
+}
+
+merge_base_list_t merge_bases_octopus(git_repository_t *repo, const int *commits, size_t count, arena_t *arena)
+{
+    arena_t scratch = arena_init(0);
+    merge_base_list_t bases = { .commits = arena_alloc(&scratch, sizeof(int)), .count = count ? 1 : 0 };
+    
+    if (count)
+        bases.commits[0] = commits[0];
+    for (size_t i = 1; i < count && bases.count > 0; i++) {
+        merge_base_list_t *parts = arena_alloc(&scratch, bases.count * sizeof(*parts));
+        size_t total = 0;
+        
+        merge_bases_batch(repo, commits[i], bases.commits, bases.count, &scratch, parts);
+        for (size_t j = 0; j < bases.count; j++)
+            total += parts[j].count;
+        
+        // A base found twice is kept where it first turned up
+        int *next = arena_alloc(&scratch, (total + 1) * sizeof(*next));
+        size_t next_count = 0;
+        for (size_t j = 0; j < bases.count; j++) {
+            for (size_t k = 0; k < parts[j].count; k++) {
+                size_t seen = 0;
+                while (seen < next_count && next[seen] != parts[j].commits[k])
+                    seen++;
+                if (seen == next_count)
+                    next[next_count++] = parts[j].commits[k];
+            }
+        }
+        bases = (merge_base_list_t){ next, next_count };
+    }
+    
+    merge_base_list_t list = merge_base_independent(repo, bases.commits, bases.count, arena);
+    arena_free(&scratch);
+    return list;
+}
+
+merge_base_list_t merge_base_independent(git_repository_t *repo, const int *commits, size_t count, arena_t *arena)
+{
+    merge_base_list_t list = { .commits = arena_alloc(arena, (count + 1) * sizeof(int)), .count = count };
+    arena_t scratch = arena_init(0);
+    
+    memcpy(list.commits, commits, count * sizeof(*commits));
+    if (count > 1)
+        list.count = remove_redundant(repo, &scratch, walk_generations(repo), list.commits, count);
+    arena_free(&scratch);
+    return list;
+}
+
+bool merge_base_is_ancestor(git_repository_t *repo, int ancestor, int descendant)
+{
+    arena_t scratch = arena_init(0);
+    merge_base_list_t bases = merge_bases_many(repo, descendant, &ancestor, 1, &scratch);
+    bool is_ancestor = bases.count == 1 && bases.commits[0] == ancestor;
+    
+    arena_free(&scratch);
+    return is_ancestor;
+}
+
+/*
+ * Generations of the commits that `starts` reach, for a walk that needs
+ * them when there is no commit graph. The rest are left at 0.
+ */
+static uint32_t* reach_generations(git_repository_t *repo, arena_t *scratch, const int *starts, size_t count)
+{
+    uint32_t *generations = arena_calloc(scratch, (size_t)repo->commit_count + 1, sizeof(*generations));
+    int *stack = arena_alloc(scratch, ((size_t)repo->commit_count + 1) * sizeof(*stack));
+    
+    for (size_t i = 0; i < count; i++) {
+        size_t depth = 0;
+        if (generations[starts[i]])
+            continue;
+        
+        stack[depth++] = starts[i];
+        while (depth > 0) {
+            const git_commit_node_t *node = &repo->commits[stack[depth - 1]];
+            uint32_t generation = 1;
+            bool ready = true;
+            for (int p = 0; p < node->parent_count; p++) {
+                uint32_t parent = generations[node->parents[p]];
+                if (!parent) {
+                    stack[depth++] = node->parents[p];
+                    ready = false;
+                    break;
+                }
+                if (parent + 1 > generation)
+                    generation = parent + 1;
+            }
+            if (ready)
+                generations[stack[--depth]] = generation;
+        }
+    }
+    return generations;
+}
+
+static bool paint_has_bit(const uint64_t *paint, size_t bit)
+{
+    return (paint[bit / 64] >> (bit % 64)) & 1;
+}
+
+static bool paint_is_full(const count_walk_t *walk, const uint64_t *paint)
+{
+    for (size_t w = 0; w < walk->words; w++) {
+        size_t bits = walk->bit_count - w * 64;
+        uint64_t full = bits >= 64 ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+        if ((paint[w] & full) != full)
+            return false;
+    }
+    return true;
+}
+
+static bool queue_has_partial(const count_walk_t *walk)
+{
+    for (size_t i = 0; i < walk->queue.count; i++) {
+        if (!paint_is_full(walk, walk->paint[walk->queue.items[i].pos]))
+            return true;
+    }
+    return false;
+}
+
+// By generation nothing painting a commit comes after it, so it is queued only once
+static uint64_t* count_paint(count_walk_t *walk, int pos)
+{
+    if (!walk->paint[pos]) {
+        walk->paint[pos] = arena_calloc(walk->scratch, walk->words, sizeof(**walk->paint));
+        rev_queue_push(&walk->queue, walk->scratch, pos);
+    }
+    return walk->paint[pos];
+}
+
+void merge_base_ahead_behind(git_repository_t *repo, const int *tips, const int *bases, size_t count,
+                             ahead_behind_t *out)
+{
+    arena_t scratch = arena_init(0);
+    size_t commit_count = (size_t)repo->commit_count + 1;
+    size_t *bit_of = arena_calloc(&scratch, commit_count, sizeof(*bit_of));
+    size_t bit_count = 0;
+    
+    // Bits are numbered from 1 in `bit_of` so that 0 can mean none yet
+    for (size_t i = 0; i < count; i++) {
+        if (!bit_of[tips[i]])
+            bit_of[tips[i]] = ++bit_count;
+        if (!bit_of[bases[i]])
+            bit_of[bases[i]] = ++bit_count;
+        out[i] = (ahead_behind_t){ 0, 0 };
+    }
+    if (count == 0) {
+        arena_free(&scratch);
+        return;
+    }
+    
+    const commit_graph_t *graph = commit_graph_open(repo);
+    int *starts = arena_alloc(&scratch, 2 * count * sizeof(*starts));
+    memcpy(starts, tips, count * sizeof(*tips));
+    memcpy(starts + count, bases, count * sizeof(*bases));
+    const uint32_t *generations = graph ? graph->generations : reach_generations(repo, &scratch, starts, 2 * count);
+    
+    count_walk_t walk = {
+        .scratch = &scratch,
+        .paint = arena_calloc(&scratch, commit_count, sizeof(*walk.paint)),
+        .words = (bit_count + 63) / 64,
+        .bit_count = bit_count,
+        .queue = rev_queue_init(repo, generations),
+    };
+    for (size_t i = 0; i < 2 * count; i++) {
+        size_t bit = bit_of[starts[i]] - 1;
+        count_paint(&walk, starts[i])[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+    
+    while (queue_has_partial(&walk)) {
+        int pos = rev_queue_pop(&walk.queue);
+        const uint64_t *paint = walk.paint[pos];
+        
+        for (size_t i = 0; i < count; i++) {
+            bool from_tip = paint_has_bit(paint, bit_of[tips[i]] - 1);
+            bool from_base = paint_has_bit(paint, bit_of[bases[i]] - 1);
+            if (from_tip && !from_base)
+                out[i].ahead++;
+            else if (from_base && !from_tip)
+                out[i].behind++;
+        }
+        
+        const git_commit_node_t *node = &repo->commits[pos];
+        for (int p = 0; p < node->parent_count; p++) {
+            uint64_t *parent = count_paint(&walk, node->parents[p]);
+            for (size_t w = 0; w < walk.words; w++)
+                parent[w] |= paint[w];
+        }
+    }
+    arena_free(&scratch);
+}
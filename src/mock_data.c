@@ -14,9 +14,9 @@ const git_remote_t* get_mock_remotes(int *count)
 const git_stash_entry_t* get_mock_stashes(int *count)
 {
     static const git_stash_entry_t stashes[] = {
-        {0, "WIP on main: abc1234 Add new feature for user authentication", "main", "2024-01-15 10:30:00"},
-        {1, "On feature-branch: def5678 Fix bug in payment processing", "feature-branch", "2024-01-14 15:45:00"},
-        {2, "WIP on main: ghi9012 Update documentation for API endpoints", "main", "2024-01-13 09:15:00"}
+        {0, "WIP on main: abc1234 Add new feature for user authentication", "main", "2024-01-15 10:30:00", "abc1234"},
+        {1, "On feature-branch: def5678 Fix bug in payment processing", "feature-branch", "2024-01-14 15:45:00", "def5678"},
+        {2, "WIP on main: ghi9012 Update documentation for API endpoints", "main", "2024-01-13 09:15:00", "ghi9012"}
     };
     *count = 3;
     return stashes;
@@ -25,11 +25,11 @@ const git_stash_entry_t* get_mock_stashes(int *count)
 const git_commit_t* get_mock_commits(int *count)
 {
     static const git_commit_t commits[] = {
-        {"abc1234", "Add new feature for user authentication", "John Doe", "Mon Jan 15 10:30:45 2024", "john.doe@example.com"},
-        {"def5678", "Fix bug in payment processing", "Jane Smith", "Sun Jan 14 15:45:20 2024", "jane.smith@example.com"},
-        {"ghi9012", "Update documentation for API endpoints", "Bob Wilson", "Sat Jan 13 09:15:30 2024", "bob.wilson@example.com"},
-        {"jkl3456", "Refactor database connection logic", "Alice Brown", "Fri Jan 12 14:22:10 2024", "alice.brown@example.com"},
-        {"mno7890", "Initial commit", "John Doe", "Thu Jan 11 16:00:00 2024", "john.doe@example.com"}
+        {"abc1234", "Add new feature for user authentication", "John Doe", "Mon Jan 15 10:30:45 2024", "john.doe@example.com", {"def5678"}},
+        {"def5678", "Fix bug in payment processing", "Jane Smith", "Sun Jan 14 15:45:20 2024", "jane.smith@example.com", {"ghi9012"}},
+        {"ghi9012", "Update documentation for API endpoints", "Bob Wilson", "Sat Jan 13 09:15:30 2024", "bob.wilson@example.com", {"jkl3456"}},
+        {"jkl3456", "Refactor database connection logic", "Alice Brown", "Fri Jan 12 14:22:10 2024", "alice.brown@example.com", {"mno7890"}},
+        {"mno7890", "Initial commit", "John Doe", "Thu Jan 11 16:00:00 2024", "john.doe@example.com", {NULL}}
     };
     *count = 5;
     return commits;
@@ -58,6 +58,16 @@ const git_branch_t* get_mock_remote_branches(int *count)
     return remote_branches;
 }
 
+const git_tag_t* get_mock_tags(int *count)
+{
+    static const git_tag_t tags[] = {
+        {"v0.1.0", "mno7890", NULL, NULL},
+        {"v1.0.0", "ghi9012", "Release 1.0.0", "Bob Wilson <bob.wilson@example.com>"}
+    };
+    *count = 2;
+    return tags;
+}
+
 const git_file_status_t* get_mock_file_status(int *count)
 {
     static const git_file_status_t files[] = {
@@ -92,4 +102,174 @@ const git_config_entry_t* get_mock_config_entries(const char *scope, int *count)
     
     *count = 8;
     return configs;
-}
\ No newline at end of file
+}
+
+#define MOCK_GITIGNORE      "*.log\nbuild/\n"
+#define MOCK_MAKEFILE       "all:\n\tmeson compile -C build\n"
+#define MOCK_README         "# Demo project\n\nA small service used to demonstrate git.\n"
+#define MOCK_DOCS_README    "# Documentation\n\nSee api.md for the endpoint reference.\n"
+#define MOCK_DOCS_API       "# API\n\nPOST /login\nPOST /payment\nGET /status\n"
+#define MOCK_APP_H          "#ifndef APP_H\n#define APP_H\n\nint app_run(void);\n\n#endif\n"
+#define MOCK_AUTH_H         "#ifndef AUTH_H\n#define AUTH_H\n\nint auth_login(const char *user);\n\n#endif\n"
+#define MOCK_MAIN_C         "#include \"app.h\"\n\nint main() {\n    return app_run();\n}\n"
+#define MOCK_UTILS_C        "#include <string.h>\n\nint is_empty(const char *s)\n{\n    return !s || !*s;\n}\n"
+#define MOCK_AUTH_C         "#include \"auth.h\"\n\nint auth_login(const char *user)\n{\n    return user != 0;\n}\n"
+#define MOCK_PAYMENT_C      "int payment_process(int amount)\n{\n    return amount > 0 ? 0 : -1;\n}\n"
+#define MOCK_CONNECTION_C   "int db_connect(const char *url)\n{\n    return url ? 0 : -1;\n}\n"
+#define MOCK_TEST_API_C     "#include <assert.h>\n\nint main(void)\n{\n    assert(1);\n    return 0;\n}\n"
+#define MOCK_MODIFIED_FILE  "Line 1\nAdded line\nLine 2\nLine 3\n"
+#define MOCK_NEW_FILE       "This is a new file\nwith some content\nfor demonstration\n"
+#define MOCK_UNTRACKED_FILE "scratch notes\n"
+#define MOCK_IGNORED_LOG    "debug: starting application\n"
+#define MOCK_MAILMAP        "# One identity per contributor\n" \
+                            "Jane Smith <jane@example.com> <jane.smith@example.com>\n" \
+                            "Robert Wilson <bob.wilson@example.com>\n" \
+                            "<john@example.com> John Doe <john.doe@example.com>\n"
+
+const git_tree_file_t* get_mock_commit_changes(const char *hash, int *count)
+{
+    // Changes of each commit against its first parent; NULL content deletes
+    static const git_tree_file_t initial_commit[] = {
+        {".gitignore", MOCK_GITIGNORE},
+        {".mailmap", MOCK_MAILMAP},
+        {"Makefile", MOCK_MAKEFILE},
+        {"README.md", MOCK_README},
+        {"docs/README.md", "# Documentation\n"},
+        {"include/app.h", MOCK_APP_H},
+        {"modified-file.txt", "Line 1\nLine 2\nLine 3\n"},
+        {"src/database.c", "int db_connect(const char *url)\n{\n    return 0;\n}\n"},
+        {"src/main.c", MOCK_MAIN_C},
+        {"src/payment.c", "int payment_process(int amount)\n{\n    return 0;\n}\n"},
+        {"src/utils.c", MOCK_UTILS_C},
+        {"tests/test_api.c", MOCK_TEST_API_C}
+    };
+    static const git_tree_file_t refactor_database[] = {
+        {"src/database.c", NULL},
+        {"src/db/connection.c", MOCK_CONNECTION_C}
+    };
+    static const git_tree_file_t update_documentation[] = {
+        {"docs/README.md", MOCK_DOCS_README},
+        {"docs/api.md", MOCK_DOCS_API}
+    };
+    static const git_tree_file_t fix_payment[] = {
+        {"src/payment.c", MOCK_PAYMENT_C}
+    };
+    static const git_tree_file_t add_authentication[] = {
+        {"include/auth.h", MOCK_AUTH_H},
+        {"src/auth.c", MOCK_AUTH_C}
+    };
+    static const struct {
+        const char *hash;
+        const git_tree_file_t *changes;
+        int count;
+    } history[] = {
+        {"mno7890", initial_commit, 12},
+        {"jkl3456", refactor_database, 2},
+        {"ghi9012", update_documentation, 2},
+        {"def5678", fix_payment, 1},
+        {"abc1234", add_authentication, 2}
+    };
+    
+    for (int i = 0; i < 5; i++) {
+        if (strcmp(history[i].hash, hash) == 0) {
+            *count = history[i].count;
+            return history[i].changes;
+        }
+    }
+    *count = 0;
+    return NULL;
+}
+
+const git_tree_file_t* get_mock_stash_changes(int index, int *count)
+{
+    // Worktree changes each stash recorded on top of its base commit
+    static const git_tree_file_t wip_authentication[] = {
+        {"modified-file.txt", MOCK_MODIFIED_FILE},
+        {"src/main.c", "#include \"app.h\"\n#include <stdio.h>\n\nint main() {\n"
+                       "    printf(\"Debug: Starting application\\n\");\n    return app_run();\n}\n"}
+    };
+    static const git_tree_file_t payment_limits[] = {
+        {"src/payment.c", "#define PAYMENT_LIMIT 10000\n\nint payment_process(int amount)\n{\n"
+                          "    if (amount > PAYMENT_LIMIT)\n        return -1;\n    return amount > 0 ? 0 : -1;\n}\n"}
+    };
+    static const git_tree_file_t wip_documentation[] = {
+        {"docs/api.md", "# API\n\nPOST /login\nPOST /logout\nPOST /payment\nGET /status\n"},
+        {"docs/README.md", NULL}
+    };
+    static const struct {
+        const git_tree_file_t *changes;
+        int count;
+    } stashes[] = {
+        {wip_authentication, 2},
+        {payment_limits, 1},
+        {wip_documentation, 2}
+    };
+    
+    if (index < 0 || index >= 3) {
+        *count = 0;
+        return NULL;
+    }
+    *count = stashes[index].count;
+    return stashes[index].changes;
+}
+
+#define MOCK_INDEX_TIMESTAMP 1705314645LL
+
+#define MOCK_STAT(content, mtime, ino) {mtime, mtime, sizeof(content) - 1, ino}
+
+long long get_mock_index_timestamp(void)
+{
+    return MOCK_INDEX_TIMESTAMP;
+}
+
+const git_index_stat_t* get_mock_index_stats(int *count)
+{
+    static const git_index_stat_t stats[] = {
+        {".gitignore", MOCK_STAT(MOCK_GITIGNORE, 1705000000LL, 1001)},
+        {".mailmap", MOCK_STAT(MOCK_MAILMAP, 1705000000LL, 1018)},
+        {"Makefile", MOCK_STAT(MOCK_MAKEFILE, 1705000000LL, 1002)},
+        {"README.md", MOCK_STAT(MOCK_README, MOCK_INDEX_TIMESTAMP, 1003)},
+        {"docs/README.md", MOCK_STAT(MOCK_DOCS_README, 1705150000LL, 1004)},
+        {"docs/api.md", MOCK_STAT(MOCK_DOCS_API, 1705150000LL, 1005)},
+        {"include/app.h", MOCK_STAT(MOCK_APP_H, 1705000000LL, 1006)},
+        {"include/auth.h", MOCK_STAT(MOCK_AUTH_H, 1705310000LL, 1007)},
+        {"modified-file.txt", MOCK_STAT("Line 1\nLine 2\nLine 3\n", 1705200000LL, 1008)},
+        {"new-file.txt", MOCK_STAT(MOCK_NEW_FILE, 1705314000LL, 1009)},
+        {"src/auth.c", MOCK_STAT(MOCK_AUTH_C, 1705310000LL, 1010)},
+        {"src/db/connection.c", MOCK_STAT(MOCK_CONNECTION_C, 1705070000LL, 1011)},
+        {"src/main.c", MOCK_STAT(MOCK_MAIN_C, 1705000000LL, 1012)},
+        {"src/payment.c", MOCK_STAT(MOCK_PAYMENT_C, 1705240000LL, 1013)},
+        {"src/utils.c", MOCK_STAT(MOCK_UTILS_C, 1705000000LL, 1014)},
+        {"tests/test_api.c", MOCK_STAT(MOCK_TEST_API_C, 1705000000LL, 1015)}
+    };
+    *count = 16;
+    return stats;
+}
+
+const git_worktree_file_t* get_mock_worktree_files(int *count)
+{
+    // Sorted by path. README.md is racily clean, src/utils.c was touched
+    // without being changed and modified-file.txt really differs.
+    static const git_worktree_file_t files[] = {
+        {".gitignore", MOCK_GITIGNORE, MOCK_STAT(MOCK_GITIGNORE, 1705000000LL, 1001)},
+        {".mailmap", MOCK_MAILMAP, MOCK_STAT(MOCK_MAILMAP, 1705000000LL, 1018)},
+        {"Makefile", MOCK_MAKEFILE, MOCK_STAT(MOCK_MAKEFILE, 1705000000LL, 1002)},
+        {"README.md", MOCK_README, MOCK_STAT(MOCK_README, MOCK_INDEX_TIMESTAMP, 1003)},
+        {"docs/README.md", MOCK_DOCS_README, MOCK_STAT(MOCK_DOCS_README, 1705150000LL, 1004)},
+        {"docs/api.md", MOCK_DOCS_API, MOCK_STAT(MOCK_DOCS_API, 1705150000LL, 1005)},
+        {"ignored-file.log", MOCK_IGNORED_LOG, MOCK_STAT(MOCK_IGNORED_LOG, 1705316000LL, 1016)},
+        {"include/app.h", MOCK_APP_H, MOCK_STAT(MOCK_APP_H, 1705000000LL, 1006)},
+        {"include/auth.h", MOCK_AUTH_H, MOCK_STAT(MOCK_AUTH_H, 1705310000LL, 1007)},
+        {"modified-file.txt", MOCK_MODIFIED_FILE, MOCK_STAT(MOCK_MODIFIED_FILE, 1705318000LL, 1008)},
+        {"new-file.txt", MOCK_NEW_FILE, MOCK_STAT(MOCK_NEW_FILE, 1705314000LL, 1009)},
+        {"src/auth.c", MOCK_AUTH_C, MOCK_STAT(MOCK_AUTH_C, 1705310000LL, 1010)},
+        {"src/db/connection.c", MOCK_CONNECTION_C, MOCK_STAT(MOCK_CONNECTION_C, 1705070000LL, 1011)},
+        {"src/main.c", MOCK_MAIN_C, MOCK_STAT(MOCK_MAIN_C, 1705000000LL, 1012)},
+        {"src/payment.c", MOCK_PAYMENT_C, MOCK_STAT(MOCK_PAYMENT_C, 1705240000LL, 1013)},
+        {"src/utils.c", MOCK_UTILS_C, MOCK_STAT(MOCK_UTILS_C, 1705317000LL, 1014)},
+        {"tests/test_api.c", MOCK_TEST_API_C, MOCK_STAT(MOCK_TEST_API_C, 1705000000LL, 1015)},
+        {"untracked-file.txt", MOCK_UNTRACKED_FILE, MOCK_STAT(MOCK_UNTRACKED_FILE, 1705316500LL, 1017)}
+    };
+    *count = 18;
+    return files;
+}
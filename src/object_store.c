@@ -0,0 +1,95 @@
+#include "object_store.h"
+#include <stdint.h>
+#include <string.h>
+
+#define ODB_INITIAL_CAPACITY 256
+
+static size_t oid_slot(const git_oid_t *oid, size_t capacity)
+{
+    uint64_t hash;
+    
+    // Object names are already uniformly distributed
+    memcpy(&hash, oid->id, sizeof(hash));
+    return (size_t)(hash & (capacity - 1));
+}
+
+static void odb_grow(git_odb_t *odb)
+{
+    size_t new_capacity = odb->capacity ? odb->capacity * 2 : ODB_INITIAL_CAPACITY;
+    git_object_t **slots = arena_calloc(odb->arena, new_capacity, sizeof(*slots));
+    
+    for (size_t i = 0; i < odb->capacity; i++) {
+        git_object_t *obj = odb->slots[i];
+        if (!obj)
+            continue;
+        
+        size_t slot = oid_slot(&obj->oid, new_capacity);
+        while (slots[slot])
+            slot = (slot + 1) & (new_capacity - 1);
+        slots[slot] = obj;
+    }
+    
+    odb->slots = slots;
+    odb->capacity = new_capacity;
+}
+
+git_odb_t odb_init(arena_t *arena)
+{
+    git_odb_t odb = {
+        .arena = arena,
+        .slots = NULL,
+        .capacity = 0,
+        .count = 0,
+    };
+    odb_grow(&odb);
+    return odb;
+}
+
+const char* object_type_name(git_object_type_t type)
+{
+    switch (type) {
+    case OBJ_BLOB:   return "blob";
+    case OBJ_TREE:   return "tree";
+    case OBJ_COMMIT: return "commit";
+    case OBJ_TAG:    return "tag";
+    }
+    return "unknown";
+}
+
+const git_object_t* odb_read(const git_odb_t *odb, const git_oid_t *oid)
+{
+    size_t slot = oid_slot(oid, odb->capacity);
+    
+    while (odb->slots[slot]) {
+        if (oid_cmp(&odb->slots[slot]->oid, oid) == 0)
+            return odb->slots[slot];
+        slot = (slot + 1) & (odb->capacity - 1);
+    }
+    return NULL;
+}
+
+const git_object_t* odb_write(git_odb_t *odb, git_object_type_t type, const void *data, size_t size)
+{
+    git_oid_t oid;
+    oid_hash_object(object_type_name(type), data, size, &oid);
+    
+    const git_object_t *existing = odb_read(odb, &oid);
+    if (existing)
+        return existing;
+    
+    if ((odb->count + 1) * 4 > odb->capacity * 3)
+        odb_grow(odb);
+    
+    git_object_t *obj = arena_alloc(odb->arena, sizeof(*obj));
+    obj->oid = oid;
+    obj->type = type;
+    obj->data = arena_strndup(odb->arena, data, size);
+    obj->size = size;
+    
+    size_t slot = oid_slot(&oid, odb->capacity);
+    while (odb->slots[slot])
+        slot = (slot + 1) & (odb->capacity - 1);
+    odb->slots[slot] = obj;
+    odb->count++;
+    return obj;
+}
@@ -0,0 +1,184 @@
+#include "oid.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t state[5];
+    uint64_t length;
+    unsigned char block[64];
+    size_t block_len;
+} sha1_ctx_t;
+
+static uint32_t rol32(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1_transform(sha1_ctx_t *ctx, const unsigned char *block)
+{
+    uint32_t w[80];
+    
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+               (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+    for (int i = 16; i < 80; i++)
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2];
+    uint32_t d = ctx->state[3], e = ctx->state[4];
+    
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = temp;
+    }
+    
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+}
+
+static void sha1_init(sha1_ctx_t *ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+static void sha1_update(sha1_ctx_t *ctx, const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    
+    ctx->length += len;
+    
+    if (ctx->block_len > 0) {
+        size_t take = 64 - ctx->block_len < len ? 64 - ctx->block_len : len;
+        memcpy(ctx->block + ctx->block_len, bytes, take);
+        ctx->block_len += take;
+        bytes += take;
+        len -= take;
+        if (ctx->block_len < 64)
+            return;
+        sha1_transform(ctx, ctx->block);
+        ctx->block_len = 0;
+    }
+    
+    for (; len >= 64; bytes += 64, len -= 64)
+        sha1_transform(ctx, bytes);
+    
+    memcpy(ctx->block, bytes, len);
+    ctx->block_len = len;
+}
+
+static void sha1_final(sha1_ctx_t *ctx, unsigned char *digest)
+{
+    uint64_t bit_length = ctx->length * 8;
+    unsigned char padding[72] = { 0x80 };
+    size_t pad_len = ctx->block_len < 56 ? 56 - ctx->block_len : 120 - ctx->block_len;
+    
+    for (int i = 0; i < 8; i++)
+        padding[pad_len + i] = (unsigned char)(bit_length >> (56 - 8 * i));
+    sha1_update(ctx, padding, pad_len + 8);
+    
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+void oid_hash_object(const char *type, const void *data, size_t len, git_oid_t *out)
+{
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "%s %zu", type, len);
+    sha1_ctx_t ctx;
+    
+    sha1_init(&ctx);
+    sha1_update(&ctx, header, (size_t)header_len + 1);
+    sha1_update(&ctx, data, len);
+    sha1_final(&ctx, out->id);
+}
+
+void oid_hash_buffer(const void *data, size_t len, git_oid_t *out)
+{
+    sha1_ctx_t ctx;
+    
+    sha1_init(&ctx);
+    sha1_update(&ctx, data, len);
+    sha1_final(&ctx, out->id);
+}
+
+void oid_to_hex(const git_oid_t *oid, char *out)
+{
+    static const char hex[] = "0123456789abcdef";
+    
+    for (int i = 0; i < GIT_OID_RAWSZ; i++) {
+        out[i * 2] = hex[oid->id[i] >> 4];
+        out[i * 2 + 1] = hex[oid->id[i] & 0xf];
+    }
+    out[GIT_OID_HEXSZ] = '\0';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int oid_from_hex(const char *hex, git_oid_t *out)
+{
+    for (int i = 0; i < GIT_OID_RAWSZ; i++) {
+        int high = hex_value(hex[i * 2]);
+        if (high < 0)
+            return -1;
+        int low = hex_value(hex[i * 2 + 1]);
+        if (low < 0)
+            return -1;
+        out->id[i] = (unsigned char)(high << 4 | low);
+    }
+    return 0;
+}
+
+int oid_cmp(const git_oid_t *a, const git_oid_t *b)
+{
+    return memcmp(a->id, b->id, GIT_OID_RAWSZ);
+}
+
+bool oid_is_zero(const git_oid_t *oid)
+{
+    for (int i = 0; i < GIT_OID_RAWSZ; i++) {
+        if (oid->id[i])
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,344 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel_checkout.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config_utils.h"
+#include "sparse_index.h"
+#include "tree.h"
+#include "tree_diff.h"
+
+#define CHECKOUT_DEFAULT_THRESHOLD 100
+#define CHECKOUT_MAX_WORKERS       64
+
+typedef struct {
+    parallel_checkout_t *pc;
+    atomic_size_t next;
+    long long now;
+    unsigned long first_ino;
+} checkout_shared_t;
+
+parallel_checkout_t parallel_checkout_init(git_repository_t *repo)
+{
+    parallel_checkout_t pc = {
+        .repo = repo,
+        .items = NULL,
+        .count = 0,
+        .alloc = 0,
+    };
+    return pc;
+}
+
+void parallel_checkout_add(parallel_checkout_t *pc, const char *path, const git_oid_t *oid, unsigned int mode)
+{
+    arena_t *arena = &pc->repo->ctx->arena;
+    
+    if (pc->count == pc->alloc) {
+        size_t new_alloc = pc->alloc ? pc->alloc * 2 : 64;
+        pc->items = arena_realloc(arena, pc->items, pc->alloc * sizeof(*pc->items),
+                                  new_alloc * sizeof(*pc->items));
+        pc->alloc = new_alloc;
+    }
+    
+    pc->items[pc->count++] = (checkout_item_t){
+        .path = path,
+        .oid = *oid,
+        .mode = mode,
+    };
+}
+
+static void write_item(checkout_shared_t *shared, size_t i)
+{
+    checkout_item_t *item = &shared->pc->items[i];
+    const git_worktree_file_t *existing = repo_worktree_file(shared->pc->repo, item->path);
+    
+    memcpy(item->buffer, item->blob->data, item->blob->size);
+    item->buffer[item->blob->size] = '\0';
+    item->stat = (git_stat_data_t){
+        .mtime = shared->now,
+        .ctime = shared->now,
+        .size = item->blob->size,
+        .ino = existing ? existing->stat.ino : shared->first_ino + i,
+    };
+}
+
+static void* checkout_worker(void *arg)
+{
+    checkout_shared_t *shared = arg;
+    
+    // Items are handed out one at a time so a few large blobs cannot
+    // leave the other workers idle.
+    for (;;) {
+        size_t i = atomic_fetch_add(&shared->next, 1);
+        if (i >= shared->pc->count)
+            break;
+        write_item(shared, i);
+    }
+    return NULL;
+}
+
+static int resolve_worker_count(parallel_checkout_t *pc)
+{
+    git_context_t *ctx = pc->repo->ctx;
+    int workers = config_get_int(ctx, "checkout.workers", 1);
+    int threshold = config_get_int(ctx, "checkout.thresholdForParallelism", CHECKOUT_DEFAULT_THRESHOLD);
+    
+    if (workers <= 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > CHECKOUT_MAX_WORKERS)
+        workers = CHECKOUT_MAX_WORKERS;
+    if (workers > (int)pc->count)
+        workers = (int)pc->count;
+    if ((int)pc->count < threshold || workers < 1)
+        workers = 1;
+    return workers;
+}
+
+/*
+ * Everything workers touch is prepared here: blobs are looked up, output
+ * buffers allocated and directories created parent first, so the workers
+ * never allocate or write to shared state.
+ */
+static int prepare_items(parallel_checkout_t *pc)
+{
+    git_repository_t *repo = pc->repo;
+    
+    for (size_t i = 0; i < pc->count; i++) {
+        checkout_item_t *item = &pc->items[i];
+        
+        item->blob = odb_read(&repo->odb, &item->oid);
+        if (!item->blob || item->blob->type != OBJ_BLOB) {
+            char hex[GIT_OID_HEXSZ + 1];
+            oid_to_hex(&item->oid, hex);
+            printf("error: unable to read sha1 file of %s (%s)\n", item->path, hex);
+            return -1;
+        }
+        item->buffer = arena_alloc(&repo->ctx->arena, item->blob->size + 1);
+        
+        for (const char *slash = strchr(item->path, '/'); slash; slash = strchr(slash + 1, '/'))
+            repo_worktree_mkdir(repo, item->path, (size_t)(slash - item->path));
+    }
+    return 0;
+}
+
+static void finish_items(parallel_checkout_t *pc)
+{
+    git_repository_t *repo = pc->repo;
+    
+    for (size_t i = 0; i < pc->count; i++) {
+        checkout_item_t *item = &pc->items[i];
+        repo_write_worktree_file(repo, item->path, item->buffer, &item->stat);
+        
+        long pos = index_find(&repo->index, item->path);
+        if (pos >= 0 && oid_cmp(&repo->index.entries[pos].oid, &item->oid) == 0)
+            repo->index.entries[pos].stat = item->stat;
+    }
+}
+
+int parallel_checkout_run(parallel_checkout_t *pc)
+{
+    if (pc->count == 0)
+        return 0;
+    if (prepare_items(pc) < 0)
+        return -1;
+    
+    checkout_shared_t shared = {
+        .pc = pc,
+        .now = (long long)time(NULL),
+        .first_ino = 100000,
+    };
+    atomic_init(&shared.next, 0);
+    
+    int workers = resolve_worker_count(pc);
+    pthread_t threads[CHECKOUT_MAX_WORKERS];
+    int started = 0;
+    
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, checkout_worker, &shared) != 0)
+            break;
+        started++;
+    }
+    
+    // The main thread works too, and finishes the queue alone if no
+    // thread could be started.
+    checkout_worker(&shared);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    
+    finish_items(pc);
+    return (int)pc->count;
+}
+
+/*
+ * A path the switch would touch is only safe to overwrite when both its
+ * index entry and its worktree file still match the old tree, or already
+ * match the new one. Paths outside the sparse cone have no worktree file
+ * to lose.
+ */
+static bool path_is_clean(const git_repository_t *repo, const git_diff_entry_t *change)
+{
+    const git_oid_t *old_oid = change->status == DIFF_ADDED ? NULL : &change->old_oid;
+    const git_oid_t *new_oid = change->status == DIFF_DELETED ? NULL : &change->new_oid;
+    if (sparse_index_find_dir(&repo->index, change->path) >= 0)
+        return true;
+    
+    long pos = index_find(&repo->index, change->path);
+    const git_oid_t *staged = pos >= 0 ? &repo->index.entries[pos].oid : NULL;
+    bool skipped = pos >= 0 ? repo->index.entries[pos].skip_worktree
+                            : !sparse_checkout_includes(&repo->sparse, change->path);
+    
+    if (new_oid && staged && oid_cmp(staged, new_oid) == 0 &&
+        (skipped || repo_worktree_matches(repo, change->path, new_oid)))
+        return true;
+    if (old_oid ? !staged || oid_cmp(staged, old_oid) != 0 : staged != NULL)
+        return false;
+    return skipped || repo_worktree_matches(repo, change->path, old_oid);
+}
+
+/*
+ * Point a sparse directory entry at its tree in `new_tree`, so paths
+ * outside the cone are switched without expanding the index.
+ */
+static void retarget_sparse_dir(git_repository_t *repo, long pos, const git_oid_t *new_tree)
+{
+    git_index_entry_t *entry = &repo->index.entries[pos];
+    const char *path = entry->path;
+    char *dir = arena_strndup(&repo->ctx->arena, path, strlen(path) - 1);
+    git_tree_entry_t tree_entry;
+    
+    if (tree_lookup_path(&repo->odb, new_tree, dir, &tree_entry) && tree_entry_is_dir(&tree_entry)) {
+        if (oid_cmp(&entry->oid, tree_entry.oid) != 0)
+            index_add(&repo->index, path, tree_entry.oid, GIT_MODE_DIR);
+        return;
+    }
+    index_remove(&repo->index, path);
+}
+
+/*
+ * Only a plain local modification of a file the switch modifies can be
+ * carried over with a merge; staged changes still block the switch.
+ */
+static bool path_can_merge(const git_repository_t *repo, const git_diff_entry_t *change)
+{
+    if (change->status != DIFF_MODIFIED || !repo_worktree_file(repo, change->path))
+        return false;
+    
+    long pos = index_find(&repo->index, change->path);
+    return pos >= 0 && !repo->index.entries[pos].skip_worktree &&
+           oid_cmp(&repo->index.entries[pos].oid, &change->old_oid) == 0;
+}
+
+/*
+ * Merge the local version of a file into its version in the new tree. The
+ * index takes the new version and the worktree the merge result, so the
+ * local changes, conflicted or not, show up as unstaged.
+ */
+static int merge_local_change(git_repository_t *repo, const git_diff_entry_t *change,
+                              const checkout_switch_options_t *opts, parallel_checkout_t *pc)
+{
+    const git_object_t *old_blob = odb_read(&repo->odb, &change->old_oid);
+    const git_object_t *new_blob = odb_read(&repo->odb, &change->new_oid);
+    const git_worktree_file_t *local = repo_worktree_file(repo, change->path);
+    if (!old_blob || !new_blob) {
+        printf("fatal: unable to read blob for '%s'\n", change->path);
+        return -1;
+    }
+    
+    merge_options_t merge_opts = {
+        .ancestor_label = opts->old_label,
+        .ours_label = opts->new_label,
+        .theirs_label = "local",
+        .style = opts->style,
+    };
+    merge_buffer_t base = { old_blob->data, old_blob->size };
+    merge_buffer_t ours = { new_blob->data, new_blob->size };
+    merge_buffer_t theirs = { local->content, local->stat.size };
+    strbuf_t merged = strbuf_init(&repo->ctx->arena, new_blob->size + local->stat.size / 4 + 64);
+    int conflicts = merge_file(&repo->ctx->arena, &base, &ours, &theirs, &merge_opts, &merged);
+    
+    printf("Auto-merging %s\n", change->path);
+    if (conflicts > 0)
+        printf("CONFLICT (content): Merge conflict in %s\n", change->path);
+    
+    const git_object_t *result = odb_write(&repo->odb, OBJ_BLOB, merged.buf, merged.len);
+    index_add(&repo->index, change->path, &change->new_oid, change->new_mode);
+    parallel_checkout_add(pc, change->path, &result->oid, change->new_mode);
+    return conflicts;
+}
+
+int checkout_switch_tree(git_repository_t *repo, const git_oid_t *old_tree, const git_oid_t *new_tree,
+                         const checkout_switch_options_t *opts)
+{
+    if (old_tree && oid_cmp(old_tree, new_tree) == 0)
+        return 0;
+    
+    git_diff_list_t diff = diff_list_init(&repo->ctx->arena);
+    if (tree_diff(&repo->odb, old_tree, new_tree, &diff) < 0) {
+        printf("fatal: unable to read tree\n");
+        return -1;
+    }
+    
+    bool *needs_merge = arena_calloc(&repo->ctx->arena, diff.count ? diff.count : 1, sizeof(bool));
+    if (!opts->force) {
+        size_t dirty = 0;
+        for (size_t i = 0; i < diff.count; i++) {
+            if (path_is_clean(repo, &diff.entries[i]))
+                continue;
+            if (opts->merge && path_can_merge(repo, &diff.entries[i])) {
+                needs_merge[i] = true;
+                continue;
+            }
+            if (dirty++ == 0)
+                printf("error: Your local changes to the following files would be overwritten by checkout:\n");
+            printf("\t%s\n", diff.entries[i].path);
+        }
+        if (dirty > 0) {
+            printf("Please commit your changes or stash them before you switch branches.\n");
+            printf("Aborting\n");
+            return -1;
+        }
+    }
+    
+    parallel_checkout_t pc = parallel_checkout_init(repo);
+    for (size_t i = 0; i < diff.count; i++) {
+        const git_diff_entry_t *change = &diff.entries[i];
+        
+        if (needs_merge[i]) {
+            if (merge_local_change(repo, change, opts, &pc) < 0)
+                return -1;
+            continue;
+        }
+        
+        long sparse_dir = sparse_index_find_dir(&repo->index, change->path);
+        if (sparse_dir >= 0) {
+            retarget_sparse_dir(repo, sparse_dir, new_tree);
+            continue;
+        }
+        
+        if (change->status == DIFF_DELETED) {
+            long pos = index_find(&repo->index, change->path);
+            if (pos >= 0 && !repo->index.entries[pos].skip_worktree)
+                repo_remove_worktree_file(repo, change->path);
+            index_remove(&repo->index, change->path);
+            continue;
+        }
+        
+        git_index_entry_t *entry = index_add(&repo->index, change->path, &change->new_oid, change->new_mode);
+        entry->skip_worktree = !sparse_checkout_includes(&repo->sparse, change->path);
+        if (!entry->skip_worktree)
+            parallel_checkout_add(&pc, change->path, &change->new_oid, change->new_mode);
+    }
+    
+    if (parallel_checkout_run(&pc) < 0)
+        return -1;
+    
+    // Directories added outside the cone arrived as separate entries
+    if (repo->index.sparse)
+        sparse_index_convert(&repo->index, &repo->odb, &repo->sparse);
+    return (int)diff.count;
+}
@@ -0,0 +1,516 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "refs.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "reftable.h"
+#include "strbuf.h"
+
+// "<hex> " comes before the name on a record's first line
+#define RECORD_NAME_OFFSET (GIT_OID_HEXSZ + 1)
+
+typedef struct {
+    const char *start;
+    size_t len;
+} packed_record_t;
+
+static const char* line_end(const char *p, const char *end)
+{
+    const char *eol = memchr(p, '\n', (size_t)(end - p));
+    return eol ? eol : end;
+}
+
+static const char* next_line(const char *p, const char *end)
+{
+    const char *eol = line_end(p, end);
+    return eol < end ? eol + 1 : end;
+}
+
+/* The start of the record holding `p`, which may be in its peeled line. */
+static const char* record_start(const packed_refs_t *packed, const char *p)
+{
+    while (p > packed->data && p[-1] != '\n')
+        p--;
+    if (*p == '^' && p > packed->data) {
+        p--;
+        while (p > packed->data && p[-1] != '\n')
+            p--;
+    }
+    return p;
+}
+
+static const char* record_next(const packed_refs_t *packed, const char *record)
+{
+    const char *next = next_line(record, packed->end);
+    return next < packed->end && *next == '^' ? next_line(next, packed->end) : next;
+}
+
+// A malformed record has an empty name, which sorts it first and matches no lookup
+static const char* record_name(const packed_refs_t *packed, const char *record, size_t *len)
+{
+    const char *eol = line_end(record, packed->end);
+    if (eol - record <= RECORD_NAME_OFFSET || record[GIT_OID_HEXSZ] != ' ') {
+        *len = 0;
+        return record;
+    }
+    *len = (size_t)(eol - record) - RECORD_NAME_OFFSET;
+    return record + RECORD_NAME_OFFSET;
+}
+
+static void record_parse(const packed_refs_t *packed, const char *record, git_ref_t *out)
+{
+    const char *peeled = next_line(record, packed->end);
+    
+    memset(out, 0, sizeof(*out));
+    out->name = record_name(packed, record, &out->name_len);
+    if (out->name_len > 0)
+        oid_from_hex(record, &out->oid);
+    if (peeled < packed->end && *peeled == '^' && packed->end - peeled > GIT_OID_HEXSZ)
+        oid_from_hex(peeled + 1, &out->peeled);
+}
+
+static int compare_names(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0)
+        return cmp;
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+/*
+ * The first record named `key` or after it. The middle of a range can
+ * fall anywhere in a record, so each probe backs up to the start of the
+ * line, and past a peeled line to the ref it belongs to.
+ */
+static const char* packed_lower_bound(const packed_refs_t *packed, const char *key, size_t key_len)
+{
+    const char *lo = packed->data, *hi = packed->end;
+    
+    while (lo < hi) {
+        const char *record = record_start(packed, lo + (hi - lo) / 2);
+        size_t name_len;
+        const char *name = record_name(packed, record, &name_len);
+        if (compare_names(name, name_len, key, key_len) < 0)
+            lo = record_next(packed, record);
+        else
+            hi = record;
+    }
+    return lo;
+}
+
+// Whether the header line, up to `eol`, lists the "sorted" trait
+static bool header_is_sorted(const char *header, const char *eol)
+{
+    static const char trait[] = " sorted";
+    size_t len = sizeof(trait) - 1;
+    
+    for (const char *p = header; p + len <= eol; p++) {
+        if (memcmp(p, trait, len) == 0 && (p + len == eol || p[len] == ' '))
+            return true;
+    }
+    return false;
+}
+
+static int compare_records(const void *a, const void *b)
+{
+    const packed_record_t *x = a, *y = b;
+    size_t x_len = x->len, y_len = y->len;
+    const char *x_eol = memchr(x->start, '\n', x_len), *y_eol = memchr(y->start, '\n', y_len);
+    
+    x_len = (size_t)((x_eol ? x_eol : x->start + x_len) - x->start);
+    y_len = (size_t)((y_eol ? y_eol : y->start + y_len) - y->start);
+    return compare_names(x->start + RECORD_NAME_OFFSET, x_len > RECORD_NAME_OFFSET ? x_len - RECORD_NAME_OFFSET : 0,
+                         y->start + RECORD_NAME_OFFSET, y_len > RECORD_NAME_OFFSET ? y_len - RECORD_NAME_OFFSET : 0);
+}
+
+/* Copy unsorted records into `arena` in name order, each ending in a newline. */
+static void sort_records(packed_refs_t *packed, arena_t *arena)
+{
+    size_t count = 0, alloc = 64;
+    packed_record_t *records = arena_alloc(arena, alloc * sizeof(*records));
+    
+    for (const char *p = packed->data; p < packed->end; p = record_next(packed, p)) {
+        if (count == alloc) {
+            records = arena_realloc(arena, records, alloc * sizeof(*records), 2 * alloc * sizeof(*records));
+            alloc *= 2;
+        }
+        records[count++] = (packed_record_t){ p, (size_t)(record_next(packed, p) - p) };
+    }
+    qsort(records, count, sizeof(*records), compare_records);
+    
+    strbuf_t sorted = strbuf_init(arena, (size_t)(packed->end - packed->data) + 1);
+    for (size_t i = 0; i < count; i++) {
+        strbuf_add(&sorted, records[i].start, records[i].len);
+        if (sorted.buf[sorted.len - 1] != '\n')
+            strbuf_addch(&sorted, '\n');
+    }
+    packed->data = sorted.buf;
+    packed->end = sorted.buf + sorted.len;
+}
+
+static void packed_refs_load(packed_refs_t *packed, const char *data, size_t size, arena_t *arena)
+{
+    const char *end = data + size;
+    bool sorted = false;
+    
+    if (size > 0 && *data == '#') {
+        const char *eol = line_end(data, end);
+        sorted = header_is_sorted(data, eol);
+        data = eol < end ? eol + 1 : end;
+    }
+    packed->data = data;
+    packed->end = end;
+    if (!sorted && data < end)
+        sort_records(packed, arena);
+}
+
+int packed_refs_open(packed_refs_t *packed, const char *path, arena_t *arena)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    memset(packed, 0, sizeof(*packed));
+    if (st.st_size > 0) {
+        size_t size = (size_t)st.st_size;
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        packed->map = map;
+        packed->map_size = size;
+        packed_refs_load(packed, map, size, arena);
+    }
+    
+    close(fd);
+    return 0;
+}
+
+void packed_refs_from_buffer(packed_refs_t *packed, const char *data, size_t size, arena_t *arena)
+{
+    memset(packed, 0, sizeof(*packed));
+    packed_refs_load(packed, data, size, arena);
+}
+
+void packed_refs_close(packed_refs_t *packed)
+{
+    if (packed->map)
+        munmap(packed->map, packed->map_size);
+    memset(packed, 0, sizeof(*packed));
+}
+
+ref_store_t ref_store_init(arena_t *arena)
+{
+    ref_store_t store = { .arena = arena };
+    return store;
+}
+
+static int compare_loose(const void *a, const void *b)
+{
+    return strcmp(((const loose_ref_t *)a)->ref.name, ((const loose_ref_t *)b)->ref.name);
+}
+
+static loose_ref_t* loose_push(ref_store_t *store)
+{
+    if (store->loose_count == store->loose_alloc) {
+        size_t alloc = store->loose_alloc ? store->loose_alloc * 2 : 16;
+        store->loose = arena_realloc(store->arena, store->loose, store->loose_alloc * sizeof(*store->loose),
+                                     alloc * sizeof(*store->loose));
+        store->loose_alloc = alloc;
+    }
+    return &store->loose[store->loose_count++];
+}
+
+// A file holding anything but an object name, as a symbolic ref does, is passed over
+static int read_loose_file(ref_store_t *store, const char *path, const strbuf_t *name)
+{
+    char hex[GIT_OID_HEXSZ + 1];
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    
+    size_t len = fread(hex, 1, GIT_OID_HEXSZ, file);
+    fclose(file);
+    hex[len] = '\0';
+    
+    git_oid_t oid;
+    if (len < GIT_OID_HEXSZ || oid_from_hex(hex, &oid) < 0)
+        return 0;
+    
+    loose_ref_t *loose = loose_push(store);
+    memset(loose, 0, sizeof(*loose));
+    loose->ref.name = arena_strndup(store->arena, name->buf, name->len);
+    loose->ref.name_len = name->len;
+    loose->ref.oid = oid;
+    return 0;
+}
+
+static int read_loose_dir(ref_store_t *store, strbuf_t *path, strbuf_t *name)
+{
+    DIR *dir = opendir(path->buf);
+    if (!dir)
+        return errno == ENOENT ? 0 : -1;
+    
+    size_t path_len = path->len, name_len = name->len;
+    struct dirent *entry;
+    int status = 0;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        struct stat st;
+        if (entry->d_name[0] == '.')
+            continue;
+        
+        strbuf_addch(path, '/');
+        strbuf_addstr(path, entry->d_name);
+        strbuf_addch(name, '/');
+        strbuf_addstr(name, entry->d_name);
+        if (stat(path->buf, &st) < 0)
+            status = -1;
+        else if (S_ISDIR(st.st_mode))
+            status = read_loose_dir(store, path, name);
+        else if (S_ISREG(st.st_mode))
+            status = read_loose_file(store, path->buf, name);
+        
+        path->len = path_len;
+        path->buf[path_len] = '\0';
+        name->len = name_len;
+        name->buf[name_len] = '\0';
+    }
+    closedir(dir);
+    return status;
+}
+
+int ref_store_open(ref_store_t *store, const char *git_dir, const reftable_options_t *options)
+{
+    strbuf_t path = strbuf_init(store->arena, 256);
+    strbuf_t name = strbuf_init(store->arena, 256);
+    struct stat st;
+    
+    strbuf_addf(&path, "%s/reftable/tables.list", git_dir);
+    if (stat(path.buf, &st) == 0) {
+        strbuf_reset(&path);
+        strbuf_addf(&path, "%s/reftable", git_dir);
+        return reftable_stack_open(&store->reftable, path.buf, options, store->arena);
+    }
+    
+    strbuf_reset(&path);
+    strbuf_addf(&path, "%s/packed-refs", git_dir);
+    if (packed_refs_open(&store->packed, path.buf, store->arena) < 0 && errno != ENOENT)
+        return -1;
+    
+    strbuf_reset(&path);
+    strbuf_addf(&path, "%s/refs", git_dir);
+    strbuf_addstr(&name, "refs");
+    if (read_loose_dir(store, &path, &name) < 0)
+        return -1;
+    
+    // Read in directory order, then sorted once
+    if (store->loose_count > 1)
+        qsort(store->loose, store->loose_count, sizeof(*store->loose), compare_loose);
+    return 0;
+}
+
+void ref_store_close(ref_store_t *store)
+{
+    packed_refs_close(&store->packed);
+    if (store->reftable)
+        reftable_stack_close(store->reftable);
+}
+
+/* The first loose ref named `key` or after it. */
+static size_t loose_lower_bound(const ref_store_t *store, const char *key, size_t key_len)
+{
+    size_t lo = 0, hi = store->loose_count;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const git_ref_t *ref = &store->loose[mid].ref;
+        if (compare_names(ref->name, ref->name_len, key, key_len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static const loose_ref_t* loose_find(const ref_store_t *store, const char *name, size_t len)
+{
+    size_t at = loose_lower_bound(store, name, len);
+    if (at < store->loose_count && compare_names(store->loose[at].ref.name, store->loose[at].ref.name_len,
+                                                 name, len) == 0)
+        return &store->loose[at];
+    return NULL;
+}
+
+bool ref_store_lookup(const ref_store_t *store, const char *name, git_ref_t *out)
+{
+    if (store->reftable)
+        return reftable_stack_lookup(store->reftable, name, out);
+    
+    size_t len = strlen(name);
+    const loose_ref_t *loose = loose_find(store, name, len);
+    
+    if (loose) {
+        *out = loose->ref;
+        return !loose->deleted;
+    }
+    
+    const char *record = packed_lower_bound(&store->packed, name, len);
+    if (record == store->packed.end)
+        return false;
+    record_parse(&store->packed, record, out);
+    return compare_names(out->name, out->name_len, name, len) == 0;
+}
+
+/* The loose ref `name`, inserted in order if it is not there yet. */
+static loose_ref_t* loose_entry(ref_store_t *store, const char *name)
+{
+    size_t len = strlen(name);
+    size_t at = loose_lower_bound(store, name, len);
+    
+    if (at < store->loose_count && strcmp(store->loose[at].ref.name, name) == 0)
+        return &store->loose[at];
+    
+    loose_push(store);
+    memmove(&store->loose[at + 1], &store->loose[at], (store->loose_count - 1 - at) * sizeof(*store->loose));
+    memset(&store->loose[at], 0, sizeof(store->loose[at]));
+    store->loose[at].ref.name = arena_strndup(store->arena, name, len);
+    store->loose[at].ref.name_len = len;
+    return &store->loose[at];
+}
+
+// The files backend keeps its updates in memory, as loose refs over packed-refs
+int ref_store_commit(ref_store_t *store, const ref_update_t *updates, size_t count)
+{
+    if (store->reftable)
+        return reftable_stack_add(store->reftable, updates, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        loose_ref_t *loose = loose_entry(store, updates[i].name);
+        loose->ref.oid = updates[i].oid;
+        loose->ref.peeled = updates[i].peeled;
+        loose->deleted = updates[i].deleted;
+    }
+    return 0;
+}
+
+int ref_store_update(ref_store_t *store, const char *name, const git_oid_t *oid, const git_oid_t *peeled)
+{
+    ref_update_t update = { .name = name, .oid = *oid };
+    
+    if (peeled)
+        update.peeled = *peeled;
+    return ref_store_commit(store, &update, 1);
+}
+
+int ref_store_delete(ref_store_t *store, const char *name)
+{
+    ref_update_t update = { .name = name, .deleted = true };
+    return ref_store_commit(store, &update, 1);
+}
+
+ref_iter_t ref_store_iter(const ref_store_t *store, const char *prefix)
+{
+    size_t len = strlen(prefix);
+    ref_iter_t iter = {
+        .store = store,
+        .prefix = prefix,
+        .prefix_len = len,
+        .packed = packed_lower_bound(&store->packed, prefix, len),
+        .loose = loose_lower_bound(store, prefix, len),
+    };
+    
+    if (store->reftable)
+        iter.reftable = reftable_stack_iter(store->reftable, prefix);
+    return iter;
+}
+
+bool ref_iter_next(ref_iter_t *iter, git_ref_t *out)
+{
+    const ref_store_t *store = iter->store;
+    const packed_refs_t *packed = &store->packed;
+    
+    if (iter->reftable)
+        return reftable_iter_next(iter->reftable, out);
+    
+    for (;;) {
+        git_ref_t from_packed;
+        const loose_ref_t *loose = NULL;
+        bool has_packed = false;
+        
+        if (iter->packed < packed->end) {
+            record_parse(packed, iter->packed, &from_packed);
+            has_packed = from_packed.name_len >= iter->prefix_len &&
+                         memcmp(from_packed.name, iter->prefix, iter->prefix_len) == 0;
+        }
+        if (iter->loose < store->loose_count && strncmp(store->loose[iter->loose].ref.name, iter->prefix,
+                                                        iter->prefix_len) == 0)
+            loose = &store->loose[iter->loose];
+        if (!has_packed && !loose)
+            return false;
+        
+        int cmp = !loose ? -1 : !has_packed ? 1 : compare_names(from_packed.name, from_packed.name_len,
+                                                                loose->ref.name, loose->ref.name_len);
+        if (cmp <= 0)
+            iter->packed = record_next(packed, iter->packed);
+        if (cmp < 0) {
+            *out = from_packed;
+            return true;
+        }
+        
+        // A loose ref stands in for the packed one of the same name
+        iter->loose++;
+        if (!loose->deleted) {
+            *out = loose->ref;
+            return true;
+        }
+    }
+}
+
+size_t ref_store_count(const ref_store_t *store, const char *prefix)
+{
+    ref_iter_t iter = ref_store_iter(store, prefix);
+    git_ref_t ref;
+    size_t count = 0;
+    
+    while (ref_iter_next(&iter, &ref))
+        count++;
+    return count;
+}
+
+size_t ref_store_refs_at(const ref_store_t *store, const git_oid_t *oid, git_ref_t **out)
+{
+    if (store->reftable)
+        return reftable_stack_refs_at(store->reftable, oid, out);
+    
+    ref_iter_t iter = ref_store_iter(store, "");
+    git_ref_t ref, *refs = NULL;
+    size_t count = 0, alloc = 0;
+    
+    while (ref_iter_next(&iter, &ref)) {
+        if (oid_cmp(&ref.oid, oid) != 0 && oid_cmp(&ref.peeled, oid) != 0)
+            continue;
+        if (count == alloc) {
+            size_t grown = alloc ? alloc * 2 : 16;
+            refs = arena_realloc(store->arena, refs, alloc * sizeof(*refs), grown * sizeof(*refs));
+            alloc = grown;
+        }
+        refs[count++] = ref;
+    }
+    *out = refs;
+    return count;
+}
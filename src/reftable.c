@@ -0,0 +1,1204 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "reftable.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "strbuf.h"
+
+// "REFT", the version, the block size and the range of update indices
+#define HEADER_SIZE 24
+// The header again, five section offsets and a CRC-32
+#define FOOTER_SIZE 68
+#define FORMAT_VERSION 1
+
+// The longest name a record may carry, so a cursor can hold any whole
+#define MAX_KEY_LEN 4096
+// What a block length and the restart offsets in it can address
+#define MAX_BLOCK_SIZE ((1u << 24) - 1)
+
+#define BLOCK_REF 'r'
+#define BLOCK_OBJ 'o'
+#define BLOCK_INDEX 'i'
+
+// What a ref record holds, in the low three bits after its suffix length
+#define VALUE_DELETION 0
+#define VALUE_OID 1
+#define VALUE_PEELED 2
+#define VALUE_SYMREF 3
+
+static void put_be(strbuf_t *sb, uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        strbuf_addch(sb, (char)((value >> (8 * i)) & 0xff));
+}
+
+static void set_be(char *p, uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        *p++ = (char)((value >> (8 * i)) & 0xff);
+}
+
+static uint64_t get_be(const unsigned char *p, int bytes)
+{
+    uint64_t value = 0;
+    
+    for (int i = 0; i < bytes; i++)
+        value = value << 8 | p[i];
+    return value;
+}
+
+/*
+ * Varints as in git's offset deltas: seven bits a byte, most significant
+ * first, and each continuation byte counting one more, so that every
+ * value has a single encoding.
+ */
+static void put_varint(strbuf_t *sb, uint64_t value)
+{
+    unsigned char buf[10];
+    size_t pos = sizeof(buf) - 1;
+    
+    buf[pos] = value & 127;
+    while (value >>= 7)
+        buf[--pos] = (unsigned char)(128 | (--value & 127));
+    strbuf_add(sb, (const char *)buf + pos, sizeof(buf) - pos);
+}
+
+static bool get_varint(const unsigned char **p, const unsigned char *end, uint64_t *out)
+{
+    const unsigned char *q = *p;
+    if (q >= end)
+        return false;
+    
+    unsigned char c = *q++;
+    uint64_t value = c & 127;
+    while (c & 128) {
+        if (q >= end || value >= (UINT64_MAX >> 7))
+            return false;
+        c = *q++;
+        value = ((value + 1) << 7) | (c & 127);
+    }
+    *out = value;
+    *p = q;
+    return true;
+}
+
+static uint32_t crc32(const unsigned char *data, size_t len)
+{
+    uint32_t crc = 0xffffffffu;
+    
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static int compare_keys(const unsigned char *a, size_t a_len, const unsigned char *b, size_t b_len)
+{
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0)
+        return cmp;
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+typedef struct {
+    const unsigned char *key;
+    size_t key_len;
+    uint64_t position;
+} index_entry_t;
+
+/*
+ * Records go into blocks of one type until the next would overflow the
+ * block size, with a restart every `restart_interval` records. Each
+ * finished block leaves its last key and position in `index`.
+ */
+typedef struct {
+    strbuf_t *out;
+    const reftable_options_t *options;
+    arena_t *arena;
+    char type;
+    bool open;
+    size_t start;
+    size_t *restarts;
+    size_t restart_count;
+    size_t restart_alloc;
+    size_t since_restart;
+    const unsigned char *last_key;
+    size_t last_key_len;
+    index_entry_t *index;
+    size_t index_count;
+    size_t index_alloc;
+    strbuf_t record;
+} block_writer_t;
+
+static void block_writer_init(block_writer_t *bw, strbuf_t *out, const reftable_options_t *options, arena_t *arena,
+                              char type)
+{
+    memset(bw, 0, sizeof(*bw));
+    bw->out = out;
+    bw->options = options;
+    bw->arena = arena;
+    bw->type = type;
+    bw->record = strbuf_init(arena, 64);
+}
+
+// The first block of a table starts at the file header, and counts it in its length
+static size_t block_type_offset(size_t start)
+{
+    return start == 0 ? HEADER_SIZE : start;
+}
+
+static void block_begin(block_writer_t *bw)
+{
+    bw->start = bw->out->len == HEADER_SIZE ? 0 : bw->out->len;
+    strbuf_addch(bw->out, bw->type);
+    put_be(bw->out, 0, 3);
+    bw->restart_count = 0;
+    bw->since_restart = 0;
+    bw->open = true;
+}
+
+static void block_finish(block_writer_t *bw)
+{
+    if (!bw->open)
+        return;
+    
+    for (size_t i = 0; i < bw->restart_count; i++)
+        put_be(bw->out, bw->restarts[i], 3);
+    put_be(bw->out, bw->restart_count, 2);
+    set_be(bw->out->buf + block_type_offset(bw->start) + 1, bw->out->len - bw->start, 3);
+    
+    if (bw->index_count == bw->index_alloc) {
+        size_t alloc = bw->index_alloc ? bw->index_alloc * 2 : 16;
+        bw->index = arena_realloc(bw->arena, bw->index, bw->index_alloc * sizeof(*bw->index),
+                                  alloc * sizeof(*bw->index));
+        bw->index_alloc = alloc;
+    }
+    bw->index[bw->index_count++] = (index_entry_t){ bw->last_key, bw->last_key_len, bw->start };
+    bw->open = false;
+}
+
+static void encode_record(block_writer_t *bw, bool restart, const unsigned char *key, size_t key_len, int extra,
+                          const strbuf_t *value)
+{
+    size_t prefix = 0;
+    
+    if (!restart) {
+        size_t max = key_len < bw->last_key_len ? key_len : bw->last_key_len;
+        while (prefix < max && key[prefix] == bw->last_key[prefix])
+            prefix++;
+    }
+    strbuf_reset(&bw->record);
+    put_varint(&bw->record, prefix);
+    put_varint(&bw->record, (uint64_t)(key_len - prefix) << 3 | (uint64_t)extra);
+    strbuf_add(&bw->record, (const char *)key + prefix, key_len - prefix);
+    strbuf_add(&bw->record, value->buf, value->len);
+}
+
+/*
+ * Add a record, keys in ascending order, and return the position of the
+ * block it went into. `key` must outlive the writer.
+ */
+static size_t block_add(block_writer_t *bw, const unsigned char *key, size_t key_len, int extra,
+                        const strbuf_t *value)
+{
+    bool restart;
+    
+    for (;;) {
+        if (!bw->open)
+            block_begin(bw);
+        restart = bw->since_restart == 0 || bw->since_restart >= (size_t)bw->options->restart_interval;
+        encode_record(bw, restart, key, key_len, extra, value);
+        
+        // A record bigger than a block gets a block to itself
+        size_t used = bw->out->len - bw->start + bw->record.len + 3 * (bw->restart_count + restart) + 2;
+        if ((used <= bw->options->block_size && bw->restart_count + restart <= 0xffff) || bw->restart_count == 0)
+            break;
+        block_finish(bw);
+    }
+    
+    if (restart) {
+        if (bw->restart_count == bw->restart_alloc) {
+            size_t alloc = bw->restart_alloc ? bw->restart_alloc * 2 : 16;
+            bw->restarts = arena_realloc(bw->arena, bw->restarts, bw->restart_alloc * sizeof(*bw->restarts),
+                                         alloc * sizeof(*bw->restarts));
+            bw->restart_alloc = alloc;
+        }
+        bw->restarts[bw->restart_count++] = bw->out->len - bw->start;
+        bw->since_restart = 0;
+    }
+    strbuf_add(bw->out, bw->record.buf, bw->record.len);
+    bw->since_restart++;
+    bw->last_key = key;
+    bw->last_key_len = key_len;
+    return bw->start;
+}
+
+/*
+ * Index `entries`, the blocks of a section, with a level of index blocks,
+ * and those with another level while there is more than one. Returns the
+ * position of the top block.
+ */
+static uint64_t write_index(strbuf_t *out, const reftable_options_t *options, arena_t *arena,
+                            const index_entry_t *entries, size_t count)
+{
+    strbuf_t value = strbuf_init(arena, 16);
+    
+    for (;;) {
+        block_writer_t bw;
+        block_writer_init(&bw, out, options, arena, BLOCK_INDEX);
+        for (size_t i = 0; i < count; i++) {
+            strbuf_reset(&value);
+            put_varint(&value, entries[i].position);
+            block_add(&bw, entries[i].key, entries[i].key_len, 0, &value);
+        }
+        block_finish(&bw);
+        
+        if (bw.index_count == 1)
+            return bw.index[0].position;
+        entries = bw.index;
+        count = bw.index_count;
+    }
+}
+
+typedef struct {
+    const char *name;
+    size_t name_len;
+    int type;
+    git_oid_t oid;
+    git_oid_t peeled;
+    uint64_t update_index;
+} ref_record_t;
+
+typedef struct {
+    git_oid_t oid;
+    uint64_t position;
+} obj_ref_t;
+
+static int compare_obj_refs(const void *a, const void *b)
+{
+    const obj_ref_t *x = a, *y = b;
+    int cmp = oid_cmp(&x->oid, &y->oid);
+    
+    if (cmp != 0)
+        return cmp;
+    return x->position < y->position ? -1 : x->position > y->position;
+}
+
+/* The fewest leading bytes that tell the distinct object names of `objs` apart, at least two. */
+static int unique_prefix_len(const obj_ref_t *objs, size_t count)
+{
+    int len = 2;
+    
+    for (size_t i = 1; i < count; i++) {
+        int common = 0;
+        while (common < GIT_OID_RAWSZ && objs[i - 1].oid.id[common] == objs[i].oid.id[common])
+            common++;
+        if (common < GIT_OID_RAWSZ && common + 1 > len)
+            len = common + 1;
+    }
+    return len;
+}
+
+/*
+ * The object index: for each object a ref points at, the positions of
+ * the ref blocks naming it, keyed by as much of the object name as tells
+ * it from the others. Returns the position of its first block.
+ */
+static uint64_t write_obj_section(strbuf_t *out, const reftable_options_t *options, arena_t *arena,
+                                  obj_ref_t *objs, size_t count, int *id_len, uint64_t *index_position)
+{
+    strbuf_t value = strbuf_init(arena, 64);
+    block_writer_t bw;
+    
+    qsort(objs, count, sizeof(*objs), compare_obj_refs);
+    *id_len = unique_prefix_len(objs, count);
+    block_writer_init(&bw, out, options, arena, BLOCK_OBJ);
+    
+    for (size_t i = 0, next; i < count; i = next) {
+        size_t positions = 0;
+        
+        for (next = i; next < count && oid_cmp(&objs[next].oid, &objs[i].oid) == 0; next++)
+            positions += next == i || objs[next].position != objs[next - 1].position;
+        
+        strbuf_reset(&value);
+        if (positions > 7)
+            put_varint(&value, positions);
+        for (size_t j = i; j < next; j++) {
+            if (j == i)
+                put_varint(&value, objs[j].position);
+            else if (objs[j].position != objs[j - 1].position)
+                put_varint(&value, objs[j].position - objs[j - 1].position);
+        }
+        block_add(&bw, objs[i].oid.id, (size_t)*id_len, positions > 7 ? 0 : (int)positions, &value);
+    }
+    block_finish(&bw);
+    
+    *index_position = bw.index_count > 1 ? write_index(out, options, arena, bw.index, bw.index_count) : 0;
+    return bw.index[0].position;
+}
+
+/*
+ * A whole table of `records`, sorted by name: the ref blocks, their index
+ * if there is more than one, and then the object index, which a single
+ * block is as quick to scan as to look up in.
+ */
+static void write_table(strbuf_t *out, const reftable_options_t *options, arena_t *arena,
+                        const ref_record_t *records, size_t count, uint64_t min_index, uint64_t max_index)
+{
+    strbuf_t value = strbuf_init(arena, 64);
+    obj_ref_t *objs = arena_alloc(arena, (2 * count + 1) * sizeof(*objs));
+    size_t obj_count = 0;
+    uint64_t ref_index_position = 0, obj_position = 0, obj_index_position = 0;
+    int obj_id_len = 0;
+    block_writer_t bw;
+    
+    strbuf_add(out, "REFT", 4);
+    put_be(out, FORMAT_VERSION, 1);
+    put_be(out, options->block_size, 3);
+    put_be(out, min_index, 8);
+    put_be(out, max_index, 8);
+    
+    block_writer_init(&bw, out, options, arena, BLOCK_REF);
+    for (size_t i = 0; i < count; i++) {
+        const ref_record_t *record = &records[i];
+        
+        strbuf_reset(&value);
+        put_varint(&value, record->update_index - min_index);
+        if (record->type != VALUE_DELETION)
+            strbuf_add(&value, (const char *)record->oid.id, GIT_OID_RAWSZ);
+        if (record->type == VALUE_PEELED)
+            strbuf_add(&value, (const char *)record->peeled.id, GIT_OID_RAWSZ);
+        
+        size_t position = block_add(&bw, (const unsigned char *)record->name, record->name_len, record->type, &value);
+        if (record->type != VALUE_DELETION)
+            objs[obj_count++] = (obj_ref_t){ record->oid, position };
+        if (record->type == VALUE_PEELED)
+            objs[obj_count++] = (obj_ref_t){ record->peeled, position };
+    }
+    block_finish(&bw);
+    
+    if (bw.index_count > 1)
+        ref_index_position = write_index(out, options, arena, bw.index, bw.index_count);
+    if (bw.index_count > 1 && obj_count > 0)
+        obj_position = write_obj_section(out, options, arena, objs, obj_count, &obj_id_len, &obj_index_position);
+    
+    size_t footer = out->len;
+    strbuf_add(out, out->buf, HEADER_SIZE);
+    put_be(out, ref_index_position, 8);
+    put_be(out, obj_position << 5 | (uint64_t)obj_id_len, 8);
+    put_be(out, obj_index_position, 8);
+    put_be(out, 0, 8);
+    put_be(out, 0, 8);
+    put_be(out, crc32((const unsigned char *)out->buf + footer, out->len - footer), 4);
+}
+
+typedef struct {
+    uint64_t start;
+    size_t first;
+    size_t restarts;
+    size_t restart_count;
+    size_t end;
+    char type;
+} block_t;
+
+static bool block_read(const reftable_table_t *table, uint64_t position, block_t *block)
+{
+    size_t at = block_type_offset((size_t)position);
+    if (position >= table->footer || at + 6 > table->footer)
+        return false;
+    
+    const unsigned char *p = table->data + at;
+    block->type = (char)p[0];
+    block->start = position;
+    block->first = at + 4;
+    block->end = (size_t)position + (size_t)get_be(p + 1, 3);
+    if (block->end > table->footer || block->end < block->first + 2)
+        return false;
+    
+    block->restart_count = (size_t)get_be(table->data + block->end - 2, 2);
+    if (block->restart_count == 0 || 3 * block->restart_count > block->end - 2 - block->first)
+        return false;
+    block->restarts = block->end - 2 - 3 * block->restart_count;
+    return true;
+}
+
+/*
+ * A position in the records of one section of a table. Keys are prefix
+ * compressed, so the cursor rebuilds each from the one before it. The
+ * value fields that are set depend on the type of the block.
+ */
+typedef struct {
+    const reftable_table_t *table;
+    block_t block;
+    size_t next;
+    bool valid;
+    unsigned char key[MAX_KEY_LEN];
+    size_t key_len;
+    int extra;
+    uint64_t update_index;
+    git_oid_t oid;
+    git_oid_t peeled;
+    uint64_t position;
+    const unsigned char *positions;
+    uint64_t position_count;
+} cursor_t;
+
+/* Read the record at `next`, its key built on that of the record before. */
+static bool cursor_decode(cursor_t *c)
+{
+    const unsigned char *data = c->table->data;
+    const unsigned char *p = data + c->next, *end = data + c->block.restarts;
+    uint64_t prefix, suffix_type, value;
+    
+    if (!get_varint(&p, end, &prefix) || !get_varint(&p, end, &suffix_type))
+        return false;
+    
+    uint64_t suffix = suffix_type >> 3;
+    if (prefix > c->key_len || suffix > (uint64_t)(end - p) || prefix + suffix > MAX_KEY_LEN)
+        return false;
+    memcpy(c->key + prefix, p, (size_t)suffix);
+    c->key_len = (size_t)(prefix + suffix);
+    c->extra = (int)(suffix_type & 7);
+    p += suffix;
+    
+    switch (c->block.type) {
+        case BLOCK_REF:
+            if (!get_varint(&p, end, &value))
+                return false;
+            c->update_index = c->table->min_update_index + value;
+            memset(&c->oid, 0, sizeof(c->oid));
+            memset(&c->peeled, 0, sizeof(c->peeled));
+            if (c->extra == VALUE_OID || c->extra == VALUE_PEELED) {
+                size_t len = (size_t)c->extra * GIT_OID_RAWSZ;
+                if ((size_t)(end - p) < len)
+                    return false;
+                memcpy(c->oid.id, p, GIT_OID_RAWSZ);
+                if (c->extra == VALUE_PEELED)
+                    memcpy(c->peeled.id, p + GIT_OID_RAWSZ, GIT_OID_RAWSZ);
+                p += len;
+            } else if (c->extra == VALUE_SYMREF) {
+                if (!get_varint(&p, end, &value) || value > (uint64_t)(end - p))
+                    return false;
+                p += value;
+            } else if (c->extra != VALUE_DELETION) {
+                return false;
+            }
+            break;
+        case BLOCK_INDEX:
+            if (!get_varint(&p, end, &c->position))
+                return false;
+            break;
+        case BLOCK_OBJ:
+            c->position_count = (uint64_t)c->extra;
+            if (c->extra == 0 && !get_varint(&p, end, &c->position_count))
+                return false;
+            c->positions = p;
+            for (uint64_t i = 0; i < c->position_count; i++) {
+                if (!get_varint(&p, end, &value))
+                    return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    
+    c->next = (size_t)(p - data);
+    return true;
+}
+
+/* On to the next record, in the next block of the section at the end of this one. */
+static bool cursor_next(cursor_t *c)
+{
+    if (!c->valid)
+        return false;
+    
+    if (c->next >= c->block.restarts) {
+        block_t next;
+        if (!block_read(c->table, c->block.end, &next) || next.type != c->block.type)
+            return c->valid = false;
+        c->block = next;
+        c->next = next.first;
+        c->key_len = 0;
+    }
+    return c->valid = cursor_decode(c);
+}
+
+static size_t restart_offset(const cursor_t *c, size_t i)
+{
+    size_t offset = (size_t)c->block.start + (size_t)get_be(c->table->data + c->block.restarts + 3 * i, 3);
+    return offset >= c->block.first && offset < c->block.restarts ? offset : c->block.first;
+}
+
+/* How the key of restart `i`, which a restart record spells out whole, compares with `key`. */
+static int restart_compare(const cursor_t *c, size_t i, const unsigned char *key, size_t key_len)
+{
+    const unsigned char *p = c->table->data + restart_offset(c, i), *end = c->table->data + c->block.restarts;
+    uint64_t prefix, suffix_type;
+    
+    if (!get_varint(&p, end, &prefix) || !get_varint(&p, end, &suffix_type) || prefix != 0 ||
+        (suffix_type >> 3) > (uint64_t)(end - p))
+        return 1;
+    return compare_keys(p, (size_t)(suffix_type >> 3), key, key_len);
+}
+
+/*
+ * Move to the first record of the block at or after `key`: bisect the
+ * restarts for the last at or before it, and read on from there. Returns
+ * false with the cursor still valid if every key in the block is less.
+ */
+static bool cursor_seek_block(cursor_t *c, const unsigned char *key, size_t key_len)
+{
+    size_t lo = 0, hi = c->block.restart_count;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (restart_compare(c, mid, key, key_len) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    c->next = lo == 0 ? c->block.first : restart_offset(c, lo - 1);
+    c->key_len = 0;
+    c->valid = true;
+    while (c->next < c->block.restarts) {
+        if (!cursor_decode(c))
+            return c->valid = false;
+        if (compare_keys(c->key, c->key_len, key, key_len) >= 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Put `c` on the first record at or after `key` among the blocks of
+ * `type`. With an index, descend it a level at a time, each level's
+ * records naming the last key of the block below; without one, try the
+ * blocks in turn.
+ */
+static bool table_seek(cursor_t *c, const reftable_table_t *table, char type, const unsigned char *key,
+                       size_t key_len)
+{
+    uint64_t position = type == BLOCK_REF ? 0 : table->obj_position;
+    uint64_t index = type == BLOCK_REF ? table->ref_index_position : table->obj_index_position;
+    
+    c->table = table;
+    c->valid = false;
+    if (type == BLOCK_OBJ && position == 0)
+        return false;
+    
+    if (index) {
+        position = index;
+        for (;;) {
+            if (!block_read(table, position, &c->block))
+                return false;
+            if (c->block.type != BLOCK_INDEX)
+                break;
+            if (!cursor_seek_block(c, key, key_len))
+                return c->valid = false;
+            position = c->position;
+        }
+        if (c->block.type != type || !cursor_seek_block(c, key, key_len))
+            return c->valid = false;
+        return true;
+    }
+    
+    for (; block_read(table, position, &c->block) && c->block.type == type; position = c->block.end) {
+        if (cursor_seek_block(c, key, key_len))
+            return true;
+        if (!c->valid)
+            return false;
+    }
+    return c->valid = false;
+}
+
+static int table_open(reftable_table_t *table, const char *path, const char *name)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < HEADER_SIZE + FOOTER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    
+    const unsigned char *data = map;
+    const unsigned char *footer = data + size - FOOTER_SIZE;
+    if (memcmp(data, "REFT", 4) != 0 || data[4] != FORMAT_VERSION || memcmp(footer, data, HEADER_SIZE) != 0 ||
+        crc32(footer, FOOTER_SIZE - 4) != get_be(footer + FOOTER_SIZE - 4, 4)) {
+        munmap(map, size);
+        return -1;
+    }
+    
+    memset(table, 0, sizeof(*table));
+    table->data = data;
+    table->size = size;
+    table->name = name;
+    table->block_size = (uint32_t)get_be(data + 5, 3);
+    table->min_update_index = get_be(data + 8, 8);
+    table->max_update_index = get_be(data + 16, 8);
+    table->footer = size - FOOTER_SIZE;
+    table->ref_index_position = get_be(footer + 24, 8);
+    table->obj_position = get_be(footer + 32, 8) >> 5;
+    table->obj_id_len = (int)(get_be(footer + 32, 8) & 31);
+    table->obj_index_position = get_be(footer + 40, 8);
+    
+    if (table->ref_index_position >= table->footer || table->obj_position >= table->footer ||
+        table->obj_index_position >= table->footer || table->obj_id_len > GIT_OID_RAWSZ) {
+        munmap(map, size);
+        return -1;
+    }
+    return 0;
+}
+
+static void table_close(reftable_table_t *table)
+{
+    munmap((void *)table->data, table->size);
+}
+
+/*
+ * The records of several tables merged by name, each table a cursor.
+ * Of the records of one name the newest table's counts, and unless
+ * `keep_deletions` is set, one saying the ref was deleted hides it.
+ */
+struct reftable_iter {
+    arena_t *arena;
+    const unsigned char *prefix;
+    size_t prefix_len;
+    cursor_t *cursors;
+    size_t count;
+    bool keep_deletions;
+};
+
+/* Iterate `tables`, given oldest first. */
+static reftable_iter_t* iter_new(arena_t *arena, const reftable_table_t *tables, size_t count, const char *prefix,
+                                 bool keep_deletions)
+{
+    reftable_iter_t *iter = arena_alloc(arena, sizeof(*iter));
+    
+    iter->arena = arena;
+    iter->prefix = (const unsigned char *)prefix;
+    iter->prefix_len = strlen(prefix);
+    iter->cursors = arena_alloc(arena, (count + 1) * sizeof(*iter->cursors));
+    iter->count = count;
+    iter->keep_deletions = keep_deletions;
+    for (size_t i = 0; i < count; i++)
+        table_seek(&iter->cursors[i], &tables[count - 1 - i], BLOCK_REF, iter->prefix, iter->prefix_len);
+    return iter;
+}
+
+static bool iter_next_record(reftable_iter_t *iter, ref_record_t *out)
+{
+    for (;;) {
+        cursor_t *best = NULL;
+        
+        for (size_t i = 0; i < iter->count; i++) {
+            cursor_t *c = &iter->cursors[i];
+            if (!c->valid)
+                continue;
+            if (c->key_len < iter->prefix_len || memcmp(c->key, iter->prefix, iter->prefix_len) != 0) {
+                c->valid = false;
+                continue;
+            }
+            if (!best || compare_keys(c->key, c->key_len, best->key, best->key_len) < 0)
+                best = c;
+        }
+        if (!best)
+            return false;
+        
+        // Older records of the name are overridden
+        for (size_t i = 0; i < iter->count; i++) {
+            cursor_t *c = &iter->cursors[i];
+            if (c != best && c->valid && compare_keys(c->key, c->key_len, best->key, best->key_len) == 0)
+                cursor_next(c);
+        }
+        
+        bool hidden = best->extra == VALUE_SYMREF || (best->extra == VALUE_DELETION && !iter->keep_deletions);
+        if (!hidden) {
+            out->name = arena_strndup(iter->arena, (const char *)best->key, best->key_len);
+            out->name_len = best->key_len;
+            out->type = best->extra;
+            out->oid = best->oid;
+            out->peeled = best->peeled;
+            out->update_index = best->update_index;
+        }
+        cursor_next(best);
+        if (!hidden)
+            return true;
+    }
+}
+
+reftable_iter_t* reftable_stack_iter(const reftable_stack_t *stack, const char *prefix)
+{
+    return iter_new(stack->arena, stack->tables, stack->count, prefix, false);
+}
+
+bool reftable_iter_next(reftable_iter_t *iter, git_ref_t *out)
+{
+    ref_record_t record;
+    
+    if (!iter_next_record(iter, &record))
+        return false;
+    out->name = record.name;
+    out->name_len = record.name_len;
+    out->oid = record.oid;
+    out->peeled = record.peeled;
+    return true;
+}
+
+static char* stack_path(const reftable_stack_t *stack, const char *name)
+{
+    return arena_sprintf(stack->arena, "%s/%s", stack->dir, name);
+}
+
+static int read_file(const char *path, strbuf_t *out)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+        strbuf_add(out, buf, len);
+    
+    int status = ferror(file) ? -1 : 0;
+    fclose(file);
+    return status;
+}
+
+static int write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 0;
+}
+
+static void stack_push(reftable_stack_t *stack, const reftable_table_t *table)
+{
+    if (stack->count == stack->alloc) {
+        size_t alloc = stack->alloc ? stack->alloc * 2 : 8;
+        stack->tables = arena_realloc(stack->arena, stack->tables, stack->alloc * sizeof(*stack->tables),
+                                      alloc * sizeof(*stack->tables));
+        stack->alloc = alloc;
+    }
+    stack->tables[stack->count++] = *table;
+}
+
+static void stack_list(const reftable_stack_t *stack, strbuf_t *out)
+{
+    for (size_t i = 0; i < stack->count; i++) {
+        strbuf_addstr(out, stack->tables[i].name);
+        strbuf_addch(out, '\n');
+    }
+}
+
+int reftable_stack_create(const char *dir)
+{
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+        return -1;
+    
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/tables.list", dir) >= (int)sizeof(path))
+        return -1;
+    
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+        return errno == EEXIST ? 0 : -1;
+    close(fd);
+    return 0;
+}
+
+int reftable_stack_open(reftable_stack_t **out, const char *dir, const reftable_options_t *options, arena_t *arena)
+{
+    reftable_stack_t *stack = arena_calloc(arena, 1, sizeof(*stack));
+    strbuf_t list = strbuf_init(arena, 256);
+    
+    stack->arena = arena;
+    stack->dir = arena_strdup(arena, dir);
+    stack->options = *options;
+    if (stack->options.block_size < 256 || stack->options.block_size > MAX_BLOCK_SIZE)
+        stack->options.block_size = 4096;
+    if (stack->options.restart_interval <= 0 || stack->options.restart_interval > 65535)
+        stack->options.restart_interval = 16;
+    
+    if (read_file(stack_path(stack, "tables.list"), &list) < 0)
+        return -1;
+    
+    for (const char *line = list.buf; *line;) {
+        size_t len = strcspn(line, "\n");
+        char *name = arena_strndup(arena, line, len);
+        reftable_table_t table;
+        
+        line += len + (line[len] == '\n');
+        if (!*name)
+            continue;
+        if (table_open(&table, stack_path(stack, name), name) < 0) {
+            reftable_stack_close(stack);
+            return -1;
+        }
+        stack_push(stack, &table);
+    }
+    
+    *out = stack;
+    return 0;
+}
+
+void reftable_stack_close(reftable_stack_t *stack)
+{
+    for (size_t i = 0; i < stack->count; i++)
+        table_close(&stack->tables[i]);
+    stack->count = 0;
+}
+
+/*
+ * Take `tables.list.lock`, which is how writers keep out of each other's
+ * way, and make sure no other writer changed the stack since it was
+ * read. Returns the lock's descriptor, or -1.
+ */
+static int stack_lock(reftable_stack_t *stack)
+{
+    strbuf_t current = strbuf_init(stack->arena, 256), ours = strbuf_init(stack->arena, 256);
+    int fd = open(stack_path(stack, "tables.list.lock"), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+        return -1;
+    
+    stack_list(stack, &ours);
+    if (read_file(stack_path(stack, "tables.list"), &current) < 0 || strcmp(current.buf, ours.buf) != 0) {
+        close(fd);
+        unlink(stack_path(stack, "tables.list.lock"));
+        return -1;
+    }
+    return fd;
+}
+
+static int stack_unlock(reftable_stack_t *stack, int fd, bool commit)
+{
+    strbuf_t list = strbuf_init(stack->arena, 256);
+    int status = 0;
+    
+    if (commit) {
+        stack_list(stack, &list);
+        status = write_all(fd, list.buf, list.len);
+    }
+    if (close(fd) < 0)
+        status = -1;
+    if (commit && status == 0 && rename(stack_path(stack, "tables.list.lock"), stack_path(stack, "tables.list")) < 0)
+        status = -1;
+    if (!commit || status < 0)
+        unlink(stack_path(stack, "tables.list.lock"));
+    return status;
+}
+
+/* Write out and map a new table, named for the update indices it covers. */
+static int write_table_file(reftable_stack_t *stack, const strbuf_t *data, uint64_t min_index, uint64_t max_index,
+                            reftable_table_t *table)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    
+    char *name = arena_sprintf(stack->arena, "0x%012llx-0x%012llx-%08x.ref", (unsigned long long)min_index,
+                               (unsigned long long)max_index, (unsigned)now.tv_nsec ^ ((unsigned)getpid() << 8));
+    char *path = stack_path(stack, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0)
+        return -1;
+    
+    int status = write_all(fd, data->buf, data->len);
+    if (close(fd) < 0 || status < 0 || table_open(table, path, name) < 0) {
+        unlink(path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Merge the tables from `start` up into one. Deletions have nothing left
+ * to hide once the oldest table is among them, and are dropped then.
+ */
+static int stack_compact(reftable_stack_t *stack, size_t start)
+{
+    int fd = stack_lock(stack);
+    if (fd < 0)
+        return -1;
+    
+    arena_t scratch = arena_init(0);
+    reftable_iter_t *iter = iter_new(&scratch, stack->tables + start, stack->count - start, "", start > 0);
+    ref_record_t *records = NULL;
+    size_t count = 0, alloc = 0;
+    ref_record_t record;
+    
+    while (iter_next_record(iter, &record)) {
+        if (count == alloc) {
+            size_t grown = alloc ? alloc * 2 : 256;
+            records = arena_realloc(&scratch, records, alloc * sizeof(*records), grown * sizeof(*records));
+            alloc = grown;
+        }
+        records[count++] = record;
+    }
+    
+    strbuf_t data = strbuf_init(&scratch, 4096);
+    reftable_table_t table;
+    uint64_t min_index = stack->tables[start].min_update_index;
+    uint64_t max_index = stack->tables[stack->count - 1].max_update_index;
+    write_table(&data, &stack->options, &scratch, records, count, min_index, max_index);
+    int status = write_table_file(stack, &data, min_index, max_index, &table);
+    arena_free(&scratch);
+    if (status < 0) {
+        stack_unlock(stack, fd, false);
+        return -1;
+    }
+    
+    size_t old_count = stack->count;
+    reftable_table_t *old = arena_alloc(stack->arena, (old_count - start) * sizeof(*old));
+    memcpy(old, stack->tables + start, (old_count - start) * sizeof(*old));
+    stack->count = start;
+    stack_push(stack, &table);
+    
+    if (stack_unlock(stack, fd, true) < 0) {
+        // The list on disk still names the old tables, so keep them
+        unlink(stack_path(stack, table.name));
+        table_close(&table);
+        stack->count = start;
+        for (size_t i = 0; i < old_count - start; i++)
+            stack_push(stack, &old[i]);
+        return -1;
+    }
+    for (size_t i = 0; i < old_count - start; i++) {
+        table_close(&old[i]);
+        unlink(stack_path(stack, old[i].name));
+    }
+    return 0;
+}
+
+/*
+ * Where to start merging the newest tables: going down, a table joins
+ * while it is less than twice the size of all those above it together.
+ * Sizes then at least double down the stack, which stays O(log n) tables
+ * deep, and each record is rewritten O(log n) times over its life.
+ */
+static size_t compaction_start(const reftable_stack_t *stack)
+{
+    size_t start = stack->count - 1;
+    uint64_t above = stack->tables[start].size;
+    
+    while (start > 0 && stack->tables[start - 1].size < 2 * above) {
+        start--;
+        above += stack->tables[start].size;
+    }
+    return start;
+}
+
+typedef struct {
+    const ref_update_t *update;
+    size_t order;
+} sorted_update_t;
+
+static int compare_updates(const void *a, const void *b)
+{
+    const sorted_update_t *x = a, *y = b;
+    int cmp = strcmp(x->update->name, y->update->name);
+    
+    if (cmp != 0)
+        return cmp;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+int reftable_stack_add(reftable_stack_t *stack, const ref_update_t *updates, size_t count)
+{
+    if (count == 0)
+        return 0;
+    
+    int fd = stack_lock(stack);
+    if (fd < 0)
+        return -1;
+    
+    arena_t scratch = arena_init(0);
+    sorted_update_t *sorted = arena_alloc(&scratch, count * sizeof(*sorted));
+    ref_record_t *records = arena_alloc(&scratch, count * sizeof(*records));
+    uint64_t update_index = stack->count ? stack->tables[stack->count - 1].max_update_index + 1 : 1;
+    size_t record_count = 0;
+    
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = (sorted_update_t){ &updates[i], i };
+    qsort(sorted, count, sizeof(*sorted), compare_updates);
+    
+    for (size_t i = 0; i < count; i++) {
+        const ref_update_t *update = sorted[i].update;
+        if (i + 1 < count && strcmp(update->name, sorted[i + 1].update->name) == 0)
+            continue;
+        if (strlen(update->name) > MAX_KEY_LEN) {
+            arena_free(&scratch);
+            stack_unlock(stack, fd, false);
+            return -1;
+        }
+        
+        ref_record_t *record = &records[record_count++];
+        record->name = update->name;
+        record->name_len = strlen(update->name);
+        record->type = update->deleted ? VALUE_DELETION : oid_is_zero(&update->peeled) ? VALUE_OID : VALUE_PEELED;
+        record->oid = update->oid;
+        record->peeled = update->peeled;
+        record->update_index = update_index;
+    }
+    
+    strbuf_t data = strbuf_init(&scratch, 4096);
+    reftable_table_t table;
+    write_table(&data, &stack->options, &scratch, records, record_count, update_index, update_index);
+    int status = write_table_file(stack, &data, update_index, update_index, &table);
+    arena_free(&scratch);
+    if (status < 0) {
+        stack_unlock(stack, fd, false);
+        return -1;
+    }
+    
+    stack_push(stack, &table);
+    if (stack_unlock(stack, fd, true) < 0) {
+        stack->count--;
+        unlink(stack_path(stack, table.name));
+        table_close(&table);
+        return -1;
+    }
+    
+    // The update is in; a compaction that fails leaves the stack as it was, only deeper
+    if (stack->options.auto_compaction && stack->count > 1) {
+        size_t start = compaction_start(stack);
+        if (start + 1 < stack->count)
+            stack_compact(stack, start);
+    }
+    return 0;
+}
+
+bool reftable_stack_lookup(const reftable_stack_t *stack, const char *name, git_ref_t *out)
+{
+    const unsigned char *key = (const unsigned char *)name;
+    size_t len = strlen(name);
+    cursor_t c;
+    
+    for (size_t i = stack->count; i-- > 0;) {
+        if (!table_seek(&c, &stack->tables[i], BLOCK_REF, key, len) || compare_keys(c.key, c.key_len, key, len) != 0)
+            continue;
+        if (c.extra != VALUE_OID && c.extra != VALUE_PEELED)
+            return false;
+        out->name = arena_strndup(stack->arena, name, len);
+        out->name_len = len;
+        out->oid = c.oid;
+        out->peeled = c.peeled;
+        return true;
+    }
+    return false;
+}
+
+typedef struct {
+    arena_t *arena;
+    git_ref_t *refs;
+    size_t count;
+    size_t alloc;
+} ref_list_t;
+
+static void collect_if_at(ref_list_t *list, const cursor_t *c, const git_oid_t *oid)
+{
+    if (c->extra == VALUE_DELETION || c->extra == VALUE_SYMREF)
+        return;
+    if (oid_cmp(&c->oid, oid) != 0 && (c->extra != VALUE_PEELED || oid_cmp(&c->peeled, oid) != 0))
+        return;
+    
+    if (list->count == list->alloc) {
+        size_t alloc = list->alloc ? list->alloc * 2 : 16;
+        list->refs = arena_realloc(list->arena, list->refs, list->alloc * sizeof(*list->refs),
+                                   alloc * sizeof(*list->refs));
+        list->alloc = alloc;
+    }
+    list->refs[list->count++] = (git_ref_t){
+        .name = arena_strndup(list->arena, (const char *)c->key, c->key_len),
+        .name_len = c->key_len,
+        .oid = c->oid,
+        .peeled = c->peeled,
+    };
+}
+
+/* The refs of one table at `oid`, from the ref blocks its object index names, or all of them without one. */
+static void table_refs_at(const reftable_table_t *table, const git_oid_t *oid, ref_list_t *list)
+{
+    cursor_t c;
+    
+    if (!table->obj_position) {
+        for (bool more = table_seek(&c, table, BLOCK_REF, (const unsigned char *)"", 0); more; more = cursor_next(&c))
+            collect_if_at(list, &c, oid);
+        return;
+    }
+    
+    if (!table_seek(&c, table, BLOCK_OBJ, oid->id, (size_t)table->obj_id_len) ||
+        compare_keys(c.key, c.key_len, oid->id, (size_t)table->obj_id_len) != 0)
+        return;
+    
+    const unsigned char *p = c.positions, *end = table->data + c.block.restarts;
+    uint64_t position = 0, delta;
+    cursor_t ref;
+    ref.table = table;
+    for (uint64_t i = 0; i < c.position_count && get_varint(&p, end, &delta); i++) {
+        position += delta;
+        if (!block_read(table, position, &ref.block) || ref.block.type != BLOCK_REF)
+            continue;
+        ref.next = ref.block.first;
+        ref.key_len = 0;
+        while (ref.next < ref.block.restarts && cursor_decode(&ref))
+            collect_if_at(list, &ref, oid);
+    }
+}
+
+static int compare_refs(const void *a, const void *b)
+{
+    const git_ref_t *x = a, *y = b;
+    return compare_keys((const unsigned char *)x->name, x->name_len, (const unsigned char *)y->name, y->name_len);
+}
+
+size_t reftable_stack_refs_at(const reftable_stack_t *stack, const git_oid_t *oid, git_ref_t **out)
+{
+    ref_list_t list = { .arena = stack->arena };
+    size_t count = 0;
+    
+    for (size_t i = 0; i < stack->count; i++)
+        table_refs_at(&stack->tables[i], oid, &list);
+    if (list.count > 1)
+        qsort(list.refs, list.count, sizeof(*list.refs), compare_refs);
+    
+    // A newer table may have moved or deleted what an older one had here
+    for (size_t i = 0; i < list.count; i++) {
+        git_ref_t current;
+        if (count > 0 && compare_refs(&list.refs[count - 1], &list.refs[i]) == 0)
+            continue;
+        if (!reftable_stack_lookup(stack, list.refs[i].name, &current))
+            continue;
+        if (oid_cmp(&current.oid, oid) == 0 || oid_cmp(&current.peeled, oid) == 0)
+            list.refs[count++] = current;
+    }
+    *out = list.refs;
+    return count;
+}
@@ -0,0 +1,546 @@
+#include "repository.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "commit_graph.h"
+#include "config_utils.h"
+#include "date.h"
+#include "mock_data.h"
+#include "sparse_index.h"
+#include "strbuf.h"
+#include "tree.h"
+
+static const git_worktree_file_t* find_file(const git_worktree_file_t *files, size_t count,
+                                           const char *path, size_t *insert_at)
+{
+    size_t low = 0, high = count;
+    
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strcmp(files[mid].path, path);
+        if (cmp == 0)
+            return &files[mid];
+        if (cmp < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (insert_at)
+        *insert_at = low;
+    return NULL;
+}
+
+const git_worktree_file_t* repo_worktree_file(const git_repository_t *repo, const char *path)
+{
+    const git_worktree_file_t *file = find_file(repo->worktree.files, repo->worktree.count, path, NULL);
+    if (file)
+        return file->content ? file : NULL;
+    
+    int file_count;
+    const git_worktree_file_t *files = get_mock_worktree_files(&file_count);
+    return find_file(files, (size_t)file_count, path, NULL);
+}
+
+/*
+ * Whether the worktree holds exactly `oid` at `path`, or nothing when
+ * `oid` is NULL. Clean stat data against a matching index entry spares
+ * hashing the file.
+ */
+bool repo_worktree_matches(const git_repository_t *repo, const char *path, const git_oid_t *oid)
+{
+    const git_worktree_file_t *file = repo_worktree_file(repo, path);
+    if (!file)
+        return oid == NULL;
+    if (!oid)
+        return false;
+    
+    long pos = index_find(&repo->index, path);
+    if (pos >= 0) {
+        const git_index_entry_t *entry = &repo->index.entries[pos];
+        if (oid_cmp(&entry->oid, oid) == 0 && index_entry_stat_matches(entry, &file->stat) &&
+            !index_entry_is_racy(&repo->index, entry))
+            return true;
+    }
+    
+    git_oid_t actual;
+    oid_hash_object("blob", file->content, file->stat.size, &actual);
+    return oid_cmp(&actual, oid) == 0;
+}
+
+void repo_write_worktree_file(git_repository_t *repo, const char *path, const char *content,
+                              const git_stat_data_t *st)
+{
+    git_worktree_overlay_t *wt = &repo->worktree;
+    size_t insert_at;
+    git_worktree_file_t *file = (git_worktree_file_t *)find_file(wt->files, wt->count, path, &insert_at);
+    
+    if (!file) {
+        if (wt->count == wt->alloc) {
+            size_t new_alloc = wt->alloc ? wt->alloc * 2 : 16;
+            wt->files = arena_realloc(&repo->ctx->arena, wt->files, wt->alloc * sizeof(*wt->files),
+                                      new_alloc * sizeof(*wt->files));
+            wt->alloc = new_alloc;
+        }
+        memmove(&wt->files[insert_at + 1], &wt->files[insert_at],
+                (wt->count - insert_at) * sizeof(*wt->files));
+        file = &wt->files[insert_at];
+        file->path = arena_strdup(&repo->ctx->arena, path);
+        wt->count++;
+    }
+    
+    file->content = content;
+    file->stat = st ? *st : (git_stat_data_t){ 0 };
+}
+
+void repo_remove_worktree_file(git_repository_t *repo, const char *path)
+{
+    repo_write_worktree_file(repo, path, NULL, NULL);
+}
+
+bool repo_worktree_mkdir(git_repository_t *repo, const char *path, size_t len)
+{
+    git_worktree_overlay_t *wt = &repo->worktree;
+    
+    for (size_t i = wt->dir_count; i > 0; i--) {
+        if (strncmp(wt->dirs[i - 1], path, len) == 0 && wt->dirs[i - 1][len] == '\0')
+            return false;
+    }
+    
+    int file_count;
+    const git_worktree_file_t *files = get_mock_worktree_files(&file_count);
+    for (int i = 0; i < file_count; i++) {
+        if (strncmp(files[i].path, path, len) == 0 && files[i].path[len] == '/')
+            return false;
+    }
+    
+    if (wt->dir_count == wt->dir_alloc) {
+        size_t new_alloc = wt->dir_alloc ? wt->dir_alloc * 2 : 8;
+        wt->dirs = arena_realloc(&repo->ctx->arena, wt->dirs, wt->dir_alloc * sizeof(*wt->dirs),
+                                 new_alloc * sizeof(*wt->dirs));
+        wt->dir_alloc = new_alloc;
+    }
+    wt->dirs[wt->dir_count++] = arena_strndup(&repo->ctx->arena, path, len);
+    return true;
+}
+
+void repo_stage_worktree_file(git_repository_t *repo, const char *path)
+{
+    const git_worktree_file_t *file = repo_worktree_file(repo, path);
+    if (!file)
+        return;
+    
+    sparse_index_expand_for_path(&repo->index, &repo->odb, path);
+    const git_object_t *blob = odb_write(&repo->odb, OBJ_BLOB, file->content, file->stat.size);
+    git_index_entry_t *entry = index_add(&repo->index, file->path, &blob->oid, GIT_MODE_FILE);
+    entry->stat = file->stat;
+}
+
+void repo_refresh_index(git_repository_t *repo, bool stage, git_refresh_result_t *result)
+{
+    git_index_t *index = &repo->index;
+    
+    result->changes = arena_alloc(index->arena, (index->count + 1) * sizeof(*result->changes));
+    result->change_count = 0;
+    result->hashed_count = 0;
+    
+    for (size_t i = 0; i < index->count; i++) {
+        git_index_entry_t *entry = &index->entries[i];
+        if (entry->skip_worktree)
+            continue;
+        
+        const git_worktree_file_t *file = repo_worktree_file(repo, entry->path);
+        if (!file) {
+            result->changes[result->change_count++] = (git_worktree_change_t){ entry->path, true };
+            continue;
+        }
+        
+        // Unchanged stat data is trusted unless the entry is racily clean
+        if (index_entry_stat_matches(entry, &file->stat) && !index_entry_is_racy(index, entry))
+            continue;
+        
+        git_oid_t oid;
+        oid_hash_object("blob", file->content, file->stat.size, &oid);
+        result->hashed_count++;
+        
+        if (oid_cmp(&oid, &entry->oid) == 0) {
+            entry->stat = file->stat;
+            continue;
+        }
+        result->changes[result->change_count++] = (git_worktree_change_t){ entry->path, false };
+    }
+    
+    if (!stage)
+        return;
+    
+    for (size_t i = 0; i < result->change_count; i++) {
+        if (result->changes[i].deleted)
+            index_remove(index, result->changes[i].path);
+        else
+            repo_stage_worktree_file(repo, result->changes[i].path);
+    }
+}
+
+void repo_reset_path(git_repository_t *repo, const git_oid_t *tree, const char *path)
+{
+    git_tree_entry_t entry;
+    
+    sparse_index_expand_for_path(&repo->index, &repo->odb, path);
+    
+    if (tree && tree_lookup_path(&repo->odb, tree, path, &entry) && !tree_entry_is_dir(&entry)) {
+        index_add(&repo->index, path, entry.oid, entry.mode);
+        return;
+    }
+    index_remove(&repo->index, path);
+}
+
+int repo_find_commit(const git_repository_t *repo, const char *hash)
+{
+    size_t len = strlen(hash);
+    
+    // Abbreviated names are accepted as long as they are unambiguous
+    int found = -1;
+    for (int i = 0; len >= 4 && i < repo->commit_count; i++) {
+        if (strncmp(repo->commits[i].commit->hash, hash, len) != 0)
+            continue;
+        if (found >= 0)
+            return -1;
+        found = i;
+    }
+    return found;
+}
+
+int repo_find_commit_oid(const git_repository_t *repo, const git_oid_t *oid)
+{
+    for (int i = 0; i < repo->commit_count; i++) {
+        if (oid_cmp(&repo->commits[i].object->oid, oid) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int repo_resolve_commit(const git_repository_t *repo, const char *rev)
+{
+    // Git's order for a short name: as given, then a tag, a branch, a remote-tracking branch
+    static const char *const rules[] = { "%s", "refs/%s", "refs/tags/%s", "refs/heads/%s", "refs/remotes/%s" };
+    
+    if (strcmp(rev, "HEAD") == 0 || strcmp(rev, "@") == 0)
+        return repo->head;
+    
+    for (size_t i = 0; i < sizeof(rules) / sizeof(*rules); i++) {
+        git_ref_t ref;
+        if (ref_store_lookup(&repo->refs, arena_sprintf(&repo->ctx->arena, rules[i], rev), &ref))
+            return repo_find_commit_oid(repo, oid_is_zero(&ref.peeled) ? &ref.oid : &ref.peeled);
+    }
+    return repo_find_commit(repo, rev);
+}
+
+int repo_find_stash(const git_repository_t *repo, const char *name)
+{
+    const char *number = name;
+    size_t len = strlen(name);
+    
+    if (strncmp(name, "stash@{", 7) == 0 && len > 8 && name[len - 1] == '}') {
+        number = name + 7;
+        len -= 8;
+    }
+    if (len == 0 || strspn(number, "0123456789") < len)
+        return -1;
+    
+    int index = atoi(number);
+    for (int i = 0; i < repo->stash_count; i++) {
+        if (repo->stashes[i].entry->index == index)
+            return i;
+    }
+    return -1;
+}
+
+void repo_set_head(git_repository_t *repo, const char *ref, int commit)
+{
+    repo->head_ref = ref ? arena_strdup(&repo->ctx->arena, ref) : NULL;
+    repo->head = commit;
+}
+
+static void apply_changes(git_repository_t *repo, git_index_t *index, const git_tree_file_t *changes, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (!changes[i].content) {
+            index_remove(index, changes[i].path);
+            continue;
+        }
+        const git_object_t *blob = odb_write(&repo->odb, OBJ_BLOB, changes[i].content,
+                                             strlen(changes[i].content));
+        index_add(index, changes[i].path, &blob->oid, GIT_MODE_FILE);
+    }
+}
+
+/*
+ * Replay the mock history into the object database. Each commit's index is
+ * its first parent's with the commit's changes applied, so the cache-tree
+ * only rewrites the directories a commit touched.
+ */
+static const git_index_t* build_commit_tree(git_repository_t *repo, int pos, git_index_t **snapshots)
+{
+    if (snapshots[pos])
+        return snapshots[pos];
+    
+    git_commit_node_t *node = &repo->commits[pos];
+    git_index_t *index = arena_alloc(&repo->ctx->arena, sizeof(*index));
+    
+    if (node->parent_count > 0)
+        *index = index_clone(build_commit_tree(repo, node->parents[0], snapshots));
+    else
+        *index = index_init(&repo->ctx->arena);
+    
+    int change_count;
+    const git_tree_file_t *changes = get_mock_commit_changes(node->commit->hash, &change_count);
+    apply_changes(repo, index, changes, change_count);
+    
+    cache_tree_update(index, &repo->odb);
+    node->tree = index->cache_tree->oid;
+    snapshots[pos] = index;
+    return index;
+}
+
+/*
+ * The mock author is the committer too. Parents are written first, as
+ * the history is newest first, so each names its parents' object ids.
+ */
+static const git_object_t* write_commit_object(git_repository_t *repo, int pos)
+{
+    git_commit_node_t *node = &repo->commits[pos];
+    const git_commit_t *commit = node->commit;
+    char tree_hex[GIT_OID_HEXSZ + 1], parent_hex[GIT_OID_HEXSZ + 1];
+    
+    if (node->object)
+        return node->object;
+    date_formatter_t raw = date_formatter_init((date_mode_t){ .type = DATE_RAW }, 0);
+    strbuf_t when = strbuf_init(&repo->ctx->arena, 32);
+    
+    oid_to_hex(&node->tree, tree_hex);
+    date_format(&raw, node->date, node->tz, &when);
+    strbuf_t buf = strbuf_init(&repo->ctx->arena, strlen(commit->message) + 256);
+    strbuf_addf(&buf, "tree %s\n", tree_hex);
+    for (int p = 0; p < node->parent_count; p++) {
+        oid_to_hex(&write_commit_object(repo, node->parents[p])->oid, parent_hex);
+        strbuf_addf(&buf, "parent %s\n", parent_hex);
+    }
+    strbuf_addf(&buf, "author %s <%s> %s\n", commit->author, commit->email, when.buf);
+    strbuf_addf(&buf, "committer %s <%s> %s\n", commit->author, commit->email, when.buf);
+    strbuf_addch(&buf, '\n');
+    strbuf_addstr(&buf, commit->message);
+    strbuf_addch(&buf, '\n');
+    node->object = odb_write(&repo->odb, OBJ_COMMIT, buf.buf, buf.len);
+    return node->object;
+}
+
+static void load_history(git_repository_t *repo)
+{
+    int count;
+    const git_commit_t *commits = get_mock_commits(&count);
+    
+    repo->commits = arena_calloc(&repo->ctx->arena, (size_t)count, sizeof(*repo->commits));
+    repo->commit_count = count;
+    for (int i = 0; i < count; i++) {
+        repo->commits[i].commit = &commits[i];
+        if (date_parse(commits[i].date, 0, false, &repo->commits[i].date, &repo->commits[i].tz) < 0)
+            repo->commits[i].date = 0;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        git_commit_node_t *node = &repo->commits[i];
+        for (int p = 0; p < 2 && commits[i].parents[p]; p++) {
+            int parent = repo_find_commit(repo, commits[i].parents[p]);
+            if (parent >= 0)
+                node->parents[node->parent_count++] = parent;
+        }
+    }
+    
+    const git_branch_t *branches = get_mock_branches(&count);
+    repo->head = -1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(branches[i].type, "current") == 0) {
+            repo->head_ref = branches[i].name;
+            repo->head = repo_find_commit(repo, branches[i].hash);
+        }
+    }
+}
+
+// A stash's tree is its base commit's with the stashed changes applied
+static void load_stashes(git_repository_t *repo, git_index_t **snapshots)
+{
+    int count;
+    const git_stash_entry_t *entries = get_mock_stashes(&count);
+    
+    repo->stashes = arena_calloc(&repo->ctx->arena, (size_t)count, sizeof(*repo->stashes));
+    for (int i = 0; i < count; i++) {
+        int base = repo_find_commit(repo, entries[i].base);
+        if (base < 0)
+            continue;
+        
+        git_index_t index = index_clone(snapshots[base]);
+        int change_count;
+        const git_tree_file_t *changes = get_mock_stash_changes(entries[i].index, &change_count);
+        apply_changes(repo, &index, changes, change_count);
+        cache_tree_update(&index, &repo->odb);
+        
+        git_stash_node_t *node = &repo->stashes[repo->stash_count++];
+        node->entry = &entries[i];
+        node->base = base;
+        node->tree = index.cache_tree->oid;
+    }
+}
+
+static int compare_refs(const void *a, const void *b)
+{
+    return strcmp(((const git_ref_t *)a)->name, ((const git_ref_t *)b)->name);
+}
+
+static git_ref_t* add_ref(git_repository_t *repo, git_ref_t *refs, size_t *count, const char *prefix,
+                          const char *name, const char *hash)
+{
+    int pos = repo_find_commit(repo, hash);
+    if (pos < 0)
+        return NULL;
+    
+    git_ref_t *ref = &refs[(*count)++];
+    ref->name = arena_sprintf(&repo->ctx->arena, "%s%s", prefix, name);
+    ref->name_len = strlen(ref->name);
+    ref->oid = repo->commits[pos].object->oid;
+    return ref;
+}
+
+// An annotated tag's object is dated as the commit it tags
+static void write_tag_object(git_repository_t *repo, git_ref_t *ref, const git_tag_t *tag)
+{
+    const git_commit_node_t *node = &repo->commits[repo_find_commit(repo, tag->hash)];
+    char target_hex[GIT_OID_HEXSZ + 1];
+    date_formatter_t raw = date_formatter_init((date_mode_t){ .type = DATE_RAW }, 0);
+    strbuf_t buf = strbuf_init(&repo->ctx->arena, strlen(tag->message) + 256);
+    
+    oid_to_hex(&ref->oid, target_hex);
+    strbuf_addf(&buf, "object %s\ntype commit\ntag %s\ntagger %s ", target_hex, tag->name, tag->tagger);
+    date_format(&raw, node->date, node->tz, &buf);
+    strbuf_addf(&buf, "\n\n%s\n", tag->message);
+    ref->peeled = ref->oid;
+    ref->oid = odb_write(&repo->odb, OBJ_TAG, buf.buf, buf.len)->oid;
+}
+
+/*
+ * The refs of `$GIT_DIR`, in whichever backend it keeps them, if it is
+ * set and readable. If not, the mock refs written out as the packed-refs
+ * file git would keep for them, peeled lines and all, for the store to
+ * search in place like a mapped one.
+ */
+static void load_refs(git_repository_t *repo)
+{
+    arena_t *arena = &repo->ctx->arena;
+    const char *git_dir = getenv("GIT_DIR");
+    reftable_options_t options = {
+        .block_size = (uint32_t)config_get_int(repo->ctx, "reftable.blockSize", 4096),
+        .restart_interval = config_get_int(repo->ctx, "reftable.restartInterval", 16),
+        .auto_compaction = config_get_bool(repo->ctx, "reftable.autoCompaction", true),
+    };
+    
+    repo->refs = ref_store_init(arena);
+    if (git_dir && ref_store_open(&repo->refs, git_dir, &options) == 0)
+        return;
+    repo->refs = ref_store_init(arena);
+    
+    int branch_count, remote_count, tag_count;
+    const git_branch_t *branches = get_mock_branches(&branch_count);
+    const git_branch_t *remote_branches = get_mock_remote_branches(&remote_count);
+    const git_tag_t *tags = get_mock_tags(&tag_count);
+    git_ref_t *refs = arena_calloc(arena, (size_t)(branch_count + remote_count + tag_count) + 1, sizeof(*refs));
+    size_t count = 0;
+    
+    for (int i = 0; i < branch_count; i++)
+        add_ref(repo, refs, &count, "refs/heads/", branches[i].name, branches[i].hash);
+    for (int i = 0; i < remote_count; i++)
+        add_ref(repo, refs, &count, "refs/remotes/", remote_branches[i].name, remote_branches[i].hash);
+    for (int i = 0; i < tag_count; i++) {
+        git_ref_t *ref = add_ref(repo, refs, &count, "refs/tags/", tags[i].name, tags[i].hash);
+        if (ref && tags[i].message)
+            write_tag_object(repo, ref, &tags[i]);
+    }
+    qsort(refs, count, sizeof(*refs), compare_refs);
+    
+    strbuf_t packed = strbuf_init(arena, (count + 1) * (GIT_OID_HEXSZ + 64));
+    char hex[GIT_OID_HEXSZ + 1];
+    strbuf_addstr(&packed, "# pack-refs with: peeled fully-peeled sorted \n");
+    for (size_t i = 0; i < count; i++) {
+        oid_to_hex(&refs[i].oid, hex);
+        strbuf_addf(&packed, "%s %s\n", hex, refs[i].name);
+        if (!oid_is_zero(&refs[i].peeled)) {
+            oid_to_hex(&refs[i].peeled, hex);
+            strbuf_addf(&packed, "^%s\n", hex);
+        }
+    }
+    packed_refs_from_buffer(&repo->refs.packed, packed.buf, packed.len, arena);
+}
+
+static void load_head_index(git_repository_t *repo)
+{
+    git_index_t **snapshots = arena_calloc(&repo->ctx->arena, (size_t)repo->commit_count, sizeof(*snapshots));
+    
+    for (int i = 0; i < repo->commit_count; i++)
+        build_commit_tree(repo, i, snapshots);
+    for (int i = 0; i < repo->commit_count; i++)
+        write_commit_object(repo, i);
+    load_stashes(repo, snapshots);
+    if (repo->head < 0)
+        return;
+    
+    // The cloned cache-tree matches HEAD, as the TREE extension of a
+    // freshly written index would
+    repo->index = index_clone(snapshots[repo->head]);
+    
+    int stat_count;
+    const git_index_stat_t *stats = get_mock_index_stats(&stat_count);
+    for (int i = 0; i < stat_count; i++) {
+        long pos = index_find(&repo->index, stats[i].path);
+        if (pos >= 0)
+            repo->index.entries[pos].stat = stats[i].stat;
+    }
+    repo->index.timestamp = get_mock_index_timestamp();
+}
+
+git_repository_t* repo_open(git_context_t *ctx)
+{
+    if (ctx->repo)
+        return ctx->repo;
+    
+    git_repository_t *repo = arena_calloc(&ctx->arena, 1, sizeof(*repo));
+    repo->ctx = ctx;
+    repo->odb = odb_init(&ctx->arena);
+    repo->index = index_init(&ctx->arena);
+    load_history(repo);
+    load_head_index(repo);
+    load_refs(repo);
+    
+    // Without a patterns file to read, an enabled cone starts out holding
+    // only the top-level files, as right after `sparse-checkout init`
+    sparse_checkout_init(&repo->sparse, &ctx->arena);
+    repo->sparse.enabled = config_get_bool(ctx, "core.sparseCheckout", false);
+    for (size_t i = 0; repo->sparse.enabled && i < repo->index.count; i++) {
+        git_index_entry_t *entry = &repo->index.entries[i];
+        entry->skip_worktree = !sparse_checkout_includes(&repo->sparse, entry->path);
+    }
+    if (repo->sparse.enabled && config_get_bool(ctx, "index.sparse", false))
+        sparse_index_convert(&repo->index, &repo->odb, &repo->sparse);
+    
+    int status_count;
+    const git_file_status_t *statuses = get_mock_file_status(&status_count);
+    for (int i = 0; i < status_count; i++) {
+        if (statuses[i].staged)
+            repo_stage_worktree_file(repo, statuses[i].filename);
+    }
+    
+    ctx->repo = repo;
+    return repo;
+}
+
+void repo_close(git_repository_t *repo)
+{
+    ref_store_close(&repo->refs);
+    commit_graph_close(repo->graph);
+}
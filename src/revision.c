@@ -0,0 +1,565 @@
+#include "revision.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_utils.h"
+#include "merge_base.h"
+
+#define REV_SEEN          0x01
+#define REV_UNINTERESTING 0x02
+#define REV_QUEUED        0x04
+#define REV_PENDING       0x08
+
+// Commits walked past the point where only uninteresting ones are left,
+// for dates that run backwards
+#define REV_SLOP 5
+
+rev_queue_t rev_queue_init(const git_repository_t *repo, const uint32_t *generations)
+{
+    return (rev_queue_t){ .repo = repo, .generations = generations };
+}
+
+static bool rev_queue_before(const rev_queue_t *queue, const rev_entry_t *a, const rev_entry_t *b)
+{
+    if (queue->generations && queue->generations[a->pos] != queue->generations[b->pos])
+        return queue->generations[a->pos] > queue->generations[b->pos];
+    
+    long long date_a = queue->repo->commits[a->pos].date;
+    long long date_b = queue->repo->commits[b->pos].date;
+    if (date_a != date_b)
+        return date_a > date_b;
+    return a->seq < b->seq;
+}
+
+void rev_queue_push(rev_queue_t *queue, arena_t *arena, int pos)
+{
+    if (queue->count == queue->alloc) {
+        size_t alloc = queue->alloc ? queue->alloc * 2 : 64;
+        queue->items = arena_realloc(arena, queue->items, queue->alloc * sizeof(*queue->items),
+                                     alloc * sizeof(*queue->items));
+        queue->alloc = alloc;
+    }
+    
+    size_t at = queue->count++;
+    rev_entry_t entry = { pos, queue->next_seq++ };
+    while (at > 0) {
+        size_t parent = (at - 1) / 2;
+        if (!rev_queue_before(queue, &entry, &queue->items[parent]))
+            break;
+        queue->items[at] = queue->items[parent];
+        at = parent;
+    }
+    queue->items[at] = entry;
+}
+
+int rev_queue_pop(rev_queue_t *queue)
+{
+    if (queue->count == 0)
+        return -1;
+    
+    int top = queue->items[0].pos;
+    rev_entry_t last = queue->items[--queue->count];
+    size_t at = 0;
+    for (;;) {
+        size_t child = 2 * at + 1;
+        if (child >= queue->count)
+            break;
+        if (child + 1 < queue->count && rev_queue_before(queue, &queue->items[child + 1], &queue->items[child]))
+            child++;
+        if (!rev_queue_before(queue, &queue->items[child], &last))
+            break;
+        queue->items[at] = queue->items[child];
+        at = child;
+    }
+    if (queue->count > 0)
+        queue->items[at] = last;
+    return top;
+}
+
+rev_walk_t rev_walk_init(git_repository_t *repo)
+{
+    rev_walk_t walk = {
+        .repo = repo,
+        .flags = arena_calloc(&repo->ctx->arena, (size_t)repo->commit_count + 1, 1),
+        .since = LLONG_MIN,
+        .until = LLONG_MAX,
+    };
+    return walk;
+}
+
+const char* rev_upstream_name(git_repository_t *repo, const char *branch)
+{
+    arena_t *arena = &repo->ctx->arena;
+    
+    if (*branch == '\0' || strcmp(branch, "HEAD") == 0 || strcmp(branch, "@") == 0)
+        branch = repo->head_ref;
+    if (!branch)
+        return NULL;
+    
+    const char *remote = config_get(repo->ctx, arena_sprintf(arena, "branch.%s.remote", branch), NULL);
+    const char *merge = config_get(repo->ctx, arena_sprintf(arena, "branch.%s.merge", branch), NULL);
+    if (!remote || !merge)
+        return NULL;
+    if (strncmp(merge, "refs/heads/", 11) == 0)
+        merge += 11;
+    return strcmp(remote, ".") == 0 ? merge : arena_sprintf(arena, "%s/%s", remote, merge);
+}
+
+static int resolve_name(git_repository_t *repo, const char *name)
+{
+    if (strncmp(name, "refs/heads/", 11) == 0)
+        name += 11;
+    else if (strncmp(name, "refs/remotes/", 13) == 0)
+        name += 13;
+    return repo_resolve_commit(repo, name);
+}
+
+int rev_resolve(git_repository_t *repo, const char *expr)
+{
+    arena_t *arena = &repo->ctx->arena;
+    const char *steps = expr + strcspn(expr, "~^");
+    const char *at = strstr(expr, "@{");
+    int pos;
+    
+    if (at && at < steps) {
+        const char *close = strchr(at, '}');
+        if (!close)
+            return -1;
+        
+        const char *which = arena_strndup(arena, at + 2, (size_t)(close - at - 2));
+        if (strcmp(which, "upstream") != 0 && strcmp(which, "u") != 0)
+            return -1;
+        const char *upstream = rev_upstream_name(repo, arena_strndup(arena, expr, (size_t)(at - expr)));
+        if (!upstream)
+            return -1;
+        pos = resolve_name(repo, upstream);
+        steps = close + 1;
+    } else {
+        pos = resolve_name(repo, arena_strndup(arena, expr, (size_t)(steps - expr)));
+    }
+    
+    // `~<n>` follows first parents n times; `^<n>` takes the nth parent
+    while (pos >= 0 && *steps) {
+        char step = *steps++;
+        if (step != '~' && step != '^')
+            return -1;
+        
+        char *end;
+        long n = strtol(steps, &end, 10);
+        if (end == steps)
+            n = 1;
+        else if (n < 0)
+            return -1;
+        steps = end;
+        
+        const git_commit_node_t *node = &repo->commits[pos];
+        if (step == '~') {
+            for (; n > 0 && pos >= 0; n--)
+                pos = repo->commits[pos].parent_count > 0 ? repo->commits[pos].parents[0] : -1;
+        } else if (n > 0) {
+            pos = n <= node->parent_count ? node->parents[n - 1] : -1;
+        }
+    }
+    return pos;
+}
+
+void rev_add_tip(rev_walk_t *walk, int pos, bool uninteresting)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    
+    if (walk->tip_count == walk->tip_alloc) {
+        size_t alloc = walk->tip_alloc ? walk->tip_alloc * 2 : 8;
+        walk->tips = arena_realloc(arena, walk->tips, walk->tip_alloc * sizeof(*walk->tips),
+                                   alloc * sizeof(*walk->tips));
+        walk->tip_alloc = alloc;
+    }
+    walk->tips[walk->tip_count++] = (rev_tip_t){ pos, uninteresting };
+    if (uninteresting)
+        walk->limited = true;
+    else
+        walk->interesting_tips++;
+}
+
+int rev_parse_arg(rev_walk_t *walk, const char *arg, bool negate)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    const char *dots = strstr(arg, "..");
+    
+    if (dots) {
+        bool symmetric = dots[2] == '.';
+        const char *left = arena_strndup(arena, arg, (size_t)(dots - arg));
+        const char *right = dots + (symmetric ? 3 : 2);
+        int from = rev_resolve(walk->repo, *left ? left : "HEAD");
+        int to = rev_resolve(walk->repo, *right ? right : "HEAD");
+        if (from < 0 || to < 0)
+            return -1;
+        
+        rev_add_tip(walk, from, symmetric ? negate : !negate);
+        rev_add_tip(walk, to, negate);
+        if (symmetric && !negate) {
+            merge_base_list_t bases = merge_bases_many(walk->repo, from, &to, 1, arena);
+            for (size_t i = 0; i < bases.count; i++)
+                rev_add_tip(walk, bases.commits[i], true);
+        }
+        return 0;
+    }
+    
+    bool excluded = arg[0] == '^';
+    int pos = rev_resolve(walk->repo, excluded ? arg + 1 : arg);
+    if (pos < 0)
+        return -1;
+    rev_add_tip(walk, pos, excluded != negate);
+    return 0;
+}
+
+/*
+ * An uninteresting commit makes its parents uninteresting too, and so on
+ * down through every commit the walk has reached, queued or passed.
+ */
+static void mark_parents_uninteresting(rev_walk_t *walk, int pos, size_t *interesting_queued)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    size_t depth = 0;
+    
+    if (walk->stack_alloc == 0) {
+        walk->stack_alloc = 16;
+        walk->stack = arena_alloc(arena, walk->stack_alloc * sizeof(*walk->stack));
+    }
+    walk->stack[depth++] = pos;
+    while (depth > 0) {
+        const git_commit_node_t *node = &walk->repo->commits[walk->stack[--depth]];
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            unsigned char *flags = &walk->flags[parent];
+            if (*flags & REV_UNINTERESTING)
+                continue;
+            
+            *flags |= REV_UNINTERESTING;
+            if (*flags & REV_QUEUED)
+                (*interesting_queued)--;
+            if (!(*flags & REV_SEEN))
+                continue;
+            if (depth == walk->stack_alloc) {
+                walk->stack = arena_realloc(arena, walk->stack, depth * sizeof(*walk->stack),
+                                            2 * depth * sizeof(*walk->stack));
+                walk->stack_alloc *= 2;
+            }
+            walk->stack[depth++] = parent;
+        }
+    }
+}
+
+static void queue_commit(rev_walk_t *walk, int pos, size_t *interesting_queued)
+{
+    if (walk->flags[pos] & REV_SEEN)
+        return;
+    walk->flags[pos] |= REV_SEEN | REV_QUEUED;
+    if (!(walk->flags[pos] & REV_UNINTERESTING))
+        (*interesting_queued)++;
+    rev_queue_push(&walk->queue, &walk->repo->ctx->arena, pos);
+}
+
+/*
+ * Put the results in the order an unlimited walk over them alone would
+ * take: newest first as the walk reaches them, so a parent dated after
+ * its child still follows it. The walk passes through every commit taken
+ * as interesting, but keeps only those still interesting and no newer
+ * than `until`.
+ */
+static void order_results(rev_walk_t *walk)
+{
+    arena_t scratch = arena_init(0);
+    rev_queue_t queue = rev_queue_init(walk->repo, NULL);
+    size_t count = 0;
+    
+    for (size_t i = 0; i < walk->result_count; i++)
+        walk->flags[walk->results[i]] |= REV_PENDING;
+    for (size_t i = 0; i < walk->tip_count; i++) {
+        int pos = walk->tips[i].pos;
+        if (walk->flags[pos] & REV_PENDING) {
+            walk->flags[pos] &= (unsigned char)~REV_PENDING;
+            rev_queue_push(&queue, &scratch, pos);
+        }
+    }
+    while (queue.count > 0) {
+        int pos = rev_queue_pop(&queue);
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        if (!(walk->flags[pos] & REV_UNINTERESTING) && node->date <= walk->until)
+            walk->results[count++] = pos;
+        
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            if (walk->flags[parent] & REV_PENDING) {
+                walk->flags[parent] &= (unsigned char)~REV_PENDING;
+                rev_queue_push(&queue, &scratch, parent);
+            }
+        }
+    }
+    walk->result_count = count;
+    arena_free(&scratch);
+}
+
+/*
+ * Without generations, whether anything interesting is still to come:
+ * surely while the queue holds commits no older than the last one kept,
+ * or interesting ones, and otherwise for a few more commits.
+ */
+static int still_interesting(const rev_walk_t *walk, long long date, size_t interesting_queued, int slop)
+{
+    if (walk->queue.count == 0)
+        return 0;
+    if (date <= walk->repo->commits[walk->queue.items[0].pos].date || interesting_queued > 0)
+        return REV_SLOP;
+    return slop - 1;
+}
+
+static void limit_walk(rev_walk_t *walk, size_t interesting_queued)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    size_t alloc = 64;
+    long long date = LLONG_MAX;
+    int slop = REV_SLOP;
+    
+    walk->results = arena_alloc(arena, alloc * sizeof(*walk->results));
+    while (walk->queue.count > 0) {
+        int pos = rev_queue_pop(&walk->queue);
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        unsigned char *flags = &walk->flags[pos];
+        *flags &= (unsigned char)~REV_QUEUED;
+        if (node->date < walk->since && !(*flags & REV_UNINTERESTING)) {
+            *flags |= REV_UNINTERESTING;
+            interesting_queued--;
+        }
+        if (*flags & REV_UNINTERESTING) {
+            mark_parents_uninteresting(walk, pos, &interesting_queued);
+            for (int p = 0; p < node->parent_count; p++) {
+                mark_parents_uninteresting(walk, node->parents[p], &interesting_queued);
+                queue_commit(walk, node->parents[p], &interesting_queued);
+            }
+            if (walk->graph ? interesting_queued == 0 : (slop = still_interesting(walk, date, interesting_queued, slop)) == 0)
+                break;
+            continue;
+        }
+        
+        interesting_queued--;
+        if (walk->result_count == alloc) {
+            walk->results = arena_realloc(arena, walk->results, alloc * sizeof(*walk->results),
+                                          2 * alloc * sizeof(*walk->results));
+            alloc *= 2;
+        }
+        walk->results[walk->result_count++] = pos;
+        date = node->date;
+        for (int p = 0; p < node->parent_count; p++)
+            queue_commit(walk, node->parents[p], &interesting_queued);
+    }
+    
+    // Dates that run backwards can mark a commit after it was taken, so
+    // order_results() drops those along with the ones after --until
+    order_results(walk);
+}
+
+/*
+ * Sort the results so each commit follows all of its children. Commits
+ * ready to go are stacked, so a merge's last parent line is taken first
+ * and followed down until it joins the rest, as git does.
+ */
+static void sort_results_topo(rev_walk_t *walk)
+{
+    arena_t scratch = arena_init(0);
+    int *children = arena_calloc(&scratch, (size_t)walk->repo->commit_count + 1, sizeof(*children));
+    int *stack = arena_alloc(&scratch, (walk->result_count + 1) * sizeof(*stack));
+    int *sorted = arena_alloc(&walk->repo->ctx->arena, (walk->result_count + 1) * sizeof(*sorted));
+    size_t depth = 0, count = 0;
+    
+    for (size_t i = 0; i < walk->result_count; i++)
+        walk->flags[walk->results[i]] |= REV_PENDING;
+    for (size_t i = 0; i < walk->result_count; i++) {
+        const git_commit_node_t *node = &walk->repo->commits[walk->results[i]];
+        for (int p = 0; p < node->parent_count; p++) {
+            if (walk->flags[node->parents[p]] & REV_PENDING)
+                children[node->parents[p]]++;
+        }
+    }
+    
+    // Stacked oldest first, so the newest commit without children comes off first
+    for (size_t i = walk->result_count; i-- > 0;) {
+        if (children[walk->results[i]] == 0)
+            stack[depth++] = walk->results[i];
+    }
+    while (depth > 0) {
+        int pos = stack[--depth];
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        walk->flags[pos] &= (unsigned char)~REV_PENDING;
+        sorted[count++] = pos;
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            if ((walk->flags[parent] & REV_PENDING) && --children[parent] == 0)
+                stack[depth++] = parent;
+        }
+    }
+    walk->results = sorted;
+    walk->result_count = count;
+    arena_free(&scratch);
+}
+
+/*
+ * Take commits off the generation queue down to `generation`, counting
+ * each as a child of its parents. An indegree of 0 means not reached yet,
+ * so a commit is ready once its count is back to 1: every child that can
+ * reach it has a higher generation and has been counted and taken.
+ */
+static void count_indegrees(rev_walk_t *walk, uint32_t generation)
+{
+    const uint32_t *generations = walk->graph->generations;
+    
+    while (walk->queue.count > 0 && generations[walk->queue.items[0].pos] >= generation) {
+        const git_commit_node_t *node = &walk->repo->commits[rev_queue_pop(&walk->queue)];
+        if (node->date < walk->since)
+            continue;
+        
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            if (walk->indegree[parent] > 0) {
+                walk->indegree[parent]++;
+                continue;
+            }
+            walk->indegree[parent] = 2;
+            rev_queue_push(&walk->queue, &walk->repo->ctx->arena, parent);
+        }
+    }
+}
+
+static void prepare_topo_walk(rev_walk_t *walk)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    arena_t scratch = arena_init(0);
+    rev_queue_t by_date = rev_queue_init(walk->repo, NULL);
+    size_t count = (size_t)walk->repo->commit_count + 1;
+    
+    walk->indegree = arena_calloc(arena, count, sizeof(*walk->indegree));
+    walk->topo_stack = arena_alloc(arena, count * sizeof(*walk->topo_stack));
+    walk->min_generation = UINT32_MAX;
+    for (size_t i = 0; i < walk->tip_count; i++) {
+        int pos = walk->tips[i].pos;
+        if (walk->indegree[pos] == 0) {
+            walk->indegree[pos] = 1;
+            if (walk->graph->generations[pos] < walk->min_generation)
+                walk->min_generation = walk->graph->generations[pos];
+            rev_queue_push(&by_date, &scratch, pos);
+        }
+    }
+    count_indegrees(walk, walk->min_generation);
+    
+    // Tips no other tip reaches are stacked oldest first, to come off newest first
+    int *tips = arena_alloc(&scratch, (by_date.count + 1) * sizeof(*tips));
+    size_t tip_count = 0;
+    for (int pos; (pos = rev_queue_pop(&by_date)) >= 0;)
+        tips[tip_count++] = pos;
+    while (tip_count > 0) {
+        int pos = tips[--tip_count];
+        if (walk->indegree[pos] == 1)
+            walk->topo_stack[walk->topo_count++] = pos;
+    }
+    arena_free(&scratch);
+}
+
+static int next_in_date_order(rev_walk_t *walk)
+{
+    for (int pos; (pos = rev_queue_pop(&walk->queue)) >= 0;) {
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        size_t interesting_queued = 0;
+        
+        // Like an uninteresting commit in a limited walk, one before
+        // --since ends the walk along its line of history
+        if (node->date < walk->since)
+            continue;
+        
+        for (int p = 0; p < node->parent_count; p++)
+            queue_commit(walk, node->parents[p], &interesting_queued);
+        if (node->date <= walk->until)
+            return pos;
+    }
+    return -1;
+}
+
+static int next_in_topo_order(rev_walk_t *walk)
+{
+    const uint32_t *generations = walk->graph->generations;
+    
+    while (walk->topo_count > 0) {
+        int pos = walk->topo_stack[--walk->topo_count];
+        const git_commit_node_t *node = &walk->repo->commits[pos];
+        if (node->date < walk->since)
+            continue;
+        
+        for (int p = 0; p < node->parent_count; p++) {
+            int parent = node->parents[p];
+            if (generations[parent] < walk->min_generation) {
+                walk->min_generation = generations[parent];
+                count_indegrees(walk, walk->min_generation);
+            }
+            if (--walk->indegree[parent] == 1)
+                walk->topo_stack[walk->topo_count++] = parent;
+        }
+        if (node->date <= walk->until)
+            return pos;
+    }
+    return -1;
+}
+
+/* The whole unlimited walk, for a topological order without generations. */
+static void collect_walk(rev_walk_t *walk)
+{
+    arena_t *arena = &walk->repo->ctx->arena;
+    size_t alloc = 64;
+    
+    walk->results = arena_alloc(arena, alloc * sizeof(*walk->results));
+    for (int pos; (pos = next_in_date_order(walk)) >= 0;) {
+        if (walk->result_count == alloc) {
+            walk->results = arena_realloc(arena, walk->results, alloc * sizeof(*walk->results),
+                                          2 * alloc * sizeof(*walk->results));
+            alloc *= 2;
+        }
+        walk->results[walk->result_count++] = pos;
+    }
+}
+
+static void prepare_walk(rev_walk_t *walk)
+{
+    size_t interesting_queued = 0;
+    
+    walk->prepared = true;
+    if (walk->limited || walk->topo_order)
+        walk->graph = commit_graph_open(walk->repo);
+    walk->queue = rev_queue_init(walk->repo, walk->graph ? walk->graph->generations : NULL);
+    
+    for (size_t i = 0; i < walk->tip_count; i++) {
+        if (walk->tips[i].uninteresting)
+            walk->flags[walk->tips[i].pos] |= REV_UNINTERESTING;
+    }
+    for (size_t i = 0; i < walk->tip_count; i++)
+        queue_commit(walk, walk->tips[i].pos, &interesting_queued);
+    if (walk->limited)
+        limit_walk(walk, interesting_queued);
+    else if (walk->topo_order && walk->graph)
+        prepare_topo_walk(walk);
+    else if (walk->topo_order)
+        collect_walk(walk);
+    if (walk->topo_order && walk->results)
+        sort_results_topo(walk);
+}
+
+int rev_walk_next(rev_walk_t *walk)
+{
+    if (!walk->prepared)
+        prepare_walk(walk);
+    if (walk->results)
+        return walk->next_result < walk->result_count ? walk->results[walk->next_result++] : -1;
+    return walk->indegree ? next_in_topo_order(walk) : next_in_date_order(walk);
+}
+
+bool rev_walk_excluded(const rev_walk_t *walk, int pos)
+{
+    return (walk->flags[pos] & REV_UNINTERESTING) != 0;
+}
@@ -0,0 +1,345 @@
+#include "shortlog.h"
+#include <pthread.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define SHORTLOG_MAX_WORKERS   64
+#define SHORTLOG_MIN_BATCH     1024
+#define SHORTLOG_MAX_IDENTS    32
+#define SHORTLOG_TABLE_INITIAL 64
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+typedef struct {
+    const char *text;
+    size_t len;
+} span_t;
+
+typedef struct {
+    uint32_t commit;
+    uint32_t entry;
+} shortlog_hit_t;
+
+typedef struct {
+    git_repository_t *repo;
+    const int *positions;
+    const shortlog_options_t *opts;
+    size_t begin;
+    size_t end;
+    arena_t arena;
+    shortlog_table_t table;
+    shortlog_hit_t *hits;
+    size_t hit_count;
+    size_t hit_alloc;
+    bool failed;
+} shortlog_worker_t;
+
+// The hash of the spans one after another, as of the string they make
+static uint64_t spans_hash(const span_t *spans, size_t count)
+{
+    uint64_t hash = FNV_OFFSET;
+    
+    for (size_t s = 0; s < count; s++) {
+        for (size_t i = 0; i < spans[s].len; i++)
+            hash = (hash ^ (unsigned char)spans[s].text[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool spans_equal(const shortlog_entry_t *entry, const span_t *spans, size_t count)
+{
+    size_t at = 0;
+    
+    for (size_t s = 0; s < count; s++) {
+        if (at + spans[s].len > entry->len || memcmp(entry->ident + at, spans[s].text, spans[s].len) != 0)
+            return false;
+        at += spans[s].len;
+    }
+    return at == entry->len;
+}
+
+static void table_init(shortlog_table_t *table, arena_t *arena)
+{
+    *table = (shortlog_table_t){
+        .slots = arena_calloc(arena, SHORTLOG_TABLE_INITIAL, sizeof(*table->slots)),
+        .capacity = SHORTLOG_TABLE_INITIAL,
+    };
+}
+
+static void table_grow(shortlog_table_t *table, arena_t *arena)
+{
+    size_t capacity = table->capacity * 2;
+    uint32_t *slots = arena_calloc(arena, capacity, sizeof(*slots));
+    
+    for (size_t i = 0; i < table->count; i++) {
+        size_t slot = (size_t)(table->entries[i].hash & (capacity - 1));
+        while (slots[slot])
+            slot = (slot + 1) & (capacity - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+}
+
+/*
+ * The entry for the identity the spans spell, added on first sight with
+ * a copy of them: every later lookup of it compares in place.
+ */
+static uint32_t table_intern(shortlog_table_t *table, arena_t *arena, const span_t *spans, size_t count)
+{
+    uint64_t hash = spans_hash(spans, count);
+    size_t slot = (size_t)(hash & (table->capacity - 1));
+    
+    for (; table->slots[slot]; slot = (slot + 1) & (table->capacity - 1)) {
+        const shortlog_entry_t *entry = &table->entries[table->slots[slot] - 1];
+        if (entry->hash == hash && spans_equal(entry, spans, count))
+            return table->slots[slot] - 1;
+    }
+    
+    if ((table->count + 1) * 2 > table->capacity) {
+        table_grow(table, arena);
+        slot = (size_t)(hash & (table->capacity - 1));
+        while (table->slots[slot])
+            slot = (slot + 1) & (table->capacity - 1);
+    }
+    if (table->count == table->alloc) {
+        size_t alloc = table->alloc ? table->alloc * 2 : 16;
+        table->entries = arena_realloc(arena, table->entries, table->alloc * sizeof(*table->entries),
+                                       alloc * sizeof(*table->entries));
+        table->alloc = alloc;
+    }
+    
+    size_t len = 0;
+    for (size_t s = 0; s < count; s++)
+        len += spans[s].len;
+    char *ident = arena_alloc(arena, len + 1);
+    len = 0;
+    for (size_t s = 0; s < count; s++) {
+        memcpy(ident + len, spans[s].text, spans[s].len);
+        len += spans[s].len;
+    }
+    ident[len] = '\0';
+    
+    table->entries[table->count] = (shortlog_entry_t){ .ident = ident, .len = len, .hash = hash };
+    table->slots[slot] = (uint32_t)++table->count;
+    return (uint32_t)(table->count - 1);
+}
+
+static const char* find_blank_line(const char *text, const char *end)
+{
+    for (const char *p = text; (p = memchr(p, '\n', (size_t)(end - p))) && p + 1 < end; p++) {
+        if (p[1] == '\n')
+            return p;
+    }
+    return NULL;
+}
+
+/*
+ * "Name <email>" in `text`, the email left out of a value without one,
+ * as a trailer may be. Returns false for an empty name.
+ */
+static bool parse_ident(const char *text, const char *end, span_t *name, span_t *email)
+{
+    const char *open = memchr(text, '<', (size_t)(end - text));
+    const char *close = open ? memchr(open, '>', (size_t)(end - open)) : NULL;
+    const char *name_end = close ? open : end;
+    
+    while (text < name_end && (*text == ' ' || *text == '\t'))
+        text++;
+    while (name_end > text && (name_end[-1] == ' ' || name_end[-1] == '\t'))
+        name_end--;
+    *name = (span_t){ text, (size_t)(name_end - text) };
+    *email = close ? (span_t){ open + 1, (size_t)(close - open - 1) } : (span_t){ NULL, 0 };
+    return name->len > 0;
+}
+
+static void count_ident(shortlog_worker_t *worker, size_t commit, span_t name, span_t email, uint32_t *seen,
+                        size_t *seen_count)
+{
+    const shortlog_options_t *opts = worker->opts;
+    
+    if (opts->mailmap && email.text)
+        mailmap_map(opts->mailmap, &name.text, &name.len, &email.text, &email.len);
+    
+    span_t spans[4] = { name, { " <", 2 }, email, { ">", 1 } };
+    uint32_t entry = table_intern(&worker->table, &worker->arena, spans, opts->email && email.text ? 4 : 1);
+    for (size_t i = 0; i < *seen_count; i++) {
+        if (seen[i] == entry)
+            return;
+    }
+    if (*seen_count < SHORTLOG_MAX_IDENTS)
+        seen[(*seen_count)++] = entry;
+    
+    worker->table.entries[entry].count++;
+    if (!opts->subjects)
+        return;
+    if (worker->hit_count == worker->hit_alloc) {
+        size_t alloc = worker->hit_alloc ? worker->hit_alloc * 2 : 256;
+        worker->hits = arena_realloc(&worker->arena, worker->hits, worker->hit_alloc * sizeof(*worker->hits),
+                                     alloc * sizeof(*worker->hits));
+        worker->hit_alloc = alloc;
+    }
+    worker->hits[worker->hit_count++] = (shortlog_hit_t){ (uint32_t)commit, entry };
+}
+
+static void count_header(shortlog_worker_t *worker, size_t commit, const char *header, const char *end,
+                         const char *key, uint32_t *seen, size_t *seen_count)
+{
+    size_t key_len = strlen(key);
+    span_t name, email;
+    
+    for (const char *line = header; line < end;) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        eol = eol ? eol : end;
+        if ((size_t)(eol - line) > key_len && memcmp(line, key, key_len) == 0) {
+            if (parse_ident(line + key_len, eol, &name, &email))
+                count_ident(worker, commit, name, email, seen, seen_count);
+            return;
+        }
+        line = eol + 1;
+    }
+}
+
+/* "Key: value" lines of the last paragraph, when it is not the subject. */
+static void count_trailers(shortlog_worker_t *worker, size_t commit, const char *message, const char *end,
+                           uint32_t *seen, size_t *seen_count)
+{
+    const shortlog_options_t *opts = worker->opts;
+    const char *block = NULL;
+    span_t name, email;
+    
+    for (const char *blank = message; (blank = find_blank_line(blank, end)); blank++)
+        block = blank + 2;
+    if (!block)
+        return;
+    
+    for (const char *line = block; line < end;) {
+        const char *eol = memchr(line, '\n', (size_t)(end - line));
+        eol = eol ? eol : end;
+        const char *colon = memchr(line, ':', (size_t)(eol - line));
+        for (size_t t = 0; colon && t < opts->trailer_count; t++) {
+            size_t key_len = strlen(opts->trailers[t]);
+            if ((size_t)(colon - line) == key_len && strncasecmp(line, opts->trailers[t], key_len) == 0 &&
+                parse_ident(colon + 1, eol, &name, &email))
+                count_ident(worker, commit, name, email, seen, seen_count);
+        }
+        line = eol + 1;
+    }
+}
+
+static void* shortlog_worker(void *arg)
+{
+    shortlog_worker_t *worker = arg;
+    unsigned groups = worker->opts->groups;
+    
+    for (size_t i = worker->begin; i < worker->end; i++) {
+        const git_object_t *object = worker->repo->commits[worker->positions[i]].object;
+        if (!object) {
+            worker->failed = true;
+            break;
+        }
+        
+        const char *data = object->data, *end = data + object->size;
+        const char *blank = find_blank_line(data, end);
+        const char *header_end = blank ? blank + 1 : end;
+        uint32_t seen[SHORTLOG_MAX_IDENTS];
+        size_t seen_count = 0;
+        
+        if (groups & SHORTLOG_GROUP_AUTHOR)
+            count_header(worker, i, data, header_end, "author ", seen, &seen_count);
+        if (groups & SHORTLOG_GROUP_COMMITTER)
+            count_header(worker, i, data, header_end, "committer ", seen, &seen_count);
+        if ((groups & SHORTLOG_GROUP_TRAILER) && blank)
+            count_trailers(worker, i, blank + 2, end, seen, &seen_count);
+    }
+    return NULL;
+}
+
+/*
+ * Fold the per-thread tables into `out` in run order. Each identity's
+ * commits get a stretch of one array, sized by its count, which the hits
+ * then fill in the order they were made.
+ */
+static void merge_workers(shortlog_worker_t *workers, int worker_count, const shortlog_options_t *opts,
+                          arena_t *arena, shortlog_table_t *out)
+{
+    uint32_t *maps[SHORTLOG_MAX_WORKERS];
+    size_t total = 0;
+    
+    table_init(out, arena);
+    for (int w = 0; w < worker_count; w++) {
+        const shortlog_table_t *table = &workers[w].table;
+        maps[w] = arena_alloc(&workers[w].arena, (table->count + 1) * sizeof(*maps[w]));
+        for (size_t e = 0; e < table->count; e++) {
+            span_t key = { table->entries[e].ident, table->entries[e].len };
+            maps[w][e] = table_intern(out, arena, &key, 1);
+            out->entries[maps[w][e]].count += table->entries[e].count;
+            total += table->entries[e].count;
+        }
+    }
+    if (!opts->subjects)
+        return;
+    
+    size_t *commits = arena_alloc(arena, (total + 1) * sizeof(*commits));
+    size_t *fill = arena_calloc(arena, out->count + 1, sizeof(*fill));
+    for (size_t e = 0, at = 0; e < out->count; e++) {
+        out->entries[e].commits = commits + at;
+        at += out->entries[e].count;
+    }
+    for (int w = 0; w < worker_count; w++) {
+        for (size_t h = 0; h < workers[w].hit_count; h++) {
+            uint32_t entry = maps[w][workers[w].hits[h].entry];
+            out->entries[entry].commits[fill[entry]++] = workers[w].hits[h].commit;
+        }
+    }
+}
+
+int shortlog_collect(git_repository_t *repo, const int *positions, size_t count, const shortlog_options_t *opts,
+                     int workers, arena_t *arena, shortlog_table_t *out)
+{
+    if (workers <= 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > SHORTLOG_MAX_WORKERS)
+        workers = SHORTLOG_MAX_WORKERS;
+    if ((size_t)workers > count / SHORTLOG_MIN_BATCH)
+        workers = (int)(count / SHORTLOG_MIN_BATCH);
+    if (workers < 1)
+        workers = 1;
+    
+    shortlog_worker_t slots[SHORTLOG_MAX_WORKERS];
+    pthread_t threads[SHORTLOG_MAX_WORKERS];
+    for (int w = 0; w < workers; w++) {
+        slots[w] = (shortlog_worker_t){
+            .repo = repo,
+            .positions = positions,
+            .opts = opts,
+            .begin = count * (size_t)w / (size_t)workers,
+            .end = count * (size_t)(w + 1) / (size_t)workers,
+            .arena = arena_init(0),
+        };
+        table_init(&slots[w].table, &slots[w].arena);
+    }
+    
+    // The main thread takes the first run, and any whose thread failed to start
+    bool running[SHORTLOG_MAX_WORKERS] = { false };
+    for (int w = 1; w < workers; w++)
+        running[w] = pthread_create(&threads[w], NULL, shortlog_worker, &slots[w]) == 0;
+    for (int w = 0; w < workers; w++) {
+        if (!running[w])
+            shortlog_worker(&slots[w]);
+    }
+    for (int w = 1; w < workers; w++) {
+        if (running[w])
+            pthread_join(threads[w], NULL);
+    }
+    
+    bool failed = false;
+    for (int w = 0; w < workers; w++)
+        failed |= slots[w].failed;
+    if (!failed)
+        merge_workers(slots, workers, opts, arena, out);
+    for (int w = 0; w < workers; w++)
+        arena_free(&slots[w].arena);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,186 @@
+#include "sparse_checkout.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config_utils.h"
+#include "parallel_checkout.h"
+#include "repository.h"
+#include "sparse_index.h"
+
+#define DIR_SET_INITIAL_CAPACITY 32
+
+static uint32_t hash_dir(const char *dir, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char)dir[i]) * 16777619u;
+    return hash;
+}
+
+static const char** dir_set_slot(const sparse_dir_set_t *set, const char *dir, size_t len)
+{
+    size_t mask = set->capacity - 1;
+    size_t pos = hash_dir(dir, len) & mask;
+    
+    while (set->slots[pos]) {
+        if (strncmp(set->slots[pos], dir, len) == 0 && set->slots[pos][len] == '\0')
+            break;
+        pos = (pos + 1) & mask;
+    }
+    return &set->slots[pos];
+}
+
+static bool dir_set_contains(const sparse_dir_set_t *set, const char *dir, size_t len)
+{
+    return set->count > 0 && *dir_set_slot(set, dir, len) != NULL;
+}
+
+static void dir_set_insert(arena_t *arena, sparse_dir_set_t *set, const char *dir, size_t len)
+{
+    // Kept at most half full so probe sequences stay short
+    if ((set->count + 1) * 2 > set->capacity) {
+        sparse_dir_set_t grown = {
+            .capacity = set->capacity ? set->capacity * 2 : DIR_SET_INITIAL_CAPACITY,
+            .count = set->count,
+        };
+        grown.slots = arena_calloc(arena, grown.capacity, sizeof(*grown.slots));
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (set->slots[i])
+                *dir_set_slot(&grown, set->slots[i], strlen(set->slots[i])) = set->slots[i];
+        }
+        *set = grown;
+    }
+    
+    const char **slot = dir_set_slot(set, dir, len);
+    if (!*slot) {
+        *slot = arena_strndup(arena, dir, len);
+        set->count++;
+    }
+}
+
+void sparse_checkout_init(git_sparse_checkout_t *sc, arena_t *arena)
+{
+    memset(sc, 0, sizeof(*sc));
+    sc->arena = arena;
+}
+
+void sparse_checkout_clear(git_sparse_checkout_t *sc)
+{
+    sc->recursive = (sparse_dir_set_t){ 0 };
+    sc->parents = (sparse_dir_set_t){ 0 };
+    sc->dir_count = 0;
+}
+
+bool sparse_checkout_add_dir(git_sparse_checkout_t *sc, const char *dir)
+{
+    while (*dir == '/')
+        dir++;
+    size_t len = strlen(dir);
+    while (len > 0 && dir[len - 1] == '/')
+        len--;
+    if (len == 0 || dir_set_contains(&sc->recursive, dir, len))
+        return false;
+    
+    dir_set_insert(sc->arena, &sc->recursive, dir, len);
+    for (size_t i = 0; i < len; i++) {
+        if (dir[i] == '/')
+            dir_set_insert(sc->arena, &sc->parents, dir, i);
+    }
+    
+    // The sorted list only serves `sparse-checkout list`
+    const char *copy = arena_strndup(sc->arena, dir, len);
+    size_t insert_at = 0;
+    while (insert_at < sc->dir_count && strcmp(sc->dirs[insert_at], copy) < 0)
+        insert_at++;
+    if (sc->dir_count == sc->dir_alloc) {
+        size_t new_alloc = sc->dir_alloc ? sc->dir_alloc * 2 : 8;
+        sc->dirs = arena_realloc(sc->arena, sc->dirs, sc->dir_alloc * sizeof(*sc->dirs),
+                                 new_alloc * sizeof(*sc->dirs));
+        sc->dir_alloc = new_alloc;
+    }
+    memmove(&sc->dirs[insert_at + 1], &sc->dirs[insert_at], (sc->dir_count - insert_at) * sizeof(*sc->dirs));
+    sc->dirs[insert_at] = copy;
+    sc->dir_count++;
+    return true;
+}
+
+bool sparse_checkout_includes(const git_sparse_checkout_t *sc, const char *path)
+{
+    if (!sc->enabled)
+        return true;
+    
+    const char *last_slash = strrchr(path, '/');
+    if (!last_slash)
+        return true;
+    
+    for (const char *slash = strchr(path, '/'); slash; slash = strchr(slash + 1, '/')) {
+        if (dir_set_contains(&sc->recursive, path, (size_t)(slash - path)))
+            return true;
+    }
+    return dir_set_contains(&sc->parents, path, (size_t)(last_slash - path));
+}
+
+bool sparse_checkout_excludes_dir(const git_sparse_checkout_t *sc, const char *dir, size_t len)
+{
+    if (!sc->enabled || dir_set_contains(&sc->parents, dir, len))
+        return false;
+    
+    for (size_t i = 1; i <= len; i++) {
+        if ((i == len || dir[i] == '/') && dir_set_contains(&sc->recursive, dir, i))
+            return false;
+    }
+    return true;
+}
+
+static bool worktree_file_is_clean(const git_repository_t *repo, const git_index_entry_t *entry)
+{
+    const git_worktree_file_t *file = repo_worktree_file(repo, entry->path);
+    if (!file)
+        return true;
+    if (index_entry_stat_matches(entry, &file->stat) && !index_entry_is_racy(&repo->index, entry))
+        return true;
+    
+    git_oid_t oid;
+    oid_hash_object("blob", file->content, file->stat.size, &oid);
+    return oid_cmp(&oid, &entry->oid) == 0;
+}
+
+int sparse_checkout_update_worktree(git_repository_t *repo)
+{
+    parallel_checkout_t pc = parallel_checkout_init(repo);
+    size_t kept = 0;
+    
+    // Directories may be entering the cone, so work on the full index
+    sparse_index_ensure_full(&repo->index, &repo->odb);
+    
+    for (size_t i = 0; i < repo->index.count; i++) {
+        git_index_entry_t *entry = &repo->index.entries[i];
+        bool included = sparse_checkout_includes(&repo->sparse, entry->path);
+        
+        if (included && entry->skip_worktree) {
+            entry->skip_worktree = false;
+            if (!repo_worktree_file(repo, entry->path))
+                parallel_checkout_add(&pc, entry->path, &entry->oid, entry->mode);
+            continue;
+        }
+        if (included || entry->skip_worktree)
+            continue;
+        
+        if (!worktree_file_is_clean(repo, entry)) {
+            if (kept++ == 0)
+                printf("warning: The following paths are not up to date and were left despite sparse patterns:\n");
+            printf("\t%s\n", entry->path);
+            continue;
+        }
+        entry->skip_worktree = true;
+        repo_remove_worktree_file(repo, entry->path);
+    }
+    
+    if (parallel_checkout_run(&pc) < 0)
+        return -1;
+    if (config_get_bool(repo->ctx, "index.sparse", false))
+        sparse_index_convert(&repo->index, &repo->odb, &repo->sparse);
+    return 0;
+}
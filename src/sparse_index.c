@@ -0,0 +1,224 @@
+#include "sparse_index.h"
+#include <string.h>
+
+#include "strbuf.h"
+#include "tree.h"
+
+typedef struct {
+    git_index_t *index;
+    const git_odb_t *odb;
+    git_index_entry_t *entries;
+    size_t count;
+    size_t alloc;
+} expand_state_t;
+
+static bool entries_all_skipped(const git_index_t *index, size_t first, size_t count)
+{
+    for (size_t i = first; i < first + count; i++) {
+        if (!index->entries[i].skip_worktree)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Compact the entries covered by `tree` in place, replacing each excluded
+ * subtree by one directory entry. Needs a fully valid cache-tree, whose
+ * entry counts are rewritten to match the collapsed index.
+ */
+static void collapse_tree(git_index_t *index, const git_sparse_checkout_t *sc, cache_tree_t *tree,
+                          size_t *read, size_t *write, size_t prefix_len, int *collapsed)
+{
+    size_t end = *read + (size_t)tree->entry_count;
+    size_t first_written = *write;
+    
+    while (*read < end) {
+        git_index_entry_t entry = index->entries[*read];
+        const char *name = entry.path + prefix_len;
+        const char *slash = strchr(name, '/');
+        
+        if (!slash || (index_entry_is_sparse_dir(&entry) && slash[1] == '\0')) {
+            index->entries[(*write)++] = entry;
+            (*read)++;
+            continue;
+        }
+        
+        size_t dir_len = prefix_len + (size_t)(slash - name);
+        cache_tree_t *sub = cache_tree_subtree(tree, name, (size_t)(slash - name));
+        
+        if (!sparse_checkout_excludes_dir(sc, entry.path, dir_len) ||
+            !entries_all_skipped(index, *read, (size_t)sub->entry_count)) {
+            collapse_tree(index, sc, sub, read, write, dir_len + 1, collapsed);
+            continue;
+        }
+        
+        index->entries[(*write)++] = (git_index_entry_t){
+            .path = arena_strndup(index->arena, entry.path, dir_len + 1),
+            .oid = sub->oid,
+            .mode = GIT_MODE_DIR,
+            .skip_worktree = true,
+        };
+        *read += (size_t)sub->entry_count;
+        sub->entry_count = 1;
+        sub->subtree_count = 0;
+        (*collapsed)++;
+    }
+    tree->entry_count = (int)(*write - first_written);
+}
+
+int sparse_index_convert(git_index_t *index, git_odb_t *odb, const git_sparse_checkout_t *sc)
+{
+    if (!sc->enabled)
+        return 0;
+    
+    cache_tree_update(index, odb);
+    
+    size_t read = 0, write = 0;
+    int collapsed = 0;
+    collapse_tree(index, sc, index->cache_tree, &read, &write, 0, &collapsed);
+    index->count = write;
+    index->sparse = true;
+    return collapsed;
+}
+
+static void push_entry(expand_state_t *st, const git_index_entry_t *entry)
+{
+    if (st->count == st->alloc) {
+        size_t new_alloc = st->alloc * 2;
+        st->entries = arena_realloc(st->index->arena, st->entries, st->alloc * sizeof(*st->entries),
+                                    new_alloc * sizeof(*st->entries));
+        st->alloc = new_alloc;
+    }
+    st->entries[st->count++] = *entry;
+}
+
+static int expand_tree(expand_state_t *st, const git_oid_t *tree_oid, strbuf_t *path, cache_tree_t *node)
+{
+    arena_t *arena = st->index->arena;
+    git_tree_iter_t it = tree_iter_init(odb_read(st->odb, tree_oid));
+    git_tree_entry_t entry;
+    size_t base_len = path->len;
+    int count = 0, subtree_alloc = 0;
+    
+    node->oid = *tree_oid;
+    node->subtrees = NULL;
+    node->subtree_count = 0;
+    
+    while (tree_iter_next(&it, &entry)) {
+        strbuf_add(path, entry.name, entry.name_len);
+        
+        if (tree_entry_is_dir(&entry)) {
+            if (node->subtree_count == subtree_alloc) {
+                int new_alloc = subtree_alloc ? subtree_alloc * 2 : 4;
+                node->subtrees = arena_realloc(arena, node->subtrees,
+                                               (size_t)subtree_alloc * sizeof(*node->subtrees),
+                                               (size_t)new_alloc * sizeof(*node->subtrees));
+                subtree_alloc = new_alloc;
+            }
+            cache_tree_t *sub = cache_tree_new(arena, entry.name, entry.name_len);
+            node->subtrees[node->subtree_count++] = sub;
+            strbuf_addch(path, '/');
+            count += expand_tree(st, entry.oid, path, sub);
+        } else {
+            git_index_entry_t file = {
+                .path = arena_strndup(arena, path->buf, path->len),
+                .oid = *entry.oid,
+                .mode = entry.mode,
+                .skip_worktree = true,
+            };
+            push_entry(st, &file);
+            count++;
+        }
+        
+        path->len = base_len;
+        path->buf[base_len] = '\0';
+    }
+    node->entry_count = count;
+    return count;
+}
+
+/*
+ * Find the cache-tree node of the sparse directory `dir` ("a/b/") and
+ * add `delta` to the entry count of each valid ancestor.
+ */
+static cache_tree_t* adjust_ancestors(cache_tree_t *root, const char *dir, int delta)
+{
+    cache_tree_t *tree = root;
+    const char *name = dir;
+    
+    while (tree) {
+        if (tree->entry_count >= 0)
+            tree->entry_count += delta;
+        
+        const char *slash = strchr(name, '/');
+        cache_tree_t *sub = cache_tree_subtree(tree, name, (size_t)(slash - name));
+        if (slash[1] == '\0')
+            return sub;
+        tree = sub;
+        name = slash + 1;
+    }
+    return NULL;
+}
+
+void sparse_index_ensure_full(git_index_t *index, const git_odb_t *odb)
+{
+    if (!index->sparse)
+        return;
+    
+    expand_state_t st = {
+        .index = index,
+        .odb = odb,
+        .alloc = index->count * 2 + 16,
+    };
+    st.entries = arena_alloc(index->arena, st.alloc * sizeof(*st.entries));
+    strbuf_t path = strbuf_init(index->arena, 256);
+    
+    for (size_t i = 0; i < index->count; i++) {
+        const git_index_entry_t *entry = &index->entries[i];
+        if (!index_entry_is_sparse_dir(entry)) {
+            push_entry(&st, entry);
+            continue;
+        }
+        
+        cache_tree_t *node = adjust_ancestors(index->cache_tree, entry->path, 0);
+        bool tracked = node != NULL;
+        if (!tracked) {
+            cache_tree_invalidate_path(index->cache_tree, entry->path);
+            node = cache_tree_new(index->arena, "", 0);
+        }
+        
+        strbuf_reset(&path);
+        strbuf_addstr(&path, entry->path);
+        int count = expand_tree(&st, &entry->oid, &path, node);
+        if (tracked)
+            adjust_ancestors(index->cache_tree, entry->path, count - 1);
+    }
+    
+    index->entries = st.entries;
+    index->count = st.count;
+    index->alloc = st.alloc;
+    index->sparse = false;
+}
+
+long sparse_index_find_dir(const git_index_t *index, const char *path)
+{
+    if (!index->sparse)
+        return -1;
+    
+    long pos = index_find(index, path);
+    if (pos >= 0 || pos == -1)
+        return -1;
+    
+    // Nothing can sort between a sparse directory and the paths it hides
+    const git_index_entry_t *entry = &index->entries[-pos - 2];
+    size_t len = strlen(entry->path);
+    if (index_entry_is_sparse_dir(entry) && strncmp(entry->path, path, len) == 0)
+        return -pos - 2;
+    return -1;
+}
+
+void sparse_index_expand_for_path(git_index_t *index, const git_odb_t *odb, const char *path)
+{
+    if (sparse_index_find_dir(index, path) >= 0)
+        sparse_index_ensure_full(index, odb);
+}
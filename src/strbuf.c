@@ -0,0 +1,78 @@
+#include "strbuf.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STRBUF_MIN_ALLOC 64
+
+strbuf_t strbuf_init(arena_t *arena, size_t hint)
+{
+    strbuf_t sb = {
+        .arena = arena,
+        .buf = NULL,
+        .len = 0,
+        .alloc = 0,
+    };
+    strbuf_grow(&sb, hint);
+    return sb;
+}
+
+void strbuf_grow(strbuf_t *sb, size_t extra)
+{
+    size_t needed = sb->len + extra + 1;
+    if (needed <= sb->alloc)
+        return;
+    
+    size_t new_alloc = sb->alloc ? sb->alloc : STRBUF_MIN_ALLOC;
+    while (new_alloc < needed)
+        new_alloc *= 2;
+    
+    sb->buf = arena_realloc(sb->arena, sb->buf, sb->alloc, new_alloc);
+    if (sb->alloc == 0)
+        sb->buf[0] = '\0';
+    sb->alloc = new_alloc;
+}
+
+void strbuf_add(strbuf_t *sb, const char *data, size_t len)
+{
+    strbuf_grow(sb, len);
+    memcpy(sb->buf + sb->len, data, len);
+    sb->len += len;
+    sb->buf[sb->len] = '\0';
+}
+
+void strbuf_addstr(strbuf_t *sb, const char *str)
+{
+    strbuf_add(sb, str, strlen(str));
+}
+
+void strbuf_addch(strbuf_t *sb, char c)
+{
+    strbuf_grow(sb, 1);
+    sb->buf[sb->len++] = c;
+    sb->buf[sb->len] = '\0';
+}
+
+void strbuf_addf(strbuf_t *sb, const char *format, ...)
+{
+    va_list args, args_copy;
+    
+    va_start(args, format);
+    va_copy(args_copy, args);
+    int len = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    
+    if (len > 0) {
+        strbuf_grow(sb, (size_t)len);
+        vsnprintf(sb->buf + sb->len, (size_t)len + 1, format, args);
+        sb->len += (size_t)len;
+    }
+    va_end(args);
+}
+
+void strbuf_reset(strbuf_t *sb)
+{
+    sb->len = 0;
+    if (sb->buf)
+        sb->buf[0] = '\0';
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+
+#include "colors.h"
+#include "revision.h"
+#include "tracking.h"
+
+tracking_t tracking_find(git_repository_t *repo, bool count)
+{
+    tracking_t tracking = { .upstream = rev_upstream_name(repo, "HEAD") };
+    
+    if (!tracking.upstream)
+        return tracking;
+    
+    int upstream = rev_resolve(repo, tracking.upstream);
+    if (upstream < 0 || repo->head < 0) {
+        tracking.state = TRACKING_GONE;
+        return tracking;
+    }
+    
+    tracking.state = TRACKING_COUNTED;
+    if (count)
+        merge_base_ahead_behind(repo, &repo->head, &upstream, 1, &tracking.counts);
+    else if (upstream != repo->head)
+        tracking.state = TRACKING_DIFFERENT;
+    return tracking;
+}
+
+void tracking_print(const tracking_t *tracking)
+{
+    int ahead = tracking->counts.ahead, behind = tracking->counts.behind;
+    
+    switch (tracking->state) {
+    case TRACKING_NONE:
+        break;
+    case TRACKING_GONE:
+        printf("Your branch is based on '" COLOR_CYAN("%s") "', but the upstream is gone.\n"
+               "  (use \"git branch --unset-upstream\" to fixup)\n", tracking->upstream);
+        break;
+    case TRACKING_DIFFERENT:
+        printf("Your branch and '" COLOR_CYAN("%s") "' refer to different commits.\n"
+               "  (use \"git status --ahead-behind\" for details)\n", tracking->upstream);
+        break;
+    case TRACKING_COUNTED:
+        if (ahead && behind)
+            printf("Your branch and '" COLOR_CYAN("%s") "' have diverged,\n"
+                   "and have %d and %d different commits each, respectively.\n"
+                   "  (use \"git pull\" to merge the remote branch into yours)\n", tracking->upstream, ahead, behind);
+        else if (ahead)
+            printf("Your branch is ahead of '" COLOR_CYAN("%s") "' by %d commit%s.\n"
+                   "  (use \"git push\" to publish your local commits)\n",
+                   tracking->upstream, ahead, ahead == 1 ? "" : "s");
+        else if (behind)
+            printf("Your branch is behind '" COLOR_CYAN("%s") "' by %d commit%s, and can be fast-forwarded.\n"
+                   "  (use \"git pull\" to update your local branch)\n",
+                   tracking->upstream, behind, behind == 1 ? "" : "s");
+        else
+            printf("Your branch is up to date with '" COLOR_CYAN("%s") "'.\n", tracking->upstream);
+        break;
+    }
+}
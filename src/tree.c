@@ -0,0 +1,88 @@
+#include "tree.h"
+#include <string.h>
+
+#include "index.h"
+
+git_tree_iter_t tree_iter_init(const git_object_t *tree)
+{
+    git_tree_iter_t it = {
+        .cursor = tree ? tree->data : NULL,
+        .end = tree ? tree->data + tree->size : NULL,
+    };
+    return it;
+}
+
+bool tree_iter_next(git_tree_iter_t *it, git_tree_entry_t *entry)
+{
+    if (!it->cursor || it->cursor >= it->end)
+        return false;
+    
+    unsigned int mode = 0;
+    const char *p = it->cursor;
+    while (p < it->end && *p >= '0' && *p <= '7')
+        mode = (mode << 3) | (unsigned int)(*p++ - '0');
+    if (p >= it->end || *p++ != ' ')
+        return false;
+    
+    const char *name = p;
+    const char *nul = memchr(p, '\0', (size_t)(it->end - p));
+    if (!nul || it->end - nul - 1 < GIT_OID_RAWSZ)
+        return false;
+    
+    entry->name = name;
+    entry->name_len = (size_t)(nul - name);
+    entry->mode = mode;
+    entry->oid = (const git_oid_t *)(nul + 1);
+    it->cursor = nul + 1 + GIT_OID_RAWSZ;
+    return true;
+}
+
+bool tree_entry_is_dir(const git_tree_entry_t *entry)
+{
+    return entry->mode == GIT_MODE_DIR;
+}
+
+int tree_entry_cmp(const git_tree_entry_t *a, const git_tree_entry_t *b)
+{
+    size_t min_len = a->name_len < b->name_len ? a->name_len : b->name_len;
+    int cmp = memcmp(a->name, b->name, min_len);
+    if (cmp)
+        return cmp;
+    
+    // Trees sort as if their name ended with a slash
+    unsigned char ca = a->name_len > min_len ? (unsigned char)a->name[min_len]
+                                             : (tree_entry_is_dir(a) ? '/' : '\0');
+    unsigned char cb = b->name_len > min_len ? (unsigned char)b->name[min_len]
+                                             : (tree_entry_is_dir(b) ? '/' : '\0');
+    return (int)ca - (int)cb;
+}
+
+bool tree_lookup_path(const git_odb_t *odb, const git_oid_t *tree_oid, const char *path,
+                      git_tree_entry_t *entry)
+{
+    const git_object_t *tree = odb_read(odb, tree_oid);
+    
+    while (tree && tree->type == OBJ_TREE) {
+        const char *slash = strchr(path, '/');
+        size_t len = slash ? (size_t)(slash - path) : strlen(path);
+        git_tree_iter_t it = tree_iter_init(tree);
+        bool found = false;
+        
+        while (tree_iter_next(&it, entry)) {
+            if (entry->name_len == len && memcmp(entry->name, path, len) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+        if (!slash)
+            return true;
+        if (!tree_entry_is_dir(entry))
+            return false;
+        
+        tree = odb_read(odb, entry->oid);
+        path = slash + 1;
+    }
+    return false;
+}
@@ -0,0 +1,179 @@
+#include "tree_diff.h"
+#include <string.h>
+
+#include "strbuf.h"
+#include "tree.h"
+
+git_diff_list_t diff_list_init(arena_t *arena)
+{
+    git_diff_list_t list = {
+        .arena = arena,
+        .entries = NULL,
+        .count = 0,
+        .alloc = 0,
+    };
+    return list;
+}
+
+bool pathspec_matches(const git_pathspec_t *pathspec, const char *path, size_t len, bool is_dir)
+{
+    if (!pathspec || pathspec->count == 0)
+        return true;
+    
+    for (size_t i = 0; i < pathspec->count; i++) {
+        const char *spec = pathspec->paths[i];
+        size_t spec_len = strlen(spec);
+        
+        if (len >= spec_len && memcmp(path, spec, spec_len) == 0 && (len == spec_len || path[spec_len] == '/'))
+            return true;
+        if (is_dir && spec_len > len && memcmp(path, spec, len) == 0 && spec[len] == '/')
+            return true;
+    }
+    return false;
+}
+
+static void diff_list_push(git_diff_list_t *list, git_diff_status_t status, const strbuf_t *prefix,
+                           const git_tree_entry_t *old_entry, const git_tree_entry_t *new_entry)
+{
+    if (list->count == list->alloc) {
+        size_t new_alloc = list->alloc ? list->alloc * 2 : 32;
+        list->entries = arena_realloc(list->arena, list->entries, list->alloc * sizeof(*list->entries),
+                                      new_alloc * sizeof(*list->entries));
+        list->alloc = new_alloc;
+    }
+    
+    const git_tree_entry_t *named = new_entry ? new_entry : old_entry;
+    git_diff_entry_t *entry = &list->entries[list->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->status = status;
+    entry->path = arena_sprintf(list->arena, "%s%.*s", prefix->buf, (int)named->name_len, named->name);
+    entry->old_path = entry->path;
+    if (old_entry) {
+        entry->old_oid = *old_entry->oid;
+        entry->old_mode = old_entry->mode;
+    }
+    if (new_entry) {
+        entry->new_oid = *new_entry->oid;
+        entry->new_mode = new_entry->mode;
+    }
+}
+
+typedef struct {
+    const git_odb_t *odb;
+    const git_pathspec_t *pathspec;
+    strbuf_t prefix;
+    git_diff_list_t *out;
+} tree_diff_t;
+
+static int diff_trees(tree_diff_t *td, const git_object_t *old_tree, const git_object_t *new_tree);
+
+static int diff_subtrees(tree_diff_t *td, const git_tree_entry_t *old_entry, const git_tree_entry_t *new_entry)
+{
+    const git_odb_t *odb = td->odb;
+    strbuf_t *prefix = &td->prefix;
+    const git_object_t *old_tree = old_entry ? odb_read(odb, old_entry->oid) : NULL;
+    const git_object_t *new_tree = new_entry ? odb_read(odb, new_entry->oid) : NULL;
+    const git_tree_entry_t *named = new_entry ? new_entry : old_entry;
+    size_t prefix_len = prefix->len;
+    
+    if ((old_entry && !old_tree) || (new_entry && !new_tree))
+        return -1;
+    
+    strbuf_add(prefix, named->name, named->name_len);
+    strbuf_addch(prefix, '/');
+    int result = diff_trees(td, old_tree, new_tree);
+    prefix->len = prefix_len;
+    prefix->buf[prefix_len] = '\0';
+    return result;
+}
+
+static int emit_one_side(tree_diff_t *td, git_diff_status_t status, const git_tree_entry_t *entry)
+{
+    bool deleted = status == DIFF_DELETED;
+    
+    if (tree_entry_is_dir(entry))
+        return diff_subtrees(td, deleted ? entry : NULL, deleted ? NULL : entry);
+    
+    diff_list_push(td->out, status, &td->prefix, deleted ? entry : NULL, deleted ? NULL : entry);
+    return 0;
+}
+
+static bool entry_in_pathspec(tree_diff_t *td, const git_tree_entry_t *entry)
+{
+    strbuf_t *prefix = &td->prefix;
+    size_t prefix_len = prefix->len;
+    
+    if (!td->pathspec)
+        return true;
+    
+    strbuf_add(prefix, entry->name, entry->name_len);
+    bool matches = pathspec_matches(td->pathspec, prefix->buf, prefix->len, tree_entry_is_dir(entry));
+    prefix->len = prefix_len;
+    prefix->buf[prefix_len] = '\0';
+    return matches;
+}
+
+static int diff_trees(tree_diff_t *td, const git_object_t *old_tree, const git_object_t *new_tree)
+{
+    git_tree_iter_t old_it = tree_iter_init(old_tree);
+    git_tree_iter_t new_it = tree_iter_init(new_tree);
+    git_tree_entry_t old_entry, new_entry;
+    bool has_old = tree_iter_next(&old_it, &old_entry);
+    bool has_new = tree_iter_next(&new_it, &new_entry);
+    int result = 0;
+    
+    while ((has_old || has_new) && result == 0) {
+        int cmp = !has_old ? 1 : !has_new ? -1 : tree_entry_cmp(&old_entry, &new_entry);
+        
+        if (cmp < 0) {
+            if (entry_in_pathspec(td, &old_entry))
+                result = emit_one_side(td, DIFF_DELETED, &old_entry);
+            has_old = tree_iter_next(&old_it, &old_entry);
+            continue;
+        }
+        if (cmp > 0) {
+            if (entry_in_pathspec(td, &new_entry))
+                result = emit_one_side(td, DIFF_ADDED, &new_entry);
+            has_new = tree_iter_next(&new_it, &new_entry);
+            continue;
+        }
+        
+        // Identical names sort equal only when both are trees or both blobs
+        if ((oid_cmp(old_entry.oid, new_entry.oid) != 0 || old_entry.mode != new_entry.mode) &&
+            entry_in_pathspec(td, &old_entry)) {
+            if (tree_entry_is_dir(&old_entry))
+                result = diff_subtrees(td, &old_entry, &new_entry);
+            else
+                diff_list_push(td->out, DIFF_MODIFIED, &td->prefix, &old_entry, &new_entry);
+        }
+        has_old = tree_iter_next(&old_it, &old_entry);
+        has_new = tree_iter_next(&new_it, &new_entry);
+    }
+    return result;
+}
+
+int tree_diff(const git_odb_t *odb, const git_oid_t *old_tree, const git_oid_t *new_tree,
+              git_diff_list_t *out)
+{
+    return tree_diff_limited(odb, old_tree, new_tree, NULL, out);
+}
+
+int tree_diff_limited(const git_odb_t *odb, const git_oid_t *old_tree, const git_oid_t *new_tree,
+                      const git_pathspec_t *pathspec, git_diff_list_t *out)
+{
+    if (old_tree && new_tree && oid_cmp(old_tree, new_tree) == 0)
+        return 0;
+    
+    const git_object_t *old_obj = old_tree ? odb_read(odb, old_tree) : NULL;
+    const git_object_t *new_obj = new_tree ? odb_read(odb, new_tree) : NULL;
+    if ((old_tree && !old_obj) || (new_tree && !new_obj))
+        return -1;
+    
+    tree_diff_t td = {
+        .odb = odb,
+        .pathspec = pathspec && pathspec->count > 0 ? pathspec : NULL,
+        .prefix = strbuf_init(out->arena, 256),
+        .out = out,
+    };
+    return diff_trees(&td, old_obj, new_obj);
+}